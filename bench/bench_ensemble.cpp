@@ -0,0 +1,86 @@
+// K個のレプリカを1つのEnsembleSimulation2Dで実行した場合と、K回Simulation2D<FlatSEO>を実行した場合の比較(秒)
+//   single        : 同じシードでSimulation2D<FlatSEO>をK回実行した合計
+//   ensemble/<level>: K個のレプリカを1回で実行(レプリカ用カーネルの命令セットごと)
+// どちらも自励振動する格子(市松模様のバイアス)を出力無しで実行し、トンネル回数の合計が同じことも確かめる
+// 使い方: EnsembleBench [格子の1辺(デフォルト64)] [レプリカ数(デフォルト8)] [終了時刻(デフォルト20)] [繰り返し回数(デフォルト3)]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "ensemble_simulation_2d.hpp"
+#include "lattice_builder.hpp"
+#include "simulation_2d.hpp"
+
+namespace
+{
+    // fを繰り返し実行し、最も速かった回の時間[s]を返す
+    template <typename F>
+    double bestSeconds(int repeats, F &&f)
+    {
+        double best = 1e300;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    // 自励振動する格子(素子ごとに異なる初期電荷)
+    Grid2D<FlatSEO> makeGrid(int n)
+    {
+        LatticeBuilder builder(n, n);
+        builder.setParams({0.5, 0.002, 10.0, 2.0, 0.006}).setCheckerboardBias().setOutputEnabled(false);
+        Grid2D<FlatSEO> grid = builder.buildFlatGrid();
+        for (int i = 0; i < n * n; ++i)
+            grid.getElement(i / n, i % n)->setQ(0.01 * (i % 7) - 0.03);
+        return grid;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int n = (argc > 1) ? std::atoi(argv[1]) : 64;
+    const int K = (argc > 2) ? std::atoi(argv[2]) : 8;
+    const double endtime = (argc > 3) ? std::atof(argv[3]) : 20.0;
+    const int repeats = (argc > 4) ? std::atoi(argv[4]) : 3;
+    const std::uint64_t seed = 2024;
+    const Grid2D<FlatSEO> grid = makeGrid(n);
+
+    long long singleTunnels = 0;
+    const double single = bestSeconds(repeats, [&] {
+        singleTunnels = 0;
+        for (int r = 0; r < K; ++r)
+        {
+            Simulation2D<FlatSEO> sim(0.1, endtime);
+            sim.setSeed(deriveSeed(seed, static_cast<std::uint64_t>(r)));
+            sim.appendGrid(Grid2D<FlatSEO>(grid));
+            sim.run();
+            singleTunnels += sim.getTunnelCount();
+        }
+    });
+    std::cout << "single          " << single << " s (" << K << " runs, " << singleTunnels << " tunnels)"
+              << std::endl;
+
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        if (!isSimdLevelSupported(level))
+            continue;
+        long long ensembleTunnels = 0;
+        const double ensemble = bestSeconds(repeats, [&] {
+            EnsembleSimulation2D sim(0.1, endtime, K);
+            sim.setGrid(grid);
+            sim.setSeed(seed);
+            sim.setSimdLevel(level);
+            sim.run();
+            ensembleTunnels = 0;
+            for (int r = 0; r < K; ++r)
+                ensembleTunnels += sim.getTunnelCount(r);
+        });
+        std::cout << "ensemble/" << simdLevelName(level) << (level == SimdLevel::Scalar ? " " : "   ") << ensemble
+                  << " s (x" << single / ensemble << ")"
+                  << (ensembleTunnels == singleTunnels ? "" : "  tunnel count differs!") << std::endl;
+    }
+    return 0;
+}
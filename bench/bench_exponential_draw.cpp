@@ -0,0 +1,74 @@
+// 指数分布の乱数 -log(u) を引くコストの比較(1サンプルあたりのns)
+//   std::log    : 以前の std::log(1/philoxUniform) のループ
+//   variate     : exponentialVariate(1素子版。SEO・インクリメンタル更新・イベント駆動が使う)
+//   draw/<level>: exponentialDraw カーネル(gridminwtが使う)
+// 使い方: ExponentialDrawBench [素子数(デフォルト1000000)] [繰り返し回数(デフォルト20)]
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "philox.hpp"
+#include "seo_kernels.hpp"
+
+namespace
+{
+    // fを繰り返し実行し、最も速かった回の1サンプルあたりの時間[ns]を返す
+    template <typename F>
+    double bestNanosPerSample(int repeats, int samples, F &&f)
+    {
+        double best = 1e300;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count() / samples);
+        }
+        return best;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int n = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    const int repeats = (argc > 2) ? std::atoi(argv[2]) : 20;
+    const std::uint64_t seed = 12345;
+    // 全素子がトンネルしうる(dEが正)場合
+    std::vector<double> dE(2 * static_cast<std::size_t>(n), 0.0);
+    for (int i = 0; i < n; ++i)
+        dE[2 * i] = 1.0;
+    std::vector<double> expo(n);
+    std::vector<std::uint64_t> counter(n, 0);
+    double sink = 0.0;
+
+    const double stdlog = bestNanosPerSample(repeats, n, [&] {
+        for (int i = 0; i < n; ++i)
+            expo[i] = std::log(1 / philoxUniform(seed, static_cast<std::uint64_t>(i), counter[i]++));
+        sink += expo[n / 2];
+    });
+    std::cout << "std::log      " << stdlog << " ns/sample" << std::endl;
+
+    const double variate = bestNanosPerSample(repeats, n, [&] {
+        for (int i = 0; i < n; ++i)
+            expo[i] = exponentialVariate(seed, static_cast<std::uint64_t>(i), counter[i]++);
+        sink += expo[n / 2];
+    });
+    std::cout << "variate       " << variate << " ns/sample" << std::endl;
+
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        if (!isSimdLevelSupported(level))
+            continue;
+        const SEOKernelTable &k = seoKernels(level);
+        const double draw = bestNanosPerSample(repeats, n, [&] {
+            k.exponentialDraw(dE.data(), seed, 0, counter.data(), expo.data(), 0, n);
+            sink += expo[n / 2];
+        });
+        std::cout << "draw/" << simdLevelName(level) << (level == SimdLevel::Scalar ? " " : "   ") << draw
+                  << " ns/sample" << std::endl;
+    }
+    // 最適化で計算が消えないように使う
+    return (sink == 0.123) ? 1 : 0;
+}
@@ -0,0 +1,373 @@
+#ifndef APPROX_DOMAIN_SIMULATION_2D_HPP
+#define APPROX_DOMAIN_SIMULATION_2D_HPP
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "simulation_2d.hpp"
+#include "flat_seo_grid.hpp"
+#include "philox.hpp"
+
+// 領域分割による近似の並列シミュレーション(Grid2D<BasicFlatSEO<Topology>>用)
+// gridを行方向の帯(領域)に分け、領域ごとに独立したgridとして緩和・dE・最小wt・トンネル・充電を進める。
+// 全体で1ステップ1回しかトンネルしない通常のエンジンと違い、離れた領域のイベントが同時に進むので、
+// 大きな格子では領域数(スレッド数)に応じて速くなる。
+//
+// 同期は時間窓(syncInterval)ごと:
+// 窓の初めに隣の領域のVn(のり代)を境界の素子の外部電圧として渡し、窓の間はのり代を固定して各領域を窓の終わりまで進める。
+// 窓の終わりに各領域のQ・Vnをgridへ書き戻す。
+//
+// 近似であること: トンネルは隣の素子の電圧を即座に変えるので先読みできる時間が無く、保守的な同期(因果律を守る窓)は作れない。
+// 境界の素子は最大で1窓分古いのり代を見て進むので、結果は領域数とsyncIntervalによって変わる
+// (のり代の行で起きたトンネルの回数(getHaloTunnelCount)が、影響が遅れて伝わったイベントの数になる)。
+// 窓は出力・トリガの切り替わり・終了時刻をまたがない
+//
+// 乱数は領域ごとの乱数列(deriveSeed(gridのシード, 領域番号))から引くので、
+// 同じシード・同じ領域数・同じsyncIntervalならスレッド数によらず同じ経過になる
+template <typename Element>
+class ApproxDomainSimulation2D : public Simulation2D<Element>
+{
+private:
+    using Topology = typename Grid2D<Element>::topology_type;
+
+    // 1つの領域(gridのfirstRow行目からの帯)
+    struct Domain
+    {
+        Grid2D<Element> grid;  // 領域の素子だけを持つgrid(のり代は外部電圧として持つ)
+        int gridIndex;         // grids内の番号
+        int firstRow;          // 元のgridでの最初の行
+        long long tunnels = 0; // 直前の窓でのトンネル回数
+        long long iterations = 0; // 直前の窓での緩和の反復回数
+        long long haloTunnels = 0; // 直前の窓で、隣の領域ののり代になる行で起きたトンネル回数
+
+        Domain(int rows, int cols, int g, int first) : grid(rows, cols, false), gridIndex(g), firstRow(first) {}
+    };
+
+    // 1つのgridの分け方
+    int domainCount;
+    // 同期の間隔
+    double syncInterval;
+    // gridごと・領域ごとの状態(最初のステップで作る)
+    std::vector<std::vector<Domain>> domains;
+    // 窓の統計
+    long long windowCount;      // 進めた窓の数
+    long long windowTunnelMax;  // 1つの窓でのトンネル回数の最大
+    long long haloTunnelCount;  // のり代になる行で起きたトンネルの回数
+
+    // 登録されたgridのうち、まだ分けていないものを領域に分ける
+    void buildDomains();
+
+    // 領域の乱数列を設定
+    void seedDomain(Domain &domain, int d);
+
+    // gridの状態とのり代を領域に渡す
+    void scatter(Domain &domain);
+
+    // 領域をuntilまで進める
+    void advance(Domain &domain, double until);
+
+    // 領域の状態をgridへ書き戻す
+    void gather(Domain &domain);
+
+public:
+    // コンストラクタ(刻み時間,シミュレーションの終了タイミング,1つのgridの領域数)
+    ApproxDomainSimulation2D(double dT, double EndTime, int DomainCount = 4);
+
+    // シミュレーションの1ステップ(全領域を1つの同期の窓だけ進める)
+    void runStep() override;
+
+    // 実行のシードを設定(領域の乱数列もここから作る)
+    void setSeed(std::uint64_t runSeed) override;
+
+    // 1つのgridの領域数を設定(1以上。行数より多ければ行数まで。最初のステップより前に設定する)
+    void setDomainCount(int count);
+
+    // 1つのgridの領域数を取得
+    int getDomainCount() const;
+
+    // 同期の間隔を設定(正の値。デフォルトはdt)
+    void setSyncInterval(double interval);
+
+    // 同期の間隔を取得
+    double getSyncInterval() const;
+
+    // 進めた窓の数を取得
+    long long getWindowCount() const;
+
+    // 1つの窓でのトンネル回数の最大を取得
+    long long getMaxTunnelsPerWindow() const;
+
+    // 隣の領域ののり代になる行(領域の最初と最後の行)で起きたトンネルの回数を取得
+    // 隣の領域には窓の終わりまで伝わらないので、近似でずれたイベントの数の目安になる
+    long long getHaloTunnelCount() const;
+};
+
+// コンストラクタ
+template <typename Element>
+ApproxDomainSimulation2D<Element>::ApproxDomainSimulation2D(double dT, double EndTime, int DomainCount)
+    : Simulation2D<Element>(dT, EndTime), domainCount(1), syncInterval(dT), windowCount(0), windowTunnelMax(0),
+      haloTunnelCount(0)
+{
+    setDomainCount(DomainCount);
+}
+
+// まだ分けていないgridを領域に分ける
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::buildDomains()
+{
+    for (std::size_t g = domains.size(); g < this->grids.size(); ++g)
+    {
+        const auto &grid = this->grids[g];
+        if (grid.isIncrementalUpdate())
+        {
+            throw std::logic_error("Domain decomposition does not support incremental update");
+        }
+        const int rows = grid.numRows(), cols = grid.numCols();
+        const int count = std::min(domainCount, rows);
+        std::vector<Domain> parts;
+        parts.reserve(count);
+        for (int d = 0; d < count; ++d)
+        {
+            const int first = d * rows / count, last = (d + 1) * rows / count;
+            parts.emplace_back(last - first, cols, static_cast<int>(g), first);
+            Domain &domain = parts.back();
+            domain.grid.setSimdLevel(grid.getSimdLevel());
+            for (int r = first; r < last; ++r)
+            {
+                for (int c = 0; c < cols; ++c)
+                {
+                    auto src = grid.getElement(r, c);
+                    domain.grid.getElement(r - first, c)->setUp(src->getR(), src->getRj(), src->getCj(), src->getC(),
+                                                                 src->getVd(), src->getlegs());
+                }
+            }
+            if (grid.isParameterClasses())
+                domain.grid.setParameterClasses(true);
+            seedDomain(domain, d);
+        }
+        domains.push_back(std::move(parts));
+    }
+}
+
+// 領域の乱数列を設定(シード未設定なら実行ごとに異なる)
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::seedDomain(Domain &domain, int d)
+{
+    const std::uint64_t gridSeed = this->seeded ? deriveSeed(this->seed, domain.gridIndex) : nondeterministicSeed();
+    domain.grid.seedRandom(deriveSeed(gridSeed, d));
+}
+
+// gridの状態とのり代を領域に渡す
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::scatter(Domain &domain)
+{
+    const auto &grid = this->grids[domain.gridIndex];
+    const int rows = grid.numRows(), cols = grid.numCols();
+    const int first = domain.firstRow, last = first + domain.grid.numRows();
+    for (int r = first; r < last; ++r)
+    {
+        for (int c = 0; c < cols; ++c)
+        {
+            auto src = grid.getElement(r, c);
+            auto dst = domain.grid.getElement(r - first, c);
+            dst->setQ(src->getQ());
+            dst->setVn(src->getVn());
+            // 領域の外の隣接素子のVn(のり代)は外部電圧に含める(隣接は1行隣まで)
+            double halo = 0.0;
+            if (r == first || r == last - 1)
+            {
+                for (const NeighbourOffset &o : Topology::offsets)
+                {
+                    const int nr = r + o.dr, nc = c + o.dc;
+                    if ((nr < first || nr >= last) && nr >= 0 && nr < rows && nc >= 0 && nc < cols)
+                        halo += grid.getElement(nr, nc)->getVn();
+                }
+            }
+            dst->setExternalVoltage(src->getExternalVoltage() + halo);
+        }
+    }
+}
+
+// 領域をuntilまで進める(1ステップの中身は通常のエンジンと同じ)
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::advance(Domain &domain, double until)
+{
+    auto &grid = domain.grid;
+    domain.tunnels = 0;
+    domain.iterations = 0;
+    domain.haloTunnels = 0;
+    const int rows = grid.numRows(), cols = grid.numCols();
+    const bool upperHalo = domain.firstRow > 0;
+    const bool lowerHalo = domain.firstRow + rows < this->grids[domain.gridIndex].numRows();
+    double time = this->t;
+    while (time < until)
+    {
+        const double remaining = until - time;
+        double steptime = std::min(this->dt, remaining);
+        domain.iterations += grid.relax(this->relaxation).iterations;
+        grid.updateGriddE();
+        if (grid.gridminwt(steptime))
+        {
+            steptime = grid.getMinWT();
+            grid.applyTunnel(grid.getTunnelIndex(), grid.getTunnelDirection());
+            ++domain.tunnels;
+            const int row = grid.getTunnelIndex() / cols;
+            if ((row == 0 && upperHalo) || (row == rows - 1 && lowerHalo))
+                ++domain.haloTunnels;
+        }
+        else if (this->chargeIntegrator == ChargeIntegrator::ExponentialJump)
+        {
+            // トンネルしうる素子が無い間は窓の終わりまでまとめて進める
+            // (Simulation2D::quietStepTimeと同じく、V_sumのずれがjumpToleranceを超える前に止める)
+            const double next = std::min(grid.nextThresholdTime(), grid.vsumDriftTime(this->jumpTolerance));
+            steptime = std::min(remaining, std::max(steptime, next));
+        }
+        if (this->chargeIntegrator == ChargeIntegrator::Euler)
+            grid.updateGridQn(steptime);
+        else
+            grid.updateGridQnExponential(steptime);
+        // 残りを全て進めたら丸め誤差によらず窓の終わりに揃える
+        time = (steptime >= remaining) ? until : time + steptime;
+    }
+}
+
+// 領域の状態をgridへ書き戻す
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::gather(Domain &domain)
+{
+    auto &grid = this->grids[domain.gridIndex];
+    const int first = domain.firstRow;
+    for (int r = 0; r < domain.grid.numRows(); ++r)
+    {
+        for (int c = 0; c < grid.numCols(); ++c)
+        {
+            auto src = domain.grid.getElement(r, c);
+            auto dst = grid.getElement(first + r, c);
+            dst->setQ(src->getQ());
+            dst->setVn(src->getVn());
+        }
+    }
+}
+
+// シミュレーションの1ステップ(1つの同期の窓)を実行
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::runStep()
+{
+    // oyl-video形式に出力
+    this->outputTooyl();
+
+    buildDomains();
+    // トリガはgridの外部電圧に入れ、scatterで領域に渡す
+    this->applyVoltageTriggers();
+
+    const double until = this->t + std::min(syncInterval, this->timeToNextBoundary());
+
+    std::vector<Domain *> all;
+    for (auto &parts : domains)
+        for (auto &domain : parts)
+            all.push_back(&domain);
+
+    // 窓の間は領域どうしで読み書きが重ならない(のり代はgrid側から読むだけ)
+    const int n = static_cast<int>(all.size());
+    parallelChunks(this->threadPool.get(), 0, n, [&](int, int first, int last) {
+        for (int k = first; k < last; ++k)
+        {
+            scatter(*all[k]);
+            advance(*all[k], until);
+        }
+    });
+    // 全領域が進み終わってからgridへ書き戻す(scatterがgridのVnを読み終わっているように)
+    parallelChunks(this->threadPool.get(), 0, n, [&](int, int first, int last) {
+        for (int k = first; k < last; ++k)
+            gather(*all[k]);
+    });
+
+    // 統計は領域の順に足す
+    long long tunnels = 0;
+    for (const Domain *domain : all)
+    {
+        tunnels += domain->tunnels;
+        this->totalRelaxationIterations += domain->iterations;
+        haloTunnelCount += domain->haloTunnels;
+    }
+    this->tunnelCount += tunnels;
+    windowTunnelMax = std::max(windowTunnelMax, tunnels);
+    ++windowCount;
+
+    // tの増加
+    this->t = until;
+}
+
+// 実行のシードを設定
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::setSeed(std::uint64_t runSeed)
+{
+    Simulation2D<Element>::setSeed(runSeed);
+    for (auto &parts : domains)
+        for (std::size_t d = 0; d < parts.size(); ++d)
+            seedDomain(parts[d], static_cast<int>(d));
+}
+
+// 1つのgridの領域数を設定
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::setDomainCount(int count)
+{
+    if (count < 1)
+    {
+        throw std::invalid_argument("Domain count must be at least 1");
+    }
+    if (!domains.empty())
+    {
+        throw std::logic_error("Domain count must be set before the first step");
+    }
+    domainCount = count;
+}
+
+// 1つのgridの領域数を取得
+template <typename Element>
+int ApproxDomainSimulation2D<Element>::getDomainCount() const
+{
+    return domainCount;
+}
+
+// 同期の間隔を設定
+template <typename Element>
+void ApproxDomainSimulation2D<Element>::setSyncInterval(double interval)
+{
+    if (!(interval > 0))
+    {
+        throw std::invalid_argument("Sync interval must be positive");
+    }
+    syncInterval = interval;
+}
+
+// 同期の間隔を取得
+template <typename Element>
+double ApproxDomainSimulation2D<Element>::getSyncInterval() const
+{
+    return syncInterval;
+}
+
+// 進めた窓の数を取得
+template <typename Element>
+long long ApproxDomainSimulation2D<Element>::getWindowCount() const
+{
+    return windowCount;
+}
+
+// 1つの窓でのトンネル回数の最大を取得
+template <typename Element>
+long long ApproxDomainSimulation2D<Element>::getMaxTunnelsPerWindow() const
+{
+    return windowTunnelMax;
+}
+
+// のり代になる行で起きたトンネルの回数を取得
+template <typename Element>
+long long ApproxDomainSimulation2D<Element>::getHaloTunnelCount() const
+{
+    return haloTunnelCount;
+}
+
+#endif // APPROX_DOMAIN_SIMULATION_2D_HPP
@@ -0,0 +1,52 @@
+#ifndef CHARGE_INTEGRATION_HPP
+#define CHARGE_INTEGRATION_HPP
+
+#include <cmath>
+#include <limits>
+#include "seo_class.hpp"
+
+// ノード電荷Qの時間発展の計算方法
+enum class ChargeIntegrator
+{
+    Euler,          // Q += (Vd - Vn)*dt/R(従来の方法。dtを小さくしないと精度が出ない)
+    Exponential,    // 周囲の電圧をステップ内で一定として、RC充電を解析的に解く(刻みはdtのまま)
+    ExponentialJump // Exponentialに加え、dEが正の素子が無い間は次にdEが正になる時刻まで一度に進む
+                    // (周囲の電圧のずれが許容値を超える時刻があればそこで止め、緩和し直して予測し直す)
+};
+
+// 周囲の電圧を一定としたときのRC充電の解析解で、時間dtの間に増える電荷
+// 時定数は R*Ctot で、dtが時定数より十分小さければ(Vd - Vn)*dt/Rと一致する
+inline double exponentialChargeIncrement(double vd, double vn, double r, double ctot, double dt)
+{
+    return (vd - vn) * ctot * -std::expm1(-dt / (r * ctot));
+}
+
+// 周囲の電圧を一定としたとき、s = Q + C*V_sum が ±e/2 を超える(dEが正になる)までの時間
+// sは Ctot*Vd に向かって指数的に近づく。既に超えていれば0、超えないなら+inf
+inline double thresholdCrossingTime(double s, double vd, double r, double ctot)
+{
+    const double half = e / 2;
+    if (s > half || s < -half)
+        return 0.0;
+    const double sInf = ctot * vd;
+    double target;
+    if (sInf > half)
+        target = half;
+    else if (sInf < -half)
+        target = -half;
+    else
+        return std::numeric_limits<double>::infinity();
+    return r * ctot * std::log((s - sInf) / (target - sInf));
+}
+
+// 周囲の電圧を一定としたとき、Vn(Vdに向かって指数的に近づく)の変化がdelta以下に収まる時間
+// 収まり続けるなら+inf。ExponentialJumpで、周囲のV_sumのずれを抑えるために跳ぶ時間を制限するのに使う
+inline double voltageDriftTime(double vn, double vd, double r, double ctot, double delta)
+{
+    const double gap = std::fabs(vd - vn);
+    if (gap <= delta)
+        return std::numeric_limits<double>::infinity();
+    return -r * ctot * std::log1p(-delta / gap);
+}
+
+#endif // CHARGE_INTEGRATION_HPP
@@ -0,0 +1,587 @@
+#ifndef ENSEMBLE_SIMULATION_2D_HPP
+#define ENSEMBLE_SIMULATION_2D_HPP
+
+#include <vector>
+#include <string>
+#include <tuple>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include "seo_class.hpp"
+#include "flat_seo_grid.hpp"
+#include "relaxation.hpp"
+#include "philox.hpp"
+#include "seo_kernels.hpp"
+#include "charge_integration.hpp"
+
+// 同じ格子のK個の複製(レプリカ)を1つの配列に並べ、同じ手順で一斉に進めるエンジン
+// シードやバイアスだけを変えた実行を何十回も繰り返す場合に、K回のMainAppを1つの実行にまとめる
+//
+// 状態は素子ごとにK個のレプリカを続けて並べる(添字は素子*K + レプリカ)。
+// 接続と回路パラメータ(Vd以外)は全レプリカで共通なので、Vn・dE・充電の計算は素子ごとに1回だけ隣接素子をたどり、
+// K個のレプリカをseo_kernelsのレプリカ用カーネル(AVX2なら4個、AVX-512なら8個ずつ)でまとめて計算する。
+// トンネル・時刻・乱数列・出力はレプリカごとに持つ。
+// レプリカrは、同じ格子を1つのSimulation2D<FlatSEO>で実行した場合とビット単位で同じ経過になる
+// (シードはgetReplicaSeed(r)、Jacobi法を反復回数固定で使う場合)
+//
+// 格子は4近傍(Grid2D<FlatSEO>)のみ、緩和はJacobi法のみ、電荷の計算はEuler法かExponentialのみ
+class EnsembleSimulation2D
+{
+public:
+    // 1レプリカの1素子分のビュー（getElementの戻り値）
+    class ElementRef
+    {
+    private:
+        EnsembleSimulation2D *sim;
+        std::size_t lane; // 素子*K + レプリカ
+
+    public:
+        ElementRef(EnsembleSimulation2D *s, std::size_t l) : sim(s), lane(l) {}
+
+        // shared_ptr<SEO>と同じ書き方(->)で使うため
+        ElementRef *operator->() { return this; }
+        const ElementRef *operator->() const { return this; }
+
+        // バイアス電圧を設定(レプリカごとに変えられる)
+        void setVias(double vd) { sim->Vd[lane] = vd; }
+        // 外部から加える電圧を設定
+        void setExternalVoltage(double v) { sim->Vext[lane] = v; }
+        void setVn(double vn) { sim->Vn[lane] = vn; }
+        void setQ(double qn) { sim->Qn[lane] = qn; }
+
+        double getVn() const { return sim->Vn[lane]; }
+        double getQ() const { return sim->Qn[lane]; }
+        double getVd() const { return sim->Vd[lane]; }
+        double getSurroundingVsum() const { return sim->V_sum[lane]; }
+        double getExternalVoltage() const { return sim->Vext[lane]; }
+    };
+
+private:
+    double dt;      // 基本刻み
+    double endtime; // 終了時刻
+    int K;          // レプリカ数
+    int rows_ = 0, cols_ = 0;
+    bool outputEnabled = true;
+    std::string outputlabel;
+
+    //---- 素子ごと(全レプリカで共通) ----//
+    std::vector<double> R, Rj, Cj, C;
+    std::vector<int> legs;
+    std::vector<int> neighbours; // 素子*4 + k: 隣接素子(上・右・下・左の順、格子の外は-1)
+
+    //---- 素子*K + レプリカ ----//
+    std::vector<double> Qn, Vn, VnNext, V_sum, Vext, Vd;
+    std::vector<double> dEUp, dEDown;
+    std::vector<std::uint64_t> rngCounter;
+
+    //---- レプリカごと ----//
+    std::vector<double> t;              // 現在の時刻
+    std::vector<double> nextOutputTime; // 次に出力すべき時刻
+    std::vector<double> steptime;       // このステップで進める時間
+    std::vector<char> live;             // 終了時刻前か(終わったレプリカは状態を変えない)
+    std::vector<std::uint64_t> runSeeds;  // 実行のシード(Simulation2D::setSeedに渡す値に相当)
+    std::vector<std::uint64_t> gridSeeds; // 乱数列のシード(deriveSeed(実行のシード, 0))
+    std::vector<long long> tunnelCount;
+    std::vector<double> minwt;
+    std::vector<int> tunnelIndex;
+    std::vector<TunnelDirection> tunnelDirection;
+    std::vector<double> residual;             // 緩和の作業領域(K個)
+    std::vector<double> frozenVn, frozenVsum; // 終わったレプリカがある間の緩和前のVn・V_sum
+    // oyl-video形式のデータ([レプリカ][timeframe][y][x])
+    std::vector<std::vector<std::vector<std::vector<double>>>> outputs;
+
+    // トリガ(時刻, x, y, V)。全レプリカに同じトリガを加える
+    std::vector<std::tuple<double, int, int, double>> voltageTriggers;
+    // Vnの緩和の設定(Jacobi法のみ)
+    RelaxationConfig relaxation;
+    // 電荷の時間発展の計算方法(EulerかExponential)
+    ChargeIntegrator chargeIntegrator = ChargeIntegrator::Euler;
+    // レプリカ用カーネル(命令セットごとの実装)
+    const SEOKernelTable *kernels = &seoKernels();
+
+    // 格子が設定されているか確かめる
+    void requireGrid() const;
+
+    // 素子iのレプリカrの添字
+    std::size_t lane(int i, int r) const { return static_cast<std::size_t>(i) * K + r; }
+
+    // 出力の時刻になったレプリカのVnを記録する(Simulation2D::outputTooylと同じ形)
+    void outputTooyl();
+
+    // トリガを適用する(レプリカごとの時刻で判定する)
+    void applyVoltageTriggers();
+
+    // 全レプリカのVnをJacobi法で一斉に緩和する
+    void relaxLanes();
+
+    // 全レプリカのdEを計算する
+    void updatedE();
+
+    // レプリカごとに最小wtを探し、トンネルさせて進める時間を決める
+    void tunnelLanes();
+
+    // 全レプリカの電荷をそれぞれの進める時間だけ充電する
+    void chargeLanes();
+
+public:
+    // コンストラクタ(刻み時間,シミュレーションの終了タイミング,レプリカ数)
+    EnsembleSimulation2D(double dT, double EndTime, int Replicas);
+
+    // 全レプリカに同じ格子を設定する(パラメータ・電荷・Vn・外部電圧・出力の設定を写す)
+    void setGrid(const Grid2D<FlatSEO> &grid);
+
+    // 実行のシードを設定(レプリカrはderiveSeed(runSeed, r)を実行のシードにする)
+    void setSeed(std::uint64_t runSeed);
+
+    // レプリカrの実行のシードを設定(Simulation2D::setSeedにrunSeedを渡したのと同じ乱数列になる)
+    void setReplicaSeed(int replica, std::uint64_t runSeed);
+
+    // レプリカrの実行のシードを取得
+    std::uint64_t getReplicaSeed(int replica) const;
+
+    // レプリカrの素子のビューを取得
+    ElementRef getElement(int replica, int row, int col);
+
+    // トリガーを追加する(全レプリカに加える)
+    void addVoltageTrigger(double triggerTime, int x, int y, double voltage);
+
+    // Vnの緩和方法を設定(Jacobi法のみ。許容誤差を使う場合は、全レプリカが収束するまで反復する)
+    void setRelaxation(const RelaxationConfig &config);
+
+    // 電荷の時間発展の計算方法を設定(EulerかExponential)
+    void setChargeIntegrator(ChargeIntegrator integrator);
+
+    // レプリカ用カーネルの命令セットを設定(CPUが対応していなければ例外)
+    // どの命令セットでも結果はビット単位で同じ
+    void setSimdLevel(SimdLevel level);
+
+    // レプリカ用カーネルの命令セットを取得
+    SimdLevel getSimdLevel() const;
+
+    // シミュレーションの1ステップ(終了時刻前の全レプリカを1ステップずつ進める)
+    void runStep();
+
+    // 全レプリカが終了時刻になるまで実行する
+    void run();
+
+    // レプリカ数を取得
+    int numReplicas() const;
+
+    // 行数を取得
+    int numRows() const;
+
+    // 列数を取得
+    int numCols() const;
+
+    // レプリカrの現在の時刻を取得
+    double getTime(int replica) const;
+
+    // レプリカrのトンネル回数を取得
+    long long getTunnelCount(int replica) const;
+
+    // レプリカrの出力([timeframe][y][x]、Simulation2D::getOutputsの1ラベル分と同じ形)を取得
+    const std::vector<std::vector<std::vector<double>>> &getOutputs(int replica) const;
+
+    // 出力のラベルを取得(setGridで渡したgridのラベル)
+    std::string getOutputLabel() const;
+};
+
+// コンストラクタ
+inline EnsembleSimulation2D::EnsembleSimulation2D(double dT, double EndTime, int Replicas)
+    : dt(dT), endtime(EndTime), K(Replicas)
+{
+    if (Replicas < 1)
+    {
+        throw std::invalid_argument("Ensemble needs at least one replica");
+    }
+    t.assign(K, 0.0);
+    nextOutputTime.assign(K, 0.0);
+    steptime.assign(K, 0.0);
+    live.assign(K, 0);
+    tunnelCount.assign(K, 0);
+    minwt.assign(K, 0.0);
+    tunnelIndex.assign(K, -1);
+    tunnelDirection.assign(K, TunnelDirection::Up);
+    residual.assign(K, 0.0);
+    outputs.resize(K);
+    runSeeds.resize(K);
+    gridSeeds.resize(K);
+    for (int r = 0; r < K; ++r)
+        setReplicaSeed(r, nondeterministicSeed());
+}
+
+// 全レプリカに同じ格子を設定する
+inline void EnsembleSimulation2D::setGrid(const Grid2D<FlatSEO> &grid)
+{
+    rows_ = grid.numRows();
+    cols_ = grid.numCols();
+    outputEnabled = grid.isOutputEnabled();
+    outputlabel = grid.getOutputLabel();
+    const int n = rows_ * cols_;
+    for (auto *field : {&R, &Rj, &Cj, &C})
+        field->assign(n, 0.0);
+    legs.assign(n, 0);
+    neighbours.assign(static_cast<std::size_t>(n) * VonNeumann4::legs, -1);
+    const std::size_t lanes = static_cast<std::size_t>(n) * K;
+    for (auto *field : {&Qn, &Vn, &VnNext, &V_sum, &Vext, &Vd, &dEUp, &dEDown})
+        field->assign(lanes, 0.0);
+    rngCounter.assign(lanes, 0);
+    for (int i = 0; i < n; ++i)
+    {
+        const int row = i / cols_, col = i % cols_;
+        const auto elem = grid.getElement(row, col);
+        R[i] = elem->getR();
+        Rj[i] = elem->getRj();
+        Cj[i] = elem->getCj();
+        C[i] = elem->getC();
+        legs[i] = elem->getlegs();
+        int *cell = &neighbours[static_cast<std::size_t>(i) * VonNeumann4::legs];
+        for (int k = 0; k < VonNeumann4::legs; ++k)
+        {
+            const int nr = row + VonNeumann4::offsets[k].dr, nc = col + VonNeumann4::offsets[k].dc;
+            cell[k] = (nr >= 0 && nr < rows_ && nc >= 0 && nc < cols_) ? nr * cols_ + nc : -1;
+        }
+        for (int r = 0; r < K; ++r)
+        {
+            Qn[lane(i, r)] = elem->getQ();
+            Vn[lane(i, r)] = elem->getVn();
+            V_sum[lane(i, r)] = elem->getSurroundingVsum();
+            Vext[lane(i, r)] = elem->getExternalVoltage();
+            Vd[lane(i, r)] = elem->getVd();
+        }
+    }
+}
+
+// 実行のシードを設定
+inline void EnsembleSimulation2D::setSeed(std::uint64_t runSeed)
+{
+    for (int r = 0; r < K; ++r)
+        setReplicaSeed(r, deriveSeed(runSeed, static_cast<std::uint64_t>(r)));
+}
+
+// レプリカrの実行のシードを設定(Simulation2Dは0番目のgridにderiveSeed(シード, 0)を使う)
+inline void EnsembleSimulation2D::setReplicaSeed(int replica, std::uint64_t runSeed)
+{
+    runSeeds.at(replica) = runSeed;
+    gridSeeds[replica] = deriveSeed(runSeed, 0);
+    for (std::size_t i = replica; i < rngCounter.size(); i += K)
+        rngCounter[i] = 0;
+}
+
+// レプリカrの実行のシードを取得
+inline std::uint64_t EnsembleSimulation2D::getReplicaSeed(int replica) const
+{
+    return runSeeds.at(replica);
+}
+
+// レプリカrの素子のビューを取得
+inline EnsembleSimulation2D::ElementRef EnsembleSimulation2D::getElement(int replica, int row, int col)
+{
+    requireGrid();
+    if (replica < 0 || replica >= K || row < 0 || row >= rows_ || col < 0 || col >= cols_)
+    {
+        throw std::out_of_range("EnsembleSimulation2D::getElement index out of range");
+    }
+    return ElementRef(this, lane(row * cols_ + col, replica));
+}
+
+// トリガーを追加する
+inline void EnsembleSimulation2D::addVoltageTrigger(double triggerTime, int x, int y, double voltage)
+{
+    voltageTriggers.emplace_back(triggerTime, x, y, voltage);
+}
+
+// Vnの緩和方法を設定
+inline void EnsembleSimulation2D::setRelaxation(const RelaxationConfig &config)
+{
+    validateRelaxationConfig(config);
+    if (config.method != RelaxationMethod::Jacobi)
+    {
+        throw std::invalid_argument("Ensemble simulation supports only Jacobi relaxation");
+    }
+    relaxation = config;
+}
+
+// 電荷の時間発展の計算方法を設定
+inline void EnsembleSimulation2D::setChargeIntegrator(ChargeIntegrator integrator)
+{
+    if (integrator == ChargeIntegrator::ExponentialJump)
+    {
+        throw std::invalid_argument("Ensemble simulation does not support ExponentialJump");
+    }
+    chargeIntegrator = integrator;
+}
+
+// レプリカ用カーネルの命令セットを設定
+inline void EnsembleSimulation2D::setSimdLevel(SimdLevel level)
+{
+    kernels = &seoKernels(level);
+}
+
+// レプリカ用カーネルの命令セットを取得
+inline SimdLevel EnsembleSimulation2D::getSimdLevel() const
+{
+    return kernels->level;
+}
+
+// 格子が設定されているか確かめる
+inline void EnsembleSimulation2D::requireGrid() const
+{
+    if (rows_ == 0)
+    {
+        throw std::logic_error("Ensemble grid has not been set");
+    }
+}
+
+// 出力の時刻になったレプリカのVnを記録する(出力間隔はdt)
+inline void EnsembleSimulation2D::outputTooyl()
+{
+    if (!outputEnabled || rows_ < 2 || cols_ < 2)
+        return;
+    for (int r = 0; r < K; ++r)
+    {
+        if (!live[r] || t[r] < nextOutputTime[r])
+            continue;
+        const int timeframe = static_cast<int>(std::round(nextOutputTime[r] / dt));
+        std::vector<std::vector<double>> vnGrid(rows_ - 2, std::vector<double>(cols_ - 2));
+        for (int i = 1; i < rows_ - 1; ++i)
+        {
+            for (int j = 1; j < cols_ - 1; ++j)
+            {
+                const std::size_t k = lane(i * cols_ + j, r);
+                // Vdが負のとき、Vnを反転して記録
+                vnGrid[i - 1][j - 1] = (Vd[k] < 0) ? -Vn[k] : Vn[k];
+            }
+        }
+        outputs[r].resize(timeframe + 1);
+        outputs[r][timeframe] = vnGrid;
+        nextOutputTime[r] += dt;
+    }
+}
+
+// トリガを適用する(同じ素子の複数のトリガは足し合わせる)
+inline void EnsembleSimulation2D::applyVoltageTriggers()
+{
+    for (const auto &[triggerTime, x, y, voltage] : voltageTriggers)
+    {
+        if (x < 0 || x >= cols_ || y < 0 || y >= rows_)
+        {
+            throw std::out_of_range("Trigger coordinates (x=" + std::to_string(x) + ", y=" + std::to_string(y) +
+                                    ") are out of grid bounds (" + std::to_string(cols_) + "x" +
+                                    std::to_string(rows_) + ").");
+        }
+        for (int r = 0; r < K; ++r)
+        {
+            if (live[r])
+                Vext[lane(y * cols_ + x, r)] = 0.0;
+        }
+    }
+    for (const auto &[triggerTime, x, y, voltage] : voltageTriggers)
+    {
+        for (int r = 0; r < K; ++r)
+        {
+            if (live[r] && t[r] >= triggerTime && t[r] < triggerTime + dt)
+                Vext[lane(y * cols_ + x, r)] += voltage;
+        }
+    }
+}
+
+// 全レプリカのVnをJacobi法で一斉に緩和する
+// 素子ごとに隣接素子を1回たどり、レプリカ用カーネルでK個の和とVnをまとめて求める。
+// 足す順・式はGrid2D<FlatSEO>と同じ。
+// 終わったレプリカも一緒に計算し(カーネルの中で分岐しないため)、最後に緩和前の値へ戻す
+inline void EnsembleSimulation2D::relaxLanes()
+{
+    const int n = rows_ * cols_;
+    const bool allLive = std::all_of(live.begin(), live.end(), [](char l) { return l != 0; });
+    if (!allLive)
+    {
+        frozenVn = Vn;
+        frozenVsum = V_sum;
+    }
+    for (int it = 0; it < relaxation.maxIterations; ++it)
+    {
+        std::fill(residual.begin(), residual.end(), 0.0);
+        kernels->laneNodeVoltage(neighbours.data(), VonNeumann4::legs, C.data(), Cj.data(), legs.data(),
+                                 Qn.data(), Vn.data(), Vext.data(), V_sum.data(), VnNext.data(), residual.data(), K,
+                                 0, n);
+        Vn.swap(VnNext);
+        // 収束の判定は終わっていないレプリカだけで行う
+        double maxResidual = 0.0;
+        for (int r = 0; r < K; ++r)
+        {
+            if (live[r])
+                maxResidual = std::max(maxResidual, residual[r]);
+        }
+        if (relaxation.tolerance > 0 && maxResidual <= relaxation.tolerance)
+            break;
+    }
+    if (!allLive)
+    {
+        for (int r = 0; r < K; ++r)
+        {
+            if (live[r])
+                continue;
+            for (int i = 0; i < n; ++i)
+            {
+                Vn[lane(i, r)] = frozenVn[lane(i, r)];
+                V_sum[lane(i, r)] = frozenVsum[lane(i, r)];
+            }
+        }
+    }
+}
+
+// 全レプリカのdEを計算する(Q・V_sumが変わらないので、終わったレプリカも同じ値のまま)
+inline void EnsembleSimulation2D::updatedE()
+{
+    kernels->laneEnergyChange(C.data(), Cj.data(), legs.data(), Qn.data(), V_sum.data(), dEUp.data(), dEDown.data(),
+                              K, 0, rows_ * cols_);
+}
+
+// レプリカごとに最小wtを探し、トンネルさせて進める時間を決める
+// 乱数はGrid2D<FlatSEO>と同じく、dEが正の向きがある素子だけ添字順に(シード, 素子の添字)の乱数列から引く
+inline void EnsembleSimulation2D::tunnelLanes()
+{
+    const int n = rows_ * cols_;
+    std::fill(minwt.begin(), minwt.end(), dt);
+    std::fill(tunnelIndex.begin(), tunnelIndex.end(), -1);
+    for (int i = 0; i < n; ++i)
+    {
+        for (int r = 0; r < K; ++r)
+        {
+            const std::size_t k = lane(i, r);
+            if (!live[r] || !(dEUp[k] > 0 || dEDown[k] > 0))
+                continue;
+            // upとdownが同時に正になることはないので、正の方だけ計算する
+            const TunnelDirection dir = (dEUp[k] > 0) ? TunnelDirection::Up : TunnelDirection::Down;
+            const double de = (dir == TunnelDirection::Up) ? dEUp[k] : dEDown[k];
+            const double expo = exponentialVariate(gridSeeds[r], static_cast<std::uint64_t>(i), rngCounter[k]++);
+            const double w = (e * e * Rj[i] / de) * expo;
+            if (w < minwt[r])
+            {
+                minwt[r] = w;
+                tunnelIndex[r] = i;
+                tunnelDirection[r] = dir;
+            }
+        }
+    }
+    for (int r = 0; r < K; ++r)
+    {
+        // 終わったレプリカは進める時間を0にして、充電を何もしない計算にする
+        steptime[r] = live[r] ? dt : 0.0;
+        if (!live[r] || tunnelIndex[r] < 0)
+            continue;
+        Qn[lane(tunnelIndex[r], r)] += (tunnelDirection[r] == TunnelDirection::Up) ? -e : e;
+        ++tunnelCount[r];
+        steptime[r] = minwt[r];
+    }
+}
+
+// 全レプリカの電荷をそれぞれの進める時間だけ充電する
+// 終わったレプリカは進める時間が0なので電荷は変わらない
+// (ExponentialはexpをSIMDで計算しないので、レプリカのループのまま)
+inline void EnsembleSimulation2D::chargeLanes()
+{
+    const int n = rows_ * cols_;
+    if (chargeIntegrator == ChargeIntegrator::Euler)
+    {
+        kernels->laneChargeEuler(R.data(), Vd.data(), Vn.data(), steptime.data(), Qn.data(), K, 0, n);
+    }
+    else
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const double resistance = R[i], ctot = legs[i] * C[i] + Cj[i];
+            for (int r = 0; r < K; ++r)
+            {
+                const std::size_t k = lane(i, r);
+                Qn[k] += exponentialChargeIncrement(Vd[k], Vn[k], resistance, ctot, steptime[r]);
+            }
+        }
+    }
+    for (int r = 0; r < K; ++r)
+    {
+        if (live[r])
+            t[r] += steptime[r];
+    }
+}
+
+// シミュレーションの1ステップを実行(Simulation2D::runStepと同じ順)
+inline void EnsembleSimulation2D::runStep()
+{
+    requireGrid();
+    for (int r = 0; r < K; ++r)
+        live[r] = t[r] < endtime ? 1 : 0;
+
+    // oyl-video形式に出力
+    outputTooyl();
+
+    // 全レプリカのVn計算
+    applyVoltageTriggers();
+    relaxLanes();
+
+    // 全レプリカのdE計算
+    updatedE();
+
+    // wtの計算と比較・トンネル(レプリカごと)
+    tunnelLanes();
+
+    // チャージの計算と時刻の増加(レプリカごとの時間)
+    chargeLanes();
+}
+
+// 全レプリカが終了時刻になるまで実行
+inline void EnsembleSimulation2D::run()
+{
+    requireGrid();
+    while (*std::min_element(t.begin(), t.end()) < endtime)
+    {
+        runStep();
+    }
+}
+
+// レプリカ数を取得
+inline int EnsembleSimulation2D::numReplicas() const
+{
+    return K;
+}
+
+// 行数を取得
+inline int EnsembleSimulation2D::numRows() const
+{
+    return rows_;
+}
+
+// 列数を取得
+inline int EnsembleSimulation2D::numCols() const
+{
+    return cols_;
+}
+
+// レプリカrの現在の時刻を取得
+inline double EnsembleSimulation2D::getTime(int replica) const
+{
+    return t.at(replica);
+}
+
+// レプリカrのトンネル回数を取得
+inline long long EnsembleSimulation2D::getTunnelCount(int replica) const
+{
+    return tunnelCount.at(replica);
+}
+
+// レプリカrの出力を取得
+inline const std::vector<std::vector<std::vector<double>>> &EnsembleSimulation2D::getOutputs(int replica) const
+{
+    return outputs.at(replica);
+}
+
+// 出力のラベルを取得
+inline std::string EnsembleSimulation2D::getOutputLabel() const
+{
+    return outputlabel;
+}
+
+#endif // ENSEMBLE_SIMULATION_2D_HPP
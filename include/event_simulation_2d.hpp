@@ -0,0 +1,277 @@
+#ifndef EVENT_SIMULATION_2D_HPP
+#define EVENT_SIMULATION_2D_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include "simulation_2d.hpp"
+#include "indexed_heap.hpp"
+#include "philox.hpp"
+#include "seo_kernels.hpp"
+
+// インクリメンタル更新でdEを計算し直した素子を報告できるgridか
+template <typename Grid, typename = void>
+struct HasdEUpdatedCells : std::false_type
+{
+};
+template <typename Grid>
+struct HasdEUpdatedCells<Grid, std::void_t<decltype(std::declval<const Grid &>().getdEUpdatedCells()),
+                                           decltype(std::declval<const Grid &>().stableRateTime(1.0))>>
+    : std::true_type
+{
+};
+
+// next-reaction法によるイベント駆動のシミュレーション
+// 素子ごと・向きごと(チャネル)に「残りの内部時間」を持ち、次のトンネル時刻を添字付きヒープで管理する
+// 毎ステップ乱数を引き直さず、レートが変わったチャネルだけヒープ上の時刻を組み直す
+// (レートはステップ内で一定として積分する)
+// Grid2D<FlatSEO>をインクリメンタル更新(とアクティブセット)で使うと、緩和・dE・組み直し・充電は
+// トンネルした素子の周りと充電中の素子だけになり、1イベントあたりの手間は格子の大きさによらない。
+// それ以外のgridでは従来通り毎ステップgrid全体を計算する
+// ExponentialJump(既定)では、dtで刻まずに次の発火・出力などの区切り・レートを一定とみなせなくなる時刻まで進む
+template <typename Element>
+class EventSimulation2D : public Simulation2D<Element>
+{
+private:
+    // gridごとのチャネル状態（チャネル番号は 素子の添字*2 + 向き）
+    struct ChannelState
+    {
+        std::vector<double> remain; // 発火までに残っている内部時間(積分レートの残り)
+        std::vector<double> rate;   // 現在のレート
+        std::vector<double> last;   // remainを最後に更新した時刻
+        std::vector<std::uint64_t> draws; // チャネルごとの内部時間の抽選回数
+        IndexedMinHeap queue;       // 次の発火時刻のヒープ
+    };
+    std::vector<ChannelState> channels;
+    // 組み直したチャネル数の累計
+    long long rescheduleCount;
+    // 内部時間用の乱数列のシード(gridgのチャネルidは(channelSeed, (g<<32)|id, 抽選回数)から引く)
+    std::uint64_t channelSeed;
+
+    // gridgのチャネルidの乱数列から指数分布(平均1)の乱数を引く
+    double drawExp(std::size_t g, int id);
+
+    // チャネル状態をgridに合わせて初期化
+    void initChannels();
+
+    // 1チャネルのレートを更新し、次の発火時刻を組み直す
+    void reschedule(ChannelState &state, int id, double newRate);
+
+    // gridgのチャネルのうち、dEが変わった素子のものを組み直す(fullなら全チャネル)
+    void rescheduleGrid(std::size_t g, bool full);
+
+    // 発火が無ければ進める時間
+    double eventStepLimit() const;
+
+public:
+    // コンストラクタ(刻み時間,シミュレーションの終了タイミング)
+    EventSimulation2D(double dT, double EndTime);
+
+    // シミュレーションの1ステップ
+    void runStep() override;
+
+    // 実行のシードを設定(gridの乱数列に加えて内部時間の乱数列も決まる)
+    void setSeed(std::uint64_t runSeed) override;
+
+    // 乱数のシードを設定(互換用。setSeedと同じ)
+    void seedRandom(std::uint64_t runSeed);
+
+    // 指定gridでヒープに入っている(レートが正の)チャネル数を取得
+    int numScheduled(int gridIndex) const;
+
+    // レートを計算し直したチャネル数の累計を取得
+    long long getRescheduleCount() const;
+};
+
+// コンストラクタ
+template <typename Element>
+EventSimulation2D<Element>::EventSimulation2D(double dT, double EndTime)
+    : Simulation2D<Element>(dT, EndTime), rescheduleCount(0), channelSeed(nondeterministicSeed())
+{
+    this->chargeIntegrator = ChargeIntegrator::ExponentialJump;
+}
+
+// 指数分布(平均1)の乱数
+template <typename Element>
+double EventSimulation2D<Element>::drawExp(std::size_t g, int id)
+{
+    const std::uint64_t stream = (static_cast<std::uint64_t>(g) << 32) | static_cast<std::uint32_t>(id);
+    return exponentialVariate(channelSeed, stream, channels[g].draws[id]++);
+}
+
+// チャネル状態をgridに合わせて初期化
+template <typename Element>
+void EventSimulation2D<Element>::initChannels()
+{
+    channels.assign(this->grids.size(), ChannelState());
+    for (std::size_t g = 0; g < this->grids.size(); ++g)
+    {
+        const int n = 2 * this->grids[g].numCells();
+        auto &state = channels[g];
+        state.draws.assign(n, 0);
+        state.remain.resize(n);
+        for (int id = 0; id < n; ++id)
+            state.remain[id] = drawExp(g, id);
+        state.rate.assign(n, 0.0);
+        state.last.assign(n, this->t);
+        state.queue.reset(n);
+    }
+}
+
+// 1チャネルのレートを更新し、次の発火時刻を組み直す
+template <typename Element>
+void EventSimulation2D<Element>::reschedule(ChannelState &state, int id, double newRate)
+{
+    ++rescheduleCount;
+    if (newRate == state.rate[id])
+        return;
+    // 前回からの経過分の内部時間を消費
+    if (state.rate[id] > 0)
+    {
+        state.remain[id] = std::max(0.0, state.remain[id] - state.rate[id] * (this->t - state.last[id]));
+    }
+    state.last[id] = this->t;
+    state.rate[id] = newRate;
+    if (newRate > 0)
+        state.queue.update(id, this->t + state.remain[id] / newRate);
+    else
+        state.queue.remove(id);
+}
+
+// gridgのチャネルを組み直す
+template <typename Element>
+void EventSimulation2D<Element>::rescheduleGrid(std::size_t g, bool full)
+{
+    auto &grid = this->grids[g];
+    auto &state = channels[g];
+    auto update = [&](int i) {
+        reschedule(state, 2 * i, grid.tunnelRate(i, TunnelDirection::Up));
+        reschedule(state, 2 * i + 1, grid.tunnelRate(i, TunnelDirection::Down));
+    };
+    if constexpr (HasdEUpdatedCells<Grid2D<Element>>::value)
+    {
+        if (!full && grid.isIncrementalUpdate())
+        {
+            for (int i : grid.getdEUpdatedCells())
+                update(i);
+            return;
+        }
+    }
+    for (int i = 0; i < grid.numCells(); ++i)
+        update(i);
+}
+
+// 発火が無ければ進める時間
+// Euler法ではdt。解析解では、出力などの区切りとレートを一定とみなせる時間まで(dtより短くはしない)
+template <typename Element>
+double EventSimulation2D<Element>::eventStepLimit() const
+{
+    if (this->chargeIntegrator != ChargeIntegrator::ExponentialJump)
+        return this->dt;
+    double limit = this->timeToNextBoundary();
+    for (const auto &grid : this->grids)
+    {
+        if constexpr (HasdEUpdatedCells<Grid2D<Element>>::value)
+            limit = std::min(limit, grid.stableRateTime(this->jumpTolerance));
+        else
+            limit = std::min(limit, this->dt);
+    }
+    return std::max(this->dt, limit);
+}
+
+// シミュレーションの1ステップを実行
+template <typename Element>
+void EventSimulation2D<Element>::runStep()
+{
+    const bool full = channels.size() != this->grids.size();
+    if (full)
+    {
+        initChannels();
+    }
+
+    // oyl-video形式に出力
+    this->outputTooyl();
+
+    // Vn, dE計算(インクリメンタル更新時は変化した素子の周りだけ)
+    this->relaxGrids();
+    this->updateGridsdE();
+
+    // dEが変わった素子のチャネルだけ発火時刻を組み直す
+    for (std::size_t g = 0; g < this->grids.size(); ++g)
+    {
+        rescheduleGrid(g, full);
+    }
+
+    // 次の区切りまでで最も早い発火を探す
+    double steptime = eventStepLimit();
+    int firedGrid = -1;
+    for (std::size_t g = 0; g < channels.size(); ++g)
+    {
+        const auto &queue = channels[g].queue;
+        if (!queue.empty() && queue.topKey() - this->t < steptime)
+        {
+            steptime = std::max(0.0, queue.topKey() - this->t);
+            firedGrid = static_cast<int>(g);
+        }
+    }
+
+    // トンネル処理。発火したチャネルは内部時間を引き直す
+    if (firedGrid >= 0)
+    {
+        auto &state = channels[firedGrid];
+        const int id = state.queue.top();
+        TunnelEvent event;
+        event.gridIndex = firedGrid;
+        event.cellIndex = id / 2;
+        event.direction = (id % 2 == 0) ? TunnelDirection::Up : TunnelDirection::Down;
+        event.wt = steptime;
+        this->handleTunnels(event);
+
+        state.remain[id] = drawExp(firedGrid, id);
+        state.last[id] = this->t + steptime;
+        state.queue.update(id, state.last[id] + state.remain[id] / state.rate[id]);
+    }
+
+    // チャージの計算
+    this->updateGridsQn(steptime);
+
+    // tの増加
+    this->t += steptime;
+}
+
+// 実行のシードを設定
+template <typename Element>
+void EventSimulation2D<Element>::setSeed(std::uint64_t runSeed)
+{
+    Simulation2D<Element>::setSeed(runSeed);
+    // gridのシード(deriveSeed(runSeed, g))と重ならない番号から作る
+    channelSeed = deriveSeed(runSeed, ~std::uint64_t(0));
+    // 内部時間は次のステップで引き直す
+    channels.clear();
+}
+
+// 乱数のシードを設定(互換用)
+template <typename Element>
+void EventSimulation2D<Element>::seedRandom(std::uint64_t runSeed)
+{
+    setSeed(runSeed);
+}
+
+// ヒープに入っているチャネル数を取得
+template <typename Element>
+int EventSimulation2D<Element>::numScheduled(int gridIndex) const
+{
+    return channels.at(gridIndex).queue.size();
+}
+
+// 組み直したチャネル数の累計を取得
+template <typename Element>
+long long EventSimulation2D<Element>::getRescheduleCount() const
+{
+    return rescheduleCount;
+}
+
+#endif // EVENT_SIMULATION_2D_HPP
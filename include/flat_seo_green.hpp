@@ -0,0 +1,167 @@
+#ifndef FLAT_SEO_GREEN_HPP
+#define FLAT_SEO_GREEN_HPP
+
+#include <algorithm>
+#include <stdexcept>
+#include "green_kernel.hpp"
+
+// Grid2D<FlatSEO>のグリーン関数によるトンネル時の更新(C, Cj, legsが一様な格子で、インクリメンタル更新中のみ)
+// 格子の配列を直接読み書きするので、格子からfriendにされて格子のメンバとして持たれる。
+// 4近傍・倍精度の格子だけが持ち、それ以外の格子はFlatNoGreenを持つ
+//
+// 有効にすると、トンネルした素子の周り(打ち切り半径まで)のVnとV_sumをその場で直す。
+// 全体を反復し直すとトンネル1回の仕事量が格子の大きさに比例したままになるので、
+// 打ち切りの残りと充電による変化はインクリメンタル更新で直した素子の周りだけ緩和する
+class FlatGreenUpdater
+{
+private:
+    bool enabled_ = false;
+    double tolerance_ = 1e-8;
+    // グリーン関数の表（パラメータを変えると捨て、次のトンネルで作り直す）
+    GreenKernelTable kernels;
+
+    // 全素子で共通の対角 legs + Cj/C (C, Cj, legsが一様でなければ例外)
+    template <typename Grid>
+    static double uniformDiagonal(const Grid &grid);
+
+    // 表が無ければ作る
+    template <typename Grid>
+    void configure(const Grid &grid);
+
+public:
+    // グリーン関数による更新中かどうか
+    bool enabled() const { return enabled_; }
+
+    // 切り替え(toleranceは応答を打ち切る中心値との比)
+    // インクリメンタル更新中でなければ例外。使えない格子(一様でない)なら有効にするときに例外
+    template <typename Grid>
+    void setEnabled(const Grid &grid, bool enabled, double tolerance);
+
+    // 無効にする(インクリメンタル更新を無効にしたとき用)
+    void disable() { enabled_ = false; }
+
+    // 表を捨てる(回路パラメータを変えたとき用)
+    void reset() { kernels.clear(); }
+
+    // 打ち切り半径を取得(未計算なら作る)
+    template <typename Grid>
+    int radius(const Grid &grid);
+
+    // index素子の電荷がdq変わった分のVnの変化を足し、周囲のV_sumを直す
+    template <typename Grid>
+    void apply(Grid &grid, int index, double dq);
+};
+
+// 4近傍・倍精度以外の格子が持つ空の更新(常に無効)
+struct FlatNoGreen
+{
+    static constexpr bool enabled() { return false; }
+    void disable() {}
+    void reset() {}
+};
+
+// 全素子で共通の対角
+template <typename Grid>
+inline double FlatGreenUpdater::uniformDiagonal(const Grid &grid)
+{
+    const int n = grid.numCells();
+    const double c0 = grid.cellC(0), cj0 = grid.cellCj(0);
+    const int legs0 = grid.cellLegs(0);
+    for (int i = 1; i < n; ++i)
+    {
+        if (grid.cellC(i) != c0 || grid.cellCj(i) != cj0 || grid.cellLegs(i) != legs0)
+        {
+            throw std::invalid_argument("Green update requires uniform C, Cj and legs");
+        }
+    }
+    if (!(c0 > 0 && cj0 > 0))
+    {
+        throw std::invalid_argument("Green update requires positive C and Cj");
+    }
+    return legs0 + cj0 / c0;
+}
+
+// 表が無ければ作る
+template <typename Grid>
+inline void FlatGreenUpdater::configure(const Grid &grid)
+{
+    if (!kernels.isConfigured())
+    {
+        kernels.configure(uniformDiagonal(grid), tolerance_);
+    }
+}
+
+// グリーン関数による更新の切り替え
+template <typename Grid>
+inline void FlatGreenUpdater::setEnabled(const Grid &grid, bool enabled, double tolerance)
+{
+    if (!(tolerance > 0 && tolerance < 1))
+    {
+        throw std::invalid_argument("Tolerance must be in (0, 1)");
+    }
+    if (enabled && !grid.isIncrementalUpdate())
+    {
+        throw std::logic_error("Green update requires incremental update");
+    }
+    if (enabled)
+    {
+        uniformDiagonal(grid); // 使えない格子ならここで例外にする
+    }
+    if (tolerance != tolerance_)
+    {
+        kernels.clear();
+    }
+    enabled_ = enabled;
+    tolerance_ = tolerance;
+}
+
+// 打ち切り半径を取得
+template <typename Grid>
+inline int FlatGreenUpdater::radius(const Grid &grid)
+{
+    configure(grid);
+    return kernels.radius();
+}
+
+// index素子の電荷がdq変わった分のVnの変化を足し、周囲のV_sumを直す
+// 計算量は打ち切り半径の2乗で、格子の大きさによらない
+template <typename Grid>
+inline void FlatGreenUpdater::apply(Grid &grid, int index, double dq)
+{
+    configure(grid);
+    const int rows = grid.numRows(), cols = grid.numCols();
+    const int row = index / cols, col = index % cols;
+    const GreenKernel &k = kernels.kernel(rows, cols, row, col);
+    const double scale = dq / grid.cellC(index);
+    // Vnが変わる範囲の1つ外側までV_sumを計算し直す
+    const int r0 = std::max(0, row + k.rowBegin - 1), r1 = std::min(rows - 1, row + k.rowEnd + 1);
+    const int c0 = std::max(0, col + k.colBegin - 1), c1 = std::min(cols - 1, col + k.colEnd + 1);
+    // 眠っている素子は、Vnが変わる前の充電を足して起こしておく
+    if (grid.tracker.activeSet())
+    {
+        for (int i = r0; i <= r1; ++i)
+            for (int j = c0; j <= c1; ++j)
+                grid.tracker.wake(grid, i * cols + j);
+    }
+    for (int dr = k.rowBegin; dr <= k.rowEnd; ++dr)
+    {
+        for (int dc = k.colBegin; dc <= k.colEnd; ++dc)
+        {
+            grid.Vn[(row + dr) * cols + col + dc] += scale * k.at(dr, dc);
+        }
+    }
+    for (int i = r0; i <= r1; ++i)
+    {
+        for (int j = c0; j <= c1; ++j)
+        {
+            const int idx = i * cols + j;
+            double sum = 0.0;
+            grid.forEachNeighbour(idx, [&](int m) { sum += grid.Vn[m]; });
+            grid.V_sum[idx] = sum + grid.Vext[idx];
+            // 打ち切りの残りもインクリメンタル更新で拾う
+            grid.tracker.touch(grid, idx);
+        }
+    }
+}
+
+#endif // FLAT_SEO_GREEN_HPP
@@ -0,0 +1,1502 @@
+#ifndef FLAT_SEO_GRID_HPP
+#define FLAT_SEO_GRID_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <array>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <tuple>
+#include "seo_class.hpp"
+#include "grid_2dim.hpp"
+#include "relaxation.hpp"
+#include "thread_pool.hpp"
+#include "seo_kernels.hpp"
+#include "philox.hpp"
+#include "charge_integration.hpp"
+#include "stencil_topology.hpp"
+#include "flat_seo_solvers.hpp"
+#include "flat_seo_incremental.hpp"
+#include "flat_seo_green.hpp"
+
+// SEOをSoA（フィールドごとの連続配列）で保持するためのタグ型
+// TopologyはVonNeumann4, Moore8, Hex6などの接続の形(stencil_topology.hpp)
+template <typename Topology, typename Real = double>
+struct BasicFlatSEO
+{
+    static_assert(std::is_floating_point<Real>::value, "BasicFlatSEO requires a floating-point type");
+};
+
+// 従来通りの4近傍の格子。Grid2D<FlatSEO> として使う
+using FlatSEO = BasicFlatSEO<VonNeumann4>;
+
+// 素子の状態・回路パラメータをReal(floatかdouble)で持つ4近傍の格子(Grid2D<SingleSEO>のように使う)
+// 探索的なスイープではfloatにするとメモリの読み書きが半分になり、単精度のSIMDカーネルで1命令に倍の素子を計算する
+template <typename Real>
+using PrecisionSEO = BasicFlatSEO<VonNeumann4, Real>;
+using SingleSEO = PrecisionSEO<float>;
+using DoubleSEO = PrecisionSEO<double>;
+
+// Real = float用の式(Vn・dE・wtの一括計算はseo_kernelsの単精度カーネルを使う)
+namespace precision_kernels
+{
+    // exponentialChargeIncrementのReal版(式の順は同じなので、Real = doubleなら一致する)
+    template <typename Real>
+    inline Real exponentialChargeIncrement(Real vd, Real vn, Real r, Real ctot, Real dt)
+    {
+        return (vd - vn) * ctot * -std::expm1(-dt / (r * ctot));
+    }
+}
+
+// パラメータクラス：同じ回路パラメータ(バイアス電圧を含む)を持つ素子の組
+struct SEOParameterClass
+{
+    double R, Rj, Cj, C, Vd;
+    int legs;
+};
+
+// 倍精度の格子だけが持つメンバ関数の制約(他の格子で呼ぶとコンパイルエラーになる)
+template <typename Real>
+using RequireDoubleGrid = std::enable_if_t<std::is_same<Real, double>::value, int>;
+
+// 4近傍・倍精度の格子だけが持つメンバ関数の制約
+template <typename Topology, typename Real>
+using RequireVonNeumannDoubleGrid =
+    std::enable_if_t<std::is_same<Topology, VonNeumann4>::value && std::is_same<Real, double>::value, int>;
+
+// Grid2D<BasicFlatSEO<Topology, Real>>：SEOの状態を row*cols+col で並べた配列で保持する2次元グリッド
+// 接続はTopologyの隣接位置（端は開放）を添字の差で解決するので、素子ごとの接続情報は持たない。
+// 端から離れた素子では隣接素子の和を展開した添字の差だけで求め、端の素子だけ範囲を確かめる
+//
+// パラメータクラスモード(setParameterClasses)では、回路パラメータを素子ごとに持たず、
+// 同じパラメータの素子をまとめたクラスの表と素子ごとのクラス番号(16bit)だけを持つ
+//
+// 他のモードは別のヘッダの部品を組み合わせて持つ
+//   flat_seo_solvers.hpp     : 直接法・マルチグリッド(4近傍・doubleのみ)とタイル分割のJacobi法(doubleのみ)
+//   flat_seo_incremental.hpp : インクリメンタル更新とアクティブセット(doubleのみ)
+//   flat_seo_green.hpp       : グリーン関数によるトンネル時の更新(4近傍・doubleのみ)
+// Topology・Realで使えない部品は空の型になり、その切り替えのメンバ関数(setIncrementalUpdate,
+// setGreenUpdateなど)も無いので、使えない組み合わせはコンパイルエラーになる。
+// 緩和方法はRelaxationConfigの値なので、使えるかはsupportsRelaxationで確かめる(relaxでは例外)
+//
+// Real = floatでは状態・回路パラメータ・dE・wtをfloatの配列で持つ(時刻と待ち時間の比較はdouble)。
+// 乱数は同じ乱数列から引くので、Real = doubleとのずれは丸め誤差だけから生じる(precision_comparison.hpp)。
+template <typename Topology, typename Real>
+class Grid2D<BasicFlatSEO<Topology, Real>>
+{
+public:
+    using topology_type = Topology;
+    using value_type = Real;
+    using pair_type = BasicTunnelPair<Real>;
+    // 1素子分のビュー（getElementの戻り値）
+    // SEOと同じ名前のアクセサを持ち、elem->getVn() のように使える
+    class ElementRef
+    {
+    private:
+        Grid2D *grid;
+        int index;
+
+    public:
+        ElementRef(Grid2D *g, int idx) : grid(g), index(idx) {}
+
+        // shared_ptr<SEO>と同じ書き方(->)で使うため
+        ElementRef *operator->() { return this; }
+        const ElementRef *operator->() const { return this; }
+
+        // 配列上の添字
+        int getIndex() const { return index; }
+
+        // パラメータセットアップ
+        void setUp(double r, double rj, double cj, double c, double vd, int legscounts);
+        // パラメータセットアップ(足の数はトポロジの隣接数)
+        void setUp(double r, double rj, double cj, double c, double vd) { setUp(r, rj, cj, c, vd, Topology::legs); }
+        // バイアス電圧を設定
+        void setVias(double vd) { grid->setVias(index, vd); }
+        // V_sumを設定
+        void setVsum(double v)
+        {
+            grid->V_sum[index] = v;
+            grid->tracker.touch(*grid, index);
+        }
+        // 外部から加える電圧を設定
+        void setExternalVoltage(double v) { grid->setExternalVoltage(index, v); }
+        // 振動子のトンネル
+        void setTunnel(TunnelDirection direction) { grid->applyTunnel(index, direction); }
+        // 振動子のトンネル（互換用）
+        void setTunnel(const std::string &direction) { setTunnel(toTunnelDirection(direction)); }
+
+        double getVn() const { return grid->Vn[index]; }
+        double getQ() const { return grid->cellCharge(index); }
+        double getSurroundingVsum() const { return grid->V_sum[index]; }
+        double getExternalVoltage() const { return grid->Vext[index]; }
+        const pair_type &getdE() const { return grid->dE[index]; }
+        const pair_type &getWT() const { return grid->wt[index]; }
+        double getR() const { return grid->cellR(index); }
+        double getRj() const { return grid->cellRj(index); }
+        double getCj() const { return grid->cellCj(index); }
+        double getC() const { return grid->cellC(index); }
+        double getVd() const { return grid->cellVd(index); }
+        int getlegs() const { return grid->cellLegs(index); }
+        // パラメータクラスの番号(パラメータクラスモードのみ)
+        int getParameterClass() const { return grid->paramClass.at(index); }
+
+        // テスト用セッター
+        void setdE(TunnelDirection direction, double value) { grid->dE[index][direction] = value; }
+        void setdE(const std::string &direction, double value) { setdE(toTunnelDirection(direction), value); }
+        void setVn(double vn)
+        {
+            grid->tracker.wake(*grid, index);
+            grid->Vn[index] = vn;
+            grid->tracker.touchNeighbours(*grid, index);
+        }
+        void setQ(double qn)
+        {
+            grid->tracker.wake(*grid, index);
+            grid->Qn[index] = qn;
+            grid->tracker.touch(*grid, index);
+        }
+    };
+
+private:
+    friend class FlatMatrixRelaxation;
+    friend class FlatTiledJacobi<Real>;
+    friend class FlatIncrementalTracker;
+    friend struct FlatNoIncremental;
+    friend class FlatGreenUpdater;
+
+    // 縦横のサイズ
+    int rows_, cols_;
+    // 状態量（添字は row*cols+col）
+    std::vector<Real> Qn;       // ノード電荷
+    std::vector<Real> Vn;       // ノード電圧
+    std::vector<Real> V_sum;    // 周囲のノード電圧の総和
+    std::vector<Real> Vd;       // バイアス電圧
+    std::vector<Real> Vext;     // 外部から加える電圧（トリガ用、V_sumに足される）
+    std::vector<pair_type> dE;  // エネルギー変化量(up, down)
+    std::vector<pair_type> wt;  // トンネル待時間(up, down)
+    // 回路パラメータ
+    std::vector<Real> R;  // 抵抗
+    std::vector<Real> Rj; // トンネル抵抗
+    std::vector<Real> Cj; // 接合容量
+    std::vector<Real> C;  // 接続容量
+    std::vector<int> legs;  // 足の数
+
+    //---- パラメータクラスモード用(有効な間は上の素子ごとの回路パラメータとVdは空) ----//
+    bool classMode = false;
+    std::vector<std::uint16_t> paramClass;      // 素子ごとのクラス番号
+    std::vector<SEOParameterClass> classParams; // クラスごとの回路パラメータ
+    std::map<std::tuple<double, double, double, double, double, int>, std::uint16_t> classLookup;
+    // クラスごとの係数(割り算を済ませたもの)
+    std::vector<double> classC, classInvCtot, classEOverCtot, classHalfE2OverCtot, classE2Rj, classInvR, classVd;
+
+    // パラメータに対応するクラス番号(無ければ作る)
+    std::uint16_t internClass(const SEOParameterClass &p);
+
+    // カーネルに渡すクラスの係数
+    SEOClassCoefficients classCoefficients() const;
+
+    // クラスの表を空にする
+    void clearClassTables();
+
+    // 素子の回路パラメータ(モードによらず使える)
+    Real cellR(int i) const { return classMode ? classParams[paramClass[i]].R : R[i]; }
+    Real cellRj(int i) const { return classMode ? classParams[paramClass[i]].Rj : Rj[i]; }
+    Real cellCj(int i) const { return classMode ? classParams[paramClass[i]].Cj : Cj[i]; }
+    Real cellC(int i) const { return classMode ? classParams[paramClass[i]].C : C[i]; }
+    Real cellVd(int i) const { return classMode ? classParams[paramClass[i]].Vd : Vd[i]; }
+    int cellLegs(int i) const { return classMode ? classParams[paramClass[i]].legs : legs[i]; }
+
+    // 素子のパラメータを設定
+    void setCellParams(int i, const SEOParameterClass &p);
+
+    // バイアス電圧を設定
+    void setVias(int i, double vd);
+
+    // 範囲[first, last)のVnを計算してoutに書き込む(モードに合わせてカーネルを選ぶ)
+    void nodeVoltageRange(Real *out, int first, int last);
+    // 範囲[first, last)のVnを計算する(vsum・outは添字shiftの素子から始まる配列)
+    void nodeVoltageRange(const Real *vsum, Real *out, int first, int last, int shift);
+    // 出力時のファイル名(デフォルトは空)
+    std::string outputlabel = "";
+    // 電子トンネルをする場所の添字(-1はトンネル無し)
+    int tunnelindex;
+    // 電子トンネルの向き
+    TunnelDirection tunneldirection;
+    // gridにおける最小の待ち時間
+    double minwt;
+    // 出力するかのbool値(デフォルトがtrueで出力する)
+    bool outputEnabled;
+    // トンネル待ち時間用の乱数列のシード(素子iは(rngSeed, rngStreamBase + i, 抽選回数)から引く)
+    std::uint64_t rngSeed;
+    // 乱数列の番号のずれ(大きなgridの一部を持つとき、元のgridと同じ乱数列を使うため)
+    std::uint64_t rngStreamBase = 0;
+    // 素子ごとの抽選回数
+    std::vector<std::uint64_t> rngCounter;
+
+    // 素子iの乱数列から平均1の指数分布の乱数を引く(exponentialDrawの1素子版)
+    double cellExponential(int i);
+
+    // 全素子の電荷にdq(i)を足す(インクリメンタル更新時はtrackerに任せる)
+    template <typename Increment>
+    void addCharges(double dt, Increment dq);
+
+    // 眠っている間の充電を含めた素子iの電荷
+    double cellCharge(int i) const { return tracker.cellCharge(*this, i); }
+
+    // 1素子のノード電圧（updateGridVnと同じ式）
+    Real nodeVoltage(int i) const;
+
+    // 1素子のdEを計算
+    void computedE(int i);
+
+    //---- 並列実行用 ----//
+    std::shared_ptr<ThreadPool> pool;  // nullなら逐次に実行する
+    std::vector<Real> VnNext;          // Jacobi法で書き込む側のVn
+    std::vector<double> chunkValues;   // 区間ごとの最小wt・残差
+    std::vector<int> chunkIndices;     // 区間ごとの最小wtの素子
+    std::vector<TunnelDirection> chunkDirections;
+    std::vector<Real> expo;            // gridminwtで使う指数分布の乱数 -log(u)(素子ごと)
+    // Vn・dE・wtの一括計算に使うカーネル(デフォルトはCPUに合わせて選ぶ。Real = doubleのみ)
+    const SEOKernelTable *kernels;
+
+    // (up, down)の組の配列をRealの配列として見る
+    static Real *pairData(std::vector<pair_type> &pairs);
+
+    // 倍精度か(SIMDカーネル・直接法などはdoubleのみ)
+    static constexpr bool isDouble = std::is_same<Real, double>::value;
+
+    // 4近傍か(直接法・マルチグリッド・グリーン関数・赤黒の並列化は4近傍の容量行列を前提にしている)
+    static constexpr bool isVonNeumann = std::is_same<Topology, VonNeumann4>::value;
+
+    //---- 組み合わせるモード(使えない組では空の型) ----//
+    using backends = FlatRelaxationBackends<Topology, Real>;
+    // インクリメンタル更新・アクティブセットを持つか
+    static constexpr bool hasIncremental = isDouble;
+    // グリーン関数による更新を持つか
+    static constexpr bool hasGreen = isDouble && isVonNeumann;
+
+    // 直接法・マルチグリッド
+    std::conditional_t<backends::matrix, FlatMatrixRelaxation, FlatNoRelaxation> matrixRelaxation;
+    // タイル分割のJacobi法
+    std::conditional_t<backends::tiled, FlatTiledJacobi<Real>, FlatNoRelaxation> tiledJacobi;
+    // インクリメンタル更新・アクティブセット
+    std::conditional_t<hasIncremental, FlatIncrementalTracker, FlatNoIncremental> tracker;
+    // グリーン関数によるトンネル時の更新
+    std::conditional_t<hasGreen, FlatGreenUpdater, FlatNoGreen> green;
+
+    // 隣接素子への添字の差(Topology::offsetsの順、cols_に合わせて作る)
+    std::array<int, Topology::legs> neighbourOffsets;
+
+    // 全ての隣接素子が格子の中にあるか
+    bool isInterior(int row, int col) const;
+
+    // 隣接素子(Topology::offsetsの順、格子の外は飛ばす)に対してfを呼ぶ
+    template <typename F>
+    void forEachNeighbour(int idx, F f) const;
+
+    // 端から離れた素子の隣接素子の和(添字の差を展開して足す)
+    template <std::size_t... K>
+    Real interiorSum(const Real *v, int idx, std::index_sequence<K...>) const;
+
+    // 1素子の隣接素子のvの和
+    Real neighbourSum(const Real *v, int idx) const;
+
+    // row行目の全素子について、隣接素子のvの和をout[idx]に書き込む
+    // (v・outは添字shiftの素子から始まる配列でもよい。タイルの作業領域用)
+    void neighbourSumRow(const Real *v, int row, Real *out, int shift = 0) const;
+
+    // 全素子のV_sumを隣接素子のVnとVextから計算する
+    void computeNeighbourSums();
+
+public:
+    // コンストラクタ：指定した行数・列数でグリッドを初期化（パラメータは全て0）
+    Grid2D(int rows, int cols, bool enableOutput = true);
+
+    // 指定位置の要素のビューを取得
+    ElementRef getElement(int row, int col) const;
+
+    // グリッド全体の接続されている電圧を更新
+    // (インクリメンタル更新時は、記録された素子の周りだけを緩和する)
+    void updateGridSurVn();
+
+    // グリッド全体のノード電圧Vnを計算・更新
+    // (インクリメンタル更新時は、記録された素子の周りだけを緩和する)
+    void updateGridVn();
+
+    // 設定に従ってグリッド全体のVnを緩和する(この格子で使えない緩和方法は例外)
+    // (インクリメンタル更新時は、記録された素子の周りだけをインクリメンタル更新の許容誤差まで緩和する。
+    //  Jacobi法(タイル無し)以外の設定は例外。maxIterationsは波の数の上限、toleranceは波での最大変化量の閾値に使い、
+    //  打ち切ったときに残った素子は次の緩和に回す)
+    RelaxationStats relax(const RelaxationConfig &config);
+
+    // この格子(Topology・Real)でconfigの緩和方法を使えるか
+    static bool supportsRelaxation(const RelaxationConfig &config);
+
+    // グリッド全体のエネルギー変化dEを計算・更新
+    void updateGriddE();
+
+    // グリッド全体のトンネル待ち時間wtを計算し、最小wtとトンネル素子を更新
+    bool gridminwt(const double dt);
+
+    // グリッド全体のノード電荷Qnを更新
+    void updateGridQn(const double dt);
+
+    // グリッド全体のノード電荷QnをRC充電の解析解で更新(周囲の電圧はステップ内で一定とする)
+    void updateGridQnExponential(const double dt);
+
+    // 周囲の電圧を一定としたとき、いずれかの素子のdEが正になるまでの時間(既に正なら0、ならないなら+inf)
+    double nextThresholdTime() const;
+
+    // 周囲の電圧を一定として充電したとき、どの素子でも隣接素子のVnの変化の合計(V_sumのずれ)が
+    // tolerance以下に収まる時間(各素子のVnの変化をtolerance/隣接数以下に抑える)
+    double vsumDriftTime(double tolerance) const;
+
+    // dEが正でない素子のdEが正になる時刻と、いずれかの素子のVnの変化がtolerance/隣接数を超える時刻のうち早い方
+    // (イベント駆動でレートを一定とみなせる時間。アクティブセット使用時は、アクティブな素子と
+    //  眠っている素子を次に起こす時刻だけで決まる)
+    double stableRateTime(double tolerance) const;
+
+    // 直前のupdateGriddEでdEを計算し直した素子(インクリメンタル更新時のみ。それ以外は空)
+    const std::vector<int> &getdEUpdatedCells() const;
+
+    // 乱数のシードを設定(全素子の抽選回数を0に戻す)
+    void seedRandom(std::uint64_t seed);
+
+    // 乱数列の番号のずれを設定(素子iは乱数列streamBase + iから引く。
+    // 大きなgridの行firstRowからを切り出したときにfirstRow*colsとすれば、元のgridと同じ乱数を引く)
+    void setRandomStreamBase(std::uint64_t streamBase);
+
+    // 外部から加える電圧を設定
+    void setExternalVoltage(int index, double v);
+
+    // 並列実行に使うスレッドプールを設定(nullptrで逐次に戻す)
+    // 区間の分け方と乱数の引き方が固定なので、同じシードなら逐次と同じ結果になる
+    // (インクリメンタル更新・グリーン関数・直接法・マルチグリッドは逐次のまま)
+    void setThreadPool(std::shared_ptr<ThreadPool> threadPool);
+
+    // スレッドプールを取得
+    std::shared_ptr<ThreadPool> getThreadPool() const;
+
+    // Vn・dE・wtの一括計算に使う命令セットを設定(CPUが対応していなければ例外)
+    // どの命令セットでも結果はビット単位で同じ
+    void setSimdLevel(SimdLevel level);
+
+    // Vn・dE・wtの一括計算に使っている命令セットを取得
+    SimdLevel getSimdLevel() const;
+
+    // パラメータクラスモードの切り替え(倍精度の格子のみ)
+    // 有効にすると、今の素子ごとのパラメータからクラスを作り、素子ごとの配列を解放する。
+    // Vn・dEは割り算を済ませたクラスの係数で計算する(式の形が違うので、結果は丸め誤差の分だけ変わる)
+    // クラスは65536個まで(超えると例外)
+    template <typename Scalar = Real, RequireDoubleGrid<Scalar> = 0>
+    void setParameterClasses(bool enabled);
+
+    // パラメータクラスモードかどうか
+    bool isParameterClasses() const;
+
+    // パラメータクラスの数を取得(パラメータクラスモードでなければ0)
+    int numParameterClasses() const;
+
+    // インクリメンタル更新の切り替え(倍精度の格子のみ。toleranceはVn[V]と電荷の変化をまとめて無視する閾値)
+    // 無効にするとグリーン関数による更新も無効になる
+    template <typename Scalar = Real, RequireDoubleGrid<Scalar> = 0>
+    void setIncrementalUpdate(bool enabled, double tolerance = 1e-9);
+
+    // インクリメンタル更新中かどうか
+    bool isIncrementalUpdate() const;
+
+    // V_sumを全素子で計算し直し、全素子を再計算の対象にする
+    // (インクリメンタル更新中にパラメータを書き換えたときや、丸め誤差をリセットするとき用)
+    template <typename Scalar = Real, RequireDoubleGrid<Scalar> = 0>
+    void resyncIncremental();
+
+    // インクリメンタル更新でV_sumを隣接素子から計算し直す間隔(緩和の回数。0なら行わない。デフォルトは1024)
+    // V_sumは差分を足して保つので、長く走らせると丸め誤差が溜まる。これを一定の間隔で消す
+    template <typename Scalar = Real, RequireDoubleGrid<Scalar> = 0>
+    void setResyncInterval(int relaxations);
+
+    // V_sumを計算し直す間隔を取得
+    template <typename Scalar = Real, RequireDoubleGrid<Scalar> = 0>
+    int getResyncInterval() const;
+
+    // アクティブセットの切り替え(インクリメンタル更新中のみ。無効にすると全素子を起こす)
+    // 眠っている素子の充電はVnを一定として後からまとめて足すので、Euler法ではインクリメンタル更新と丸め誤差の分だけ、
+    // 解析解では許容誤差の分だけ結果が変わる
+    template <typename Scalar = Real, RequireDoubleGrid<Scalar> = 0>
+    void setActiveSet(bool enabled);
+
+    // アクティブセットを使っているかどうか
+    bool isActiveSet() const;
+
+    // アクティブな(毎ステップ充電・判定している)素子数を取得(アクティブセットを使っていなければ全素子数)
+    int numActiveCells() const;
+
+    // グリーン関数によるトンネル時の更新の切り替え(4近傍・倍精度の格子のみ。
+    // C, Cj, legsが一様な格子で、インクリメンタル更新中のみ。詳しくはflat_seo_green.hpp)
+    // Vnが収束した状態から使うこと。toleranceは応答を打ち切る中心値との比
+    template <typename Stencil = Topology, typename Scalar = Real, RequireVonNeumannDoubleGrid<Stencil, Scalar> = 0>
+    void setGreenUpdate(bool enabled, double tolerance = 1e-8);
+
+    // グリーン関数による更新中かどうか
+    bool isGreenUpdate() const;
+
+    // グリーン関数の打ち切り半径を取得(未計算なら作る)
+    template <typename Stencil = Topology, typename Scalar = Real, RequireVonNeumannDoubleGrid<Stencil, Scalar> = 0>
+    int getGreenRadius();
+
+    // 行数を取得
+    int numRows() const;
+
+    // 列数を取得
+    int numCols() const;
+
+    // 素子数を取得
+    int numCells() const;
+
+    // 添字の素子の、指定方向のトンネルレート(dE/(e^2 Rj), dE<=0なら0)を取得
+    double tunnelRate(int index, TunnelDirection direction) const;
+
+    // トンネルが発生する素子を取得
+    ElementRef getTunnelPlace() const;
+
+    // トンネルが発生する素子の添字を取得
+    int getTunnelIndex() const;
+
+    // 添字(row*cols+col)で指定した素子をトンネルさせる
+    void applyTunnel(int index, TunnelDirection direction);
+
+    // トンネルの方向を取得
+    TunnelDirection getTunnelDirection() const;
+
+    // 最小トンネル待ち時間wtを取得
+    double getMinWT() const;
+
+    // outputlabelの設定
+    void setOutputLabel(const std::string &label);
+
+    // outputlabelの取得
+    std::string getOutputLabel() const;
+
+    // outputlabelが設定されているかの取得
+    bool hasOutputLabel() const;
+
+    // OutputEnabledの設定
+    void setOutputEnabled(bool flag);
+
+    // OutputEnabledの取得
+    bool isOutputEnabled() const;
+};
+
+//-------- ElementRef ----------//
+// パラメータセットアップ
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::ElementRef::setUp(double r, double rj, double cj, double c, double vd, int legscounts)
+{
+    grid->setCellParams(index, SEOParameterClass{r, rj, cj, c, vd, legscounts});
+}
+
+
+//-------- Grid2D<BasicFlatSEO<Topology, Real>> ----------//
+// コンストラクタ：全フィールドを0で確保
+template <typename Topology, typename Real>
+inline Grid2D<BasicFlatSEO<Topology, Real>>::Grid2D(int rows, int cols, bool enableOutput)
+    : rows_(rows), cols_(cols), tunnelindex(-1), tunneldirection(TunnelDirection::Up), minwt(0.0),
+      outputEnabled(enableOutput), rngSeed(nondeterministicSeed()), kernels(&seoKernels())
+{
+    if (rows <= 0 || cols <= 0)
+    {
+        throw std::invalid_argument("Grid size must be positive");
+    }
+    const std::size_t n = static_cast<std::size_t>(rows) * cols;
+    for (auto *field : {&Qn, &Vn, &V_sum, &Vd, &Vext, &R, &Rj, &Cj, &C})
+    {
+        field->assign(n, 0.0);
+    }
+    dE.assign(n, pair_type());
+    wt.assign(n, pair_type());
+    legs.assign(n, 0);
+    rngCounter.assign(n, 0);
+    for (int k = 0; k < Topology::legs; ++k)
+    {
+        neighbourOffsets[k] = Topology::offsets[k].dr * cols_ + Topology::offsets[k].dc;
+    }
+}
+
+// 素子のパラメータを設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setCellParams(int i, const SEOParameterClass &p)
+{
+    tracker.wake(*this, i);
+    if (classMode)
+    {
+        paramClass[i] = internClass(p);
+    }
+    else
+    {
+        R[i] = p.R;
+        Rj[i] = p.Rj;
+        Cj[i] = p.Cj;
+        C[i] = p.C;
+        Vd[i] = p.Vd;
+        legs[i] = p.legs;
+    }
+    matrixRelaxation.reset();
+    green.reset();
+    tracker.touch(*this, i);
+}
+
+// バイアス電圧を設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setVias(int i, double vd)
+{
+    // 充電の速さが変わるので、それまでの分を足して起こしておく
+    tracker.wake(*this, i);
+    if (!classMode)
+    {
+        Vd[i] = vd;
+        return;
+    }
+    SEOParameterClass p = classParams[paramClass[i]];
+    p.Vd = vd;
+    paramClass[i] = internClass(p);
+}
+
+// パラメータに対応するクラス番号
+template <typename Topology, typename Real>
+inline std::uint16_t Grid2D<BasicFlatSEO<Topology, Real>>::internClass(const SEOParameterClass &p)
+{
+    auto key = std::make_tuple(p.R, p.Rj, p.Cj, p.C, p.Vd, p.legs);
+    auto found = classLookup.find(key);
+    if (found != classLookup.end())
+        return found->second;
+    if (classParams.size() > std::numeric_limits<std::uint16_t>::max())
+    {
+        throw std::invalid_argument("Too many parameter classes (at most 65536)");
+    }
+    const std::uint16_t id = static_cast<std::uint16_t>(classParams.size());
+    classParams.push_back(p);
+    classLookup.emplace(key, id);
+    // 割り算はここで済ませる
+    const double ctot = p.legs * p.C + p.Cj;
+    classC.push_back(p.C);
+    classInvCtot.push_back(1.0 / ctot);
+    classEOverCtot.push_back(e / ctot);
+    classHalfE2OverCtot.push_back(e * e / (2 * ctot));
+    classE2Rj.push_back(e * e * p.Rj);
+    classInvR.push_back(1.0 / p.R);
+    classVd.push_back(p.Vd);
+    return id;
+}
+
+// カーネルに渡すクラスの係数
+template <typename Topology, typename Real>
+inline SEOClassCoefficients Grid2D<BasicFlatSEO<Topology, Real>>::classCoefficients() const
+{
+    return SEOClassCoefficients{classC.data(), classInvCtot.data(), classEOverCtot.data(),
+                                classHalfE2OverCtot.data(), classE2Rj.data()};
+}
+
+// 範囲[first, last)のVnを計算してoutに書き込む
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::nodeVoltageRange(Real *out, int first, int last)
+{
+    if constexpr (!isDouble)
+        kernels->nodeVoltageFloat(Qn.data(), V_sum.data(), C.data(), Cj.data(), legs.data(), out, first, last);
+    else if (classMode)
+        kernels->nodeVoltageClass(Qn.data(), V_sum.data(), paramClass.data(), classCoefficients(), out, first, last);
+    else
+        kernels->nodeVoltage(Qn.data(), V_sum.data(), C.data(), Cj.data(), legs.data(), out, first, last);
+}
+
+// 範囲[first, last)のVnを計算する(vsum・outは添字shiftの素子から始まる配列)
+// 素子ごとの配列もshiftだけずらして渡すので、カーネルからはshiftから始まる格子に見える
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::nodeVoltageRange(const Real *vsum, Real *out, int first, int last,
+                                                                   int shift)
+{
+    if constexpr (!isDouble)
+        kernels->nodeVoltageFloat(Qn.data() + shift, vsum, C.data() + shift, Cj.data() + shift, legs.data() + shift,
+                                  out, first - shift, last - shift);
+    else if (classMode)
+        kernels->nodeVoltageClass(Qn.data() + shift, vsum, paramClass.data() + shift, classCoefficients(), out,
+                                  first - shift, last - shift);
+    else
+        kernels->nodeVoltage(Qn.data() + shift, vsum, C.data() + shift, Cj.data() + shift, legs.data() + shift, out,
+                             first - shift, last - shift);
+}
+
+// 素子iの乱数列から平均1の指数分布の乱数を引く(他の素子と状態を共有しないので並列に引ける)
+template <typename Topology, typename Real>
+inline double Grid2D<BasicFlatSEO<Topology, Real>>::cellExponential(int i)
+{
+    return exponentialVariate(rngSeed, rngStreamBase + static_cast<std::uint64_t>(i), rngCounter[i]++);
+}
+
+// 指定位置の要素のビューを取得
+// shared_ptr<SEO>と同じく、constなgridからでも素子の状態は書き換えられる
+template <typename Topology, typename Real>
+inline typename Grid2D<BasicFlatSEO<Topology, Real>>::ElementRef Grid2D<BasicFlatSEO<Topology, Real>>::getElement(int row, int col) const
+{
+    if (row < 0 || row >= rows_ || col < 0 || col >= cols_)
+    {
+        throw std::out_of_range("Grid2D::getElement index out of range");
+    }
+    return ElementRef(const_cast<Grid2D *>(this), row * cols_ + col);
+}
+
+// 1素子のノード電圧
+template <typename Topology, typename Real>
+inline Real Grid2D<BasicFlatSEO<Topology, Real>>::nodeVoltage(int i) const
+{
+    if (classMode)
+    {
+        const int c = paramClass[i];
+        return (Qn[i] + classC[c] * V_sum[i]) * classInvCtot[c];
+    }
+    return Qn[i] / Cj[i] + (C[i] / (Cj[i] * (legs[i] * C[i] + Cj[i]))) * (Cj[i] * V_sum[i] - legs[i] * Qn[i]);
+}
+
+// 1素子のdEを計算
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::computedE(int i)
+{
+    if (classMode)
+    {
+        const int c = paramClass[i];
+        const double a = (Qn[i] + classC[c] * V_sum[i]) * classEOverCtot[c];
+        dE[i][TunnelDirection::Up] = a - classHalfE2OverCtot[c];
+        dE[i][TunnelDirection::Down] = -a - classHalfE2OverCtot[c];
+        return;
+    }
+    const Real q = static_cast<Real>(e);
+    dE[i][TunnelDirection::Up] = -q * (q - 2 * (Qn[i] + C[i] * V_sum[i])) / (2 * (legs[i] * C[i] + Cj[i]));
+    dE[i][TunnelDirection::Down] = -q * (q + 2 * (Qn[i] + C[i] * V_sum[i])) / (2 * (legs[i] * C[i] + Cj[i]));
+}
+
+// 全ての隣接素子が格子の中にあるか(どのトポロジも隣接は1つ隣まで)
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::isInterior(int row, int col) const
+{
+    return row > 0 && row < rows_ - 1 && col > 0 && col < cols_ - 1;
+}
+
+// 隣接素子に対してfを呼ぶ
+template <typename Topology, typename Real>
+template <typename F>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::forEachNeighbour(int idx, F f) const
+{
+    const int i = idx / cols_, j = idx % cols_;
+    if (isInterior(i, j))
+    {
+        for (int off : neighbourOffsets)
+            f(idx + off);
+        return;
+    }
+    for (const NeighbourOffset &o : Topology::offsets)
+    {
+        const int r = i + o.dr, c = j + o.dc;
+        if (r >= 0 && r < rows_ && c >= 0 && c < cols_)
+            f(r * cols_ + c);
+    }
+}
+
+// 端から離れた素子の隣接素子の和
+template <typename Topology, typename Real>
+template <std::size_t... K>
+inline Real Grid2D<BasicFlatSEO<Topology, Real>>::interiorSum(const Real *v, int idx, std::index_sequence<K...>) const
+{
+    Real sum = 0;
+    ((sum += v[idx + neighbourOffsets[K]]), ...);
+    return sum;
+}
+
+// 1素子の隣接素子のvの和
+template <typename Topology, typename Real>
+inline Real Grid2D<BasicFlatSEO<Topology, Real>>::neighbourSum(const Real *v, int idx) const
+{
+    if (isInterior(idx / cols_, idx % cols_))
+        return interiorSum(v, idx, std::make_index_sequence<Topology::legs>());
+    Real sum = 0;
+    forEachNeighbour(idx, [&](int k) { sum += v[k]; });
+    return sum;
+}
+
+// row行目の全素子について、隣接素子のvの和をout[idx]に書き込む
+// 端の行・列だけ範囲を確かめ、残りは展開した添字の差で足す
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::neighbourSumRow(const Real *v, int row, Real *out, int shift) const
+{
+    const int rowBegin = row * cols_;
+    // 範囲を確かめて足す(端から離れた素子でも足す順は同じ)
+    auto edgeSum = [&](int idx) {
+        Real sum = 0;
+        forEachNeighbour(idx, [&](int k) { sum += v[k - shift]; });
+        return sum;
+    };
+    if (row == 0 || row == rows_ - 1 || cols_ < 3)
+    {
+        for (int idx = rowBegin; idx < rowBegin + cols_; ++idx)
+        {
+            out[idx - shift] = edgeSum(idx);
+        }
+        return;
+    }
+    out[rowBegin - shift] = edgeSum(rowBegin);
+    for (int idx = rowBegin + 1; idx < rowBegin + cols_ - 1; ++idx)
+    {
+        out[idx - shift] = interiorSum(v, idx - shift, std::make_index_sequence<Topology::legs>());
+    }
+    out[rowBegin + cols_ - 1 - shift] = edgeSum(rowBegin + cols_ - 1);
+}
+
+// 全素子のV_sumを隣接素子のVnとVextから計算する（Topology::offsetsの順に足す）
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::computeNeighbourSums()
+{
+    const Real *vn = Vn.data();
+    Real *vsum = V_sum.data();
+    parallelChunks(pool.get(), 0, rows_, [&](int, int first, int last) {
+        for (int i = first; i < last; ++i)
+        {
+            neighbourSumRow(vn, i, vsum);
+            for (int idx = i * cols_; idx < (i + 1) * cols_; ++idx)
+            {
+                vsum[idx] += Vext[idx];
+            }
+        }
+    });
+}
+
+// グリッド全体の接続されている電圧を更新
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::updateGridSurVn()
+{
+    if constexpr (hasIncremental)
+    {
+        if (tracker.enabled())
+        {
+            tracker.relax(*this);
+            return;
+        }
+    }
+    computeNeighbourSums();
+}
+
+// グリッド全体のノード電圧Vnを計算・更新
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::updateGridVn()
+{
+    if constexpr (hasIncremental)
+    {
+        if (tracker.enabled())
+        {
+            tracker.relax(*this);
+            return;
+        }
+    }
+    parallelChunks(pool.get(), 0, numCells(), [this](int, int first, int last) {
+        nodeVoltageRange(Vn.data(), first, last);
+    });
+}
+
+// 設定に従ってグリッド全体のVnを緩和する
+template <typename Topology, typename Real>
+inline RelaxationStats Grid2D<BasicFlatSEO<Topology, Real>>::relax(const RelaxationConfig &config)
+{
+    if constexpr (hasIncremental)
+    {
+        if (tracker.enabled())
+        {
+            if (config.method != RelaxationMethod::Jacobi || config.tileRows > 0)
+            {
+                throw std::invalid_argument(
+                    "Incremental update relaxes only the dirty cells; use Jacobi without tiles");
+            }
+            // 波の数が全体計算での反復回数にあたるので、maxIterations・toleranceは波に使う
+            return tracker.relax(*this, config.maxIterations, config.tolerance);
+        }
+    }
+    backends::require(config);
+    if constexpr (backends::matrix)
+    {
+        if (config.method == RelaxationMethod::Direct)
+        {
+            return matrixRelaxation.relaxDirect(*this);
+        }
+        if (config.method == RelaxationMethod::Multigrid)
+        {
+            return matrixRelaxation.relaxMultigrid(*this, config);
+        }
+    }
+    if constexpr (backends::tiled)
+    {
+        if (config.method == RelaxationMethod::Jacobi && config.tileRows > 0)
+        {
+            return tiledJacobi.relax(*this, config);
+        }
+    }
+    RelaxationStats stats;
+    const int n = numCells();
+    const Real omega = static_cast<Real>(config.omega);
+    chunkValues.resize(numChunks(pool.get()));
+    for (int it = 0; it < config.maxIterations; ++it)
+    {
+        std::fill(chunkValues.begin(), chunkValues.end(), 0.0);
+        if (config.method == RelaxationMethod::Jacobi)
+        {
+            // 古いVnから読んでVnNextに書き、最後に入れ替える(並列でも読み書きが競合しない)
+            VnNext.resize(n);
+            parallelChunks(pool.get(), 0, rows_, [&](int chunk, int first, int last) {
+                Real res = 0;
+                for (int i = first; i < last; ++i)
+                {
+                    const int rowBegin = i * cols_, rowEnd = rowBegin + cols_;
+                    neighbourSumRow(Vn.data(), i, V_sum.data());
+                    for (int idx = rowBegin; idx < rowEnd; ++idx)
+                    {
+                        V_sum[idx] += Vext[idx];
+                    }
+                    nodeVoltageRange(VnNext.data(), rowBegin, rowEnd);
+                    for (int idx = rowBegin; idx < rowEnd; ++idx)
+                        res = std::max(res, std::fabs(VnNext[idx] - Vn[idx]));
+                }
+                chunkValues[chunk] = res;
+            });
+            Vn.swap(VnNext);
+        }
+        else
+        {
+            // 赤(i+jが偶数)→黒(i+jが奇数)の順に、その場で更新する
+            // 4近傍なら同じ色の素子同士は独立なので並列にできる(斜めの隣接があるトポロジは逐次)
+            ThreadPool *sorPool = isVonNeumann ? pool.get() : nullptr;
+            for (int color = 0; color < 2; ++color)
+            {
+                parallelChunks(sorPool, 0, rows_, [&](int chunk, int first, int last) {
+                    Real res = static_cast<Real>(chunkValues[chunk]);
+                    for (int i = first; i < last; ++i)
+                    {
+                        for (int j = (i + color) % 2; j < cols_; j += 2)
+                        {
+                            const int idx = i * cols_ + j;
+                            V_sum[idx] = neighbourSum(Vn.data(), idx) + Vext[idx];
+                            const Real delta = omega * (nodeVoltage(idx) - Vn[idx]);
+                            Vn[idx] += delta;
+                            res = std::max(res, std::fabs(delta));
+                        }
+                    }
+                    chunkValues[chunk] = res;
+                });
+            }
+        }
+        const double residual = *std::max_element(chunkValues.begin(), chunkValues.end());
+        stats.iterations = it + 1;
+        stats.residual = residual;
+        if (config.tolerance > 0 && residual <= config.tolerance)
+            break;
+    }
+    // SORでは最後に更新したVnでV_sumを揃えておく(dEの計算に使うため)
+    if (config.method == RelaxationMethod::RedBlackSOR)
+    {
+        updateGridSurVn();
+    }
+    return stats;
+}
+
+// この格子でconfigの緩和方法を使えるか
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::supportsRelaxation(const RelaxationConfig &config)
+{
+    return backends::supports(config);
+}
+// グリッド全体のエネルギー変化dEを計算・更新
+// (インクリメンタル更新時は記録された素子だけ計算し、トンネル候補を更新する)
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::updateGriddE()
+{
+    if constexpr (hasIncremental)
+    {
+        if (tracker.enabled())
+        {
+            tracker.updatedE(*this);
+            return;
+        }
+    }
+    parallelChunks(pool.get(), 0, numCells(), [this](int, int first, int last) {
+        if constexpr (!isDouble)
+            kernels->energyChangeFloat(Qn.data(), V_sum.data(), C.data(), Cj.data(), legs.data(), pairData(dE), first,
+                                       last);
+        else if (classMode)
+            kernels->energyChangeClass(Qn.data(), V_sum.data(), paramClass.data(), classCoefficients(), pairData(dE),
+                                       first, last);
+        else
+            kernels->energyChange(Qn.data(), V_sum.data(), C.data(), Cj.data(), legs.data(), pairData(dE), first,
+                                  last);
+    });
+}
+
+// グリッド全体のトンネル待ち時間wtを計算し、最小wtとトンネル素子・方向を記録
+// (インクリメンタル更新時はトンネル候補だけを添字順に調べるので、乱数の引き方は全体計算と同じ)
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::gridminwt(const double dt)
+{
+    minwt = dt;
+    tunnelindex = -1;
+    auto evaluate = [&](int i) {
+        wt[i] = pair_type();
+        // upとdownが同時に正になることはないので、正の方だけ計算する
+        TunnelDirection dir = TunnelDirection::Up;
+        if (!(dE[i][dir] > 0))
+        {
+            dir = TunnelDirection::Down;
+            if (!(dE[i][dir] > 0))
+                return;
+        }
+        wt[i][dir] = (e * e * cellRj(i) / dE[i][dir]) * cellExponential(i);
+        if (wt[i][dir] < minwt)
+        {
+            minwt = wt[i][dir];
+            tunnelindex = i;
+            tunneldirection = dir;
+        }
+    };
+
+    if constexpr (hasIncremental)
+    {
+        if (tracker.enabled())
+        {
+            tracker.evaluateCandidates(*this, evaluate);
+            return minwt < dt;
+        }
+    }
+
+    // 1. 区間ごとに、トンネルしうる素子が自分の乱数列から指数分布の乱数をまとめて引き、カーネルでwtと最小値を求める
+    //    (floatでは乱数をdoubleで引いてから丸める)
+    const int n = numCells();
+    const int chunks = numChunks(pool.get());
+    chunkValues.assign(chunks, dt);
+    chunkIndices.assign(chunks, -1);
+    chunkDirections.assign(chunks, TunnelDirection::Up);
+    expo.resize(n);
+    parallelChunks(pool.get(), 0, n, [&](int chunk, int first, int last) {
+        WaitTimeMin found;
+        if constexpr (!isDouble)
+        {
+            kernels->exponentialDrawFloat(pairData(dE), rngSeed, rngStreamBase, rngCounter.data(), expo.data(), first,
+                                          last);
+            found = kernels->waitTimeArgminFloat(pairData(dE), Rj.data(), expo.data(), pairData(wt), first, last);
+        }
+        else
+        {
+            kernels->exponentialDraw(pairData(dE), rngSeed, rngStreamBase, rngCounter.data(), expo.data(), first,
+                                     last);
+            found = classMode ? kernels->waitTimeArgminClass(pairData(dE), paramClass.data(), classCoefficients(),
+                                                             expo.data(), pairData(wt), first, last)
+                              : kernels->waitTimeArgmin(pairData(dE), Rj.data(), expo.data(), pairData(wt), first,
+                                                        last);
+        }
+        if (found.index >= 0 && found.wt < chunkValues[chunk])
+        {
+            chunkValues[chunk] = found.wt;
+            chunkIndices[chunk] = found.index;
+            chunkDirections[chunk] =
+                (dE[found.index][TunnelDirection::Up] > 0) ? TunnelDirection::Up : TunnelDirection::Down;
+        }
+    });
+    // 2. 区間の順にまとめる(同じwtなら添字の小さい方が残る)
+    for (int c = 0; c < chunks; ++c)
+    {
+        if (chunkValues[c] < minwt)
+        {
+            minwt = chunkValues[c];
+            tunnelindex = chunkIndices[c];
+            tunneldirection = chunkDirections[c];
+        }
+    }
+    return minwt < dt;
+}
+
+// グリッド全体のノード電荷Qnを計算・更新
+// (インクリメンタル更新時は、Vn・dEへの影響が許容誤差を超えた素子だけ記録する)
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::updateGridQn(const double dt)
+{
+    tracker.setExponentialCharging(false);
+    const Real h = static_cast<Real>(dt);
+    if (!classMode)
+        addCharges(dt, [this, h](int i) { return (Vd[i] - Vn[i]) * h / R[i]; });
+    else if (!tracker.enabled())
+        // クラスの1/Rを使うので割り算は無い
+        addCharges(dt, [this, dt](int i) {
+            const int c = paramClass[i];
+            return (classVd[c] - Vn[i]) * dt * classInvR[c];
+        });
+    else
+        addCharges(dt, [this, dt](int i) { return (cellVd(i) - Vn[i]) * dt / cellR(i); });
+}
+
+// グリッド全体のノード電荷QnをRC充電の解析解で更新
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::updateGridQnExponential(const double dt)
+{
+    tracker.setExponentialCharging(true);
+    const Real h = static_cast<Real>(dt);
+    addCharges(dt, [this, h](int i) {
+        return precision_kernels::exponentialChargeIncrement(cellVd(i), Vn[i], cellR(i),
+                                                             cellLegs(i) * cellC(i) + cellCj(i), h);
+    });
+}
+
+// いずれかの素子のdEが正になるまでの時間
+template <typename Topology, typename Real>
+inline double Grid2D<BasicFlatSEO<Topology, Real>>::nextThresholdTime() const
+{
+    std::vector<double> chunks(numChunks(pool.get()), std::numeric_limits<double>::infinity());
+    parallelChunks(pool.get(), 0, numCells(), [&](int chunk, int first, int last) {
+        for (int i = first; i < last; ++i)
+        {
+            // 時刻に関わるのでdoubleで求める
+            const double c = cellC(i);
+            const double t = thresholdCrossingTime(cellCharge(i) + c * V_sum[i], cellVd(i), cellR(i),
+                                                   cellLegs(i) * c + cellCj(i));
+            chunks[chunk] = std::min(chunks[chunk], t);
+        }
+    });
+    return *std::min_element(chunks.begin(), chunks.end());
+}
+
+// V_sumのずれがtolerance以下に収まる時間
+template <typename Topology, typename Real>
+inline double Grid2D<BasicFlatSEO<Topology, Real>>::vsumDriftTime(double tolerance) const
+{
+    const double delta = tolerance / Topology::legs;
+    std::vector<double> chunks(numChunks(pool.get()), std::numeric_limits<double>::infinity());
+    parallelChunks(pool.get(), 0, numCells(), [&](int chunk, int first, int last) {
+        for (int i = first; i < last; ++i)
+        {
+            // 隣接素子が無ければ、他の素子のV_sumには関わらない
+            bool coupled = false;
+            forEachNeighbour(i, [&](int) { coupled = true; });
+            if (!coupled)
+                continue;
+            const double t =
+                voltageDriftTime(Vn[i], cellVd(i), cellR(i), cellLegs(i) * cellC(i) + cellCj(i), delta);
+            chunks[chunk] = std::min(chunks[chunk], t);
+        }
+    });
+    return *std::min_element(chunks.begin(), chunks.end());
+}
+
+// レートを一定とみなせる時間
+template <typename Topology, typename Real>
+inline double Grid2D<BasicFlatSEO<Topology, Real>>::stableRateTime(double tolerance) const
+{
+    const double delta = tolerance / Topology::legs;
+    double limit = std::numeric_limits<double>::infinity();
+    auto visit = [&](int i) {
+        const double ctot = cellLegs(i) * cellC(i) + cellCj(i);
+        // dEが正の素子はレートに乗っているので、しきい値ではなくVnのずれだけで決まる
+        if (!(dE[i][TunnelDirection::Up] > 0 || dE[i][TunnelDirection::Down] > 0))
+            limit = std::min(limit, thresholdCrossingTime(cellCharge(i) + cellC(i) * V_sum[i], cellVd(i), cellR(i), ctot));
+        bool coupled = false;
+        forEachNeighbour(i, [&](int) { coupled = true; });
+        if (coupled)
+            limit = std::min(limit, voltageDriftTime(Vn[i], cellVd(i), cellR(i), ctot, delta));
+    };
+    if constexpr (hasIncremental)
+    {
+        if (tracker.activeSet())
+        {
+            // 眠っている素子は起こす時刻まではしきい値を超えず、Vnもインクリメンタル更新の許容誤差までしか変わらない
+            const double wakeTime = tracker.visitActive(visit);
+            return std::min(limit, wakeTime);
+        }
+    }
+    for (int i = 0; i < numCells(); ++i)
+        visit(i);
+    return limit;
+}
+
+// 直前のupdateGriddEでdEを計算し直した素子
+template <typename Topology, typename Real>
+inline const std::vector<int> &Grid2D<BasicFlatSEO<Topology, Real>>::getdEUpdatedCells() const
+{
+    return tracker.dEUpdatedCells();
+}
+
+// 全素子の電荷にdq(i)を足す(インクリメンタル更新時は変化の大きい素子を計算し直す対象にする)
+template <typename Topology, typename Real>
+template <typename Increment>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::addCharges(double dt, Increment dq)
+{
+    if constexpr (hasIncremental)
+    {
+        if (tracker.enabled())
+        {
+            tracker.addCharges(*this, dt, dq);
+            return;
+        }
+    }
+    parallelChunks(pool.get(), 0, numCells(), [&](int, int first, int last) {
+        for (int i = first; i < last; ++i)
+        {
+            Qn[i] += dq(i);
+        }
+    });
+}
+// 外部から加える電圧を設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setExternalVoltage(int index, double v)
+{
+    if (tracker.enabled())
+    {
+        V_sum[index] += v - Vext[index];
+        tracker.touch(*this, index);
+    }
+    Vext[index] = v;
+}
+
+// 並列実行に使うスレッドプールを設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setThreadPool(std::shared_ptr<ThreadPool> threadPool)
+{
+    pool = std::move(threadPool);
+}
+
+// スレッドプールを取得
+template <typename Topology, typename Real>
+inline std::shared_ptr<ThreadPool> Grid2D<BasicFlatSEO<Topology, Real>>::getThreadPool() const
+{
+    return pool;
+}
+
+// Vn・dE・wtの一括計算に使う命令セットを設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setSimdLevel(SimdLevel level)
+{
+    kernels = &seoKernels(level);
+}
+
+// Vn・dE・wtの一括計算に使っている命令セットを取得
+template <typename Topology, typename Real>
+inline SimdLevel Grid2D<BasicFlatSEO<Topology, Real>>::getSimdLevel() const
+{
+    return kernels->level;
+}
+
+// (up, down)の組の配列をRealの配列として見る
+template <typename Topology, typename Real>
+inline Real *Grid2D<BasicFlatSEO<Topology, Real>>::pairData(std::vector<pair_type> &pairs)
+{
+    static_assert(sizeof(pair_type) == 2 * sizeof(Real), "TunnelPair must be two packed values");
+    return pairs.empty() ? nullptr : &pairs.front()[TunnelDirection::Up];
+}
+
+// パラメータクラスモードの切り替え
+template <typename Topology, typename Real>
+template <typename Scalar, RequireDoubleGrid<Scalar>>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setParameterClasses(bool enabled)
+{
+    if (enabled == classMode)
+        return;
+    const int n = numCells();
+    if (enabled)
+    {
+        // 途中で例外になったら(クラスが多すぎる)元の状態のままにする
+        std::vector<std::uint16_t> cls(n);
+        try
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                cls[i] = internClass(SEOParameterClass{R[i], Rj[i], Cj[i], C[i], Vd[i], legs[i]});
+            }
+        }
+        catch (...)
+        {
+            clearClassTables();
+            throw;
+        }
+        paramClass.swap(cls);
+        for (auto *field : {&R, &Rj, &Cj, &C, &Vd})
+        {
+            std::vector<Real>().swap(*field);
+        }
+        std::vector<int>().swap(legs);
+        classMode = true;
+        return;
+    }
+    // 素子ごとの配列に戻す
+    R.resize(n);
+    Rj.resize(n);
+    Cj.resize(n);
+    C.resize(n);
+    Vd.resize(n);
+    legs.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        const SEOParameterClass &p = classParams[paramClass[i]];
+        R[i] = p.R;
+        Rj[i] = p.Rj;
+        Cj[i] = p.Cj;
+        C[i] = p.C;
+        Vd[i] = p.Vd;
+        legs[i] = p.legs;
+    }
+    classMode = false;
+    std::vector<std::uint16_t>().swap(paramClass);
+    clearClassTables();
+}
+
+// クラスの表を空にする
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::clearClassTables()
+{
+    classParams.clear();
+    classLookup.clear();
+    for (auto *table : {&classC, &classInvCtot, &classEOverCtot, &classHalfE2OverCtot, &classE2Rj, &classInvR, &classVd})
+    {
+        table->clear();
+    }
+}
+
+// パラメータクラスモードかどうか
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::isParameterClasses() const
+{
+    return classMode;
+}
+
+// パラメータクラスの数を取得
+template <typename Topology, typename Real>
+inline int Grid2D<BasicFlatSEO<Topology, Real>>::numParameterClasses() const
+{
+    return static_cast<int>(classParams.size());
+}
+
+// インクリメンタル更新の切り替え
+template <typename Topology, typename Real>
+template <typename Scalar, RequireDoubleGrid<Scalar>>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setIncrementalUpdate(bool enabled, double tolerance)
+{
+    tracker.setEnabled(*this, enabled, tolerance);
+    if (!enabled)
+    {
+        green.disable();
+    }
+}
+
+// インクリメンタル更新中かどうか
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::isIncrementalUpdate() const
+{
+    return tracker.enabled();
+}
+
+// V_sumを全素子で計算し直し、全素子を再計算の対象にする
+template <typename Topology, typename Real>
+template <typename Scalar, RequireDoubleGrid<Scalar>>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::resyncIncremental()
+{
+    tracker.resync(*this);
+}
+
+// V_sumを隣接素子から計算し直す間隔を設定
+template <typename Topology, typename Real>
+template <typename Scalar, RequireDoubleGrid<Scalar>>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setResyncInterval(int relaxations)
+{
+    tracker.setResyncInterval(relaxations);
+}
+
+// V_sumを隣接素子から計算し直す間隔を取得
+template <typename Topology, typename Real>
+template <typename Scalar, RequireDoubleGrid<Scalar>>
+inline int Grid2D<BasicFlatSEO<Topology, Real>>::getResyncInterval() const
+{
+    return tracker.getResyncInterval();
+}
+
+// アクティブセットの切り替え
+template <typename Topology, typename Real>
+template <typename Scalar, RequireDoubleGrid<Scalar>>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setActiveSet(bool enabled)
+{
+    tracker.setActiveSet(*this, enabled);
+}
+
+// アクティブセットを使っているかどうか
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::isActiveSet() const
+{
+    return tracker.activeSet();
+}
+
+// アクティブな素子数を取得
+template <typename Topology, typename Real>
+inline int Grid2D<BasicFlatSEO<Topology, Real>>::numActiveCells() const
+{
+    return tracker.numActiveCells(*this);
+}
+
+// グリーン関数によるトンネル時の更新の切り替え
+template <typename Topology, typename Real>
+template <typename Stencil, typename Scalar, RequireVonNeumannDoubleGrid<Stencil, Scalar>>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setGreenUpdate(bool enabled, double tolerance)
+{
+    green.setEnabled(*this, enabled, tolerance);
+}
+
+// グリーン関数による更新中かどうか
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::isGreenUpdate() const
+{
+    return green.enabled();
+}
+
+// グリーン関数の打ち切り半径を取得
+template <typename Topology, typename Real>
+template <typename Stencil, typename Scalar, RequireVonNeumannDoubleGrid<Stencil, Scalar>>
+inline int Grid2D<BasicFlatSEO<Topology, Real>>::getGreenRadius()
+{
+    return green.radius(*this);
+}
+
+// 乱数のシードを設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::seedRandom(std::uint64_t seed)
+{
+    rngSeed = seed;
+    std::fill(rngCounter.begin(), rngCounter.end(), 0);
+}
+
+// 乱数列の番号のずれを設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setRandomStreamBase(std::uint64_t streamBase)
+{
+    rngStreamBase = streamBase;
+}
+
+// グリッドの行数を取得
+template <typename Topology, typename Real>
+inline int Grid2D<BasicFlatSEO<Topology, Real>>::numRows() const
+{
+    return rows_;
+}
+
+// グリッドの列数を取得
+template <typename Topology, typename Real>
+inline int Grid2D<BasicFlatSEO<Topology, Real>>::numCols() const
+{
+    return cols_;
+}
+
+// 素子数を取得
+template <typename Topology, typename Real>
+inline int Grid2D<BasicFlatSEO<Topology, Real>>::numCells() const
+{
+    return rows_ * cols_;
+}
+
+// トンネルレートを取得
+template <typename Topology, typename Real>
+inline double Grid2D<BasicFlatSEO<Topology, Real>>::tunnelRate(int index, TunnelDirection direction) const
+{
+    double de = dE[index][direction];
+    return de > 0 ? de / (e * e * cellRj(index)) : 0.0;
+}
+
+// 最小wtでトンネルが発生する素子を取得
+template <typename Topology, typename Real>
+inline typename Grid2D<BasicFlatSEO<Topology, Real>>::ElementRef Grid2D<BasicFlatSEO<Topology, Real>>::getTunnelPlace() const
+{
+    if (tunnelindex < 0)
+    {
+        throw std::logic_error("No tunnel has been selected");
+    }
+    return ElementRef(const_cast<Grid2D *>(this), tunnelindex);
+}
+
+// 最小wtでトンネルが発生する素子の添字を取得
+template <typename Topology, typename Real>
+inline int Grid2D<BasicFlatSEO<Topology, Real>>::getTunnelIndex() const
+{
+    return tunnelindex;
+}
+
+// 添字で指定した素子をトンネルさせる
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::applyTunnel(int index, TunnelDirection direction)
+{
+    if (index < 0 || index >= numCells())
+    {
+        throw std::out_of_range("Tunnel index out of range");
+    }
+    const Real dq = static_cast<Real>((direction == TunnelDirection::Up) ? -e : e);
+    Qn[index] += dq;
+    if constexpr (hasGreen)
+    {
+        if (green.enabled())
+        {
+            green.apply(*this, index, dq);
+            return;
+        }
+    }
+    tracker.touch(*this, index);
+}
+
+// トンネルの方向を取得
+template <typename Topology, typename Real>
+inline TunnelDirection Grid2D<BasicFlatSEO<Topology, Real>>::getTunnelDirection() const
+{
+    return tunneldirection;
+}
+
+// 最小トンネル待ち時間wtを取得
+template <typename Topology, typename Real>
+inline double Grid2D<BasicFlatSEO<Topology, Real>>::getMinWT() const
+{
+    return minwt;
+}
+
+// outputlabelの設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setOutputLabel(const std::string &label)
+{
+    outputlabel = label;
+}
+
+// outputlabelの取得
+template <typename Topology, typename Real>
+inline std::string Grid2D<BasicFlatSEO<Topology, Real>>::getOutputLabel() const
+{
+    return outputlabel;
+}
+
+// outputlabelが設定されているかの取得
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::hasOutputLabel() const
+{
+    return !outputlabel.empty();
+}
+
+// outputEnabledにbool値を設定
+template <typename Topology, typename Real>
+inline void Grid2D<BasicFlatSEO<Topology, Real>>::setOutputEnabled(bool flag)
+{
+    outputEnabled = flag;
+}
+
+// OutputEnabledを取得
+template <typename Topology, typename Real>
+inline bool Grid2D<BasicFlatSEO<Topology, Real>>::isOutputEnabled() const
+{
+    return outputEnabled;
+}
+
+#endif // FLAT_SEO_GRID_HPP
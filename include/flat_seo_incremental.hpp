@@ -0,0 +1,510 @@
+#ifndef FLAT_SEO_INCREMENTAL_HPP
+#define FLAT_SEO_INCREMENTAL_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <cstddef>
+#include "seo_class.hpp"
+#include "relaxation.hpp"
+#include "charge_integration.hpp"
+#include "indexed_heap.hpp"
+
+// Grid2D<BasicFlatSEO<Topology, double>>のインクリメンタル更新とアクティブセット
+// 格子の配列を直接読み書きするので、格子からfriendにされて格子のメンバとして持たれる。
+//
+// インクリメンタル更新(setEnabled)では、Q・V_sumが変わった素子だけを記録し、
+// 変化が許容誤差を超える素子とその周囲だけVn・V_sum・dE・wtを計算し直す
+//
+// アクティブセット(setActiveSet、インクリメンタル更新時のみ)では、しきい値から遠く変化の小さい素子を眠らせ、
+// 充電もアクティブな素子だけ行う。眠っている素子は、Vnが変わらない間の充電の速さの上限から
+// 「許容誤差を超える・dEが正になる」までの時間の下限を求め、その時刻か周囲が変わったときに起こす
+// (眠っていた間の充電は起こすときにまとめて足す)。1ステップの仕事量が格子の面積でなく活動量に比例する
+class FlatIncrementalTracker
+{
+private:
+    bool enabled_ = false;         // インクリメンタル更新を使うか
+    double tolerance_ = 0.0;       // 無視できるVn・電荷の変化量
+    std::vector<int> relaxQueue;   // Vnを計算し直す素子
+    std::vector<char> inRelaxQueue;
+    std::vector<int> dEQueue;      // dEを計算し直す素子
+    std::vector<char> indEQueue;
+    std::vector<int> dEUpdated;    // 直前のupdatedEでdEを計算し直した素子
+    std::vector<double> dQsincedE; // 前回のdE計算からの充電による電荷の変化量
+    std::vector<int> candidates;   // dEが正になっている素子（トンネル候補）
+    std::vector<char> isCandidate;
+    std::vector<int> wtCells;      // 前回のevaluateCandidatesでwtを書き込んだ素子
+    int resyncInterval = 1024;     // V_sumを隣接素子から計算し直す間隔(relaxの呼び出し回数。0なら行わない)
+    int relaxesSinceResync = 0;
+
+    //---- アクティブセット用 ----//
+    bool activeTracking = false;      // アクティブセットを使うか
+    bool exponentialCharging = false; // 直前の充電が解析解(updateGridQnExponential)か
+    double chargeClock = 0.0;         // 充電で進めた時間の合計
+    std::vector<int> activeCells;     // 毎ステップ充電・判定する素子
+    std::vector<char> isActive;
+    std::vector<double> chargedUntil; // 眠っている素子の電荷が計算済みの時刻(chargeClock基準)
+    IndexedMinHeap sleepers;          // 眠っている素子と起こす時刻
+
+    // Vnを一定として、時間hの間の素子iの充電量(眠っていた間の分をまとめて足すときに使う)
+    template <typename Grid>
+    double chargeIncrement(const Grid &grid, int i, double h) const;
+
+    // 素子iが許容誤差を超える・dEが正になるまでの時間の下限(Vnが変わらない場合)
+    template <typename Grid>
+    double sleepBound(const Grid &grid, int i) const;
+
+    // アクティブな素子のうち、眠らせてよいものを眠らせる
+    template <typename Grid>
+    void sleepQuiescent(const Grid &grid);
+
+public:
+    // インクリメンタル更新中かどうか
+    bool enabled() const { return enabled_; }
+
+    // アクティブセットを使っているかどうか
+    bool activeSet() const { return activeTracking; }
+
+    // 直前のupdatedEでdEを計算し直した素子(インクリメンタル更新時のみ。それ以外は空)
+    const std::vector<int> &dEUpdatedCells() const { return dEUpdated; }
+
+    // インクリメンタル更新の切り替え(toleranceはVn[V]と電荷の変化をまとめて無視する閾値)
+    template <typename Grid>
+    void setEnabled(Grid &grid, bool enabled, double tolerance);
+
+    // アクティブセットの切り替え(インクリメンタル更新中のみ。無効にすると全素子を起こす)
+    template <typename Grid>
+    void setActiveSet(Grid &grid, bool enabled);
+
+    // V_sumを全素子で計算し直し、全素子を再計算の対象にする
+    template <typename Grid>
+    void resync(Grid &grid);
+
+    // V_sumを隣接素子から計算し直す間隔を設定(緩和の回数。0なら行わない)
+    void setResyncInterval(int relaxations);
+
+    // V_sumを計算し直す間隔を取得
+    int getResyncInterval() const { return resyncInterval; }
+
+    // 素子のQ・V_sumが変わったことを記録(インクリメンタル更新時のみ)
+    template <typename Grid>
+    void touch(Grid &grid, int i);
+
+    // 素子のVnが直接書き換えられたとき、周囲のV_sumを直す(インクリメンタル更新時のみ)
+    template <typename Grid>
+    void touchNeighbours(Grid &grid, int i);
+
+    // 記録された素子からVnの変化を周囲へ伝え、許容誤差以下になるまで緩和する
+    // (iterationsは変化が伝わった波の数、residualは最後の波でのVnの最大変化量)
+    // maxWaves回の波か、波での最大変化量がtolerance(0なら使わない)以下になったら打ち切り、残りは次回に回す
+    template <typename Grid>
+    RelaxationStats relax(Grid &grid, int maxWaves = std::numeric_limits<int>::max(), double tolerance = 0.0);
+
+    // 全素子のV_sumを隣接素子のVnから計算し直し、差分の更新で溜まった丸め誤差を消す(ずれた素子は記録する)
+    template <typename Grid>
+    void resyncNeighbourSums(Grid &grid);
+
+    // 記録された素子だけdEを計算し直し、トンネル候補を更新する
+    template <typename Grid>
+    void updatedE(Grid &grid);
+
+    // 前回のwtを消し、トンネル候補を添字順にevaluate(i)で調べる(乱数の引き方は全体計算と同じ)
+    template <typename Grid, typename Evaluate>
+    void evaluateCandidates(Grid &grid, Evaluate evaluate);
+
+    // 電荷にdq(i)を足し、変化の大きい素子を計算し直す対象にする
+    // アクティブセット使用時は、起こす時刻になった素子を起こしてから、アクティブな素子だけを添字順に調べる
+    template <typename Grid, typename Increment>
+    void addCharges(Grid &grid, double dt, Increment dq);
+
+    // 直前の充電が解析解かを記録(眠っていた間の充電を同じ式で足すため)
+    void setExponentialCharging(bool exponential) { exponentialCharging = exponential; }
+
+    // 眠っている間の充電を含めた素子iの電荷
+    template <typename Grid>
+    double cellCharge(const Grid &grid, int i) const;
+
+    // 眠っている素子を起こし、電荷を今の時刻まで進める
+    template <typename Grid>
+    void wake(Grid &grid, int i);
+
+    // アクティブな素子に対してvisit(i)を呼び、眠っている素子を次に起こすまでの時間を返す
+    template <typename Visit>
+    double visitActive(Visit visit) const;
+
+    // アクティブな(毎ステップ充電・判定している)素子数(アクティブセットを使っていなければ全素子数)
+    template <typename Grid>
+    int numActiveCells(const Grid &grid) const;
+};
+
+// 倍精度以外の格子が持つ空のトラッカー(インクリメンタル更新は常に無効)
+struct FlatNoIncremental
+{
+    static constexpr bool enabled() { return false; }
+    static constexpr bool activeSet() { return false; }
+
+    const std::vector<int> &dEUpdatedCells() const
+    {
+        static const std::vector<int> none;
+        return none;
+    }
+
+    template <typename Grid>
+    void touch(Grid &, int) {}
+    template <typename Grid>
+    void touchNeighbours(Grid &, int) {}
+    template <typename Grid>
+    void wake(Grid &, int) {}
+    void setExponentialCharging(bool) {}
+
+    template <typename Grid>
+    double cellCharge(const Grid &grid, int i) const { return grid.Qn[i]; }
+
+    template <typename Grid>
+    int numActiveCells(const Grid &grid) const { return grid.numCells(); }
+};
+
+// インクリメンタル更新の切り替え
+template <typename Grid>
+inline void FlatIncrementalTracker::setEnabled(Grid &grid, bool enabled, double tolerance)
+{
+    if (tolerance < 0)
+    {
+        throw std::invalid_argument("Tolerance must be non-negative");
+    }
+    // 眠らせた時刻は前の許容誤差から決めたので、全素子を起こしてから変える
+    const bool tracking = activeTracking;
+    setActiveSet(grid, false);
+    tolerance_ = tolerance;
+    if (enabled == enabled_)
+    {
+        setActiveSet(grid, enabled && tracking);
+        return;
+    }
+    enabled_ = enabled;
+    relaxQueue.clear();
+    dEQueue.clear();
+    dEUpdated.clear();
+    candidates.clear();
+    wtCells.clear();
+    if (enabled)
+    {
+        const int n = grid.numCells();
+        inRelaxQueue.assign(n, 0);
+        indEQueue.assign(n, 0);
+        dQsincedE.assign(n, 0.0);
+        isCandidate.assign(n, 0);
+        resync(grid);
+    }
+}
+
+// アクティブセットの切り替え
+template <typename Grid>
+inline void FlatIncrementalTracker::setActiveSet(Grid &grid, bool enabled)
+{
+    if (enabled && !enabled_)
+    {
+        throw std::logic_error("Active set requires incremental update");
+    }
+    if (enabled == activeTracking)
+        return;
+    const int n = grid.numCells();
+    if (!enabled)
+    {
+        // 眠っている素子の電荷を今の時刻まで進めてから止める
+        for (int i = 0; i < n; ++i)
+            wake(grid, i);
+        activeTracking = false;
+        activeCells.clear();
+        sleepers.reset(0);
+        return;
+    }
+    activeTracking = true;
+    chargeClock = 0.0;
+    isActive.assign(n, 1);
+    chargedUntil.assign(n, 0.0);
+    activeCells.resize(n);
+    for (int i = 0; i < n; ++i)
+        activeCells[i] = i;
+    sleepers.reset(n);
+}
+
+// V_sumを全素子で計算し直し、全素子を再計算の対象にする
+template <typename Grid>
+inline void FlatIncrementalTracker::resync(Grid &grid)
+{
+    if (!enabled_)
+        return;
+    grid.computeNeighbourSums();
+    const int n = grid.numCells();
+    for (int i = 0; i < n; ++i)
+    {
+        touch(grid, i);
+    }
+    // wtは全素子分を消す
+    std::fill(grid.wt.begin(), grid.wt.end(), typename Grid::pair_type());
+}
+
+// V_sumを隣接素子から計算し直す間隔を設定
+inline void FlatIncrementalTracker::setResyncInterval(int relaxations)
+{
+    if (relaxations < 0)
+    {
+        throw std::invalid_argument("Resync interval must be non-negative");
+    }
+    resyncInterval = relaxations;
+    relaxesSinceResync = 0;
+}
+
+// 素子のQ・V_sumが変わったことを記録
+template <typename Grid>
+inline void FlatIncrementalTracker::touch(Grid &grid, int i)
+{
+    if (!enabled_)
+        return;
+    wake(grid, i);
+    if (!inRelaxQueue[i])
+    {
+        inRelaxQueue[i] = 1;
+        relaxQueue.push_back(i);
+    }
+    if (!indEQueue[i])
+    {
+        indEQueue[i] = 1;
+        dEQueue.push_back(i);
+    }
+}
+
+// 素子のVnが直接書き換えられたとき、周囲のV_sumを直す
+template <typename Grid>
+inline void FlatIncrementalTracker::touchNeighbours(Grid &grid, int i)
+{
+    if (!enabled_)
+        return;
+    grid.forEachNeighbour(i, [&](int j) {
+        double sum = 0.0;
+        grid.forEachNeighbour(j, [&](int k) { sum += grid.Vn[k]; });
+        grid.V_sum[j] = sum + grid.Vext[j];
+        touch(grid, j);
+    });
+}
+
+// 記録された素子からVnの変化を周囲へ伝え、許容誤差以下になるまで緩和する
+// (Gauss-Seidel型。Vnが変わった素子の周囲はV_sumを差分で更新し、次の対象にする)
+// 1つの波で記録された素子を次の波で計算し直すので、波の数が全体計算での反復回数にあたる
+template <typename Grid>
+inline RelaxationStats FlatIncrementalTracker::relax(Grid &grid, int maxWaves, double tolerance)
+{
+    if (resyncInterval > 0 && ++relaxesSinceResync >= resyncInterval)
+    {
+        resyncNeighbourSums(grid);
+    }
+    RelaxationStats stats;
+    std::size_t waveEnd = 0, head = 0;
+    for (; head < relaxQueue.size(); ++head)
+    {
+        if (head == waveEnd)
+        {
+            if (stats.iterations == maxWaves || (stats.iterations > 0 && tolerance > 0 && stats.residual <= tolerance))
+                break;
+            waveEnd = relaxQueue.size();
+            ++stats.iterations;
+            stats.residual = 0.0;
+        }
+        const int i = relaxQueue[head];
+        inRelaxQueue[i] = 0;
+        const double delta = grid.nodeVoltage(i) - grid.Vn[i];
+        stats.residual = std::max(stats.residual, std::fabs(delta));
+        if (std::fabs(delta) <= tolerance_)
+            continue;
+        grid.Vn[i] += delta;
+        grid.forEachNeighbour(i, [&](int j) {
+            grid.V_sum[j] += delta;
+            touch(grid, j);
+        });
+    }
+    // 打ち切ったときは、まだ計算し直していない素子を次回に回す
+    relaxQueue.erase(relaxQueue.begin(), relaxQueue.begin() + static_cast<std::ptrdiff_t>(head));
+    return stats;
+}
+
+// 全素子のV_sumを隣接素子のVnから計算し直す
+template <typename Grid>
+inline void FlatIncrementalTracker::resyncNeighbourSums(Grid &grid)
+{
+    relaxesSinceResync = 0;
+    const int n = grid.numCells();
+    for (int i = 0; i < n; ++i)
+    {
+        const double exact = grid.neighbourSum(grid.Vn.data(), i) + grid.Vext[i];
+        if (exact != grid.V_sum[i])
+        {
+            grid.V_sum[i] = exact;
+            touch(grid, i);
+        }
+    }
+}
+
+// 記録された素子だけdEを計算し直し、トンネル候補を更新する
+template <typename Grid>
+inline void FlatIncrementalTracker::updatedE(Grid &grid)
+{
+    for (int i : dEQueue)
+    {
+        indEQueue[i] = 0;
+        dQsincedE[i] = 0.0;
+        grid.computedE(i);
+        const bool positive = grid.dE[i][TunnelDirection::Up] > 0 || grid.dE[i][TunnelDirection::Down] > 0;
+        if (positive && !isCandidate[i])
+            candidates.push_back(i);
+        isCandidate[i] = positive ? 1 : 0;
+    }
+    dEUpdated.swap(dEQueue);
+    dEQueue.clear();
+}
+
+// トンネル候補を添字順に調べる
+template <typename Grid, typename Evaluate>
+inline void FlatIncrementalTracker::evaluateCandidates(Grid &grid, Evaluate evaluate)
+{
+    for (int i : wtCells)
+        grid.wt[i] = typename Grid::pair_type();
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this](int i) { return !isCandidate[i]; }),
+                     candidates.end());
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    for (int i : candidates)
+        evaluate(i);
+    wtCells = candidates;
+}
+
+// 電荷にdq(i)を足し、変化の大きい素子を計算し直す対象にする
+template <typename Grid, typename Increment>
+inline void FlatIncrementalTracker::addCharges(Grid &grid, double dt, Increment dq)
+{
+    auto charge = [&](int i) {
+        const double d = dq(i);
+        grid.Qn[i] += d;
+        dQsincedE[i] += d;
+        if (std::fabs(dQsincedE[i]) > tolerance_ && !indEQueue[i])
+        {
+            indEQueue[i] = 1;
+            dEQueue.push_back(i);
+        }
+        if (std::fabs(grid.nodeVoltage(i) - grid.Vn[i]) > tolerance_ && !inRelaxQueue[i])
+        {
+            inRelaxQueue[i] = 1;
+            relaxQueue.push_back(i);
+        }
+    };
+    if (!activeTracking)
+    {
+        const int n = grid.numCells();
+        for (int i = 0; i < n; ++i)
+            charge(i);
+        return;
+    }
+    // 起こす時刻がこのステップ中に来る素子は、ここまでの分を足して起こす
+    while (!sleepers.empty() && sleepers.topKey() <= chargeClock + dt)
+        wake(grid, sleepers.top());
+    std::sort(activeCells.begin(), activeCells.end());
+    for (int i : activeCells)
+        charge(i);
+    chargeClock += dt;
+    sleepQuiescent(grid);
+}
+
+// Vnを一定として、時間hの間の素子iの充電量
+template <typename Grid>
+inline double FlatIncrementalTracker::chargeIncrement(const Grid &grid, int i, double h) const
+{
+    const double ctot = grid.cellLegs(i) * grid.cellC(i) + grid.cellCj(i);
+    if (exponentialCharging)
+        return exponentialChargeIncrement(grid.cellVd(i), grid.Vn[i], grid.cellR(i), ctot, h);
+    return (grid.cellVd(i) - grid.Vn[i]) * h / grid.cellR(i);
+}
+
+// 眠っている間の充電を含めた素子iの電荷
+template <typename Grid>
+inline double FlatIncrementalTracker::cellCharge(const Grid &grid, int i) const
+{
+    if (!activeTracking || isActive[i])
+        return grid.Qn[i];
+    return grid.Qn[i] + chargeIncrement(grid, i, chargeClock - chargedUntil[i]);
+}
+
+// 眠っている素子を起こし、電荷を今の時刻まで進める
+template <typename Grid>
+inline void FlatIncrementalTracker::wake(Grid &grid, int i)
+{
+    if (!activeTracking || isActive[i])
+        return;
+    const double d = chargeIncrement(grid, i, chargeClock - chargedUntil[i]);
+    grid.Qn[i] += d;
+    dQsincedE[i] += d;
+    sleepers.remove(i);
+    isActive[i] = 1;
+    activeCells.push_back(i);
+}
+
+// 素子iが許容誤差を超える・dEが正になるまでの時間の下限
+// Vnが変わらない間の充電の速さは|Vd - Vn|/R以下(解析解でも同じ)なので、残りの余裕をこれで割る
+template <typename Grid>
+inline double FlatIncrementalTracker::sleepBound(const Grid &grid, int i) const
+{
+    const double rate = std::fabs(grid.cellVd(i) - grid.Vn[i]) / grid.cellR(i);
+    if (!(rate > 0))
+        return std::numeric_limits<double>::infinity();
+    const double ctot = grid.cellLegs(i) * grid.cellC(i) + grid.cellCj(i);
+    // dEを計算し直す・Vnを計算し直す・dEが正になる(|Q + C*V_sum|がe/2を超える)までの電荷の余裕
+    double room = tolerance_ - std::fabs(dQsincedE[i]);
+    room = std::min(room, (tolerance_ - std::fabs(grid.nodeVoltage(i) - grid.Vn[i])) * ctot);
+    room = std::min(room, e / 2 - std::fabs(grid.Qn[i] + grid.cellC(i) * grid.V_sum[i]));
+    return room / rate;
+}
+
+// アクティブな素子のうち、トンネル候補でも再計算待ちでもなく、余裕のある素子を眠らせる
+template <typename Grid>
+inline void FlatIncrementalTracker::sleepQuiescent(const Grid &grid)
+{
+    std::size_t kept = 0;
+    for (int i : activeCells)
+    {
+        if (!isCandidate[i] && !inRelaxQueue[i] && !indEQueue[i])
+        {
+            const double bound = sleepBound(grid, i);
+            if (bound > 0)
+            {
+                isActive[i] = 0;
+                chargedUntil[i] = chargeClock;
+                sleepers.update(i, chargeClock + bound);
+                continue;
+            }
+        }
+        activeCells[kept++] = i;
+    }
+    activeCells.resize(kept);
+}
+
+// アクティブな素子に対してvisit(i)を呼び、眠っている素子を次に起こすまでの時間を返す
+// 眠っている素子は起こす時刻まではしきい値を超えず、Vnもインクリメンタル更新の許容誤差までしか変わらない
+template <typename Visit>
+inline double FlatIncrementalTracker::visitActive(Visit visit) const
+{
+    for (int i : activeCells)
+        visit(i);
+    if (sleepers.empty())
+        return std::numeric_limits<double>::infinity();
+    return std::max(0.0, sleepers.topKey() - chargeClock);
+}
+
+// アクティブな素子数
+template <typename Grid>
+inline int FlatIncrementalTracker::numActiveCells(const Grid &grid) const
+{
+    return activeTracking ? static_cast<int>(activeCells.size()) : grid.numCells();
+}
+
+#endif // FLAT_SEO_INCREMENTAL_HPP
@@ -0,0 +1,274 @@
+#ifndef FLAT_SEO_SOLVERS_HPP
+#define FLAT_SEO_SOLVERS_HPP
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "relaxation.hpp"
+#include "lattice_solver.hpp"
+#include "multigrid_solver.hpp"
+#include "thread_pool.hpp"
+#include "stencil_topology.hpp"
+
+// Grid2D<BasicFlatSEO<Topology, Real>>の緩和のバックエンドのうち、Jacobi法(タイル無し)・赤黒SOR以外のもの
+// 格子の配列を直接読み書きするので、格子からfriendにされて格子のメンバとして持たれる。
+// どのバックエンドを持つかはTopology・Realで決まり(FlatRelaxationBackends)、使えない組の格子はFlatNoRelaxationを持つ
+
+// Topology・Realの格子で使える緩和方法
+template <typename Topology, typename Real>
+struct FlatRelaxationBackends
+{
+    // 直接法・マルチグリッド(4近傍の容量行列をdoubleで解く)
+    static constexpr bool matrix = std::is_same<Topology, VonNeumann4>::value && std::is_same<Real, double>::value;
+    // タイル分割のJacobi法(倍精度のカーネルのみ)
+    static constexpr bool tiled = std::is_same<Real, double>::value;
+
+    // configの緩和方法を使えるか
+    static bool supports(const RelaxationConfig &config);
+
+    // configの緩和方法を使えなければ例外
+    static void require(const RelaxationConfig &config);
+};
+
+// 使えない組の格子が持つバックエンド(何もしない)
+struct FlatNoRelaxation
+{
+    void reset() {}
+};
+
+// C_iで割った容量行列 (legs + Cj/C)V - ΣV_隣 = Q/C + Vext を解く直接法・マルチグリッド
+// 分解・階層は初回(とパラメータ変更後)だけ作り、コピーした格子同士で共有する
+class FlatMatrixRelaxation
+{
+private:
+    // 直接法の分解結果
+    std::shared_ptr<const BandedCholeskySolver> directSolver;
+    // マルチグリッドの階層
+    std::shared_ptr<const MultigridSolver> multigridSolver;
+    // 右辺・解と作業領域
+    std::vector<double> rhs, work;
+    MultigridSolver::Workspace multigridWork;
+
+    // C_iで割った容量行列の対角 legs + Cj/C
+    template <typename Grid>
+    static std::vector<double> scaledDiagonal(const Grid &grid);
+
+    // 右辺 Q/C + Vext をrhsに書き込む
+    template <typename Grid>
+    void loadRhs(const Grid &grid);
+
+public:
+    // 分解・階層を捨てる(回路パラメータを変えたとき用)
+    void reset();
+
+    // 直接法でVnを厳密に解く
+    template <typename Grid>
+    RelaxationStats relaxDirect(Grid &grid);
+
+    // マルチグリッド法でVnを解く
+    template <typename Grid>
+    RelaxationStats relaxMultigrid(Grid &grid, const RelaxationConfig &config);
+};
+
+// Jacobi法をタイル(行の帯)ごとに全反復まとめて行う(時間方向のブロッキング)
+template <typename Real>
+class FlatTiledJacobi
+{
+private:
+    // タイル1つ分の作業領域(区間ごとに持つ)
+    struct TileBuffers
+    {
+        std::array<std::vector<Real>, 2> vn; // 反復ごとに交互に読み書きするVn
+        std::vector<Real> vsum;              // V_sum
+    };
+    std::vector<TileBuffers> tileBuffers;
+
+public:
+    // config.tileRows行ずつのタイルでconfig.maxIterations回反復する
+    template <typename Grid>
+    RelaxationStats relax(Grid &grid, const RelaxationConfig &config);
+};
+
+//-------- FlatRelaxationBackends ----------//
+// configの緩和方法を使えるか
+template <typename Topology, typename Real>
+inline bool FlatRelaxationBackends<Topology, Real>::supports(const RelaxationConfig &config)
+{
+    switch (config.method)
+    {
+    case RelaxationMethod::Direct:
+    case RelaxationMethod::Multigrid:
+        return matrix;
+    case RelaxationMethod::Jacobi:
+        return config.tileRows == 0 || tiled;
+    default:
+        return true;
+    }
+}
+
+// configの緩和方法を使えなければ例外
+template <typename Topology, typename Real>
+inline void FlatRelaxationBackends<Topology, Real>::require(const RelaxationConfig &config)
+{
+    if (supports(config))
+        return;
+    if (config.method == RelaxationMethod::Jacobi)
+    {
+        throw std::invalid_argument("Single-precision grids do not support tiled Jacobi relaxation");
+    }
+    if (!std::is_same<Real, double>::value)
+    {
+        throw std::invalid_argument("Single-precision grids support only Jacobi and red-black SOR relaxation");
+    }
+    throw std::invalid_argument("Direct and multigrid relaxation require the VonNeumann4 topology");
+}
+
+//-------- FlatMatrixRelaxation ----------//
+// C_iで割った容量行列の対角
+template <typename Grid>
+inline std::vector<double> FlatMatrixRelaxation::scaledDiagonal(const Grid &grid)
+{
+    const int n = grid.numCells();
+    std::vector<double> diag(n);
+    for (int i = 0; i < n; ++i)
+    {
+        const double c = grid.cellC(i), cj = grid.cellCj(i);
+        if (!(c > 0 && cj > 0))
+        {
+            throw std::invalid_argument("Direct and multigrid relaxation require positive C and Cj");
+        }
+        diag[i] = grid.cellLegs(i) + cj / c;
+    }
+    return diag;
+}
+
+// 右辺 Q/C + Vext
+template <typename Grid>
+inline void FlatMatrixRelaxation::loadRhs(const Grid &grid)
+{
+    const int n = grid.numCells();
+    rhs.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        rhs[i] = grid.Qn[i] / grid.cellC(i) + grid.Vext[i];
+    }
+}
+
+// 分解・階層を捨てる
+inline void FlatMatrixRelaxation::reset()
+{
+    directSolver.reset();
+    multigridSolver.reset();
+}
+
+// 直接法でVnを厳密に解く
+// 分解は初回(とパラメータ変更後)だけ行い、以降は前進・後退代入だけになる
+template <typename Grid>
+inline RelaxationStats FlatMatrixRelaxation::relaxDirect(Grid &grid)
+{
+    if (!directSolver)
+    {
+        directSolver = std::make_shared<const BandedCholeskySolver>(grid.numRows(), grid.numCols(),
+                                                                    scaledDiagonal(grid));
+    }
+    loadRhs(grid);
+    directSolver->solve(rhs, work);
+
+    RelaxationStats stats;
+    stats.iterations = 1;
+    for (int i = 0; i < grid.numCells(); ++i)
+    {
+        stats.residual = std::max(stats.residual, std::fabs(rhs[i] - grid.Vn[i]));
+        grid.Vn[i] = rhs[i];
+    }
+    // dEの計算に使うV_sumを解に揃える
+    grid.updateGridSurVn();
+    return stats;
+}
+
+// マルチグリッド法でVnを解く
+// 今のVnを初期値にするので、1ステップでの電荷の変化が小さければ数回の反復で収束する
+template <typename Grid>
+inline RelaxationStats FlatMatrixRelaxation::relaxMultigrid(Grid &grid, const RelaxationConfig &config)
+{
+    if (!multigridSolver)
+    {
+        multigridSolver =
+            std::make_shared<const MultigridSolver>(grid.numRows(), grid.numCols(), scaledDiagonal(grid));
+    }
+    loadRhs(grid);
+    RelaxationStats stats = multigridSolver->solve(grid.Vn, rhs, config, multigridWork);
+    // dEの計算に使うV_sumを解に揃える
+    grid.updateGridSurVn();
+    return stats;
+}
+
+//-------- FlatTiledJacobi ----------//
+// k回目の反復で正しく求まるのはk-1回目に正しかった行から1行内側までなので、
+// 上下にmaxIterations行の重なりを持たせてタイルの作業領域に写し、全反復をキャッシュに載ったまま済ませる。
+// 足す順・カーネルはタイルを使わない場合と同じなので、結果(Vn・V_sum・残差)はビット単位で一致する
+template <typename Real>
+template <typename Grid>
+inline RelaxationStats FlatTiledJacobi<Real>::relax(Grid &grid, const RelaxationConfig &config)
+{
+    const int rows = grid.numRows(), cols = grid.numCols();
+    const int iterations = config.maxIterations;
+    const int tileRows = config.tileRows;
+    const int tiles = (rows + tileRows - 1) / tileRows;
+    grid.VnNext.resize(grid.numCells());
+    const int chunks = numChunks(grid.pool.get());
+    grid.chunkValues.assign(chunks, 0.0);
+    tileBuffers.resize(chunks);
+    parallelChunks(grid.pool.get(), 0, tiles, [&](int chunk, int first, int last) {
+        TileBuffers &buf = tileBuffers[chunk];
+        double res = 0.0;
+        for (int tile = first; tile < last; ++tile)
+        {
+            const int r0 = tile * tileRows, r1 = std::min(rows, r0 + tileRows);
+            const int e0 = std::max(0, r0 - iterations), e1 = std::min(rows, r1 + iterations);
+            const int shift = e0 * cols;
+            const std::size_t size = static_cast<std::size_t>(e1 - e0) * cols;
+            buf.vn[0].resize(size);
+            buf.vn[1].resize(size);
+            buf.vsum.resize(size);
+            std::copy(grid.Vn.begin() + shift, grid.Vn.begin() + e1 * cols, buf.vn[0].begin());
+            for (int k = 1; k <= iterations; ++k)
+            {
+                // この反復で正しく求まる行
+                const int v0 = std::max(0, r0 - (iterations - k)), v1 = std::min(rows, r1 + (iterations - k));
+                const Real *src = buf.vn[(k - 1) % 2].data();
+                Real *dst = buf.vn[k % 2].data();
+                for (int i = v0; i < v1; ++i)
+                {
+                    grid.neighbourSumRow(src, i, buf.vsum.data(), shift);
+                    for (int idx = i * cols; idx < (i + 1) * cols; ++idx)
+                    {
+                        buf.vsum[idx - shift] += grid.Vext[idx];
+                    }
+                }
+                grid.nodeVoltageRange(buf.vsum.data(), dst, v0 * cols, v1 * cols, shift);
+            }
+            // タイル自身の行だけ書き戻す(他のタイルは元のVnを読むので、VnNextに書いて最後に入れ替える)
+            const Real *prev = buf.vn[(iterations - 1) % 2].data();
+            const Real *result = buf.vn[iterations % 2].data();
+            for (int idx = r0 * cols; idx < r1 * cols; ++idx)
+            {
+                grid.VnNext[idx] = result[idx - shift];
+                grid.V_sum[idx] = buf.vsum[idx - shift];
+                res = std::max(res, std::fabs(result[idx - shift] - prev[idx - shift]));
+            }
+        }
+        grid.chunkValues[chunk] = res;
+    });
+    grid.Vn.swap(grid.VnNext);
+    RelaxationStats stats;
+    stats.iterations = iterations;
+    stats.residual = *std::max_element(grid.chunkValues.begin(), grid.chunkValues.end());
+    return stats;
+}
+
+#endif // FLAT_SEO_SOLVERS_HPP
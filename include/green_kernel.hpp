@@ -0,0 +1,144 @@
+#ifndef GREEN_KERNEL_HPP
+#define GREEN_KERNEL_HPP
+
+#include <array>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "multigrid_solver.hpp"
+
+// 1素子の電荷が変わったときの、周囲のノード電圧の応答(グリーン関数)
+// rowBegin..rowEnd, colBegin..colEndは電荷が変わった素子からの相対位置(両端を含む)
+struct GreenKernel
+{
+    int rowBegin = 0, rowEnd = 0, colBegin = 0, colEnd = 0;
+    std::vector<double> values; // 行優先。Q/Cが1変わったときのVnの変化量
+
+    double at(int dr, int dc) const
+    {
+        return values[(dr - rowBegin) * (colEnd - colBegin + 1) + (dc - colBegin)];
+    }
+};
+
+// 一様な4近傍格子(端は開放)のグリーン関数の表
+//
+// C_iで割った容量行列 A (対角 legs + Cj/C、非対角 -1) に対して、
+// 素子kの電荷がdQ変わるとVnは A^{-1} e_k * dQ/C だけ変わる。
+// 応答は距離とともに指数的に減衰するので、中心値に対する比がtoleranceを下回る所で打ち切る。
+// 端からradius以上離れた素子は全て同じ形になり、端に近い素子は端までの距離ごとに遅延評価してキャッシュする。
+class GreenKernelTable
+{
+private:
+    double diag_ = 0.0;
+    double tolerance_ = 0.0;
+    int radius_ = -1; // 打ち切り半径(チェビシェフ距離)。-1は未設定
+    int window_ = 0;  // 応答を計算する窓の半幅(これより遠い端は無いものとみなす)
+    // (上, 下, 左, 右)の端までの距離(window_で頭打ち) -> 打ち切った応答
+    std::map<std::array<int, 4>, GreenKernel> kernels;
+
+    // 素子から上下左右にup, down, left, right個の素子がある窓で応答を計算し、radius_で打ち切る
+    GreenKernel compute(int up, int down, int left, int right, int radius) const;
+
+public:
+    // 対角 legs + Cj/C と打ち切りの相対誤差で表を作り直す
+    void configure(double diag, double tolerance);
+
+    // 表を捨てる（パラメータを変えたとき用）
+    void clear();
+
+    // 表が使えるか
+    bool isConfigured() const { return radius_ >= 0; }
+
+    // 打ち切り半径
+    int radius() const { return radius_; }
+
+    // キャッシュしている応答の数
+    std::size_t numCached() const { return kernels.size(); }
+
+    // rows x colsの格子の(row, col)の素子の応答を取得
+    const GreenKernel &kernel(int rows, int cols, int row, int col);
+};
+
+inline GreenKernel GreenKernelTable::compute(int up, int down, int left, int right, int radius) const
+{
+    const int h = up + down + 1, w = left + right + 1;
+    MultigridSolver solver(h, w, std::vector<double>(h * w, diag_));
+    std::vector<double> rhs(h * w, 0.0), x(h * w, 0.0);
+    rhs[up * w + left] = 1.0;
+    // 応答は全て正で中心は1/diag以上なので、その比で収束判定する
+    RelaxationConfig config;
+    config.maxIterations = 200;
+    config.tolerance = 1e-3 * tolerance_ / diag_;
+    MultigridSolver::Workspace ws;
+    solver.solve(x, rhs, config, ws);
+
+    GreenKernel k;
+    k.rowBegin = -std::min(up, radius);
+    k.rowEnd = std::min(down, radius);
+    k.colBegin = -std::min(left, radius);
+    k.colEnd = std::min(right, radius);
+    for (int dr = k.rowBegin; dr <= k.rowEnd; ++dr)
+        for (int dc = k.colBegin; dc <= k.colEnd; ++dc)
+            k.values.push_back(x[(up + dr) * w + (left + dc)]);
+    return k;
+}
+
+inline void GreenKernelTable::configure(double diag, double tolerance)
+{
+    if (!(diag > 0) || !(tolerance > 0 && tolerance < 1))
+    {
+        throw std::invalid_argument("Green kernel needs a positive diagonal and a tolerance in (0, 1)");
+    }
+    kernels.clear();
+    diag_ = diag;
+    tolerance_ = tolerance;
+    radius_ = -1;
+    // 打ち切り半径の2倍以上の窓で計算できるまで窓を広げる
+    const int maxWindow = 512;
+    for (int window = 8;; window *= 2)
+    {
+        if (window > maxWindow)
+        {
+            throw std::runtime_error("Green kernel does not decay; use a larger tolerance");
+        }
+        GreenKernel full = compute(window, window, window, window, window);
+        const double centre = full.at(0, 0);
+        int radius = 0;
+        for (int dr = -window; dr <= window; ++dr)
+            for (int dc = -window; dc <= window; ++dc)
+                if (std::fabs(full.at(dr, dc)) > tolerance * centre)
+                    radius = std::max(radius, std::max(std::abs(dr), std::abs(dc)));
+        if (2 * radius <= window)
+        {
+            window_ = window;
+            radius_ = radius;
+            break;
+        }
+    }
+}
+
+inline void GreenKernelTable::clear()
+{
+    kernels.clear();
+    radius_ = -1;
+}
+
+inline const GreenKernel &GreenKernelTable::kernel(int rows, int cols, int row, int col)
+{
+    if (!isConfigured())
+    {
+        throw std::logic_error("GreenKernelTable is not configured");
+    }
+    const std::array<int, 4> key = {std::min(row, window_), std::min(rows - 1 - row, window_),
+                                     std::min(col, window_), std::min(cols - 1 - col, window_)};
+    auto it = kernels.find(key);
+    if (it == kernels.end())
+    {
+        it = kernels.emplace(key, compute(key[0], key[1], key[2], key[3], radius_)).first;
+    }
+    return it->second;
+}
+
+#endif // GREEN_KERNEL_HPP
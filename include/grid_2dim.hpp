@@ -6,6 +6,13 @@
 #include <stdexcept>
 #include <algorithm>
 #include <string>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "seo_class.hpp"
+#include "relaxation.hpp"
+#include "charge_integration.hpp"
+#include "thread_pool.hpp"
 
 // 2次元グリッドで任意の素子（Element）を管理するテンプレートクラス
 template <typename Element>
@@ -18,18 +25,28 @@ private:
     int rows_, cols_;
     // 出力時のファイル名(デフォルトは空)
     std::string outputlabel = "";
-    // 電子トンネルをする場所
-    std::shared_ptr<Element> tunnelplace;
+    // 電子トンネルをする場所の添字(row*cols+col, -1はトンネル無し)
+    int tunnelindex = -1;
     // 電子トンネルの向き
-    std::string tunneldirection;
+    TunnelDirection tunneldirection = TunnelDirection::Up;
     // gridにおける最小の待ち時間
     double minwt;
     // 出力するかのbool値(デフォルトがtrueで出力する)
     bool outputEnabled;
+    // 並列実行に使うスレッドプール(nullなら逐次)
+    std::shared_ptr<ThreadPool> pool;
+
+    // 行を区間に分けて、各素子にfを呼ぶ
+    template <typename F>
+    void forEachElement(F f);
 public:
     // コンストラクタ：指定した行数・列数でグリッドを初期化
     Grid2D(int rows, int cols, bool enableOutput = true); // ← outputするかどうかのbool。デフォルトをtrueにする
 
+    // コンストラクタ：まとめて確保した素子の配列(row*cols+colの順)を使う
+    // 素子ごとにmake_sharedせず、各要素は配列を共有するshared_ptrになる(LatticeBuilder用)
+    Grid2D(int rows, int cols, std::shared_ptr<std::vector<Element>> elements, bool enableOutput = true);
+
     // 指定位置の要素を取得
     std::shared_ptr<Element> getElement(int row, int col) const;
 
@@ -42,6 +59,9 @@ public:
     // グリッド全体のノード電圧Vnを計算・更新
     void updateGridVn();
 
+    // 設定に従ってグリッド全体のVnを緩和する
+    RelaxationStats relax(const RelaxationConfig &config);
+
     // グリッド全体のエネルギー変化dEを計算・更新
     void updateGriddE();
 
@@ -51,6 +71,16 @@ public:
     // グリッド全体のノード電荷Qnを更新
     void updateGridQn(const double dt);
 
+    // グリッド全体のノード電荷QnをRC充電の解析解で更新(周囲の電圧はステップ内で一定とする)
+    void updateGridQnExponential(const double dt);
+
+    // 周囲の電圧を一定としたとき、いずれかの素子のdEが正になるまでの時間(既に正なら0、ならないなら+inf)
+    double nextThresholdTime() const;
+
+    // 周囲の電圧を一定として充電したとき、どの素子でも隣接素子のVnの変化の合計(V_sumのずれ)が
+    // tolerance以下に収まる時間(各素子のVnの変化をtolerance/最大の隣接数以下に抑える)
+    double vsumDriftTime(double tolerance) const;
+
     // グリッド（全体の2次元vector）を取得
     std::vector<std::vector<std::shared_ptr<Element>>> &getGrid();
 
@@ -60,11 +90,23 @@ public:
     // 列数を取得
     int numCols() const;
 
+    // 素子数を取得
+    int numCells() const;
+
+    // 添字(row*cols+col)の素子の、指定方向のトンネルレート(dE/(e^2 Rj), dE<=0なら0)を取得
+    double tunnelRate(int index, TunnelDirection direction) const;
+
     // トンネルが発生する素子を取得
     std::shared_ptr<Element> getTunnelPlace() const;
 
-    // トンネルの方向（"up" or "down"）を取得
-    std::string getTunnelDirection() const;
+    // トンネルが発生する素子の添字を取得
+    int getTunnelIndex() const;
+
+    // 添字(row*cols+col)で指定した素子をトンネルさせる
+    void applyTunnel(int index, TunnelDirection direction);
+
+    // トンネルの方向を取得
+    TunnelDirection getTunnelDirection() const;
 
     // 最小トンネル待ち時間wtを取得
     double getMinWT() const;
@@ -83,6 +125,17 @@ public:
 
     // OutputEnabledの取得
     bool isOutputEnabled() const;
+
+    // 並列実行に使うスレッドプールを設定(nullptrで逐次に戻す)
+    // 乱数は素子ごとの乱数列から引くので、gridminwtも含めてスレッド数によらず逐次と同じ結果になる
+    // (赤黒SORは接続が2色に塗り分けられるとは限らないので逐次のまま)
+    void setThreadPool(std::shared_ptr<ThreadPool> threadPool);
+
+    // 乱数のシードを設定(素子(row, col)の乱数列を(seed, row*cols+col)にし、抽選回数を0に戻す)
+    void seedRandom(std::uint64_t seed);
+
+    // スレッドプールを取得
+    std::shared_ptr<ThreadPool> getThreadPool() const;
 };
 
 // コンストラクタ：全要素をmake_sharedで初期化
@@ -104,6 +157,30 @@ Grid2D<Element>::Grid2D(int rows, int cols, bool enableOutput)
     }
 }
 
+// コンストラクタ：まとめて確保した素子の配列を使う
+template <typename Element>
+Grid2D<Element>::Grid2D(int rows, int cols, std::shared_ptr<std::vector<Element>> elements, bool enableOutput)
+    : rows_(rows), cols_(cols), outputEnabled(enableOutput)
+{
+    if (rows <= 0 || cols <= 0)
+    {
+        throw std::invalid_argument("Grid size must be positive");
+    }
+    if (!elements || elements->size() != static_cast<std::size_t>(rows) * cols)
+    {
+        throw std::invalid_argument("Element array must have rows*cols elements");
+    }
+    grid.assign(rows, std::vector<std::shared_ptr<Element>>(cols));
+    for (int i = 0; i < rows; ++i)
+    {
+        for (int j = 0; j < cols; ++j)
+        {
+            // 配列の所有権を共有し、要素だけを指す
+            grid[i][j] = std::shared_ptr<Element>(elements, &(*elements)[i * cols + j]);
+        }
+    }
+}
+
 // 指定位置の要素を取得
 template <typename Element>
 std::shared_ptr<Element> Grid2D<Element>::getElement(int row, int col) const
@@ -122,58 +199,134 @@ void Grid2D<Element>::setElement(int row, int col, const std::shared_ptr<Element
 template <typename Element>
 void Grid2D<Element>::updateGridSurVn()
 {
-    for (auto &row : grid)
-    {
-        for (auto &elem : row)
-        {
-            elem->setSurroundingVoltages();
-        }
-    }
+    forEachElement([](const std::shared_ptr<Element> &elem) { elem->setSurroundingVoltages(); });
 }
 
 // グリッド全体のノード電圧Vnを計算・更新
 template <typename Element>
 void Grid2D<Element>::updateGridVn()
 {
-    for (auto &row : grid)
+    forEachElement([](const std::shared_ptr<Element> &elem) { elem->setPcalc(); });
+}
+
+// 設定に従ってグリッド全体のVnを緩和する
+template <typename Element>
+RelaxationStats Grid2D<Element>::relax(const RelaxationConfig &config)
+{
+    if (config.method == RelaxationMethod::Direct || config.method == RelaxationMethod::Multigrid)
     {
-        for (auto &elem : row)
+        throw std::invalid_argument("Direct and multigrid relaxation require Grid2D<FlatSEO>");
+    }
+    RelaxationStats stats;
+    // 区間ごとの残差(最後に最大値をとる)
+    std::vector<double> residuals(numChunks(pool.get()));
+    for (int it = 0; it < config.maxIterations; ++it)
+    {
+        std::fill(residuals.begin(), residuals.end(), 0.0);
+        if (config.method == RelaxationMethod::Jacobi)
         {
-            elem->setPcalc();
+            // V_sumを全て求めてからVnを更新するので、並列でも読み書きが競合しない
+            updateGridSurVn();
+            parallelChunks(pool.get(), 0, rows_, [&](int chunk, int first, int last) {
+                for (int i = first; i < last; ++i)
+                {
+                    for (auto &elem : grid[i])
+                    {
+                        double old = elem->getVn();
+                        elem->setPcalc();
+                        residuals[chunk] = std::max(residuals[chunk], std::fabs(elem->getVn() - old));
+                    }
+                }
+            });
         }
+        else
+        {
+            // 赤(i+jが偶数)→黒(i+jが奇数)の順に、その場で更新する
+            // 接続は任意(周期境界の奇数サイズや独自の配線)で同じ色の素子同士が隣接しうるので、逐次に行う
+            for (int color = 0; color < 2; ++color)
+            {
+                parallelChunks(nullptr, 0, rows_, [&](int chunk, int first, int last) {
+                    for (int i = first; i < last; ++i)
+                    {
+                        for (int j = (i + color) % 2; j < cols_; j += 2)
+                        {
+                            auto &elem = grid[i][j];
+                            double old = elem->getVn();
+                            elem->setSurroundingVoltages();
+                            elem->setPcalc();
+                            double updated = old + config.omega * (elem->getVn() - old);
+                            elem->setVn(updated);
+                            residuals[chunk] = std::max(residuals[chunk], std::fabs(updated - old));
+                        }
+                    }
+                });
+            }
+        }
+        const double residual = *std::max_element(residuals.begin(), residuals.end());
+        stats.iterations = it + 1;
+        stats.residual = residual;
+        if (config.tolerance > 0 && residual <= config.tolerance)
+            break;
+    }
+    // SORでは最後に更新したVnでV_sumを揃えておく(dEの計算に使うため)
+    if (config.method == RelaxationMethod::RedBlackSOR)
+    {
+        updateGridSurVn();
     }
+    return stats;
 }
 
 // グリッド全体のエネルギー変化dEを計算・更新
 template <typename Element>
 void Grid2D<Element>::updateGriddE()
 {
-    for (auto &row : grid)
-    {
-        for (auto &elem : row)
-        {
-            elem->setdEcalc();
-        }
-    }
+    forEachElement([](const std::shared_ptr<Element> &elem) { elem->setdEcalc(); });
 }
 
 // グリッド全体のトンネル待ち時間wtを計算し、最小wtとトンネル素子・方向を記録
 template <typename Element>
 bool Grid2D<Element>::gridminwt(const double dt)
 {
-    minwt = dt;
-    for (auto &row : grid)
+    // 行の区間ごとに最小wtを求め、区間の順にまとめる(同じwtなら添字の小さい方が残る)
+    struct ChunkMin
     {
-        for (auto &elem : row)
+        double wt;
+        int index = -1;
+        TunnelDirection direction = TunnelDirection::Up;
+    };
+    std::vector<ChunkMin> chunks(numChunks(pool.get()), ChunkMin{dt});
+    parallelChunks(pool.get(), 0, rows_, [&](int chunk, int first, int last) {
+        ChunkMin &best = chunks[chunk];
+        for (int i = first; i < last; ++i)
         {
-            if (elem->calculateTunnelWt())
+            for (int j = 0; j < cols_; ++j)
             {
-                double tmpwt = std::max(elem->getWT()["up"], elem->getWT()["down"]);
-                tunneldirection = (tmpwt == elem->getWT()["up"]) ? "up" : "down";
-                tunnelplace = elem;
-                minwt = std::min(minwt, tmpwt);
+                auto &elem = grid[i][j];
+                if (elem->calculateTunnelWt())
+                {
+                    const TunnelPair &wt = elem->getWT();
+                    double tmpwt = std::max(wt[TunnelDirection::Up], wt[TunnelDirection::Down]);
+                    // 最小wtを更新した素子だけをトンネル素子として記録する
+                    if (tmpwt < best.wt)
+                    {
+                        best.direction = (tmpwt == wt[TunnelDirection::Up]) ? TunnelDirection::Up : TunnelDirection::Down;
+                        best.index = i * cols_ + j;
+                        best.wt = tmpwt;
+                    }
+                }
             }
         }
+    });
+    minwt = dt;
+    tunnelindex = -1;
+    for (const ChunkMin &best : chunks)
+    {
+        if (best.wt < minwt)
+        {
+            minwt = best.wt;
+            tunnelindex = best.index;
+            tunneldirection = best.direction;
+        }
     }
     return minwt < dt;
 }
@@ -182,13 +335,51 @@ bool Grid2D<Element>::gridminwt(const double dt)
 template <typename Element>
 void Grid2D<Element>::updateGridQn(const double dt)
 {
-    for (auto &row : grid)
+    forEachElement([dt](const std::shared_ptr<Element> &elem) { elem->setNodeCharge(dt); });
+}
+
+// グリッド全体のノード電荷QnをRC充電の解析解で更新
+template <typename Element>
+void Grid2D<Element>::updateGridQnExponential(const double dt)
+{
+    forEachElement([dt](const std::shared_ptr<Element> &elem) { elem->setNodeChargeExponential(dt); });
+}
+
+// いずれかの素子のdEが正になるまでの時間
+template <typename Element>
+double Grid2D<Element>::nextThresholdTime() const
+{
+    std::vector<double> chunks(numChunks(pool.get()), std::numeric_limits<double>::infinity());
+    parallelChunks(pool.get(), 0, rows_, [&](int chunk, int first, int last) {
+        for (int i = first; i < last; ++i)
+            for (const auto &elem : grid[i])
+                chunks[chunk] = std::min(chunks[chunk], elem->getThresholdTime());
+    });
+    return *std::min_element(chunks.begin(), chunks.end());
+}
+
+// V_sumのずれがtolerance以下に収まる時間
+template <typename Element>
+double Grid2D<Element>::vsumDriftTime(double tolerance) const
+{
+    std::size_t maxLegs = 1;
+    for (const auto &row : grid)
+        for (const auto &elem : row)
+            maxLegs = std::max(maxLegs, elem->getConnection().size());
+    const double delta = tolerance / maxLegs;
+    double limit = std::numeric_limits<double>::infinity();
+    for (const auto &row : grid)
     {
-        for (auto &elem : row)
+        for (const auto &elem : row)
         {
-            elem->setNodeCharge(dt);
+            // 接続が無ければ、他の素子のV_sumには関わらない
+            if (elem->getConnection().empty())
+                continue;
+            const double ctot = elem->getlegs() * elem->getC() + elem->getCj();
+            limit = std::min(limit, voltageDriftTime(elem->getVn(), elem->getVd(), elem->getR(), ctot, delta));
         }
     }
+    return limit;
 }
 
 // グリッド全体のデータを取得
@@ -212,16 +403,52 @@ int Grid2D<Element>::numCols() const
     return cols_;
 }
 
+// 素子数を取得
+template <typename Element>
+int Grid2D<Element>::numCells() const
+{
+    return rows_ * cols_;
+}
+
+// トンネルレートを取得
+template <typename Element>
+double Grid2D<Element>::tunnelRate(int index, TunnelDirection direction) const
+{
+    const auto &elem = grid[index / cols_][index % cols_];
+    double de = elem->getdE()[direction];
+    return de > 0 ? de / (e * e * elem->getRj()) : 0.0;
+}
+
 // 最小wtでトンネルが発生する素子を取得
 template <typename Element>
 std::shared_ptr<Element> Grid2D<Element>::getTunnelPlace() const
 {
-    return tunnelplace;
+    if (tunnelindex < 0)
+        return nullptr;
+    return grid[tunnelindex / cols_][tunnelindex % cols_];
+}
+
+// 最小wtでトンネルが発生する素子の添字を取得
+template <typename Element>
+int Grid2D<Element>::getTunnelIndex() const
+{
+    return tunnelindex;
+}
+
+// 添字で指定した素子をトンネルさせる
+template <typename Element>
+void Grid2D<Element>::applyTunnel(int index, TunnelDirection direction)
+{
+    if (index < 0 || index >= rows_ * cols_)
+    {
+        throw std::out_of_range("Tunnel index out of range");
+    }
+    grid[index / cols_][index % cols_]->setTunnel(direction);
 }
 
-// トンネルの方向を取得（"up" または "down"）
+// トンネルの方向を取得
 template <typename Element>
-std::string Grid2D<Element>::getTunnelDirection() const
+TunnelDirection Grid2D<Element>::getTunnelDirection() const
 {
     return tunneldirection;
 }
@@ -268,4 +495,47 @@ bool Grid2D<Element>::isOutputEnabled() const
 {
     return outputEnabled;
 }
+
+// 並列実行に使うスレッドプールを設定
+template <typename Element>
+void Grid2D<Element>::setThreadPool(std::shared_ptr<ThreadPool> threadPool)
+{
+    pool = std::move(threadPool);
+}
+
+// 乱数のシードを設定
+template <typename Element>
+void Grid2D<Element>::seedRandom(std::uint64_t seed)
+{
+    for (int i = 0; i < rows_; ++i)
+    {
+        for (int j = 0; j < cols_; ++j)
+        {
+            grid[i][j]->setRandomStream(seed, static_cast<std::uint64_t>(i) * cols_ + j);
+        }
+    }
+}
+
+// スレッドプールを取得
+template <typename Element>
+std::shared_ptr<ThreadPool> Grid2D<Element>::getThreadPool() const
+{
+    return pool;
+}
+
+// 行を区間に分けて、各素子にfを呼ぶ
+template <typename Element>
+template <typename F>
+void Grid2D<Element>::forEachElement(F f)
+{
+    parallelChunks(pool.get(), 0, rows_, [&](int, int first, int last) {
+        for (int i = first; i < last; ++i)
+        {
+            for (auto &elem : grid[i])
+            {
+                f(elem);
+            }
+        }
+    });
+}
 #endif // GRID_2DIM_HPP
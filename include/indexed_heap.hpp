@@ -0,0 +1,181 @@
+#ifndef INDEXED_HEAP_HPP
+#define INDEXED_HEAP_HPP
+
+#include <vector>
+#include <stdexcept>
+#include <utility>
+
+// 添字(0..capacity-1)ごとにキーを持つ二分ヒープ（最小値が先頭）
+// キーの更新・削除がO(log N)でできるので、イベント時刻の管理に使う
+class IndexedMinHeap
+{
+private:
+    std::vector<int> heap;     // ヒープ上の並び（添字）
+    std::vector<int> position; // 添字ごとのheap上の位置(-1は未登録)
+    std::vector<double> keys;  // 添字ごとのキー
+
+    void siftUp(int pos);
+    void siftDown(int pos);
+    void swapNodes(int a, int b);
+
+public:
+    // コンストラクタ(登録できる添字の数)
+    explicit IndexedMinHeap(int capacity = 0);
+
+    // 登録できる添字の数を変更（中身は空になる）
+    void reset(int capacity);
+
+    // 添字を登録、または登録済みならキーを更新
+    void update(int id, double key);
+
+    // 添字を削除（未登録なら何もしない）
+    void remove(int id);
+
+    // 登録されているか
+    bool contains(int id) const;
+
+    // 空かどうか
+    bool empty() const;
+
+    // 登録数
+    int size() const;
+
+    // 最小キーの添字
+    int top() const;
+
+    // 最小キー
+    double topKey() const;
+
+    // 指定した添字のキー
+    double key(int id) const;
+};
+
+inline IndexedMinHeap::IndexedMinHeap(int capacity)
+{
+    reset(capacity);
+}
+
+inline void IndexedMinHeap::reset(int capacity)
+{
+    if (capacity < 0)
+    {
+        throw std::invalid_argument("Heap capacity must be non-negative");
+    }
+    heap.clear();
+    position.assign(capacity, -1);
+    keys.assign(capacity, 0.0);
+}
+
+inline void IndexedMinHeap::update(int id, double key)
+{
+    int pos = position.at(id);
+    keys[id] = key;
+    if (pos < 0)
+    {
+        position[id] = static_cast<int>(heap.size());
+        heap.push_back(id);
+        siftUp(position[id]);
+    }
+    else
+    {
+        siftUp(pos);
+        siftDown(position[id]);
+    }
+}
+
+inline void IndexedMinHeap::remove(int id)
+{
+    int pos = position.at(id);
+    if (pos < 0)
+        return;
+    int last = static_cast<int>(heap.size()) - 1;
+    swapNodes(pos, last);
+    heap.pop_back();
+    position[id] = -1;
+    if (pos < last)
+    {
+        siftUp(pos);
+        siftDown(pos);
+    }
+}
+
+inline bool IndexedMinHeap::contains(int id) const
+{
+    return position.at(id) >= 0;
+}
+
+inline bool IndexedMinHeap::empty() const
+{
+    return heap.empty();
+}
+
+inline int IndexedMinHeap::size() const
+{
+    return static_cast<int>(heap.size());
+}
+
+inline int IndexedMinHeap::top() const
+{
+    if (heap.empty())
+    {
+        throw std::logic_error("IndexedMinHeap is empty");
+    }
+    return heap.front();
+}
+
+inline double IndexedMinHeap::topKey() const
+{
+    return keys[top()];
+}
+
+inline double IndexedMinHeap::key(int id) const
+{
+    return keys.at(id);
+}
+
+// キーが同じときは添字の小さい方を先にする（順序を決定的にするため）
+inline void IndexedMinHeap::siftUp(int pos)
+{
+    while (pos > 0)
+    {
+        int parent = (pos - 1) / 2;
+        int a = heap[pos], b = heap[parent];
+        if (keys[a] < keys[b] || (keys[a] == keys[b] && a < b))
+        {
+            swapNodes(pos, parent);
+            pos = parent;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+inline void IndexedMinHeap::siftDown(int pos)
+{
+    const int n = static_cast<int>(heap.size());
+    while (true)
+    {
+        int best = pos;
+        for (int child = 2 * pos + 1; child <= 2 * pos + 2 && child < n; ++child)
+        {
+            int a = heap[child], b = heap[best];
+            if (keys[a] < keys[b] || (keys[a] == keys[b] && a < b))
+                best = child;
+        }
+        if (best == pos)
+            break;
+        swapNodes(pos, best);
+        pos = best;
+    }
+}
+
+inline void IndexedMinHeap::swapNodes(int a, int b)
+{
+    std::swap(heap[a], heap[b]);
+    position[heap[a]] = a;
+    position[heap[b]] = b;
+}
+
+#endif // INDEXED_HEAP_HPP
@@ -0,0 +1,261 @@
+#ifndef LATTICE_BUILDER_HPP
+#define LATTICE_BUILDER_HPP
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include "seo_class.hpp"
+#include "grid_2dim.hpp"
+#include "flat_seo_grid.hpp"
+#include "seo_graph.hpp"
+
+// 格子の端の扱い
+enum class BoundaryMode
+{
+    Open,    // 端の素子は隣接素子が少ない(足の数はそのまま、余った足は接地)
+    Periodic // 反対側の端とつなぐ(トーラス)
+};
+
+// 全素子で共通の回路パラメータ
+struct LatticeParams
+{
+    double R = 0.0;  // 抵抗
+    double Rj = 0.0; // トンネル抵抗
+    double Cj = 0.0; // 接合容量
+    double C = 0.0;  // 接続容量
+    double Vd = 0.0; // バイアス電圧の大きさ(符号はバイアスパターンで決める)
+};
+
+// 4近傍の格子をまとめて作る
+// パラメータ・バイアスパターン・端の扱いを決めてからbuild*()を呼ぶ。素子の確保と接続を1回の走査で行う
+//
+//   LatticeBuilder builder(32, 32);
+//   builder.setParams({R, Rj, Cj, C, Vd}).setCheckerboardBias();
+//   Grid2D<SEO> grid = builder.buildPointerGrid();
+class LatticeBuilder
+{
+public:
+    // 素子(row, col)のバイアス電圧を返す関数(引数はrow, col, Vd)
+    using BiasPattern = std::function<double(int, int, double)>;
+
+private:
+    int rows_, cols_;
+    LatticeParams params;
+    BiasPattern bias;
+    BoundaryMode boundary = BoundaryMode::Open;
+    bool outputEnabled = true;
+    // Grid2D<FlatSEO>をパラメータクラスモードで作るか
+    bool parameterClasses = false;
+    // 直前のbuild*()にかかった時間[s]
+    double buildSeconds = 0.0;
+
+    using Clock = std::chrono::steady_clock;
+
+    // 直前のbuildの時間を記録する
+    void finish(Clock::time_point start)
+    {
+        buildSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // (row, col)から(dr, dc)だけ離れた素子の添字(開放端で格子の外なら-1)
+    int neighbourIndex(int row, int col, int dr, int dc) const
+    {
+        int r = row + dr, c = col + dc;
+        if (boundary == BoundaryMode::Periodic)
+        {
+            r = (r + rows_) % rows_;
+            c = (c + cols_) % cols_;
+        }
+        else if (r < 0 || r >= rows_ || c < 0 || c >= cols_)
+        {
+            return -1;
+        }
+        return r * cols_ + c;
+    }
+
+public:
+    // 行数・列数を指定する(デフォルトは一様なバイアス・開放端)
+    LatticeBuilder(int rows, int cols) : rows_(rows), cols_(cols), bias(uniformBias())
+    {
+        if (rows <= 0 || cols <= 0)
+        {
+            throw std::invalid_argument("Grid size must be positive");
+        }
+    }
+
+    // 全素子で一様なバイアス(+Vd)
+    static BiasPattern uniformBias()
+    {
+        return [](int, int, double vd) { return vd; };
+    }
+
+    // 市松模様のバイアス((row+col)が偶数なら+Vd、奇数なら-Vd。main.cppの従来の配線)
+    static BiasPattern checkerboardBias()
+    {
+        return [](int row, int col, double vd) { return ((row + col) % 2 == 0) ? vd : -vd; };
+    }
+
+    // 回路パラメータを設定
+    LatticeBuilder &setParams(const LatticeParams &p)
+    {
+        params = p;
+        return *this;
+    }
+
+    // バイアスパターンを設定
+    LatticeBuilder &setBiasPattern(BiasPattern pattern)
+    {
+        if (!pattern)
+        {
+            throw std::invalid_argument("Bias pattern must not be empty");
+        }
+        bias = std::move(pattern);
+        return *this;
+    }
+
+    // 市松模様のバイアスにする
+    LatticeBuilder &setCheckerboardBias() { return setBiasPattern(checkerboardBias()); }
+
+    // 端の扱いを設定(周期境界は隣接がかぶらないよう3x3以上のみ)
+    LatticeBuilder &setBoundary(BoundaryMode mode)
+    {
+        if (mode == BoundaryMode::Periodic && (rows_ < 3 || cols_ < 3))
+        {
+            throw std::invalid_argument("Periodic boundaries require at least 3 rows and 3 columns");
+        }
+        boundary = mode;
+        return *this;
+    }
+
+    // 作るgridを出力するか
+    LatticeBuilder &setOutputEnabled(bool flag)
+    {
+        outputEnabled = flag;
+        return *this;
+    }
+
+    // buildFlatGridで作るgridをパラメータクラスモードにするか(倍精度の格子のみ。他の格子を作ると例外)
+    LatticeBuilder &setParameterClasses(bool flag)
+    {
+        parameterClasses = flag;
+        return *this;
+    }
+
+    // 素子(row, col)のバイアス電圧
+    double biasAt(int row, int col) const { return bias(row, col, params.Vd); }
+
+    // Grid2D<SEO>を作る
+    // 素子は1つの配列にまとめて確保し、接続は上・右・下・左の順
+    Grid2D<SEO> buildPointerGrid()
+    {
+        const Clock::time_point start = Clock::now();
+        auto elements = std::make_shared<std::vector<SEO>>(static_cast<std::size_t>(rows_) * cols_);
+        Grid2D<SEO> grid(rows_, cols_, elements, outputEnabled);
+        const auto &cells = grid.getGrid();
+        // 接続の一時配列は使い回す
+        std::vector<std::shared_ptr<SEO>> connections;
+        connections.reserve(VonNeumann4::legs);
+        for (int y = 0; y < rows_; ++y)
+        {
+            for (int x = 0; x < cols_; ++x)
+            {
+                SEO &seo = (*elements)[y * cols_ + x];
+                seo.setUp(params.R, params.Rj, params.Cj, params.C, biasAt(y, x), VonNeumann4::legs);
+                connections.clear();
+                for (const NeighbourOffset &o : VonNeumann4::offsets)
+                {
+                    const int k = neighbourIndex(y, x, o.dr, o.dc);
+                    if (k >= 0)
+                        connections.push_back(cells[k / cols_][k % cols_]);
+                }
+                seo.setConnections(connections);
+            }
+        }
+        finish(start);
+        return grid;
+    }
+
+    // Grid2D<BasicFlatSEO<Topology, Real>>を作る(開放端のみ。パラメータはRealに丸めて持つ)
+    template <typename Topology = VonNeumann4, typename Real = double>
+    Grid2D<BasicFlatSEO<Topology, Real>> buildFlatGrid()
+    {
+        if (boundary != BoundaryMode::Open)
+        {
+            throw std::invalid_argument("Grid2D<FlatSEO> supports open boundaries only; use buildGraph()");
+        }
+        const Clock::time_point start = Clock::now();
+        Grid2D<BasicFlatSEO<Topology, Real>> grid(rows_, cols_, outputEnabled);
+        for (int y = 0; y < rows_; ++y)
+        {
+            for (int x = 0; x < cols_; ++x)
+            {
+                grid.getElement(y, x)->setUp(params.R, params.Rj, params.Cj, params.C, biasAt(y, x));
+            }
+        }
+        // 全素子を設定してからクラスにまとめる(未設定の既定値がクラスに残らないように)
+        if constexpr (std::is_same<Real, double>::value)
+            grid.setParameterClasses(parameterClasses);
+        else if (parameterClasses)
+            throw std::invalid_argument("Parameter classes require a double-precision grid");
+        finish(start);
+        return grid;
+    }
+
+    // Grid2D<PrecisionSEO<Real>>を作る(buildFlatGrid<VonNeumann4, Real>と同じ)
+    template <typename Real>
+    Grid2D<PrecisionSEO<Real>> buildPrecisionGrid()
+    {
+        return buildFlatGrid<VonNeumann4, Real>();
+    }
+
+    // SEOGraphを作る(周期境界もこちらで作れる)
+    // 開放端では、端の素子の余った足の分(4 - 隣接数)*Cを接地容量にするのでGrid2D<SEO>と同じ式になる
+    SEOGraph buildGraph()
+    {
+        const Clock::time_point start = Clock::now();
+        std::vector<GraphEdge> edges;
+        edges.reserve(2 * static_cast<std::size_t>(rows_) * cols_);
+        for (int y = 0; y < rows_; ++y)
+        {
+            for (int x = 0; x < cols_; ++x)
+            {
+                // 右と下の辺だけ足す(反対向きはSEOGraphが作る)
+                const int right = neighbourIndex(y, x, 0, 1), down = neighbourIndex(y, x, 1, 0);
+                if (right >= 0)
+                    edges.push_back({y * cols_ + x, right, params.C});
+                if (down >= 0)
+                    edges.push_back({y * cols_ + x, down, params.C});
+            }
+        }
+        SEOGraph graph(rows_ * cols_, edges, outputEnabled);
+        graph.setLayout(rows_, cols_);
+        for (int y = 0; y < rows_; ++y)
+        {
+            for (int x = 0; x < cols_; ++x)
+            {
+                auto node = graph.getElement(y, x);
+                node->setUp(params.R, params.Rj, params.Cj, biasAt(y, x));
+                node->setGroundCapacitance((VonNeumann4::legs - node->getDegree()) * params.C);
+            }
+        }
+        finish(start);
+        return graph;
+    }
+
+    // 直前のbuild*()にかかった時間[s]
+    double getBuildSeconds() const { return buildSeconds; }
+
+    // 行数を取得
+    int numRows() const { return rows_; }
+
+    // 列数を取得
+    int numCols() const { return cols_; }
+
+    // 端の扱いを取得
+    BoundaryMode getBoundary() const { return boundary; }
+};
+
+#endif // LATTICE_BUILDER_HPP
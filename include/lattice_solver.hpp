@@ -0,0 +1,140 @@
+#ifndef LATTICE_SOLVER_HPP
+#define LATTICE_SOLVER_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+// 4近傍格子(端は開放)の容量行列を解く直接法ソルバ
+//
+// SEOのノード電圧は (legs*C + Cj)*Vn_i - C*Σ_j Vn_j = Q_i + C*Vext_i を満たす。
+// 行iをC_iで割ると (legs + Cj/C)*Vn_i - Σ_j Vn_j = Q_i/C_i + Vext_i となり、
+// 非対角が全て-1の対称正定値行列になるので、帯行列のCholesky分解(L L^T)で解ける。
+// 帯幅は短い辺の長さで、分解はO(N*b^2)、1回の求解はO(N*b)、メモリはN*(b+1)個のdouble。
+class BandedCholeskySolver
+{
+private:
+    int rows_, cols_;
+    bool transposed; // 列方向に番号を振り直しているか(帯幅を短い辺にするため)
+    int n, bw;       // 次元と帯幅
+    // 下三角の帯 L(k, m) を band[k*(bw+1) + (m - k + bw)] に保持
+    std::vector<double> band;
+
+    // 格子上の添字(row*cols+col)と行列上の番号の変換
+    int toMatrix(int index) const;
+
+public:
+    // diag[i] = legs_i + Cj_i/C_i (row*cols+col順) で分解する
+    BandedCholeskySolver(int rows, int cols, const std::vector<double> &diag);
+
+    // rhs(row*cols+col順)を解で上書きする(workは作業領域。分解結果は書き換えないので共有できる)
+    void solve(std::vector<double> &rhs, std::vector<double> &work) const;
+
+    int numRows() const { return rows_; }
+    int numCols() const { return cols_; }
+    int bandwidth() const { return bw; }
+};
+
+inline int BandedCholeskySolver::toMatrix(int index) const
+{
+    if (!transposed)
+        return index;
+    return (index % cols_) * rows_ + index / cols_;
+}
+
+inline BandedCholeskySolver::BandedCholeskySolver(int rows, int cols, const std::vector<double> &diag)
+    : rows_(rows), cols_(cols), transposed(rows < cols), n(rows * cols),
+      bw(std::min(rows, cols))
+{
+    if (rows <= 0 || cols <= 0 || static_cast<int>(diag.size()) != n)
+    {
+        throw std::invalid_argument("Invalid lattice size for BandedCholeskySolver");
+    }
+    const int w = bw + 1;
+    band.assign(static_cast<std::size_t>(n) * w, 0.0);
+    // 行列番号の並びでの行の長さ(隣の行との差がbw)
+    const int lineLength = transposed ? rows : cols;
+
+    // 元の行列の下三角を詰める
+    for (int index = 0; index < n; ++index)
+    {
+        const int k = toMatrix(index);
+        band[static_cast<std::size_t>(k) * w + bw] = diag[index];
+        if (k % lineLength > 0)
+            band[static_cast<std::size_t>(k) * w + bw - 1] = -1.0;
+        if (k >= lineLength)
+            band[static_cast<std::size_t>(k) * w] = -1.0;
+    }
+
+    // 帯の中でCholesky分解
+    for (int k = 0; k < n; ++k)
+    {
+        double *lk = &band[static_cast<std::size_t>(k) * w];
+        const int m0 = std::max(0, k - bw);
+        for (int m = m0; m <= k; ++m)
+        {
+            const double *lm = &band[static_cast<std::size_t>(m) * w];
+            double sum = lk[m - k + bw];
+            const int p0 = std::max(m0, m - bw);
+            for (int p = p0; p < m; ++p)
+            {
+                sum -= lk[p - k + bw] * lm[p - m + bw];
+            }
+            if (m == k)
+            {
+                if (!(sum > 0))
+                {
+                    throw std::runtime_error("Capacitance matrix is not positive definite");
+                }
+                lk[bw] = std::sqrt(sum);
+            }
+            else
+            {
+                lk[m - k + bw] = sum / lm[bw];
+            }
+        }
+    }
+}
+
+inline void BandedCholeskySolver::solve(std::vector<double> &rhs, std::vector<double> &work) const
+{
+    if (static_cast<int>(rhs.size()) != n)
+    {
+        throw std::invalid_argument("Right-hand side size does not match the lattice");
+    }
+    const int w = bw + 1;
+    work.resize(n);
+    for (int index = 0; index < n; ++index)
+    {
+        work[toMatrix(index)] = rhs[index];
+    }
+    // 前進代入 L y = b
+    for (int k = 0; k < n; ++k)
+    {
+        const double *lk = &band[static_cast<std::size_t>(k) * w];
+        double sum = work[k];
+        for (int p = std::max(0, k - bw); p < k; ++p)
+        {
+            sum -= lk[p - k + bw] * work[p];
+        }
+        work[k] = sum / lk[bw];
+    }
+    // 後退代入 L^T x = y
+    for (int k = n - 1; k >= 0; --k)
+    {
+        work[k] /= band[static_cast<std::size_t>(k) * w + bw];
+        const double *lk = &band[static_cast<std::size_t>(k) * w];
+        const double xk = work[k];
+        for (int p = std::max(0, k - bw); p < k; ++p)
+        {
+            work[p] -= lk[p - k + bw] * xk;
+        }
+    }
+    for (int index = 0; index < n; ++index)
+    {
+        rhs[index] = work[toMatrix(index)];
+    }
+}
+
+#endif // LATTICE_SOLVER_HPP
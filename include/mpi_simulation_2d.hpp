@@ -0,0 +1,448 @@
+#ifndef MPI_SIMULATION_2D_HPP
+#define MPI_SIMULATION_2D_HPP
+
+#include <mpi.h>
+#include <vector>
+#include <string>
+#include <utility>
+#include <stdexcept>
+#include "simulation_2d.hpp"
+#include "flat_seo_grid.hpp"
+
+// MPIで1つの格子を複数のプロセス(ランク)に分けて実行するエンジン(Grid2D<BasicFlatSEO<Topology>>用)
+// OYL_ENABLE_MPIを有効にしたビルドでだけ使える。
+//
+// 各ランクはgridを行方向に分けた帯と、その上下1行ののり代(隣のランクの素子の写し)を持つ。
+// Jacobi法の反復ごとにのり代のVnを隣のランクと交換し、最小wtは全ランクの最小値(MPI_MINLOC)を取って、
+// 最小のランクだけがトンネルさせる。素子iは分けない場合と同じ乱数列(deriveSeed(seed, g), i)から引くので、
+// 同じシードなら1プロセスのSimulation2Dとビット単位で同じ経過になる。
+// 出力はランク0に集める(getOutputsはランク0だけが中身を持つ)
+//
+// 緩和は反復回数固定(tolerance = 0)のJacobi法、電荷の計算はEuler法かExponentialのみ
+template <typename Element>
+class MPISimulation2D : public Simulation2D<Element>
+{
+private:
+    // 1つのgridのうち、このランクが持つ部分(grids[g]はのり代を含む行だけを持つ)
+    struct Piece
+    {
+        int rows, cols;  // 元のgridの大きさ
+        int firstRow;    // 受け持つ最初の行
+        int ownedRows;   // 受け持つ行数
+        int haloTop;     // 上ののり代の行数(0か1)
+        int haloBottom;  // 下ののり代の行数(0か1)
+    };
+
+    MPI_Comm comm;
+    int rank, size;
+    // grids[g]に対応する分け方
+    std::vector<Piece> pieces;
+
+    // 設定がこのエンジンで扱えるか確かめる
+    void validate() const;
+
+    // のり代のVnを隣のランクと交換する
+    void exchangeHalo(std::size_t g);
+
+    // 全gridのVnをJacobi法で緩和する(反復ごとにのり代を交換)
+    void relaxPieces();
+
+    // のり代の素子はトンネルの候補から外す(トンネルは受け持つランクが決める)
+    void clearHalodE(std::size_t g);
+
+    // トリガを適用する(座標は元のgridの位置)
+    void applyTriggers();
+
+    // 全ランクで最小wtを比較する。トンネルがあればtrueとイベント、決めたランクを返す
+    // (イベントの素子の添字は決めたランクのgrids[g]での添字)
+    std::pair<bool, TunnelEvent> compareGlobalwt(int &winner);
+
+    // 受け持つ素子の値をランク0に集める(ランク0以外は空)
+    template <typename Get>
+    std::vector<double> gatherOwned(std::size_t g, Get get) const;
+
+    // oyl-video形式の出力をランク0に集める
+    void gatherOutputs();
+
+public:
+    // コンストラクタ(刻み時間,シミュレーションの終了タイミング,使うコミュニケータ)
+    MPISimulation2D(double dT, double EndTime, MPI_Comm Comm = MPI_COMM_WORLD);
+
+    // 全ランクで同じgrid全体を渡し、このランクの受け持ちを登録する(行数はランク数以上)
+    // 返された参照はトリガの登録に使う(トリガの座標は元のgridの位置)
+    Grid2D<Element> &distributeGrid(const Grid2D<Element> &whole);
+
+    // シミュレーションの1ステップ(全ランクで呼ぶ)
+    void runStep() override;
+
+    // g番目のgrid全体の電荷をランク0に集める(全ランクで呼ぶ。ランク0以外は空)
+    std::vector<double> gatherCharges(std::size_t g) const;
+
+    // g番目のgrid全体のVnをランク0に集める(全ランクで呼ぶ。ランク0以外は空)
+    std::vector<double> gatherVoltages(std::size_t g) const;
+
+    // g番目のgridでこのランクが受け持つ最初の行を取得
+    int getFirstRow(std::size_t g) const;
+
+    // g番目のgridでこのランクが受け持つ行数を取得
+    int getOwnedRows(std::size_t g) const;
+
+    // このランクの番号を取得
+    int getRank() const;
+
+    // ランク数を取得
+    int getSize() const;
+};
+
+// コンストラクタ
+template <typename Element>
+MPISimulation2D<Element>::MPISimulation2D(double dT, double EndTime, MPI_Comm Comm)
+    : Simulation2D<Element>(dT, EndTime), comm(Comm), rank(0), size(1)
+{
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+}
+
+// grid全体からこのランクの受け持ちを切り出して登録する
+template <typename Element>
+Grid2D<Element> &MPISimulation2D<Element>::distributeGrid(const Grid2D<Element> &whole)
+{
+    const int rows = whole.numRows(), cols = whole.numCols();
+    if (rows < size)
+    {
+        throw std::invalid_argument("Grid has fewer rows (" + std::to_string(rows) + ") than MPI ranks (" +
+                                    std::to_string(size) + ")");
+    }
+    if (whole.isIncrementalUpdate())
+    {
+        throw std::logic_error("MPI distribution does not support incremental update");
+    }
+    Piece piece;
+    piece.rows = rows;
+    piece.cols = cols;
+    piece.firstRow = rank * rows / size;
+    piece.ownedRows = (rank + 1) * rows / size - piece.firstRow;
+    piece.haloTop = (rank > 0) ? 1 : 0;
+    piece.haloBottom = (rank < size - 1) ? 1 : 0;
+
+    // のり代を含めて切り出す(のり代の行は元のgridと同じ接続になるよう、端の判定も元のgridに合わせる)
+    const int top = piece.firstRow - piece.haloTop;
+    const int localRows = piece.haloTop + piece.ownedRows + piece.haloBottom;
+    Grid2D<Element> local(localRows, cols, whole.isOutputEnabled());
+    if (whole.hasOutputLabel())
+        local.setOutputLabel(whole.getOutputLabel());
+    local.setSimdLevel(whole.getSimdLevel());
+    for (int r = 0; r < localRows; ++r)
+    {
+        for (int c = 0; c < cols; ++c)
+        {
+            auto src = whole.getElement(top + r, c);
+            auto dst = local.getElement(r, c);
+            dst->setUp(src->getR(), src->getRj(), src->getCj(), src->getC(), src->getVd(), src->getlegs());
+            dst->setQ(src->getQ());
+            dst->setVn(src->getVn());
+            dst->setExternalVoltage(src->getExternalVoltage());
+        }
+    }
+    if (whole.isParameterClasses())
+        local.setParameterClasses(true);
+    local.setRandomStreamBase(static_cast<std::uint64_t>(top) * cols);
+
+    pieces.push_back(piece);
+    return this->appendGrid(std::move(local));
+}
+
+// 設定がこのエンジンで扱えるか確かめる
+template <typename Element>
+void MPISimulation2D<Element>::validate() const
+{
+    if (pieces.size() != this->grids.size())
+    {
+        throw std::logic_error("Grids of an MPI simulation must be added with distributeGrid");
+    }
+    if (this->relaxation.method != RelaxationMethod::Jacobi || this->relaxation.tolerance > 0)
+    {
+        throw std::logic_error("MPI simulation supports only Jacobi relaxation with a fixed iteration count");
+    }
+    if (this->chargeIntegrator == ChargeIntegrator::ExponentialJump)
+    {
+        throw std::logic_error("MPI simulation does not support ExponentialJump");
+    }
+}
+
+// のり代のVnを隣のランクと交換する
+template <typename Element>
+void MPISimulation2D<Element>::exchangeHalo(std::size_t g)
+{
+    auto &grid = this->grids[g];
+    const Piece &p = pieces[g];
+    const int cols = p.cols, last = grid.numRows() - 1;
+    const int up = p.haloTop ? rank - 1 : MPI_PROC_NULL;
+    const int down = p.haloBottom ? rank + 1 : MPI_PROC_NULL;
+    std::vector<double> sendUp(cols), sendDown(cols), recvUp(cols), recvDown(cols);
+    for (int c = 0; c < cols; ++c)
+    {
+        sendUp[c] = grid.getElement(p.haloTop, c)->getVn();
+        sendDown[c] = grid.getElement(last - p.haloBottom, c)->getVn();
+    }
+    MPI_Sendrecv(sendUp.data(), cols, MPI_DOUBLE, up, 0, recvDown.data(), cols, MPI_DOUBLE, down, 0, comm,
+                 MPI_STATUS_IGNORE);
+    MPI_Sendrecv(sendDown.data(), cols, MPI_DOUBLE, down, 1, recvUp.data(), cols, MPI_DOUBLE, up, 1, comm,
+                 MPI_STATUS_IGNORE);
+    for (int c = 0; c < cols; ++c)
+    {
+        if (p.haloTop)
+            grid.getElement(0, c)->setVn(recvUp[c]);
+        if (p.haloBottom)
+            grid.getElement(last, c)->setVn(recvDown[c]);
+    }
+}
+
+// 全gridのVnをJacobi法で緩和する
+// 1反復ずつ進めてのり代を交換するので、受け持つ素子は分けない場合と同じ値を同じ順に足す
+template <typename Element>
+void MPISimulation2D<Element>::relaxPieces()
+{
+    RelaxationConfig once;
+    once.maxIterations = 1;
+    this->relaxationStats.assign(this->grids.size(), RelaxationStats());
+    for (std::size_t g = 0; g < this->grids.size(); ++g)
+    {
+        for (int it = 0; it < this->relaxation.maxIterations; ++it)
+        {
+            this->grids[g].relax(once);
+            exchangeHalo(g);
+        }
+        this->relaxationStats[g].iterations = this->relaxation.maxIterations;
+        this->totalRelaxationIterations += this->relaxation.maxIterations;
+    }
+}
+
+// のり代の素子をトンネルの候補から外す
+template <typename Element>
+void MPISimulation2D<Element>::clearHalodE(std::size_t g)
+{
+    auto &grid = this->grids[g];
+    const Piece &p = pieces[g];
+    for (int c = 0; c < p.cols; ++c)
+    {
+        for (int r : {0, grid.numRows() - 1})
+        {
+            if ((r == 0 && p.haloTop) || (r > 0 && p.haloBottom))
+            {
+                grid.getElement(r, c)->setdE(TunnelDirection::Up, 0.0);
+                grid.getElement(r, c)->setdE(TunnelDirection::Down, 0.0);
+            }
+        }
+    }
+}
+
+// トリガを適用する(Simulation2D::applyVoltageTriggersと同じ規則で、座標を受け持ちの位置に直す)
+template <typename Element>
+void MPISimulation2D<Element>::applyTriggers()
+{
+    // 元のgridでの位置(x, y)を、このランクの切り出しでの添字に直す(持っていなければ-1)
+    auto localIndex = [this](int g, int x, int y) {
+        if (g >= static_cast<int>(this->grids.size()))
+        {
+            throw std::invalid_argument("Trigger references a grid that is not part of this simulation.");
+        }
+        const Piece &p = pieces[g];
+        if (x < 0 || x >= p.cols || y < 0 || y >= p.rows)
+        {
+            throw std::out_of_range("Trigger coordinates (x=" + std::to_string(x) + ", y=" + std::to_string(y) +
+                                    ") are out of grid bounds (" + std::to_string(p.cols) + "x" +
+                                    std::to_string(p.rows) + ").");
+        }
+        const int r = y - (p.firstRow - p.haloTop);
+        return (r >= 0 && r < this->grids[g].numRows()) ? r * p.cols + x : -1;
+    };
+    for (const auto &[g, triggerTime, x, y, voltage] : this->voltageTriggers)
+    {
+        const int i = localIndex(g, x, y);
+        if (i >= 0)
+            this->grids[g].setExternalVoltage(i, 0.0);
+    }
+    for (const auto &[g, triggerTime, x, y, voltage] : this->voltageTriggers)
+    {
+        if (this->t >= triggerTime && this->t < triggerTime + this->dt)
+        {
+            const int i = localIndex(g, x, y);
+            Grid2D<Element> &grid = this->grids[g];
+            if (i >= 0)
+                grid.setExternalVoltage(i, grid.getElement(i / grid.numCols(), i % grid.numCols())
+                                               ->getExternalVoltage() + voltage);
+        }
+    }
+}
+
+// 全ランクで最小wtを比較する(同じwtならランクの小さい方、つまり添字の小さい方が残る)
+template <typename Element>
+std::pair<bool, TunnelEvent> MPISimulation2D<Element>::compareGlobalwt(int &winner)
+{
+    TunnelEvent event;
+    event.wt = this->dt;
+    winner = -1;
+    for (std::size_t g = 0; g < this->grids.size(); ++g)
+    {
+        auto &grid = this->grids[g];
+        struct
+        {
+            double wt;
+            int rank;
+        } local{this->dt, rank}, global{};
+        if (grid.gridminwt(this->dt))
+            local.wt = grid.getMinWT();
+        MPI_Allreduce(&local, &global, 1, MPI_DOUBLE_INT, MPI_MINLOC, comm);
+        if (global.wt < event.wt)
+        {
+            event.gridIndex = static_cast<int>(g);
+            event.wt = global.wt;
+            winner = global.rank;
+            event.cellIndex = (winner == rank) ? grid.getTunnelIndex() : -1;
+            event.direction = grid.getTunnelDirection();
+        }
+    }
+    return {event.gridIndex >= 0, event};
+}
+
+// 受け持つ素子の値をランク0に集める
+template <typename Element>
+template <typename Get>
+std::vector<double> MPISimulation2D<Element>::gatherOwned(std::size_t g, Get get) const
+{
+    const auto &grid = this->grids.at(g);
+    const Piece &p = pieces.at(g);
+    std::vector<double> owned(static_cast<std::size_t>(p.ownedRows) * p.cols);
+    for (int r = 0; r < p.ownedRows; ++r)
+        for (int c = 0; c < p.cols; ++c)
+            owned[r * p.cols + c] = get(grid.getElement(p.haloTop + r, c));
+
+    std::vector<int> counts(size), displs(size);
+    for (int k = 0; k < size; ++k)
+    {
+        const int first = k * p.rows / size, last = (k + 1) * p.rows / size;
+        counts[k] = (last - first) * p.cols;
+        displs[k] = first * p.cols;
+    }
+    std::vector<double> all(rank == 0 ? static_cast<std::size_t>(p.rows) * p.cols : 0);
+    MPI_Gatherv(owned.data(), static_cast<int>(owned.size()), MPI_DOUBLE, all.data(), counts.data(), displs.data(),
+                MPI_DOUBLE, 0, comm);
+    return all;
+}
+
+// oyl-video形式の出力をランク0に集める(Simulation2D::outputTooylと同じ形)
+template <typename Element>
+void MPISimulation2D<Element>::gatherOutputs()
+{
+    if (this->t < this->nextOutputTime)
+        return;
+    const int timeframe = static_cast<int>(std::round(this->nextOutputTime / this->outputInterval));
+    int outputIndex = 0;
+    for (std::size_t g = 0; g < this->grids.size(); ++g)
+    {
+        const auto &grid = this->grids[g];
+        if (!grid.isOutputEnabled())
+            continue;
+        const std::string label = grid.hasOutputLabel() ? grid.getOutputLabel() : "output" + std::to_string(outputIndex++);
+        const Piece &p = pieces[g];
+        if (p.rows < 2 || p.cols < 2)
+            continue;
+        // Vdが負のとき、Vnを反転して記録
+        const std::vector<double> vn = gatherOwned(g, [](const auto &elem) {
+            return (elem->getVd() < 0) ? -elem->getVn() : elem->getVn();
+        });
+        if (rank != 0)
+            continue;
+        std::vector<std::vector<double>> vnGrid(p.rows - 2, std::vector<double>(p.cols - 2));
+        for (int i = 1; i < p.rows - 1; ++i)
+            for (int j = 1; j < p.cols - 1; ++j)
+                vnGrid[i - 1][j - 1] = vn[i * p.cols + j];
+        this->outputs[label].resize(timeframe + 1);
+        this->outputs[label][timeframe] = vnGrid;
+    }
+    this->nextOutputTime += this->outputInterval;
+}
+
+// シミュレーションの1ステップを実行
+template <typename Element>
+void MPISimulation2D<Element>::runStep()
+{
+    validate();
+    double steptime = this->dt;
+
+    // oyl-video形式に出力
+    gatherOutputs();
+
+    // grid全体のVn計算
+    applyTriggers();
+    relaxPieces();
+
+    // grid全体のdE計算
+    for (std::size_t g = 0; g < this->grids.size(); ++g)
+    {
+        this->grids[g].updateGriddE();
+        clearHalodE(g);
+    }
+
+    // wtの計算と比較(全ランクで同じ結果になる)
+    int winner = -1;
+    auto compared = compareGlobalwt(winner);
+    if (compared.first)
+    {
+        if (winner == rank)
+            this->grids[compared.second.gridIndex].applyTunnel(compared.second.cellIndex, compared.second.direction);
+        ++this->tunnelCount;
+        steptime = compared.second.wt;
+    }
+
+    // チャージの計算
+    this->updateGridsQn(steptime);
+
+    // tの増加
+    this->t += steptime;
+}
+
+// g番目のgrid全体の電荷をランク0に集める
+template <typename Element>
+std::vector<double> MPISimulation2D<Element>::gatherCharges(std::size_t g) const
+{
+    return gatherOwned(g, [](const auto &elem) { return elem->getQ(); });
+}
+
+// g番目のgrid全体のVnをランク0に集める
+template <typename Element>
+std::vector<double> MPISimulation2D<Element>::gatherVoltages(std::size_t g) const
+{
+    return gatherOwned(g, [](const auto &elem) { return elem->getVn(); });
+}
+
+// g番目のgridでこのランクが受け持つ最初の行を取得
+template <typename Element>
+int MPISimulation2D<Element>::getFirstRow(std::size_t g) const
+{
+    return pieces.at(g).firstRow;
+}
+
+// g番目のgridでこのランクが受け持つ行数を取得
+template <typename Element>
+int MPISimulation2D<Element>::getOwnedRows(std::size_t g) const
+{
+    return pieces.at(g).ownedRows;
+}
+
+// このランクの番号を取得
+template <typename Element>
+int MPISimulation2D<Element>::getRank() const
+{
+    return rank;
+}
+
+// ランク数を取得
+template <typename Element>
+int MPISimulation2D<Element>::getSize() const
+{
+    return size;
+}
+
+#endif // MPI_SIMULATION_2D_HPP
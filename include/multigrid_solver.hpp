@@ -0,0 +1,342 @@
+#ifndef MULTIGRID_SOLVER_HPP
+#define MULTIGRID_SOLVER_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "relaxation.hpp"
+
+// 4近傍格子(端は開放)の容量行列を解く幾何マルチグリッドソルバ
+//
+// BandedCholeskySolverと同じくC_iで割った対称正定値の系
+//   (legs + Cj/C)*Vn_i - Σ_j Vn_j = Q_i/C_i + Vext_i
+// を解く。粗い格子は2x2の素子をまとめたもので、制限は和・補間は定数のまま配る
+// (ガラーキン近似 A_c = P^T A P なので粗い格子も5点の対称正定値になる)。
+// 平滑化はsetPcalcと同じ1素子の更新を赤黒の順に行い、V-cycleを共役勾配法の前処理として使う。
+// 1反復はO(N)で、反復回数は格子の大きさにほとんどよらない。
+class MultigridSolver
+{
+public:
+    // 各レベルの作業領域（ソルバ自体は書き換えないので、分解結果と同じく共有できる）
+    struct Workspace
+    {
+        std::vector<std::vector<double>> x, b, r; // レベルごとの解・右辺・残差
+        std::vector<double> res, p, q;            // 共役勾配法用
+    };
+
+private:
+    // 1レベルの演算子: (A x)_i = diag_i x_i - Σ east/south の結合 * 隣の値
+    struct Level
+    {
+        int rows, cols;
+        std::vector<double> diag;
+        std::vector<double> east;  // (i, j)と(i, j+1)の結合(右端は0)
+        std::vector<double> south; // (i, j)と(i+1, j)の結合(下端は0)
+    };
+    std::vector<Level> levels;
+    // 最も粗いレベルの密なCholesky分解(下三角、行優先)
+    std::vector<double> coarseFactor;
+    int smoothingSweeps;
+
+    static double neighbourSum(const Level &lv, const std::vector<double> &x, int idx);
+    void smooth(const Level &lv, std::vector<double> &x, const std::vector<double> &b, int firstColor) const;
+    void residual(const Level &lv, const std::vector<double> &x, const std::vector<double> &b,
+                  std::vector<double> &r) const;
+    void apply(const Level &lv, const std::vector<double> &x, std::vector<double> &y) const;
+    void coarseSolve(std::vector<double> &x, const std::vector<double> &b) const;
+    void vcycle(int level, Workspace &ws) const;
+    void factorCoarsest();
+
+public:
+    // diag[i] = legs_i + Cj_i/C_i (row*cols+col順) で階層を作る
+    // coarsestCellsは直接解く最も粗いレベルの素子数の上限
+    MultigridSolver(int rows, int cols, const std::vector<double> &diag, int sweeps = 2, int coarsestCells = 64);
+
+    // xを初期値として rhs の系を解く
+    // tolerance>0なら1反復でのxの最大変化量がそれ以下になった時点で、そうでなければmaxIterations回で打ち切る
+    RelaxationStats solve(std::vector<double> &x, const std::vector<double> &rhs, const RelaxationConfig &config,
+                          Workspace &ws) const;
+
+    int numRows() const { return levels.front().rows; }
+    int numCols() const { return levels.front().cols; }
+    int numLevels() const { return static_cast<int>(levels.size()); }
+};
+
+inline MultigridSolver::MultigridSolver(int rows, int cols, const std::vector<double> &diag, int sweeps,
+                                        int coarsestCells)
+    : smoothingSweeps(sweeps)
+{
+    if (rows <= 0 || cols <= 0 || static_cast<int>(diag.size()) != rows * cols)
+    {
+        throw std::invalid_argument("Invalid lattice size for MultigridSolver");
+    }
+    if (sweeps < 1 || coarsestCells < 1)
+    {
+        throw std::invalid_argument("MultigridSolver needs at least one sweep and one coarse cell");
+    }
+    Level fine;
+    fine.rows = rows;
+    fine.cols = cols;
+    fine.diag = diag;
+    fine.east.assign(rows * cols, 0.0);
+    fine.south.assign(rows * cols, 0.0);
+    for (int i = 0; i < rows; ++i)
+    {
+        for (int j = 0; j < cols; ++j)
+        {
+            if (j + 1 < cols)
+                fine.east[i * cols + j] = 1.0;
+            if (i + 1 < rows)
+                fine.south[i * cols + j] = 1.0;
+        }
+    }
+    levels.push_back(std::move(fine));
+
+    // 2x2ずつまとめて粗くしていく
+    while (levels.back().rows * levels.back().cols > coarsestCells &&
+           (levels.back().rows > 1 || levels.back().cols > 1))
+    {
+        const Level &f = levels.back();
+        Level c;
+        c.rows = (f.rows + 1) / 2;
+        c.cols = (f.cols + 1) / 2;
+        c.diag.assign(c.rows * c.cols, 0.0);
+        c.east.assign(c.rows * c.cols, 0.0);
+        c.south.assign(c.rows * c.cols, 0.0);
+        for (int i = 0; i < f.rows; ++i)
+        {
+            for (int j = 0; j < f.cols; ++j)
+            {
+                const int idx = i * f.cols + j;
+                const int ci = (i / 2) * c.cols + j / 2;
+                c.diag[ci] += f.diag[idx];
+                // 同じ塊の中の結合は対角から引き、塊をまたぐ結合は粗い結合に足す
+                if (j + 1 < f.cols)
+                {
+                    if ((j + 1) / 2 == j / 2)
+                        c.diag[ci] -= 2.0 * f.east[idx];
+                    else
+                        c.east[ci] += f.east[idx];
+                }
+                if (i + 1 < f.rows)
+                {
+                    if ((i + 1) / 2 == i / 2)
+                        c.diag[ci] -= 2.0 * f.south[idx];
+                    else
+                        c.south[ci] += f.south[idx];
+                }
+            }
+        }
+        levels.push_back(std::move(c));
+    }
+    factorCoarsest();
+}
+
+inline void MultigridSolver::factorCoarsest()
+{
+    const Level &lv = levels.back();
+    const int n = lv.rows * lv.cols;
+    coarseFactor.assign(static_cast<std::size_t>(n) * n, 0.0);
+    for (int k = 0; k < n; ++k)
+    {
+        coarseFactor[static_cast<std::size_t>(k) * n + k] = lv.diag[k];
+        if (k % lv.cols > 0)
+            coarseFactor[static_cast<std::size_t>(k) * n + k - 1] = -lv.east[k - 1];
+        if (k >= lv.cols)
+            coarseFactor[static_cast<std::size_t>(k) * n + k - lv.cols] = -lv.south[k - lv.cols];
+    }
+    for (int k = 0; k < n; ++k)
+    {
+        for (int m = 0; m <= k; ++m)
+        {
+            double sum = coarseFactor[static_cast<std::size_t>(k) * n + m];
+            for (int p = 0; p < m; ++p)
+            {
+                sum -= coarseFactor[static_cast<std::size_t>(k) * n + p] * coarseFactor[static_cast<std::size_t>(m) * n + p];
+            }
+            if (m == k)
+            {
+                if (!(sum > 0))
+                {
+                    throw std::runtime_error("Capacitance matrix is not positive definite");
+                }
+                coarseFactor[static_cast<std::size_t>(k) * n + k] = std::sqrt(sum);
+            }
+            else
+            {
+                coarseFactor[static_cast<std::size_t>(k) * n + m] = sum / coarseFactor[static_cast<std::size_t>(m) * n + m];
+            }
+        }
+    }
+}
+
+inline double MultigridSolver::neighbourSum(const Level &lv, const std::vector<double> &x, int idx)
+{
+    const int j = idx % lv.cols;
+    double sum = 0.0;
+    if (idx >= lv.cols)
+        sum += lv.south[idx - lv.cols] * x[idx - lv.cols];
+    if (j + 1 < lv.cols)
+        sum += lv.east[idx] * x[idx + 1];
+    if (idx + lv.cols < lv.rows * lv.cols)
+        sum += lv.south[idx] * x[idx + lv.cols];
+    if (j > 0)
+        sum += lv.east[idx - 1] * x[idx - 1];
+    return sum;
+}
+
+// 赤黒Gauss-Seidel 1回(firstColorの色から)。1素子の更新はsetPcalcと同じ形
+inline void MultigridSolver::smooth(const Level &lv, std::vector<double> &x, const std::vector<double> &b,
+                                    int firstColor) const
+{
+    for (int c = 0; c < 2; ++c)
+    {
+        const int color = (firstColor + c) % 2;
+        for (int i = 0; i < lv.rows; ++i)
+        {
+            for (int j = (i + color) % 2; j < lv.cols; j += 2)
+            {
+                const int idx = i * lv.cols + j;
+                x[idx] = (b[idx] + neighbourSum(lv, x, idx)) / lv.diag[idx];
+            }
+        }
+    }
+}
+
+inline void MultigridSolver::apply(const Level &lv, const std::vector<double> &x, std::vector<double> &y) const
+{
+    const int n = lv.rows * lv.cols;
+    y.resize(n);
+    for (int idx = 0; idx < n; ++idx)
+    {
+        y[idx] = lv.diag[idx] * x[idx] - neighbourSum(lv, x, idx);
+    }
+}
+
+inline void MultigridSolver::residual(const Level &lv, const std::vector<double> &x, const std::vector<double> &b,
+                                      std::vector<double> &r) const
+{
+    apply(lv, x, r);
+    for (std::size_t idx = 0; idx < r.size(); ++idx)
+    {
+        r[idx] = b[idx] - r[idx];
+    }
+}
+
+inline void MultigridSolver::coarseSolve(std::vector<double> &x, const std::vector<double> &b) const
+{
+    const int n = static_cast<int>(b.size());
+    x.assign(b.begin(), b.end());
+    for (int k = 0; k < n; ++k)
+    {
+        double sum = x[k];
+        for (int p = 0; p < k; ++p)
+            sum -= coarseFactor[static_cast<std::size_t>(k) * n + p] * x[p];
+        x[k] = sum / coarseFactor[static_cast<std::size_t>(k) * n + k];
+    }
+    for (int k = n - 1; k >= 0; --k)
+    {
+        double sum = x[k];
+        for (int p = k + 1; p < n; ++p)
+            sum -= coarseFactor[static_cast<std::size_t>(p) * n + k] * x[p];
+        x[k] = sum / coarseFactor[static_cast<std::size_t>(k) * n + k];
+    }
+}
+
+// ws.b[level]を右辺、0を初期値としてV-cycleを1回行い、ws.x[level]に入れる
+// 前平滑は赤→黒、後平滑は黒→赤にして、前処理として対称になるようにする
+inline void MultigridSolver::vcycle(int level, Workspace &ws) const
+{
+    const Level &lv = levels[level];
+    std::vector<double> &x = ws.x[level];
+    const std::vector<double> &b = ws.b[level];
+    if (level + 1 == numLevels())
+    {
+        coarseSolve(x, b);
+        return;
+    }
+    x.assign(lv.rows * lv.cols, 0.0);
+    for (int s = 0; s < smoothingSweeps; ++s)
+        smooth(lv, x, b, 0);
+
+    // 残差を2x2の塊ごとに足して粗い格子へ
+    const Level &cl = levels[level + 1];
+    std::vector<double> &r = ws.r[level];
+    residual(lv, x, b, r);
+    std::vector<double> &bc = ws.b[level + 1];
+    bc.assign(cl.rows * cl.cols, 0.0);
+    for (int i = 0; i < lv.rows; ++i)
+        for (int j = 0; j < lv.cols; ++j)
+            bc[(i / 2) * cl.cols + j / 2] += r[i * lv.cols + j];
+
+    vcycle(level + 1, ws);
+
+    // 粗い格子の補正をそのまま塊の素子へ配る
+    const std::vector<double> &xc = ws.x[level + 1];
+    for (int i = 0; i < lv.rows; ++i)
+        for (int j = 0; j < lv.cols; ++j)
+            x[i * lv.cols + j] += xc[(i / 2) * cl.cols + j / 2];
+
+    for (int s = 0; s < smoothingSweeps; ++s)
+        smooth(lv, x, b, 1);
+}
+
+inline RelaxationStats MultigridSolver::solve(std::vector<double> &x, const std::vector<double> &rhs,
+                                              const RelaxationConfig &config, Workspace &ws) const
+{
+    const Level &fine = levels.front();
+    const int n = fine.rows * fine.cols;
+    if (static_cast<int>(rhs.size()) != n || static_cast<int>(x.size()) != n)
+    {
+        throw std::invalid_argument("Vector size does not match the lattice");
+    }
+    ws.x.resize(levels.size());
+    ws.b.resize(levels.size());
+    ws.r.resize(levels.size());
+
+    // V-cycleを前処理にした共役勾配法
+    residual(fine, x, rhs, ws.res);
+    ws.b[0] = ws.res;
+    vcycle(0, ws);
+    ws.p = ws.x[0];
+    double rz = 0.0;
+    for (int i = 0; i < n; ++i)
+        rz += ws.res[i] * ws.p[i];
+
+    RelaxationStats stats;
+    for (int it = 0; it < config.maxIterations; ++it)
+    {
+        if (rz == 0.0)
+            break; // 既に厳密解
+        apply(fine, ws.p, ws.q);
+        double pq = 0.0;
+        for (int i = 0; i < n; ++i)
+            pq += ws.p[i] * ws.q[i];
+        const double alpha = rz / pq;
+        double change = 0.0;
+        for (int i = 0; i < n; ++i)
+        {
+            x[i] += alpha * ws.p[i];
+            ws.res[i] -= alpha * ws.q[i];
+            change = std::max(change, std::fabs(alpha * ws.p[i]));
+        }
+        stats.iterations = it + 1;
+        stats.residual = change;
+        if (config.tolerance > 0 && change <= config.tolerance)
+            break;
+
+        ws.b[0] = ws.res;
+        vcycle(0, ws);
+        double rzNew = 0.0;
+        for (int i = 0; i < n; ++i)
+            rzNew += ws.res[i] * ws.x[0][i];
+        const double beta = rzNew / rz;
+        for (int i = 0; i < n; ++i)
+            ws.p[i] = ws.x[0][i] + beta * ws.p[i];
+        rz = rzNew;
+    }
+    return stats;
+}
+
+#endif // MULTIGRID_SOLVER_HPP
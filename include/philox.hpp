@@ -0,0 +1,98 @@
+#ifndef PHILOX_HPP
+#define PHILOX_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <random>
+
+// カウンタ方式の乱数生成器 Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC'11)
+// 内部状態を持たず、(鍵, カウンタ)から乱数を直接計算する。
+// 鍵を実行のシード、カウンタを(素子の添字, 素子ごとの抽選回数)にすると、素子ごとに独立な乱数列になり、
+// どの順番・どのスレッドで引いても同じ値になる
+struct Philox4x32
+{
+    using Counter = std::array<std::uint32_t, 4>;
+    using Key = std::array<std::uint32_t, 2>;
+
+    static constexpr std::uint32_t M0 = 0xD2511F53u;
+    static constexpr std::uint32_t M1 = 0xCD9E8D57u;
+    static constexpr std::uint32_t W0 = 0x9E3779B9u;
+    static constexpr std::uint32_t W1 = 0xBB67AE85u;
+    static constexpr int rounds = 10;
+
+    // 1ラウンド
+    static Counter round(const Counter &ctr, const Key &key)
+    {
+        const std::uint64_t p0 = static_cast<std::uint64_t>(M0) * ctr[0];
+        const std::uint64_t p1 = static_cast<std::uint64_t>(M1) * ctr[2];
+        return {static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<std::uint32_t>(p1),
+                static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<std::uint32_t>(p0)};
+    }
+
+    // カウンタと鍵から128bitの乱数を計算
+    static Counter generate(Counter ctr, Key key)
+    {
+        for (int r = 0; r < rounds; ++r)
+        {
+            if (r > 0)
+            {
+                key[0] += W0;
+                key[1] += W1;
+            }
+            ctr = round(ctr, key);
+        }
+        return ctr;
+    }
+};
+
+// (シード, ストリーム番号, カウンタ)から64bitの乱数
+inline std::uint64_t philoxBits(std::uint64_t seed, std::uint64_t stream, std::uint64_t counter)
+{
+    const Philox4x32::Counter out = Philox4x32::generate(
+        {static_cast<std::uint32_t>(counter), static_cast<std::uint32_t>(counter >> 32),
+         static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)},
+        {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)});
+    return (static_cast<std::uint64_t>(out[0]) << 32) | out[1];
+}
+
+// (シード, ストリーム番号, カウンタ)から(0, 1]の一様乱数(上位53bitを使う。log(1/u)が有限になるよう0は返さない)
+inline double philoxUniform(std::uint64_t seed, std::uint64_t stream, std::uint64_t counter)
+{
+    return static_cast<double>((philoxBits(seed, stream, counter) >> 11) + 1) * 0x1.0p-53;
+}
+
+// 親シードから番号ごとの子シードを作る(Simulation2Dがgridごとのシードに使う)
+inline std::uint64_t deriveSeed(std::uint64_t seed, std::uint64_t index)
+{
+    // 素子の乱数列(カウンタは抽選回数)と重ならないよう、カウンタの最大値を使う
+    return philoxBits(seed, index, ~std::uint64_t(0));
+}
+
+// シードを指定しない場合に使う、実行ごとに異なるシード
+inline std::uint64_t nondeterministicSeed()
+{
+    std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
+}
+
+// 1つの乱数列(シード, ストリーム番号)と、これまでに引いた回数
+struct PhiloxStream
+{
+    std::uint64_t seed = 0;
+    std::uint64_t stream = 0;
+    std::uint64_t counter = 0;
+
+    // 次の(0, 1]の一様乱数
+    double uniform() { return philoxUniform(seed, stream, counter++); }
+};
+
+// シードを指定しない素子に配る乱数列(プロセスで1つのシードと、素子ごとに異なるストリーム番号)
+inline PhiloxStream defaultPhiloxStream()
+{
+    static const std::uint64_t seed = nondeterministicSeed();
+    static std::atomic<std::uint64_t> nextStream{0};
+    return PhiloxStream{seed, nextStream.fetch_add(1, std::memory_order_relaxed), 0};
+}
+
+#endif // PHILOX_HPP
@@ -0,0 +1,169 @@
+#ifndef PRECISION_COMPARISON_HPP
+#define PRECISION_COMPARISON_HPP
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "simulation_2d.hpp"
+#include "flat_seo_grid.hpp"
+#include "lattice_builder.hpp"
+
+// 単精度の経過が倍精度からどれだけずれたか(PrecisionComparison::runの結果)
+struct PrecisionDrift
+{
+    long long steps = 0;          // 両方の精度で同じ経過だったステップ数
+    long long matchedTunnels = 0; // そのうち同じ素子・向きでトンネルした回数
+    bool diverged = false;        // トンネルの経過(素子・向き・有無)が分かれたか
+    // 分かれたステップの開始時刻(倍精度側。分かれなければ+inf)
+    double divergenceTime = std::numeric_limits<double>::infinity();
+    double maxTimeDrift = 0.0;     // 同じ経過の間の時刻の差の最大値
+    double maxWaitTimeDrift = 0.0; // 同じトンネルでの待ち時間の相対差の最大値
+    double maxVnDrift = 0.0;       // 同じ経過の間のVnの差の最大値
+    double rmsVnDrift = 0.0;       // 最後に比べたステップでのVnの差の二乗平均平方根
+
+    // 単精度で十分か(経過が分かれず、Vn・時刻のずれが許容範囲内)
+    bool isAcceptable(double vnTolerance, double timeTolerance) const
+    {
+        return !diverged && maxVnDrift <= vnTolerance && maxTimeDrift <= timeTolerance;
+    }
+};
+
+// 同じ格子を倍精度(Grid2D<DoubleSEO>)と単精度(Grid2D<SingleSEO>)で1ステップずつ並べて実行し、
+// トンネルの経過・時刻・Vnのずれを測る。両方とも同じシードの乱数列から引くので、
+// ずれは丸め誤差だけから生じる。経過が分かれたら(以降は別の経過なので)そこで止める
+//
+//   PrecisionComparison cmp(dt, endtime);
+//   cmp.addLattice(builder);
+//   PrecisionDrift drift = cmp.run();
+//   if (drift.isAcceptable(1e-4, 1e-3)) { ... 単精度でスイープする ... }
+class PrecisionComparison
+{
+private:
+    double endtime;
+    Simulation2D<DoubleSEO> reference;   // 基準(倍精度)
+    Simulation2D<SingleSEO, float> single; // 単精度(出力フレームもfloat)
+
+    // 直前のステップのトンネル(無ければgridIndex = -1)。tunnelsBeforeはステップ前のトンネル回数
+    // comparewtと同じく、wtが最小のgridを番号の小さい方から選ぶ
+    template <typename Sim>
+    static TunnelEvent lastTunnel(Sim &sim, long long tunnelsBefore)
+    {
+        TunnelEvent event;
+        if (sim.getTunnelCount() == tunnelsBefore)
+            return event;
+        event.wt = std::numeric_limits<double>::infinity();
+        const auto &grids = sim.getGrids();
+        for (std::size_t g = 0; g < grids.size(); ++g)
+        {
+            if (grids[g].getTunnelIndex() >= 0 && grids[g].getMinWT() < event.wt)
+            {
+                event.gridIndex = static_cast<int>(g);
+                event.cellIndex = grids[g].getTunnelIndex();
+                event.direction = grids[g].getTunnelDirection();
+                event.wt = grids[g].getMinWT();
+            }
+        }
+        return event;
+    }
+
+public:
+    // コンストラクタ(刻み時間,シミュレーションの終了タイミング)
+    PrecisionComparison(double dT, double EndTime) : endtime(EndTime), reference(dT, EndTime), single(dT, EndTime)
+    {
+        // 比べる2つは常に同じシードで実行する
+        setSeed(nondeterministicSeed());
+    }
+
+    // builderで作った格子を両方の精度で追加し、gridの番号を返す
+    int addLattice(LatticeBuilder &builder)
+    {
+        reference.appendGrid(builder.buildPrecisionGrid<double>());
+        single.appendGrid(builder.buildPrecisionGrid<float>());
+        return static_cast<int>(reference.getGrids().size()) - 1;
+    }
+
+    // トリガーを追加する(gridはaddLatticeの戻り値)
+    void addVoltageTrigger(double triggerTime, int grid, int x, int y, double voltage)
+    {
+        reference.addVoltageTrigger(triggerTime, grid, x, y, voltage);
+        single.addVoltageTrigger(triggerTime, grid, x, y, voltage);
+    }
+
+    // 実行のシードを設定(両方に同じシードを使う)
+    void setSeed(std::uint64_t runSeed)
+    {
+        reference.setSeed(runSeed);
+        single.setSeed(runSeed);
+    }
+
+    // Vnの緩和方法を設定(Jacobi法か赤黒SOR)
+    void setRelaxation(const RelaxationConfig &config)
+    {
+        reference.setRelaxation(config);
+        single.setRelaxation(config);
+    }
+
+    // 電荷の時間発展の計算方法を設定
+    void setChargeIntegrator(ChargeIntegrator integrator)
+    {
+        reference.setChargeIntegrator(integrator);
+        single.setChargeIntegrator(integrator);
+    }
+
+    // 倍精度側のシミュレーション(初期電荷の設定や出力の取得に使う)
+    Simulation2D<DoubleSEO> &getReference() { return reference; }
+
+    // 単精度側のシミュレーション
+    Simulation2D<SingleSEO, float> &getSingle() { return single; }
+
+    // 終了時刻まで(経過が分かれたらそこまで)並べて実行し、ずれを返す
+    PrecisionDrift run()
+    {
+        PrecisionDrift drift;
+        while (reference.getTime() < endtime && single.getTime() < endtime)
+        {
+            const double stepStart = reference.getTime();
+            const long long refBefore = reference.getTunnelCount(), singleBefore = single.getTunnelCount();
+            reference.runStep();
+            single.runStep();
+            const TunnelEvent refEvent = lastTunnel(reference, refBefore);
+            const TunnelEvent singleEvent = lastTunnel(single, singleBefore);
+            if (refEvent.gridIndex != singleEvent.gridIndex || refEvent.cellIndex != singleEvent.cellIndex ||
+                refEvent.direction != singleEvent.direction)
+            {
+                drift.diverged = true;
+                drift.divergenceTime = stepStart;
+                break;
+            }
+            ++drift.steps;
+            if (refEvent.gridIndex >= 0)
+            {
+                ++drift.matchedTunnels;
+                drift.maxWaitTimeDrift =
+                    std::max(drift.maxWaitTimeDrift, std::fabs(singleEvent.wt - refEvent.wt) / refEvent.wt);
+            }
+            drift.maxTimeDrift = std::max(drift.maxTimeDrift, std::fabs(single.getTime() - reference.getTime()));
+
+            double sumSquares = 0.0;
+            long long cells = 0;
+            for (std::size_t g = 0; g < reference.getGrids().size(); ++g)
+            {
+                const auto &a = reference.getGrids()[g];
+                const auto &b = single.getGrids()[g];
+                for (int i = 0; i < a.numCells(); ++i)
+                {
+                    const int row = i / a.numCols(), col = i % a.numCols();
+                    const double d = std::fabs(b.getElement(row, col)->getVn() - a.getElement(row, col)->getVn());
+                    drift.maxVnDrift = std::max(drift.maxVnDrift, d);
+                    sumSquares += d * d;
+                }
+                cells += a.numCells();
+            }
+            drift.rmsVnDrift = cells > 0 ? std::sqrt(sumSquares / cells) : 0.0;
+        }
+        return drift;
+    }
+};
+
+#endif // PRECISION_COMPARISON_HPP
@@ -0,0 +1,60 @@
+#ifndef RELAXATION_HPP
+#define RELAXATION_HPP
+
+#include <stdexcept>
+
+// ノード電圧Vnを落ち着かせる（緩和する）方法
+enum class RelaxationMethod
+{
+    Jacobi,     // 全素子のV_sumを求めてから全素子のVnを更新（従来の方法）
+    RedBlackSOR, // 市松模様の赤→黒の順に、更新済みの値を使って更新（omega=1でGauss-Seidel）
+    Direct,      // 容量行列を一度だけ分解してキャッシュし、毎回厳密に解く(反復回数・許容誤差は使わない)
+    Multigrid    // V-cycleを前処理にした共役勾配法(反復回数・許容誤差はこの反復に使う)
+};
+
+// 緩和の設定（デフォルトは従来通りJacobi法を5回）
+struct RelaxationConfig
+{
+    RelaxationMethod method = RelaxationMethod::Jacobi;
+    int maxIterations = 5;  // 最大反復回数
+    double tolerance = 0.0; // 1反復でのVnの最大変化量がこれ以下になったら打ち切る(0なら常にmaxIterations回)
+    double omega = 1.0;     // SORの緩和係数(0 < omega < 2)
+    // Jacobi法の時間方向ブロッキングで1タイルに入れる行数(0なら使わない。Grid2D<FlatSEO>のみ)
+    // タイルごとに上下maxIterations行の重なりを持たせて全反復を済ませるので、格子を読むのは1回で済む。
+    // 反復回数は固定(tolerance = 0)で、結果はタイルを使わない場合とビット単位で同じ
+    int tileRows = 0;
+};
+
+// 1回の緩和の結果
+struct RelaxationStats
+{
+    int iterations = 0;    // 実際に行った反復回数
+    double residual = 0.0; // 最後の反復でのVnの最大変化量
+};
+
+// 設定値の確認
+inline void validateRelaxationConfig(const RelaxationConfig &config)
+{
+    if (config.maxIterations < 1)
+    {
+        throw std::invalid_argument("maxIterations must be at least 1");
+    }
+    if (config.tolerance < 0)
+    {
+        throw std::invalid_argument("tolerance must be non-negative");
+    }
+    if (!(config.omega > 0 && config.omega < 2))
+    {
+        throw std::invalid_argument("omega must be in (0, 2)");
+    }
+    if (config.tileRows < 0)
+    {
+        throw std::invalid_argument("tileRows must be non-negative");
+    }
+    if (config.method == RelaxationMethod::Jacobi && config.tileRows > 0 && config.tolerance > 0)
+    {
+        throw std::invalid_argument("Tiled Jacobi runs a fixed number of iterations; tolerance must be 0");
+    }
+}
+
+#endif // RELAXATION_HPP
@@ -9,12 +9,41 @@
 #include <stdexcept>
 #include <random>
 #include <memory>
+#include <array>
+#include "philox.hpp"
 
 constexpr double e = 0.1602; // 電子の電荷量
 
 
 using namespace std;
 
+// トンネルの向き（配列の添字として使う）
+enum class TunnelDirection
+{
+    Up = 0,
+    Down = 1
+};
+
+// 文字列("up"/"down")からTunnelDirectionへ変換（それ以外は例外）
+TunnelDirection toTunnelDirection(const string &direction);
+
+// TunnelDirectionを文字列("up"/"down")へ変換
+const char *tunnelDirectionName(TunnelDirection direction);
+
+// up/downの2つの値を持つ固定スロット（dE, wt用。Realは単精度の格子用）
+template <typename Real>
+struct BasicTunnelPair
+{
+    array<Real, 2> value{Real(0), Real(0)};
+
+    Real &operator[](TunnelDirection direction) { return value[static_cast<int>(direction)]; }
+    Real operator[](TunnelDirection direction) const { return value[static_cast<int>(direction)]; }
+    // 互換用：文字列での参照
+    Real operator[](const string &direction) const { return (*this)[toTunnelDirection(direction)]; }
+};
+
+using TunnelPair = BasicTunnelPair<double>;
+
 class SEO {
 private:
     double Q;               // ノード電荷
@@ -27,9 +56,11 @@ private:
     int legs;               // 足の数
     // vector<double> V;    // 周囲のノード電圧
     double V_sum;           // 周囲のノード電圧の総和
-    map<string, double> dE; // エネルギー変化量(up, down)
-    map<string, double> wt; // トンネル待時間(up, down)
+    double Vext;            // 外部から加える電圧（トリガ用、V_sumに足される）
+    TunnelPair dE;          // エネルギー変化量(up, down)
+    TunnelPair wt;          // トンネル待時間(up, down)
     vector<shared_ptr<SEO>> connection; // 接続されている素子のポインタ
+    PhiloxStream rng;       // トンネル待ち時間用の乱数列(シード, ストリーム番号, 抽選回数)
 
 public:
     //-----------コンストラクタ---------// 
@@ -48,12 +79,18 @@ public:
     // V_sumを設定
     void setVsum(double v);
 
+    // 外部から加える電圧を設定（次のsetSurroundingVoltagesからV_sumに足される）
+    void setExternalVoltage(double v);
+
     // 接続情報を設定
     void setConnections(const vector<shared_ptr<SEO>> &connectedSEOs);
 
     // 周囲の電圧を設定
     void setSurroundingVoltages();
 
+    // 乱数列を設定(同じシード・ストリーム番号なら同じ乱数列になる。Grid2Dは素子の添字を番号にする)
+    void setRandomStream(uint64_t seed, uint64_t stream);
+
     // 振動子のパラメータ計算
     void setPcalc();
 
@@ -63,11 +100,20 @@ public:
     // 電荷の更新
     void setNodeCharge(const double dt);
 
+    // 電荷の更新(周囲の電圧を一定としたRC充電の解析解)
+    void setNodeChargeExponential(const double dt);
+
+    // 周囲の電圧が一定のまま充電が進んだとき、dEが正になるまでの時間(既に正なら0、ならないなら+inf)
+    double getThresholdTime() const;
+
     // トンネル待ち時間計算(upまたはdownが正の時にwtを計算してtrueを返す)
     bool calculateTunnelWt();
 
     // 振動子のトンネル
-    void setTunnel(const string direction);
+    void setTunnel(TunnelDirection direction);
+
+    // 振動子のトンネル（互換用：文字列で向きを指定）
+    void setTunnel(const string &direction);
 
     //-----------ゲッター------------//    
     // ノード電圧を取得
@@ -79,19 +125,28 @@ public:
     // 接続されてる振動子の電圧の総和を取得
     double getSurroundingVsum() const;
 
+    // 外部から加えている電圧を取得
+    double getExternalVoltage() const;
+
     // dEの取得
-    map<string, double> getdE() const;
+    const TunnelPair &getdE() const;
 
     // Qの取得
     double getQ() const;
 
     // wtの取得
-    map<string, double> getWT() const;
+    const TunnelPair &getWT() const;
+
+    // 乱数列を取得
+    const PhiloxStream &getRandomStream() const;
 
     //-------- 汎用処理 -------------//
-    // 0から1の間の乱数を生成
+    // 0から1の間(0は含まない)の乱数を生成
     double Random();
 
+    // 平均1の指数分布の乱数を生成(トンネル待ち時間用)
+    double Exponential();
+
     //-------- テスト用 -------------//
     // テスト用idCounterゲッター
     int getidCounter() const;
@@ -115,6 +170,9 @@ public:
     int getlegs() const;
 
     // テスト用dEセッター
+    void setdE(TunnelDirection direction, double value);
+
+    // テスト用dEセッター（互換用：文字列で向きを指定）
     void setdE(const string& direction, double value);
 
     // テスト用Vnセッター
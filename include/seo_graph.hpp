@@ -0,0 +1,733 @@
+#ifndef SEO_GRAPH_HPP
+#define SEO_GRAPH_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include "seo_class.hpp"
+#include "grid_2dim.hpp"
+#include "relaxation.hpp"
+#include "thread_pool.hpp"
+#include "seo_kernels.hpp"
+#include "philox.hpp"
+#include "charge_integration.hpp"
+
+// 任意の接続のSEOネットワーク（ランダム・スモールワールド・リザバーなど）用のタグ型
+struct GraphSEO
+{
+};
+
+// 接続容量Cで2つの素子をつなぐ辺（向きは無い）
+struct GraphEdge
+{
+    int from, to;
+    double C;
+};
+
+// Grid2D<GraphSEO>：接続をCSR形式（素子ごとに連続した隣接素子の添字と辺の容量）で持つSEOネットワーク
+// Simulation2Dからは他のGrid2Dと同じように使える（getElement(row, col)はsetLayoutで決めた並びで引く）
+//
+// 素子iのノード電圧は
+//   Vn_i = (Q_i + Σ_j C_ij Vn_j + Cg_i Vext_i) / (Cj_i + Cg_i + Σ_j C_ij)
+// Cgは接続先の無い足の容量で、外部電圧源(トリガ)につながる(Vext=0なら接地)。
+// 格子の端の素子(足がlegs本あるが隣接素子が少ない)は、余った足の分をCgにすればGrid2D<SEO>と同じ式になる
+template <>
+class Grid2D<GraphSEO>
+{
+public:
+    // 1素子分のビュー（getElementの戻り値）
+    class ElementRef
+    {
+    private:
+        Grid2D *grid;
+        int index;
+
+    public:
+        ElementRef(Grid2D *g, int idx) : grid(g), index(idx) {}
+
+        // shared_ptr<SEO>と同じ書き方(->)で使うため
+        ElementRef *operator->() { return this; }
+        const ElementRef *operator->() const { return this; }
+
+        // 素子の添字
+        int getIndex() const { return index; }
+
+        // パラメータセットアップ(接続容量は辺ごとに持つ)
+        void setUp(double r, double rj, double cj, double vd)
+        {
+            grid->R[index] = r;
+            grid->Rj[index] = rj;
+            grid->Cj[index] = cj;
+            grid->Vd[index] = vd;
+        }
+        // 接続先の無い足の容量を設定
+        void setGroundCapacitance(double cg) { grid->Cg[index] = cg; }
+        // バイアス電圧を設定
+        void setVias(double vd) { grid->Vd[index] = vd; }
+        // 外部から加える電圧を設定
+        void setExternalVoltage(double v) { grid->setExternalVoltage(index, v); }
+        // 振動子のトンネル
+        void setTunnel(TunnelDirection direction) { grid->applyTunnel(index, direction); }
+
+        double getVn() const { return grid->Vn[index]; }
+        double getQ() const { return grid->Qn[index]; }
+        // 隣接素子と外部電圧源から誘起される電荷 Σ_j C_ij Vn_j + Cg Vext
+        double getCoupledCharge() const { return grid->coupled[index]; }
+        double getExternalVoltage() const { return grid->Vext[index]; }
+        const TunnelPair &getdE() const { return grid->dE[index]; }
+        const TunnelPair &getWT() const { return grid->wt[index]; }
+        double getR() const { return grid->R[index]; }
+        double getRj() const { return grid->Rj[index]; }
+        double getCj() const { return grid->Cj[index]; }
+        double getGroundCapacitance() const { return grid->Cg[index]; }
+        double getVd() const { return grid->Vd[index]; }
+        // 素子の全容量 Cj + Cg + Σ_j C_ij
+        double getTotalCapacitance() const { return grid->totalCapacitance(index); }
+        // 隣接素子の数
+        int getDegree() const { return grid->degree(index); }
+
+        // テスト用セッター
+        void setVn(double vn) { grid->Vn[index] = vn; }
+        void setQ(double qn) { grid->Qn[index] = qn; }
+    };
+
+private:
+    // 素子数と、出力・トリガ用の並び(rows_*cols_ == n_)
+    int n_, rows_, cols_;
+    // CSR形式の接続：素子iの隣接素子は neighbours[offsets[i]] .. neighbours[offsets[i+1]-1]
+    std::vector<int> offsets;
+    std::vector<int> neighbours;
+    std::vector<double> edgeC;     // 辺の接続容量(neighboursと同じ並び)
+    std::vector<double> couplingC; // 素子ごとの接続容量の和 Σ_j C_ij
+    // 状態量
+    std::vector<double> Qn;      // ノード電荷
+    std::vector<double> Vn;      // ノード電圧
+    std::vector<double> coupled; // Σ_j C_ij Vn_j + Cg Vext
+    std::vector<double> Vd;      // バイアス電圧
+    std::vector<double> Vext;    // 外部から加える電圧（トリガ用）
+    std::vector<TunnelPair> dE;  // エネルギー変化量(up, down)
+    std::vector<TunnelPair> wt;  // トンネル待時間(up, down)
+    // 回路パラメータ
+    std::vector<double> R;  // 抵抗
+    std::vector<double> Rj; // トンネル抵抗
+    std::vector<double> Cj; // 接合容量
+    std::vector<double> Cg; // 接続先の無い足の容量
+    // 出力時のファイル名(デフォルトは空)
+    std::string outputlabel = "";
+    // 電子トンネルをする素子の添字(-1はトンネル無し)
+    int tunnelindex;
+    // 電子トンネルの向き
+    TunnelDirection tunneldirection;
+    // 最小の待ち時間
+    double minwt;
+    // 出力するかのbool値(デフォルトがtrueで出力する)
+    bool outputEnabled;
+    // トンネル待ち時間用の乱数列のシードと素子ごとの抽選回数(Grid2D<FlatSEO>と同じ引き方)
+    std::uint64_t rngSeed;
+    std::vector<std::uint64_t> rngCounter;
+
+    //---- 並列実行用(Grid2D<FlatSEO>と同じ区間の分け方・乱数の引き方) ----//
+    std::shared_ptr<ThreadPool> pool;
+    std::vector<double> VnNext;
+    std::vector<double> chunkValues;
+    std::vector<int> chunkIndices;
+    std::vector<TunnelDirection> chunkDirections;
+    std::vector<double> expo;
+    // wtの一括計算に使うカーネル
+    const SEOKernelTable *kernels;
+
+    // 素子iの Σ_j C_ij v_j + Cg Vext （隣接素子は連続して読む）
+    double coupledSum(const double *v, int i) const;
+
+    // 素子の全容量
+    double totalCapacitance(int i) const;
+
+    // 1素子のノード電圧
+    double nodeVoltage(int i) const;
+
+    // 1素子のdEを計算
+    void computedE(int i);
+
+    // (up, down)の組の配列をdoubleの配列として見る
+    static double *pairData(std::vector<TunnelPair> &pairs);
+
+public:
+    // コンストラクタ：numNodes個の素子をedgesでつなぐ（パラメータは全て0、並びは1行）
+    // 同じ2素子の間の辺が複数あれば、容量を足したものとして扱う
+    Grid2D(int numNodes, const std::vector<GraphEdge> &edges, bool enableOutput = true);
+
+    // 出力・トリガで使う2次元の並びを設定(rows*colsが素子数と一致すること)
+    void setLayout(int rows, int cols);
+
+    // 並びの位置(row, col)の素子のビューを取得
+    ElementRef getElement(int row, int col) const;
+
+    // 添字の素子のビューを取得
+    ElementRef getNode(int index) const;
+
+    // 全素子の隣接素子からの誘起電荷を更新
+    void updateGridSurVn();
+
+    // 全素子のノード電圧Vnを計算・更新
+    void updateGridVn();
+
+    // 設定に従って全素子のVnを緩和する
+    // (RedBlackSORは色分けせず添字順のSOR。DirectとMultigridは格子専用なので例外)
+    RelaxationStats relax(const RelaxationConfig &config);
+
+    // 全素子のエネルギー変化dEを計算・更新
+    void updateGriddE();
+
+    // 全素子のトンネル待ち時間wtを計算し、最小wtとトンネル素子を更新
+    bool gridminwt(const double dt);
+
+    // 全素子のノード電荷Qnを更新
+    void updateGridQn(const double dt);
+
+    // 全素子のノード電荷QnをRC充電の解析解で更新(隣接素子の電圧はステップ内で一定とする)
+    void updateGridQnExponential(const double dt);
+
+    // 隣接素子の電圧を一定としたとき、いずれかの素子のdEが正になるまでの時間(既に正なら0、ならないなら+inf)
+    double nextThresholdTime() const;
+
+    // 隣接素子の電圧を一定として充電したとき、どの素子でも隣接素子のVnの変化の合計が
+    // tolerance以下に収まる時間(各素子のVnの変化をtolerance/最大の隣接数以下に抑える)
+    double vsumDriftTime(double tolerance) const;
+
+    // 乱数のシードを設定
+    void seedRandom(std::uint64_t seed);
+
+    // 外部から加える電圧を設定
+    void setExternalVoltage(int index, double v);
+
+    // 並列実行に使うスレッドプールを設定(nullptrで逐次に戻す)
+    void setThreadPool(std::shared_ptr<ThreadPool> threadPool);
+
+    // スレッドプールを取得
+    std::shared_ptr<ThreadPool> getThreadPool() const;
+
+    // wtの一括計算に使う命令セットを設定(CPUが対応していなければ例外)
+    void setSimdLevel(SimdLevel level);
+
+    // wtの一括計算に使っている命令セットを取得
+    SimdLevel getSimdLevel() const;
+
+    // 並びの行数を取得
+    int numRows() const;
+
+    // 並びの列数を取得
+    int numCols() const;
+
+    // 素子数を取得
+    int numCells() const;
+
+    // 辺の数を取得
+    long long numEdges() const;
+
+    // 素子の隣接素子の数を取得
+    int degree(int index) const;
+
+    // 素子のk番目の隣接素子の添字を取得
+    int neighbour(int index, int k) const;
+
+    // 素子とk番目の隣接素子の間の接続容量を取得
+    double edgeCapacitance(int index, int k) const;
+
+    // 添字の素子の、指定方向のトンネルレート(dE/(e^2 Rj), dE<=0なら0)を取得
+    double tunnelRate(int index, TunnelDirection direction) const;
+
+    // トンネルが発生する素子を取得
+    ElementRef getTunnelPlace() const;
+
+    // トンネルが発生する素子の添字を取得
+    int getTunnelIndex() const;
+
+    // 添字で指定した素子をトンネルさせる
+    void applyTunnel(int index, TunnelDirection direction);
+
+    // トンネルの方向を取得
+    TunnelDirection getTunnelDirection() const;
+
+    // 最小トンネル待ち時間wtを取得
+    double getMinWT() const;
+
+    // outputlabelの設定
+    void setOutputLabel(const std::string &label);
+
+    // outputlabelの取得
+    std::string getOutputLabel() const;
+
+    // outputlabelが設定されているかの取得
+    bool hasOutputLabel() const;
+
+    // OutputEnabledの設定
+    void setOutputEnabled(bool flag);
+
+    // OutputEnabledの取得
+    bool isOutputEnabled() const;
+};
+
+// SEOネットワークの別名
+using SEOGraph = Grid2D<GraphSEO>;
+
+//-------- Grid2D<GraphSEO> ----------//
+// コンストラクタ：辺の一覧から素子ごとの数を数えてCSRを作る
+inline Grid2D<GraphSEO>::Grid2D(int numNodes, const std::vector<GraphEdge> &edges, bool enableOutput)
+    : n_(numNodes), rows_(1), cols_(numNodes), tunnelindex(-1), tunneldirection(TunnelDirection::Up), minwt(0.0),
+      outputEnabled(enableOutput), rngSeed(nondeterministicSeed()), kernels(&seoKernels())
+{
+    if (numNodes <= 0)
+    {
+        throw std::invalid_argument("Graph must have at least one node");
+    }
+    if (edges.size() > static_cast<std::size_t>(std::numeric_limits<int>::max() / 2))
+    {
+        throw std::invalid_argument("Too many edges");
+    }
+    // 1. 素子ごとの隣接数
+    offsets.assign(n_ + 1, 0);
+    for (const GraphEdge &edge : edges)
+    {
+        if (edge.from < 0 || edge.from >= n_ || edge.to < 0 || edge.to >= n_)
+        {
+            throw std::out_of_range("Graph edge references a node out of range");
+        }
+        if (edge.from == edge.to)
+        {
+            throw std::invalid_argument("Graph edge must connect two different nodes");
+        }
+        if (!(edge.C > 0))
+        {
+            throw std::invalid_argument("Graph edge capacitance must be positive");
+        }
+        ++offsets[edge.from + 1];
+        ++offsets[edge.to + 1];
+    }
+    for (int i = 0; i < n_; ++i)
+        offsets[i + 1] += offsets[i];
+    // 2. 両方向に書き込む(辺の順を保つので、同じ入力なら同じ並びになる)
+    neighbours.resize(offsets[n_]);
+    edgeC.resize(offsets[n_]);
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (const GraphEdge &edge : edges)
+    {
+        neighbours[fill[edge.from]] = edge.to;
+        edgeC[fill[edge.from]++] = edge.C;
+        neighbours[fill[edge.to]] = edge.from;
+        edgeC[fill[edge.to]++] = edge.C;
+    }
+    couplingC.assign(n_, 0.0);
+    for (int i = 0; i < n_; ++i)
+    {
+        for (int k = offsets[i]; k < offsets[i + 1]; ++k)
+            couplingC[i] += edgeC[k];
+    }
+    for (auto *field : {&Qn, &Vn, &coupled, &Vd, &Vext, &R, &Rj, &Cj, &Cg})
+    {
+        field->assign(n_, 0.0);
+    }
+    dE.assign(n_, TunnelPair());
+    wt.assign(n_, TunnelPair());
+    rngCounter.assign(n_, 0);
+}
+
+// 素子iの Σ_j C_ij v_j + Cg Vext
+inline double Grid2D<GraphSEO>::coupledSum(const double *v, int i) const
+{
+    double sum = 0.0;
+    const int end = offsets[i + 1];
+    for (int k = offsets[i]; k < end; ++k)
+    {
+        sum += edgeC[k] * v[neighbours[k]];
+    }
+    return sum + Cg[i] * Vext[i];
+}
+
+// 素子の全容量
+inline double Grid2D<GraphSEO>::totalCapacitance(int i) const
+{
+    return Cj[i] + Cg[i] + couplingC[i];
+}
+
+// 1素子のノード電圧
+inline double Grid2D<GraphSEO>::nodeVoltage(int i) const
+{
+    return (Qn[i] + coupled[i]) / totalCapacitance(i);
+}
+
+// 1素子のdEを計算（SEO::setdEcalcのC*V_sumを誘起電荷に、legs*C+Cjを全容量に置き換えた式）
+inline void Grid2D<GraphSEO>::computedE(int i)
+{
+    dE[i][TunnelDirection::Up] = -e * (e - 2 * (Qn[i] + coupled[i])) / (2 * totalCapacitance(i));
+    dE[i][TunnelDirection::Down] = -e * (e + 2 * (Qn[i] + coupled[i])) / (2 * totalCapacitance(i));
+}
+
+// (up, down)の組の配列をdoubleの配列として見る
+inline double *Grid2D<GraphSEO>::pairData(std::vector<TunnelPair> &pairs)
+{
+    static_assert(sizeof(TunnelPair) == 2 * sizeof(double), "TunnelPair must be two packed doubles");
+    return pairs.empty() ? nullptr : &pairs.front()[TunnelDirection::Up];
+}
+
+// 出力・トリガで使う2次元の並びを設定
+inline void Grid2D<GraphSEO>::setLayout(int rows, int cols)
+{
+    if (rows <= 0 || cols <= 0 || static_cast<long long>(rows) * cols != n_)
+    {
+        throw std::invalid_argument("Layout must cover every node exactly once");
+    }
+    rows_ = rows;
+    cols_ = cols;
+}
+
+// 並びの位置の素子のビューを取得
+inline Grid2D<GraphSEO>::ElementRef Grid2D<GraphSEO>::getElement(int row, int col) const
+{
+    if (row < 0 || row >= rows_ || col < 0 || col >= cols_)
+    {
+        throw std::out_of_range("Grid2D::getElement index out of range");
+    }
+    return ElementRef(const_cast<Grid2D *>(this), row * cols_ + col);
+}
+
+// 添字の素子のビューを取得
+inline Grid2D<GraphSEO>::ElementRef Grid2D<GraphSEO>::getNode(int index) const
+{
+    if (index < 0 || index >= n_)
+    {
+        throw std::out_of_range("Graph node index out of range");
+    }
+    return ElementRef(const_cast<Grid2D *>(this), index);
+}
+
+// 全素子の隣接素子からの誘起電荷を更新
+inline void Grid2D<GraphSEO>::updateGridSurVn()
+{
+    parallelChunks(pool.get(), 0, n_, [this](int, int first, int last) {
+        for (int i = first; i < last; ++i)
+            coupled[i] = coupledSum(Vn.data(), i);
+    });
+}
+
+// 全素子のノード電圧Vnを計算・更新
+inline void Grid2D<GraphSEO>::updateGridVn()
+{
+    parallelChunks(pool.get(), 0, n_, [this](int, int first, int last) {
+        for (int i = first; i < last; ++i)
+            Vn[i] = nodeVoltage(i);
+    });
+}
+
+// 設定に従って全素子のVnを緩和する
+inline RelaxationStats Grid2D<GraphSEO>::relax(const RelaxationConfig &config)
+{
+    if (config.method == RelaxationMethod::Direct || config.method == RelaxationMethod::Multigrid)
+    {
+        throw std::invalid_argument("Direct and multigrid relaxation require Grid2D<FlatSEO>");
+    }
+    RelaxationStats stats;
+    chunkValues.resize(numChunks(pool.get()));
+    for (int it = 0; it < config.maxIterations; ++it)
+    {
+        double residual = 0.0;
+        if (config.method == RelaxationMethod::Jacobi)
+        {
+            // 古いVnから読んでVnNextに書き、最後に入れ替える
+            VnNext.resize(n_);
+            std::fill(chunkValues.begin(), chunkValues.end(), 0.0);
+            parallelChunks(pool.get(), 0, n_, [&](int chunk, int first, int last) {
+                double res = 0.0;
+                for (int i = first; i < last; ++i)
+                {
+                    coupled[i] = coupledSum(Vn.data(), i);
+                    VnNext[i] = nodeVoltage(i);
+                    res = std::max(res, std::fabs(VnNext[i] - Vn[i]));
+                }
+                chunkValues[chunk] = res;
+            });
+            Vn.swap(VnNext);
+            residual = *std::max_element(chunkValues.begin(), chunkValues.end());
+        }
+        else
+        {
+            // 接続が任意なので色分けはせず、添字順に更新済みの値を使う（逐次）
+            for (int i = 0; i < n_; ++i)
+            {
+                coupled[i] = coupledSum(Vn.data(), i);
+                double delta = config.omega * (nodeVoltage(i) - Vn[i]);
+                Vn[i] += delta;
+                residual = std::max(residual, std::fabs(delta));
+            }
+        }
+        stats.iterations = it + 1;
+        stats.residual = residual;
+        if (config.tolerance > 0 && residual <= config.tolerance)
+            break;
+    }
+    // SORでは最後に更新したVnで誘起電荷を揃えておく(dEの計算に使うため)
+    if (config.method == RelaxationMethod::RedBlackSOR)
+    {
+        updateGridSurVn();
+    }
+    return stats;
+}
+
+// 全素子のエネルギー変化dEを計算・更新
+inline void Grid2D<GraphSEO>::updateGriddE()
+{
+    parallelChunks(pool.get(), 0, n_, [this](int, int first, int last) {
+        for (int i = first; i < last; ++i)
+            computedE(i);
+    });
+}
+
+// 全素子のトンネル待ち時間wtを計算し、最小wtとトンネル素子・方向を記録
+// (乱数は素子ごとの乱数列から引くので、スレッド数によらず同じ結果になる)
+inline bool Grid2D<GraphSEO>::gridminwt(const double dt)
+{
+    minwt = dt;
+    tunnelindex = -1;
+    // 1. 区間ごとに、トンネルしうる素子が自分の乱数列から指数分布の乱数をまとめて引き、カーネルでwtと最小値を求める
+    const int chunks = numChunks(pool.get());
+    chunkValues.assign(chunks, dt);
+    chunkIndices.assign(chunks, -1);
+    chunkDirections.assign(chunks, TunnelDirection::Up);
+    expo.resize(n_);
+    parallelChunks(pool.get(), 0, n_, [&](int chunk, int first, int last) {
+        kernels->exponentialDraw(pairData(dE), rngSeed, 0, rngCounter.data(), expo.data(), first, last);
+        WaitTimeMin found = kernels->waitTimeArgmin(pairData(dE), Rj.data(), expo.data(), pairData(wt), first, last);
+        if (found.index >= 0 && found.wt < chunkValues[chunk])
+        {
+            chunkValues[chunk] = found.wt;
+            chunkIndices[chunk] = found.index;
+            chunkDirections[chunk] =
+                (dE[found.index][TunnelDirection::Up] > 0) ? TunnelDirection::Up : TunnelDirection::Down;
+        }
+    });
+    // 2. 区間の順にまとめる(同じwtなら添字の小さい方が残る)
+    for (int c = 0; c < chunks; ++c)
+    {
+        if (chunkValues[c] < minwt)
+        {
+            minwt = chunkValues[c];
+            tunnelindex = chunkIndices[c];
+            tunneldirection = chunkDirections[c];
+        }
+    }
+    return minwt < dt;
+}
+
+// 全素子のノード電荷Qnを更新
+inline void Grid2D<GraphSEO>::updateGridQn(const double dt)
+{
+    parallelChunks(pool.get(), 0, n_, [this, dt](int, int first, int last) {
+        for (int i = first; i < last; ++i)
+            Qn[i] += (Vd[i] - Vn[i]) * dt / R[i];
+    });
+}
+
+// 全素子のノード電荷QnをRC充電の解析解で更新
+inline void Grid2D<GraphSEO>::updateGridQnExponential(const double dt)
+{
+    parallelChunks(pool.get(), 0, n_, [this, dt](int, int first, int last) {
+        for (int i = first; i < last; ++i)
+            Qn[i] += exponentialChargeIncrement(Vd[i], Vn[i], R[i], totalCapacitance(i), dt);
+    });
+}
+
+// いずれかの素子のdEが正になるまでの時間
+inline double Grid2D<GraphSEO>::nextThresholdTime() const
+{
+    std::vector<double> chunks(numChunks(pool.get()), std::numeric_limits<double>::infinity());
+    parallelChunks(pool.get(), 0, n_, [&](int chunk, int first, int last) {
+        for (int i = first; i < last; ++i)
+            chunks[chunk] =
+                std::min(chunks[chunk], thresholdCrossingTime(Qn[i] + coupled[i], Vd[i], R[i], totalCapacitance(i)));
+    });
+    return *std::min_element(chunks.begin(), chunks.end());
+}
+
+// 隣接素子のVnの変化の合計がtolerance以下に収まる時間
+inline double Grid2D<GraphSEO>::vsumDriftTime(double tolerance) const
+{
+    int maxDegree = 1;
+    for (int i = 0; i < n_; ++i)
+        maxDegree = std::max(maxDegree, degree(i));
+    const double delta = tolerance / maxDegree;
+    double limit = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < n_; ++i)
+    {
+        // 隣接素子が無ければ、他の素子には関わらない
+        if (degree(i) > 0)
+            limit = std::min(limit, voltageDriftTime(Vn[i], Vd[i], R[i], totalCapacitance(i), delta));
+    }
+    return limit;
+}
+
+// 乱数のシードを設定
+inline void Grid2D<GraphSEO>::seedRandom(std::uint64_t seed)
+{
+    rngSeed = seed;
+    std::fill(rngCounter.begin(), rngCounter.end(), 0);
+}
+
+// 外部から加える電圧を設定
+inline void Grid2D<GraphSEO>::setExternalVoltage(int index, double v)
+{
+    Vext[index] = v;
+}
+
+// 並列実行に使うスレッドプールを設定
+inline void Grid2D<GraphSEO>::setThreadPool(std::shared_ptr<ThreadPool> threadPool)
+{
+    pool = std::move(threadPool);
+}
+
+// スレッドプールを取得
+inline std::shared_ptr<ThreadPool> Grid2D<GraphSEO>::getThreadPool() const
+{
+    return pool;
+}
+
+// wtの一括計算に使う命令セットを設定
+inline void Grid2D<GraphSEO>::setSimdLevel(SimdLevel level)
+{
+    kernels = &seoKernels(level);
+}
+
+// wtの一括計算に使っている命令セットを取得
+inline SimdLevel Grid2D<GraphSEO>::getSimdLevel() const
+{
+    return kernels->level;
+}
+
+// 並びの行数を取得
+inline int Grid2D<GraphSEO>::numRows() const
+{
+    return rows_;
+}
+
+// 並びの列数を取得
+inline int Grid2D<GraphSEO>::numCols() const
+{
+    return cols_;
+}
+
+// 素子数を取得
+inline int Grid2D<GraphSEO>::numCells() const
+{
+    return n_;
+}
+
+// 辺の数を取得
+inline long long Grid2D<GraphSEO>::numEdges() const
+{
+    return static_cast<long long>(neighbours.size()) / 2;
+}
+
+// 素子の隣接素子の数を取得
+inline int Grid2D<GraphSEO>::degree(int index) const
+{
+    return offsets.at(index + 1) - offsets.at(index);
+}
+
+// 素子のk番目の隣接素子の添字を取得
+inline int Grid2D<GraphSEO>::neighbour(int index, int k) const
+{
+    if (k < 0 || k >= degree(index))
+    {
+        throw std::out_of_range("Neighbour index out of range");
+    }
+    return neighbours[offsets[index] + k];
+}
+
+// 素子とk番目の隣接素子の間の接続容量を取得
+inline double Grid2D<GraphSEO>::edgeCapacitance(int index, int k) const
+{
+    if (k < 0 || k >= degree(index))
+    {
+        throw std::out_of_range("Neighbour index out of range");
+    }
+    return edgeC[offsets[index] + k];
+}
+
+// トンネルレートを取得
+inline double Grid2D<GraphSEO>::tunnelRate(int index, TunnelDirection direction) const
+{
+    double de = dE[index][direction];
+    return de > 0 ? de / (e * e * Rj[index]) : 0.0;
+}
+
+// 最小wtでトンネルが発生する素子を取得
+inline Grid2D<GraphSEO>::ElementRef Grid2D<GraphSEO>::getTunnelPlace() const
+{
+    if (tunnelindex < 0)
+    {
+        throw std::logic_error("No tunnel has been selected");
+    }
+    return ElementRef(const_cast<Grid2D *>(this), tunnelindex);
+}
+
+// 最小wtでトンネルが発生する素子の添字を取得
+inline int Grid2D<GraphSEO>::getTunnelIndex() const
+{
+    return tunnelindex;
+}
+
+// 添字で指定した素子をトンネルさせる
+inline void Grid2D<GraphSEO>::applyTunnel(int index, TunnelDirection direction)
+{
+    if (index < 0 || index >= n_)
+    {
+        throw std::out_of_range("Tunnel index out of range");
+    }
+    Qn[index] += (direction == TunnelDirection::Up) ? -e : e;
+}
+
+// トンネルの方向を取得
+inline TunnelDirection Grid2D<GraphSEO>::getTunnelDirection() const
+{
+    return tunneldirection;
+}
+
+// 最小トンネル待ち時間wtを取得
+inline double Grid2D<GraphSEO>::getMinWT() const
+{
+    return minwt;
+}
+
+// outputlabelの設定
+inline void Grid2D<GraphSEO>::setOutputLabel(const std::string &label)
+{
+    outputlabel = label;
+}
+
+// outputlabelの取得
+inline std::string Grid2D<GraphSEO>::getOutputLabel() const
+{
+    return outputlabel;
+}
+
+// outputlabelが設定されているかの取得
+inline bool Grid2D<GraphSEO>::hasOutputLabel() const
+{
+    return !outputlabel.empty();
+}
+
+// outputEnabledにbool値を設定
+inline void Grid2D<GraphSEO>::setOutputEnabled(bool flag)
+{
+    outputEnabled = flag;
+}
+
+// OutputEnabledを取得
+inline bool Grid2D<GraphSEO>::isOutputEnabled() const
+{
+    return outputEnabled;
+}
+
+#endif // SEO_GRAPH_HPP
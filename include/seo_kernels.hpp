@@ -0,0 +1,152 @@
+#ifndef SEO_KERNELS_HPP
+#define SEO_KERNELS_HPP
+
+#include <cstdint>
+
+// SEOの式(setPcalc, setdEcalc, calculateTunnelWt)を、
+// 連続した素子の範囲[first, last)にまとめて適用するカーネル
+//
+// 配列は全てGrid2D<FlatSEO>と同じ並び(row*cols+col)で、dE・wtは(up, down)の組が並んだもの。
+// どの実装も式の計算順は同じにしてあるので(SIMD版はFMAへの縮約も禁止している)、結果はビット単位で一致する。
+
+// exponentialDrawの -log(u) の計算に使う定数(fdlibmのlogと同じ分解・係数)
+// u = 2^k * m (sqrt(2)/2 <= m < sqrt(2))、f = m - 1、s = f/(2 + f) として
+// log(u) = k*ln2 + f - s*(f - R(s))(Rはs^2の多項式)。どの実装もこの順に計算する
+namespace seo_log
+{
+    constexpr double Lg1 = 6.666666666666735130e-01;
+    constexpr double Lg2 = 3.999999999940941908e-01;
+    constexpr double Lg3 = 2.857142874366239149e-01;
+    constexpr double Lg4 = 2.222219843214978396e-01;
+    constexpr double Lg5 = 1.818357216161805012e-01;
+    constexpr double Lg6 = 1.531383769920937332e-01;
+    constexpr double Lg7 = 1.479819860511658591e-01;
+    constexpr double ln2Hi = 6.93147180369123816490e-01;
+    constexpr double ln2Lo = 1.90821492927058770002e-10;
+    // 仮数部(52bit)がこれより大きければ m = 仮数/2 にしてkを1増やす(sqrt(2)の仮数部)
+    constexpr std::uint64_t sqrt2Mantissa = 0x6a09e667f3bcdULL;
+}
+
+// パラメータクラスごとの係数(素子のクラス番号で引く。Grid2D<FlatSEO>のパラメータクラスモード用)
+// 割り算はクラスを作るときに済ませておく
+struct SEOClassCoefficients
+{
+    const double *C;              // 接続容量
+    const double *invCtot;        // 1/(legs*C + Cj)
+    const double *eOverCtot;      // e/(legs*C + Cj)
+    const double *halfE2OverCtot; // e*e/(2*(legs*C + Cj))
+    const double *e2Rj;           // e*e*Rj
+};
+
+// 使う命令セット
+enum class SimdLevel
+{
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+// 最小トンネル待ち時間の探索結果
+struct WaitTimeMin
+{
+    double wt;  // 最小の待ち時間(対象が無ければ+inf)
+    int index;  // その素子(同じ値なら添字の小さい方、対象が無ければ-1)
+};
+
+struct SEOKernelTable
+{
+    SimdLevel level;
+
+    // Vn = Q/Cj + (C/(Cj*(legs*C + Cj))) * (Cj*V_sum - legs*Q)
+    void (*nodeVoltage)(const double *Qn, const double *Vsum, const double *C, const double *Cj, const int *legs,
+                        double *Vn, int first, int last);
+
+    // dE(up)   = -e*(e - 2*(Q + C*V_sum)) / (2*(legs*C + Cj))
+    // dE(down) = -e*(e + 2*(Q + C*V_sum)) / (2*(legs*C + Cj))
+    void (*energyChange)(const double *Qn, const double *Vsum, const double *C, const double *Cj, const int *legs,
+                         double *dE, int first, int last);
+
+    // dEが正の向きについて wt = (e*e*Rj/dE) * expo を書き込み(他は0)、最小のwtを返す
+    // expoは素子ごとの指数分布の乱数 -log(u)(dEが正でない素子の値は使わない)
+    WaitTimeMin (*waitTimeArgmin)(const double *dE, const double *Rj, const double *expo, double *wt, int first,
+                                  int last);
+
+    //---- パラメータクラスモード用(clsは素子ごとのクラス番号) ----//
+    // Vn = (Q + C*V_sum) * invCtot
+    void (*nodeVoltageClass)(const double *Qn, const double *Vsum, const std::uint16_t *cls,
+                             const SEOClassCoefficients &k, double *Vn, int first, int last);
+
+    // s = Q + C*V_sum として
+    // dE(up)   =   s*eOverCtot  - halfE2OverCtot
+    // dE(down) = -(s*eOverCtot) - halfE2OverCtot
+    void (*energyChangeClass)(const double *Qn, const double *Vsum, const std::uint16_t *cls,
+                              const SEOClassCoefficients &k, double *dE, int first, int last);
+
+    // waitTimeArgminと同じ。e*e*Rjはクラスの係数を使う(値はwaitTimeArgminと同じになる)
+    WaitTimeMin (*waitTimeArgminClass)(const double *dE, const std::uint16_t *cls, const SEOClassCoefficients &k,
+                                       const double *expo, double *wt, int first, int last);
+
+    //---- 乱数 ----//
+    // dEが正の向きがある素子iだけ、乱数列(seed, streamBase + i)のcounter[i]番目の一様乱数uから
+    // expo[i] = -log(u) (平均1の指数分布)を書き込み、counter[i]を1進める(他の素子は変えない)
+    // 一様乱数はphiloxUniformと同じ値で、結果はexponentialVariateと一致する
+    void (*exponentialDraw)(const double *dE, std::uint64_t seed, std::uint64_t streamBase, std::uint64_t *counter,
+                            double *expo, int first, int last);
+
+    //---- 単精度(Grid2D<SingleSEO>)用。式の順は倍精度版と同じで、全てfloatで計算する ----//
+    // (SIMD版はdoubleの倍の素子数を1命令で計算する。どの実装でも結果はビット単位で同じ)
+    void (*nodeVoltageFloat)(const float *Qn, const float *Vsum, const float *C, const float *Cj, const int *legs,
+                             float *Vn, int first, int last);
+    void (*energyChangeFloat)(const float *Qn, const float *Vsum, const float *C, const float *Cj, const int *legs,
+                              float *dE, int first, int last);
+    // e*eはfloatに丸めてから掛ける。wtはfloatで計算し、最小値はdoubleで返す
+    WaitTimeMin (*waitTimeArgminFloat)(const float *dE, const float *Rj, const float *expo, float *wt, int first,
+                                       int last);
+    // exponentialDrawと同じ乱数をdoubleで作り、floatに丸めて書き込む
+    void (*exponentialDrawFloat)(const float *dE, std::uint64_t seed, std::uint64_t streamBase,
+                                 std::uint64_t *counter, float *expo, int first, int last);
+
+    //---- レプリカの並び(EnsembleSimulation2D)用 ----//
+    // 素子ごとのパラメータ(C, Cj, legs, R)は全レプリカで共通、状態は素子iのレプリカrを[i*K + r]に置いた配列。
+    // 素子のループの内側でK個のレプリカをSIMDのレーンにする(端数のレプリカはマスクして計算する)
+    // neighboursは素子ごとにmaxLegs個の隣接素子(無ければ-1)で、Vsumは前から順に足した和 + Vext
+    // Vn(next) = Q/Cj + (C/(Cj*(legs*C + Cj)))*(Cj*Vsum - legs*Q)
+    // residual[r] = max(residual[r], |Vn(next) - Vn|)
+    void (*laneNodeVoltage)(const int *neighbours, int maxLegs, const double *C, const double *Cj, const int *legs,
+                            const double *Qn, const double *Vn, const double *Vext, double *Vsum, double *VnNext,
+                            double *residual, int K, int first, int last);
+
+    // dE(up)   = -e*(e - 2*(Q + C*Vsum)) / (2*(legs*C + Cj))
+    // dE(down) = -e*(e + 2*(Q + C*Vsum)) / (2*(legs*C + Cj))
+    void (*laneEnergyChange)(const double *C, const double *Cj, const int *legs, const double *Qn,
+                             const double *Vsum, double *dEUp, double *dEDown, int K, int first, int last);
+
+    // Euler法の充電 Q += (Vd - Vn)*h[r]/R (hはレプリカごとの進める時間)
+    void (*laneChargeEuler)(const double *R, const double *Vd, const double *Vn, const double *h, double *Qn, int K,
+                            int first, int last);
+};
+
+// 乱数列(seed, stream)のcounter番目の一様乱数uから作る -log(u)(exponentialDrawの1素子版)
+double exponentialVariate(std::uint64_t seed, std::uint64_t stream, std::uint64_t counter);
+
+// 実行中のCPUで使える最も広い命令セット
+SimdLevel detectSimdLevel();
+
+// 命令セットが使えるか(コンパイル時に含まれていて、CPUも対応している)
+bool isSimdLevelSupported(SimdLevel level);
+
+// 指定した命令セットのカーネル(使えなければ例外)
+const SEOKernelTable &seoKernels(SimdLevel level);
+
+// 実行中のCPUに合わせて選んだカーネル(初回に一度だけ選ぶ)
+const SEOKernelTable &seoKernels();
+
+// 命令セットの名前("scalar", "avx2", "avx512")
+const char *simdLevelName(SimdLevel level);
+
+// 各命令セットの実装(コンパイルされていなければnullptrを返す)
+const SEOKernelTable *seoKernelsScalar();
+const SEOKernelTable *seoKernelsAVX2();
+const SEOKernelTable *seoKernelsAVX512();
+
+#endif // SEO_KERNELS_HPP
@@ -3,42 +3,115 @@
 
 #include <fstream>
 #include <vector>
+#include <deque>
+#include <type_traits>
 #include <memory>
 #include <utility>
 #include <map>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
 #include "seo_class.hpp"
 #include "grid_2dim.hpp"
+#include "relaxation.hpp"
+#include "thread_pool.hpp"
+#include "philox.hpp"
+#include "charge_integration.hpp"
 // #include "output_class.hpp"
 
-template <typename Element>
+// 格子の型が使える緩和方法を教えるか(Grid2D<BasicFlatSEO<...>>::supportsRelaxation)
+template <typename Grid, typename = void>
+struct HasRelaxationSupport : std::false_type
+{
+};
+template <typename Grid>
+struct HasRelaxationSupport<
+    Grid, std::void_t<decltype(Grid::supportsRelaxation(std::declval<const RelaxationConfig &>()))>> : std::true_type
+{
+};
+
+// トンネルイベントの記録（どのgridのどの素子が、どの向きに、どれだけ待ってトンネルするか）
+struct TunnelEvent
+{
+    int gridIndex = -1;                                // grids内の番号
+    int cellIndex = -1;                                // grid内の添字(row*cols+col)
+    TunnelDirection direction = TunnelDirection::Up;   // トンネルの向き
+    double wt = 0.0;                                   // トンネル待ち時間
+};
+
+// OutputValueはoutputsのフレームの値の型(floatにするとフレームのメモリが半分になる)
+template <typename Element, typename OutputValue = double>
 class Simulation2D
 {
-private:
+protected:
     double t;                           // 現在の時間（不定期に増える）
     double dt;                          // 基本刻み（参考値）
     double endtime;                     // 終了時刻
     double outputInterval;              // 出力間隔（例: 0.1）
     double nextOutputTime;              // 次に出力すべき時刻（0.1, 0.2, ...）
-    std::vector<Grid2D<Element>> grids; // Grid2Dのインスタンス配列
+    // Grid2Dのインスタンス配列(dequeなので、appendGridで足しても登録済みのgridの参照は無効にならない)
+    std::deque<Grid2D<Element>> grids;
     // oyl-video形式のデータ
     std::map<
         std::string,                                  // ラベル名
-        std::vector<std::vector<std::vector<double>>> // [timeframe][y][x]
+        std::vector<std::vector<std::vector<OutputValue>>> // [timeframe][y][x]
         >
         outputs;
-    // トリガを表すベクトル（どのgridか、時刻、位置、値)
-    std::vector<std::tuple<Grid2D<Element>*,double, int, int, double>> voltageTriggers; // (grid, time, x, y, V)
+    // トリガを表すベクトル（どのgridか(gridsでの番号)、時刻、位置、値)
+    // 番号で持ち、適用するときにgridsから引く(addGridで入れ替えても番号の意味は変わらない)
+    std::vector<std::tuple<int, double, int, int, double>> voltageTriggers; // (grid, time, x, y, V)
+    // Vnの緩和の設定（デフォルトはJacobi法5回）
+    RelaxationConfig relaxation;
+    // 直前のステップでのgridごとの緩和結果
+    std::vector<RelaxationStats> relaxationStats;
+    // これまでの緩和の反復回数の合計
+    long long totalRelaxationIterations;
+    // gridの処理に使うスレッドプール(スレッド数が1ならnull)
+    std::shared_ptr<ThreadPool> threadPool;
+    // 電荷の時間発展の計算方法(デフォルトは従来通りEuler法)
+    ChargeIntegrator chargeIntegrator;
+    // ExponentialJumpで1回に跳ぶ間に許すV_sumのずれ[V]
+    double jumpTolerance;
+    // これまでのトンネル回数(handleTunnelsで数える)
+    long long tunnelCount;
+    // 実行のシード(setSeedを呼ぶまでは各gridが実行ごとに異なるシードを使う)
+    std::uint64_t seed;
+    bool seeded;
+
+    // g番目のgridにシードから作った乱数列を設定する(setSeed済みの場合のみ)
+    void seedGrid(std::size_t g);
+
+    // grid全体のVn計算(設定に従って緩和する)
+    void relaxGrids();
+
+    // grid全体のdE計算
+    void updateGridsdE();
+
+    // grid全体のチャージの計算
+    void updateGridsQn(double steptime);
+
+    // dEが正の素子が無いときに進める時間(ExponentialJump用)
+    // 次にいずれかの素子のdEが正になる時刻まで進むが、出力・トリガの切り替わり・終了時刻は飛び越さない(最短はdt)
+    // しきい値の予測も充電も周囲の電圧を一定としているので、周囲のV_sumのずれがjumpToleranceを超える前に止め、
+    // 次のステップで緩和し直してから予測し直す
+    double quietStepTime() const;
+
+    // 現在時刻から、次の出力・トリガの切り替わり・終了時刻のうち最も早いものまでの時間
+    double timeToNextBoundary() const;
 
 public:
     // コンストラクタ(刻み時間,シミュレーションの終了タイミング)
     Simulation2D(double dT, double EndTime);
 
-    // wtの比較（gridごと）
-    std::pair<bool, std::shared_ptr<Grid2D<Element>>> comparewt();
+    // 派生したエンジン用
+    virtual ~Simulation2D() = default;
+
+    // wtの比較（gridごと）。トンネルがあればtrueと最小wtのイベントを返す
+    std::pair<bool, TunnelEvent> comparewt();
 
     // トンネルの処理
-    void handleTunnels(Grid2D<Element> &tunnelelement);
+    void handleTunnels(const TunnelEvent &event);
 
     // ファイル作成
     void openFiles() const;
@@ -52,66 +125,129 @@ public:
     // oyl-video形式に合わせた出力を生成
     void outputTooyl();
 
-    // シミュレーションの1ステップ
-    void runStep();
+    // シミュレーションの1ステップ（エンジンごとに上書きできる）
+    virtual void runStep();
 
-    // シミュレーションにgridを追加
-    void addGrid(const std::vector<Grid2D<Element>> &Gridinstance);
+    // シミュレーションにgridを登録（std::moveで渡せばコピーしない）
+    void addGrid(std::vector<Grid2D<Element>> Gridinstance);
+
+    // gridを1つムーブで追加し、登録されたgridの参照を返す
+    // (トリガ等には返された参照を使う。参照はaddGridで登録し直すまで有効)
+    Grid2D<Element> &appendGrid(Grid2D<Element> &&Gridinstance);
 
     // シミュレーションの実行
     void run();
 
     // グリッド取得
-    std::vector<Grid2D<Element>> &getGrids();
+    std::deque<Grid2D<Element>> &getGrids();
+
+    // 現在の時刻を取得
+    double getTime() const;
 
     // outputsを取得
-    const std::map<std::string, std::vector<std::vector<std::vector<double>>>> &getOutputs() const;
+    const std::map<std::string, std::vector<std::vector<std::vector<OutputValue>>>> &getOutputs() const;
+
+    // Vnの緩和方法を設定
+    void setRelaxation(const RelaxationConfig &config);
+
+    // Vnの緩和方法を取得
+    const RelaxationConfig &getRelaxation() const;
+
+    // 電荷の時間発展の計算方法を設定
+    void setChargeIntegrator(ChargeIntegrator integrator);
+
+    // 電荷の時間発展の計算方法を取得
+    ChargeIntegrator getChargeIntegrator() const;
+
+    // ExponentialJumpで1回に跳ぶ間に許すV_sumのずれ[V]を設定(正の値。小さいほど正確で、跳ぶ回数が増える)
+    void setJumpTolerance(double tolerance);
 
-    // トリガーを追加する
-    void addVoltageTrigger(double triggerTime, Grid2D<Element>* grid, int x, int y, double voltage);
+    // ExponentialJumpで1回に跳ぶ間に許すV_sumのずれ[V]を取得
+    double getJumpTolerance() const;
 
-    // トリガを適用させる
+    // 出力間隔を設定(デフォルトはdt。ExponentialJumpは出力時刻を飛び越さないので、間隔を広げるとまとめて進める)
+    void setOutputInterval(double interval);
+
+    // 出力間隔を取得
+    double getOutputInterval() const;
+
+    // 直前のステップでのgridごとの緩和結果を取得
+    const std::vector<RelaxationStats> &getRelaxationStats() const;
+
+    // これまでの緩和の反復回数の合計を取得
+    long long getTotalRelaxationIterations() const;
+
+    // これまでのトンネル回数を取得(エンジンどうしの比較用)
+    long long getTunnelCount() const;
+
+    // gridの処理に使うスレッド数を設定(1なら逐次。登録済み・今後登録するgridの全てに使う)
+    // 同じシードなら、スレッド数によらず逐次と同じ結果になる
+    void setThreadCount(int threads);
+
+    // gridの処理に使うスレッド数を取得
+    int getThreadCount() const;
+
+    // 実行のシードを設定(登録済み・今後登録するgridの全てに使う)
+    // g番目のgridの素子iは(deriveSeed(seed, g), i, 抽選回数)の乱数列から引くので、
+    // 同じシードならスレッド数・並列の分け方によらず同じトンネルの経過になる
+    virtual void setSeed(std::uint64_t runSeed);
+
+    // 実行のシードを取得(未設定なら例外)
+    std::uint64_t getSeed() const;
+
+    // トリガーを追加する(gridはgridsでの番号。まだ追加していないgridの番号でもよい)
+    void addVoltageTrigger(double triggerTime, int grid, int x, int y, double voltage);
+
+    // トリガーを追加する(gridは登録済みのgrid、つまりappendGridの戻り値やgetGrids()の要素)
+    // Grid2D<SEO>はコピーしても素子を共有するので、addGrid({grid})に渡したコピー元でもよい(従来の使い方)。
+    // それ以外の登録されていないgridなら例外
+    void addVoltageTrigger(double triggerTime, const Grid2D<Element>* grid, int x, int y, double voltage);
+
+    // トリガを適用させる（時間内のトリガは外部電圧に設定し、それ以外は0に戻す）
     void applyVoltageTriggers();
 };
 
 // コンストラクタ
-template <typename Element>
-Simulation2D<Element>::Simulation2D(double dT, double EndTime)
-    : t(0.0), dt(dT), endtime(EndTime), outputInterval(dT), nextOutputTime(0.0) {}
+template <typename Element, typename OutputValue>
+Simulation2D<Element, OutputValue>::Simulation2D(double dT, double EndTime)
+    : t(0.0), dt(dT), endtime(EndTime), outputInterval(dT), nextOutputTime(0.0),
+      totalRelaxationIterations(0), chargeIntegrator(ChargeIntegrator::Euler), jumpTolerance(1e-3), tunnelCount(0), seed(0), seeded(false) {}
 
 // 最小wtを探索する
-template <typename Element>
-std::pair<bool, std::shared_ptr<Grid2D<Element>>> Simulation2D<Element>::comparewt()
+template <typename Element, typename OutputValue>
+std::pair<bool, TunnelEvent> Simulation2D<Element, OutputValue>::comparewt()
 {
-    double minwt = dt;
-    std::shared_ptr<Grid2D<Element>> tunnelelement = nullptr;
-    for (auto &grid : grids)
+    TunnelEvent event;
+    event.wt = dt;
+    for (std::size_t g = 0; g < grids.size(); ++g)
     {
+        auto &grid = grids[g];
         if (grid.gridminwt(dt))
         {
             double candidate = grid.getMinWT();
-            if (candidate < minwt)
+            if (candidate < event.wt)
             {
-                minwt = candidate;
-                tunnelelement = std::make_shared<Grid2D<Element>>(grid);
+                event.gridIndex = static_cast<int>(g);
+                event.cellIndex = grid.getTunnelIndex();
+                event.direction = grid.getTunnelDirection();
+                event.wt = candidate;
             }
         }
     }
-    if (minwt < dt)
-        return {true, tunnelelement};
-    return {false, nullptr};
+    return {event.gridIndex >= 0, event};
 }
 
 // トンネル処理を実行
-template <typename Element>
-void Simulation2D<Element>::handleTunnels(Grid2D<Element> &tunnelelement)
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::handleTunnels(const TunnelEvent &event)
 {
-    tunnelelement.getTunnelPlace()->setTunnel(tunnelelement.getTunnelDirection());
+    grids.at(event.gridIndex).applyTunnel(event.cellIndex, event.direction);
+    ++tunnelCount;
 }
 
 // ファイルを開く
-template <typename Element>
-void Simulation2D<Element>::openFiles() const
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::openFiles() const
 {
     // for (auto &outputdata : printdatavector)
     // {
@@ -120,8 +256,8 @@ void Simulation2D<Element>::openFiles() const
 }
 
 // ファイルを閉じる
-template <typename Element>
-void Simulation2D<Element>::closeFiles() const
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::closeFiles() const
 {
     // for (auto &outputdata : printdatavector)
     // {
@@ -130,8 +266,8 @@ void Simulation2D<Element>::closeFiles() const
 }
 
 // 出力処理（未実装部分を仮追加）
-template <typename Element>
-void Simulation2D<Element>::outputToFile()
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::outputToFile()
 {
     // if (accumulatedTime >= outputInterval)
     // {
@@ -142,8 +278,8 @@ void Simulation2D<Element>::outputToFile()
 
 // oyl-video形式に合わせた出力を生成
 // 1 <= x <= max-1, 1 <= y <= max-1の範囲で出力される(sizex=32,sizey=32の場合は1から31までの範囲で30×30になる)
-template <typename Element>
-void Simulation2D<Element>::outputTooyl()
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::outputTooyl()
 {
     if (t >= nextOutputTime)
     {
@@ -169,8 +305,11 @@ void Simulation2D<Element>::outputTooyl()
 
             int rows = grid.numRows();
             int cols = grid.numCols();
+            // 端を除くと何も残らない並び(1行のSEOGraphなど)は出力しない
+            if (rows < 2 || cols < 2)
+                continue;
 
-            std::vector<std::vector<double>> vnGrid(rows - 2, std::vector<double>(cols - 2));
+            std::vector<std::vector<OutputValue>> vnGrid(rows - 2, std::vector<OutputValue>(cols - 2));
             for (int i = 1; i < rows - 1; ++i)
             {
                 for (int j = 1; j < cols - 1; ++j)
@@ -184,7 +323,7 @@ void Simulation2D<Element>::outputTooyl()
                         vn *= -1.0;
                     }
             
-                    vnGrid[i - 1][j - 1] = vn;
+                    vnGrid[i - 1][j - 1] = static_cast<OutputValue>(vn);
                 }
             }            
 
@@ -195,48 +334,113 @@ void Simulation2D<Element>::outputTooyl()
     }
 }
 
-// シミュレーションの1ステップを実行
-template <typename Element>
-void Simulation2D<Element>::runStep()
+// grid全体のVn計算(設定に従って緩和する)
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::relaxGrids()
 {
-    double steptime = dt;
+    // トリガの適用（外部電圧としてV_sumに足される）
+    applyVoltageTriggers();
+    relaxationStats.resize(grids.size());
+    for (std::size_t g = 0; g < grids.size(); ++g)
+    {
+        relaxationStats[g] = grids[g].relax(relaxation);
+        totalRelaxationIterations += relaxationStats[g].iterations;
+    }
+}
 
-    // oyl-video形式に出力
-    outputTooyl();
+// grid全体のdE計算
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::updateGridsdE()
+{
+    for (auto &grid : grids)
+    {
+        grid.updateGriddE();
+    }
+}
 
-    // grid全体のVn計算(5回計算してならす)
-    for (int i = 0; i < 5; i++)
+// grid全体のチャージの計算
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::updateGridsQn(double steptime)
+{
+    for (auto &grid : grids)
     {
-        for (auto &grid : grids)
+        if (chargeIntegrator == ChargeIntegrator::Euler)
+            grid.updateGridQn(steptime);
+        else
+            grid.updateGridQnExponential(steptime);
+    }
+}
+
+// dEが正の素子が無いときに進める時間
+template <typename Element, typename OutputValue>
+double Simulation2D<Element, OutputValue>::quietStepTime() const
+{
+    double next = std::numeric_limits<double>::infinity();
+    for (const auto &grid : grids)
+    {
+        next = std::min(next, grid.nextThresholdTime());
+    }
+    if (next > dt)
+    {
+        for (const auto &grid : grids)
         {
-            // 接続されている電圧を更新
-            grid.updateGridSurVn();
-            // トリガの適用
-            applyVoltageTriggers();
-            // 電圧を更新
-            grid.updateGridVn();
+            next = std::min(next, grid.vsumDriftTime(jumpTolerance));
         }
     }
+    if (!(next > dt))
+        return dt;
+    return std::max(dt, std::min(next, timeToNextBoundary()));
+}
 
-    // grid全体のdE計算
-    for (auto &grid : grids)
+// 次の出力・トリガの切り替わり・終了時刻までの時間
+template <typename Element, typename OutputValue>
+double Simulation2D<Element, OutputValue>::timeToNextBoundary() const
+{
+    double limit = endtime - t;
+    if (std::any_of(grids.begin(), grids.end(), [](const Grid2D<Element> &grid) { return grid.isOutputEnabled(); }))
+        limit = std::min(limit, nextOutputTime - t);
+    // トリガは[時刻, 時刻+dt)の間だけ加わるので、始まりと終わりで止まる
+    for (const auto &trigger : voltageTriggers)
     {
-        grid.updateGriddE();
+        for (double boundary : {std::get<1>(trigger), std::get<1>(trigger) + dt})
+        {
+            if (boundary > t)
+                limit = std::min(limit, boundary - t);
+        }
     }
+    return limit;
+}
+
+// シミュレーションの1ステップを実行
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::runStep()
+{
+    double steptime = dt;
+
+    // oyl-video形式に出力
+    outputTooyl();
+
+    // grid全体のVn計算
+    relaxGrids();
+
+    // grid全体のdE計算
+    updateGridsdE();
 
     // wtの計算と比較
     auto compared = this->comparewt();
     if (compared.first)
     {
-        handleTunnels(*compared.second);
-        steptime = compared.second->getMinWT();
+        handleTunnels(compared.second);
+        steptime = compared.second.wt;
     }
-
-    // チャージの計算
-    for (auto &grid : grids)
+    else if (chargeIntegrator == ChargeIntegrator::ExponentialJump)
     {
-        grid.updateGridQn(steptime);
+        // トンネルしうる素子が無い間はまとめて進める
+        steptime = quietStepTime();
     }
+
+    // チャージの計算
+    updateGridsQn(steptime);
     // if ((t >= 147.9 && t < 151.2)) {
     //     auto& grid = grids[0];
     //     std::cout << "[t=" << t << "] Vn(1,1) = " << grid.getElement(1,1)->getVn() << std::endl;
@@ -247,15 +451,33 @@ void Simulation2D<Element>::runStep()
 }
 
 // Gridインスタンスの配列を登録
-template <typename Element>
-void Simulation2D<Element>::addGrid(const std::vector<Grid2D<Element>> &Gridinstance)
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::addGrid(std::vector<Grid2D<Element>> Gridinstance)
+{
+    grids.assign(std::make_move_iterator(Gridinstance.begin()), std::make_move_iterator(Gridinstance.end()));
+    if (threadPool)
+    {
+        for (auto &grid : grids)
+            grid.setThreadPool(threadPool);
+    }
+    for (std::size_t g = 0; g < grids.size(); ++g)
+        seedGrid(g);
+}
+
+// Gridインスタンスを1つムーブで追加
+template <typename Element, typename OutputValue>
+Grid2D<Element> &Simulation2D<Element, OutputValue>::appendGrid(Grid2D<Element> &&Gridinstance)
 {
-    grids = Gridinstance;
+    grids.push_back(std::move(Gridinstance));
+    if (threadPool)
+        grids.back().setThreadPool(threadPool);
+    seedGrid(grids.size() - 1);
+    return grids.back();
 }
 
 // 全体シミュレーションの実行
-template <typename Element>
-void Simulation2D<Element>::run()
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::run()
 {
     // openFiles();
     while (t < endtime)
@@ -266,31 +488,220 @@ void Simulation2D<Element>::run()
 }
 
 // グリッド取得
-template <typename Element>
-std::vector<Grid2D<Element>> &Simulation2D<Element>::getGrids()
+template <typename Element, typename OutputValue>
+std::deque<Grid2D<Element>> &Simulation2D<Element, OutputValue>::getGrids()
 {
     return grids;
 }
 
-template <typename Element>
-const std::map<std::string, std::vector<std::vector<std::vector<double>>>> &Simulation2D<Element>::getOutputs() const
+// Vnの緩和方法を設定
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::setRelaxation(const RelaxationConfig &config)
+{
+    validateRelaxationConfig(config);
+    // 格子の型で使えない緩和方法は、実行を始める前にここで例外にする
+    if constexpr (HasRelaxationSupport<Grid2D<Element>>::value)
+    {
+        if (!Grid2D<Element>::supportsRelaxation(config))
+        {
+            throw std::invalid_argument("Relaxation method is not supported by this grid type");
+        }
+    }
+    relaxation = config;
+}
+
+// Vnの緩和方法を取得
+template <typename Element, typename OutputValue>
+const RelaxationConfig &Simulation2D<Element, OutputValue>::getRelaxation() const
+{
+    return relaxation;
+}
+
+// 電荷の時間発展の計算方法を設定
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::setChargeIntegrator(ChargeIntegrator integrator)
+{
+    chargeIntegrator = integrator;
+}
+
+// 電荷の時間発展の計算方法を取得
+template <typename Element, typename OutputValue>
+ChargeIntegrator Simulation2D<Element, OutputValue>::getChargeIntegrator() const
+{
+    return chargeIntegrator;
+}
+
+// ExponentialJumpで1回に跳ぶ間に許すV_sumのずれを設定
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::setJumpTolerance(double tolerance)
+{
+    if (!(tolerance > 0))
+    {
+        throw std::invalid_argument("Jump tolerance must be positive");
+    }
+    jumpTolerance = tolerance;
+}
+
+// ExponentialJumpで1回に跳ぶ間に許すV_sumのずれを取得
+template <typename Element, typename OutputValue>
+double Simulation2D<Element, OutputValue>::getJumpTolerance() const
+{
+    return jumpTolerance;
+}
+
+// 出力間隔を設定(次の出力は現在時刻以降で最初の間隔の倍数の時刻)
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::setOutputInterval(double interval)
+{
+    if (!(interval > 0))
+    {
+        throw std::invalid_argument("Output interval must be positive");
+    }
+    outputInterval = interval;
+    nextOutputTime = std::ceil(t / interval) * interval;
+}
+
+// 出力間隔を取得
+template <typename Element, typename OutputValue>
+double Simulation2D<Element, OutputValue>::getOutputInterval() const
+{
+    return outputInterval;
+}
+
+// 直前のステップでのgridごとの緩和結果を取得
+template <typename Element, typename OutputValue>
+const std::vector<RelaxationStats> &Simulation2D<Element, OutputValue>::getRelaxationStats() const
+{
+    return relaxationStats;
+}
+
+// これまでの緩和の反復回数の合計を取得
+template <typename Element, typename OutputValue>
+long long Simulation2D<Element, OutputValue>::getTotalRelaxationIterations() const
+{
+    return totalRelaxationIterations;
+}
+
+// これまでのトンネル回数を取得
+template <typename Element, typename OutputValue>
+long long Simulation2D<Element, OutputValue>::getTunnelCount() const
+{
+    return tunnelCount;
+}
+
+// gridの処理に使うスレッド数を設定
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::setThreadCount(int threads)
+{
+    if (threads < 1)
+    {
+        throw std::invalid_argument("Thread count must be at least 1");
+    }
+    threadPool = (threads > 1) ? std::make_shared<ThreadPool>(threads) : nullptr;
+    for (auto &grid : grids)
+    {
+        grid.setThreadPool(threadPool);
+    }
+}
+
+// gridの処理に使うスレッド数を取得
+template <typename Element, typename OutputValue>
+int Simulation2D<Element, OutputValue>::getThreadCount() const
+{
+    return threadPool ? threadPool->size() : 1;
+}
+
+// g番目のgridにシードから作った乱数列を設定する
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::seedGrid(std::size_t g)
+{
+    if (seeded)
+        grids[g].seedRandom(deriveSeed(seed, g));
+}
+
+// 実行のシードを設定
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::setSeed(std::uint64_t runSeed)
+{
+    seed = runSeed;
+    seeded = true;
+    for (std::size_t g = 0; g < grids.size(); ++g)
+        seedGrid(g);
+}
+
+// 実行のシードを取得
+template <typename Element, typename OutputValue>
+std::uint64_t Simulation2D<Element, OutputValue>::getSeed() const
+{
+    if (!seeded)
+    {
+        throw std::logic_error("Seed has not been set");
+    }
+    return seed;
+}
+
+// 現在の時刻を取得
+template <typename Element, typename OutputValue>
+double Simulation2D<Element, OutputValue>::getTime() const
+{
+    return t;
+}
+
+template <typename Element, typename OutputValue>
+const std::map<std::string, std::vector<std::vector<std::vector<OutputValue>>>> &
+Simulation2D<Element, OutputValue>::getOutputs() const
 {
     return outputs;
 }
 
-template <typename Element>
-void Simulation2D<Element>::addVoltageTrigger(double triggerTime, Grid2D<Element>* grid, int x, int y, double voltage) {
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::addVoltageTrigger(double triggerTime, int grid, int x, int y, double voltage) {
+    if (grid < 0) {
+        throw std::invalid_argument("Trigger grid index must be non-negative.");
+    }
     voltageTriggers.emplace_back(grid, triggerTime, x, y, voltage);  //.empalce_backでVoltage_triggersに新たに追加
 }
 
-template <typename Element>
-void Simulation2D<Element>::applyVoltageTriggers()
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::addVoltageTrigger(double triggerTime, const Grid2D<Element>* grid, int x, int y, double voltage) {
+    if (!grid) {
+        throw std::invalid_argument("Trigger references a null grid pointer.");
+    }
+    for (std::size_t g = 0; g < grids.size(); ++g) {
+        if (&grids[g] == grid) {
+            addVoltageTrigger(triggerTime, static_cast<int>(g), x, y, voltage);
+            return;
+        }
+    }
+    // Grid2D<SEO>のコピーは素子(shared_ptr)を共有するので、素子が同じ登録済みのgridに付ける
+    if constexpr (std::is_same<decltype(grid->getElement(0, 0)), std::shared_ptr<Element>>::value) {
+        for (std::size_t g = 0; g < grids.size(); ++g) {
+            if (grids[g].numRows() == grid->numRows() && grids[g].numCols() == grid->numCols() &&
+                grids[g].getElement(0, 0) == grid->getElement(0, 0)) {
+                addVoltageTrigger(triggerTime, static_cast<int>(g), x, y, voltage);
+                return;
+            }
+        }
+    }
+    throw std::invalid_argument("Trigger references a grid that is not part of this simulation "
+                                "(use the reference returned by appendGrid or the grid index).");
+}
+
+template <typename Element, typename OutputValue>
+void Simulation2D<Element, OutputValue>::applyVoltageTriggers()
 {
-    for (const auto& [gridPtr, triggerTime, x, y, voltage] : voltageTriggers) {
+    // 同じ素子に複数のトリガがあっても足し合わせられるように、先に全て0に戻す
+    for (const auto& [g, triggerTime, x, y, voltage] : voltageTriggers) {
+        if (g < static_cast<int>(grids.size()) && x >= 0 && x < grids[g].numCols() && y >= 0 && y < grids[g].numRows()) {
+            grids[g].getElement(y, x)->setExternalVoltage(0.0);
+        }
+    }
+    for (const auto& [g, triggerTime, x, y, voltage] : voltageTriggers) {
         if (t >= triggerTime && t < triggerTime + dt) {
-            if (!gridPtr) {
-                throw std::invalid_argument("Trigger references a null grid pointer.");
+            if (g >= static_cast<int>(grids.size())) {
+                throw std::invalid_argument("Trigger references a grid that is not part of this simulation.");
             }
+            Grid2D<Element> *gridPtr = &grids[g];
 
             if (x < 0 || x >= gridPtr->numCols() || y < 0 || y >= gridPtr->numRows()) {
                 throw std::out_of_range(
@@ -301,7 +712,7 @@ void Simulation2D<Element>::applyVoltageTriggers()
             }
 
             auto elem = gridPtr->getElement(y, x);
-            elem->setVsum(elem->getSurroundingVsum() + voltage);
+            elem->setExternalVoltage(elem->getExternalVoltage() + voltage);
         }
     }
 }
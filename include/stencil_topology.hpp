@@ -0,0 +1,38 @@
+#ifndef STENCIL_TOPOLOGY_HPP
+#define STENCIL_TOPOLOGY_HPP
+
+#include <array>
+
+// 隣接素子の位置(行・列の差)
+struct NeighbourOffset
+{
+    int dr, dc;
+};
+
+// 格子の接続の形（コンパイル時に決まる）
+// legsは隣接素子の数、offsetsは隣接素子の位置(V_sumはこの順に足す)
+//
+// 上・右・下・左の4近傍（main.cppの配線と同じ順）
+struct VonNeumann4
+{
+    static constexpr int legs = 4;
+    static constexpr std::array<NeighbourOffset, 4> offsets{{{-1, 0}, {0, 1}, {1, 0}, {0, -1}}};
+};
+
+// 斜めを含む8近傍（上から時計回り）
+struct Moore8
+{
+    static constexpr int legs = 8;
+    static constexpr std::array<NeighbourOffset, 8> offsets{
+        {{-1, 0}, {-1, 1}, {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}}};
+};
+
+// 六角格子の6近傍
+// 軸座標(row, col)をそのまま配列に並べるので、格子全体は平行四辺形になる
+struct Hex6
+{
+    static constexpr int legs = 6;
+    static constexpr std::array<NeighbourOffset, 6> offsets{{{-1, 0}, {-1, 1}, {0, 1}, {1, 0}, {1, -1}, {0, -1}}};
+};
+
+#endif // STENCIL_TOPOLOGY_HPP
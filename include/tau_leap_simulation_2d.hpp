@@ -0,0 +1,234 @@
+#ifndef TAU_LEAP_SIMULATION_2D_HPP
+#define TAU_LEAP_SIMULATION_2D_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "simulation_2d.hpp"
+#include "philox.hpp"
+
+// tau-leaping法による近似シミュレーション
+// 1ステップ(リープ)の間はレートを一定とし、全素子がそれぞれの確率 1 - exp(-rate*tau) でトンネルする
+// (1素子は1リープで高々1回。トンネルすると電荷がeずれてdEが負になるため)
+// リープの長さは、最もレートの大きい素子のトンネル確率がおよそtoleranceになるよう tau = tolerance / 最大レート とする(最長dt)
+// 厳密なエンジンは全体で1ステップ1回しかトンネルしないので、同時に活動する素子が多い大きな格子ほど速くなる。
+// イベントの順番は厳密ではないので、スループット重視の探索用
+template <typename Element>
+class TauLeapSimulation2D : public Simulation2D<Element>
+{
+private:
+    // リープの誤差の目安(最速の素子が1リープでトンネルする確率)
+    double tolerance;
+    // トンネル判定の乱数列のシード(gridgの素子iは(leapSeed, (g<<32)|i, リープ番号)から引く)
+    std::uint64_t leapSeed;
+    // gridごとの素子のレート(up + down。dEが正になるのは高々片方)
+    std::vector<std::vector<double>> rates;
+    // リープの統計
+    long long leapCount;        // トンネルしうる素子があったリープの回数
+    long long leapTunnelMax;    // 1リープでのトンネル回数の最大
+    double leapTime;            // リープで進めた時間の合計
+
+    // 全gridのレートを計算し、最大レートを返す
+    double updateRates();
+
+    // gridgでこのリープ中に起きるトンネルを素子の添字順に返す
+    std::vector<TunnelEvent> drawTunnels(std::size_t g, double tau) const;
+
+public:
+    // コンストラクタ(刻み時間,シミュレーションの終了タイミング,誤差の目安)
+    TauLeapSimulation2D(double dT, double EndTime, double Tolerance = 0.2);
+
+    // シミュレーションの1ステップ(1リープ)
+    void runStep() override;
+
+    // 実行のシードを設定(gridの乱数列に加えてトンネル判定の乱数列も決まる)
+    void setSeed(std::uint64_t runSeed) override;
+
+    // 誤差の目安を設定(0より大きく1未満)
+    void setTolerance(double tol);
+
+    // 誤差の目安を取得
+    double getTolerance() const;
+
+    // トンネルしうる素子があったリープの回数を取得
+    long long getLeapCount() const;
+
+    // 1リープでのトンネル回数の最大を取得
+    long long getMaxTunnelsPerLeap() const;
+
+    // リープ1回あたりの平均トンネル回数を取得
+    double getMeanTunnelsPerLeap() const;
+
+    // リープ1回の平均の長さを取得
+    double getMeanLeapTime() const;
+};
+
+// コンストラクタ
+template <typename Element>
+TauLeapSimulation2D<Element>::TauLeapSimulation2D(double dT, double EndTime, double Tolerance)
+    : Simulation2D<Element>(dT, EndTime), tolerance(0.0), leapSeed(nondeterministicSeed()),
+      leapCount(0), leapTunnelMax(0), leapTime(0.0)
+{
+    setTolerance(Tolerance);
+}
+
+// 全gridのレートを計算し、最大レートを返す
+template <typename Element>
+double TauLeapSimulation2D<Element>::updateRates()
+{
+    rates.resize(this->grids.size());
+    double maxRate = 0.0;
+    for (std::size_t g = 0; g < this->grids.size(); ++g)
+    {
+        const auto &grid = this->grids[g];
+        auto &rate = rates[g];
+        rate.resize(grid.numCells());
+        // 最大値は足す順によらないので、区間ごとの最大をまとめるだけでよい
+        std::vector<double> chunkMax(numChunks(this->threadPool.get()), 0.0);
+        parallelChunks(this->threadPool.get(), 0, grid.numCells(), [&](int chunk, int first, int last) {
+            for (int i = first; i < last; ++i)
+            {
+                rate[i] = grid.tunnelRate(i, TunnelDirection::Up) + grid.tunnelRate(i, TunnelDirection::Down);
+                chunkMax[chunk] = std::max(chunkMax[chunk], rate[i]);
+            }
+        });
+        maxRate = std::max(maxRate, *std::max_element(chunkMax.begin(), chunkMax.end()));
+    }
+    return maxRate;
+}
+
+// gridgでこのリープ中に起きるトンネル(素子の添字順)
+template <typename Element>
+std::vector<TunnelEvent> TauLeapSimulation2D<Element>::drawTunnels(std::size_t g, double tau) const
+{
+    const auto &grid = this->grids[g];
+    const auto &rate = rates[g];
+    const int n = static_cast<int>(rate.size());
+    std::vector<std::vector<TunnelEvent>> chunkEvents(numChunks(this->threadPool.get()));
+    parallelChunks(this->threadPool.get(), 0, n, [&](int chunk, int first, int last) {
+        for (int i = first; i < last; ++i)
+        {
+            if (rate[i] <= 0)
+                continue;
+            // u > exp(-rate*tau) となる確率は 1 - exp(-rate*tau)
+            const std::uint64_t stream = (static_cast<std::uint64_t>(g) << 32) | static_cast<std::uint32_t>(i);
+            if (philoxUniform(leapSeed, stream, leapCount) > std::exp(-rate[i] * tau))
+            {
+                TunnelEvent event;
+                event.gridIndex = static_cast<int>(g);
+                event.cellIndex = i;
+                event.direction = (grid.tunnelRate(i, TunnelDirection::Up) > 0) ? TunnelDirection::Up : TunnelDirection::Down;
+                event.wt = tau;
+                chunkEvents[chunk].push_back(event);
+            }
+        }
+    });
+    std::vector<TunnelEvent> events;
+    for (const auto &part : chunkEvents)
+        events.insert(events.end(), part.begin(), part.end());
+    return events;
+}
+
+// シミュレーションの1ステップ(1リープ)を実行
+template <typename Element>
+void TauLeapSimulation2D<Element>::runStep()
+{
+    double steptime = this->dt;
+
+    // oyl-video形式に出力
+    this->outputTooyl();
+
+    // grid全体のVn, dE計算
+    this->relaxGrids();
+    this->updateGridsdE();
+
+    const double maxRate = updateRates();
+    if (maxRate > 0)
+    {
+        steptime = std::min(this->dt, tolerance / maxRate);
+        // 全gridの判定を済ませてからトンネルさせる(リープ内のレートは一定)
+        std::vector<std::vector<TunnelEvent>> events(this->grids.size());
+        for (std::size_t g = 0; g < this->grids.size(); ++g)
+            events[g] = drawTunnels(g, steptime);
+        long long tunnels = 0;
+        for (const auto &gridEvents : events)
+        {
+            for (const auto &event : gridEvents)
+                this->handleTunnels(event);
+            tunnels += static_cast<long long>(gridEvents.size());
+        }
+        ++leapCount;
+        leapTunnelMax = std::max(leapTunnelMax, tunnels);
+        leapTime += steptime;
+    }
+    else if (this->chargeIntegrator == ChargeIntegrator::ExponentialJump)
+    {
+        // トンネルしうる素子が無い間はまとめて進める
+        steptime = this->quietStepTime();
+    }
+
+    // チャージの計算
+    this->updateGridsQn(steptime);
+
+    // tの増加
+    this->t += steptime;
+}
+
+// 実行のシードを設定
+template <typename Element>
+void TauLeapSimulation2D<Element>::setSeed(std::uint64_t runSeed)
+{
+    Simulation2D<Element>::setSeed(runSeed);
+    // gridのシード(deriveSeed(runSeed, g))と重ならない番号から作る
+    leapSeed = deriveSeed(runSeed, ~std::uint64_t(0));
+}
+
+// 誤差の目安を設定
+template <typename Element>
+void TauLeapSimulation2D<Element>::setTolerance(double tol)
+{
+    if (!(tol > 0 && tol < 1))
+    {
+        throw std::invalid_argument("Tau-leap tolerance must be in (0, 1)");
+    }
+    tolerance = tol;
+}
+
+// 誤差の目安を取得
+template <typename Element>
+double TauLeapSimulation2D<Element>::getTolerance() const
+{
+    return tolerance;
+}
+
+// トンネルしうる素子があったリープの回数を取得
+template <typename Element>
+long long TauLeapSimulation2D<Element>::getLeapCount() const
+{
+    return leapCount;
+}
+
+// 1リープでのトンネル回数の最大を取得
+template <typename Element>
+long long TauLeapSimulation2D<Element>::getMaxTunnelsPerLeap() const
+{
+    return leapTunnelMax;
+}
+
+// リープ1回あたりの平均トンネル回数を取得
+template <typename Element>
+double TauLeapSimulation2D<Element>::getMeanTunnelsPerLeap() const
+{
+    return leapCount > 0 ? static_cast<double>(this->tunnelCount) / leapCount : 0.0;
+}
+
+// リープ1回の平均の長さを取得
+template <typename Element>
+double TauLeapSimulation2D<Element>::getMeanLeapTime() const
+{
+    return leapCount > 0 ? leapTime / leapCount : 0.0;
+}
+
+#endif // TAU_LEAP_SIMULATION_2D_HPP
@@ -0,0 +1,156 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+
+// gridの各処理を並列に回すための固定サイズのスレッドプール
+// 呼び出したスレッドも1つの区間を受け持つので、size()-1個のスレッドを作る
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable wake, done;
+    std::function<void(int)> job; // 区間番号を受け取る処理
+    unsigned long generation = 0; // 新しい処理を配るたびに増やす
+    int remaining = 0;            // 終わっていない区間の数
+    bool stopping = false;
+    std::exception_ptr error;     // 区間で投げられた最初の例外
+    std::mutex callMtx;           // parallelForの同時呼び出しを防ぐ
+
+    void workerLoop(int chunk);
+    void runChunk(int chunk);
+
+public:
+    // スレッド数(呼び出し元を含む、1以上)を指定して作る
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // スレッド数(区間の数)
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // [begin, end)をsize()個の連続した区間に分け、f(区間番号, 区間の先頭, 区間の末尾)を並列に呼ぶ
+    // 区間の分け方は毎回同じなので、区間ごとの結果を番号順にまとめれば結果は決定的になる
+    template <typename F>
+    void parallelFor(int begin, int end, F f);
+};
+
+// poolがnullなら1区間として逐次に呼ぶ
+template <typename F>
+inline void parallelChunks(ThreadPool *pool, int begin, int end, F f)
+{
+    if (pool == nullptr || pool->size() == 1)
+    {
+        f(0, begin, end);
+        return;
+    }
+    pool->parallelFor(begin, end, f);
+}
+
+// parallelChunksで使われる区間の数
+inline int numChunks(const ThreadPool *pool)
+{
+    return pool == nullptr ? 1 : pool->size();
+}
+
+inline ThreadPool::ThreadPool(int threads)
+{
+    if (threads < 1)
+    {
+        throw std::invalid_argument("Thread count must be at least 1");
+    }
+    for (int chunk = 1; chunk < threads; ++chunk)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, chunk);
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+inline void ThreadPool::runChunk(int chunk)
+{
+    try
+    {
+        job(chunk);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!error)
+            error = std::current_exception();
+    }
+}
+
+inline void ThreadPool::workerLoop(int chunk)
+{
+    unsigned long seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        runChunk(chunk);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--remaining == 0)
+                done.notify_one();
+        }
+    }
+}
+
+template <typename F>
+inline void ThreadPool::parallelFor(int begin, int end, F f)
+{
+    std::lock_guard<std::mutex> call(callMtx);
+    const int chunks = size();
+    const int length = end > begin ? end - begin : 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job = [&f, begin, length, chunks](int chunk) {
+            const int b = begin + static_cast<int>(static_cast<long long>(length) * chunk / chunks);
+            const int e = begin + static_cast<int>(static_cast<long long>(length) * (chunk + 1) / chunks);
+            f(chunk, b, e);
+        };
+        remaining = chunks - 1;
+        error = nullptr;
+        ++generation;
+    }
+    wake.notify_all();
+    runChunk(0);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [&] { return remaining == 0; });
+    job = nullptr;
+    if (error)
+    {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+#endif // THREAD_POOL_HPP
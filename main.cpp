@@ -2,7 +2,12 @@
 #include "seo_class.hpp"
 #include "grid_2dim.hpp"
 #include "simulation_2d.hpp"
+#include "lattice_builder.hpp"
 #include "oyl_video.hpp"
+#ifdef OYL_ENABLE_MPI
+#include <mpi.h>
+#include "mpi_simulation_2d.hpp"
+#endif
 
 constexpr int size_x = 32;
 constexpr int size_y = 32;
@@ -14,36 +19,44 @@ constexpr double C = 2.0;
 constexpr double dt = 0.1;
 constexpr double endtime = 200;
 
-using Sim = Simulation2D<SEO>;
-using Grid = Grid2D<SEO>;
+using Sim = Simulation2D<FlatSEO>;
+using Grid = Grid2D<FlatSEO>;
 
-int main()
+int main(int argc, char **argv)
 {
-    Grid grid(size_y, size_x, true);
-    grid.setOutputLabel("seo");
-
-    // SEO初期化と接続
-    for (int y = 0; y < size_y; ++y)
-    {
-        for (int x = 0; x < size_x; ++x)
-        {
-            auto seo = grid.getElement(y, x);
-            double biasVd = ((x + y) % 2 == 0) ? Vd : -Vd;
-            seo->setUp(R, Rj, Cj, C, biasVd, 4);
-            std::vector<std::shared_ptr<SEO>> connections;
-            if (y > 0) connections.push_back(grid.getElement(y - 1, x));     // 上
-            if (x < size_x - 1) connections.push_back(grid.getElement(y, x + 1)); // 右
-            if (y < size_y - 1) connections.push_back(grid.getElement(y + 1, x)); // 下
-            if (x > 0) connections.push_back(grid.getElement(y, x - 1));     // 左
-            seo->setConnections(connections);
-        }
-    }
-    
+#ifdef OYL_ENABLE_MPI
+    MPI_Init(&argc, &argv);
+#else
+    (void)argc;
+    (void)argv;
+#endif
+    // SEO初期化と接続（市松模様のバイアス、開放端）
+    LatticeBuilder builder(size_y, size_x);
+    builder.setParams({R, Rj, Cj, C, Vd}).setCheckerboardBias().setBoundary(BoundaryMode::Open);
+    // 素子ごとの接続を持たない平坦な格子で計算する(MPIビルドと同じgridの型)
+    Grid whole = builder.buildFlatGrid();
+    whole.setOutputLabel("seo");
+#ifdef OYL_ENABLE_MPI
+    // MPIビルドでは格子を行方向に分けて各ランクで計算し、出力はランク0に集める
+    MPISimulation2D<FlatSEO> sim(dt, endtime);
+    auto &grid = sim.distributeGrid(whole);
+#else
     Sim sim(dt, endtime);
-    sim.addGrid({grid});
+    Grid &grid = sim.appendGrid(std::move(whole));
+#endif
+    std::cout << "[INFO] Built " << size_y << "x" << size_x << " grid in " << builder.getBuildSeconds() << " s"
+              << std::endl;
+
     // 時刻150ns〜150.1nsの間、(1,1)の素子に0.006Vを加える
     sim.addVoltageTrigger(150, &grid, 1, 1, 0.06);
     sim.run();
+#ifdef OYL_ENABLE_MPI
+    // 出力はランク0だけが持つ
+    const int rank = sim.getRank();
+    MPI_Finalize();
+    if (rank != 0)
+        return 0;
+#endif
 
 
     // 出力処理
@@ -1,23 +1,38 @@
 #include "seo_class.hpp"
+#include "seo_kernels.hpp"
+#include "charge_integration.hpp"
+//------ トンネルの向き ---------//
+// 文字列からTunnelDirectionへ変換
+TunnelDirection toTunnelDirection(const string &direction)
+{
+    if (direction == "up")
+    {
+        return TunnelDirection::Up;
+    }
+    if (direction == "down")
+    {
+        return TunnelDirection::Down;
+    }
+    throw invalid_argument("Invalid tunnel direction");
+}
+
+// TunnelDirectionを文字列へ変換
+const char *tunnelDirectionName(TunnelDirection direction)
+{
+    return direction == TunnelDirection::Up ? "up" : "down";
+}
+
 //------ コンストラクタ（パラメータの初期設定）---------//
 // 初期値無し
-SEO::SEO() : R(0), Rj(0), Cj(0), C(0), Vd(0), Q(0), Vn(0), legs(0), V_sum(0)
+SEO::SEO() : R(0), Rj(0), Cj(0), C(0), Vd(0), Q(0), Vn(0), legs(0), V_sum(0), Vext(0), rng(defaultPhiloxStream())
 {
-    dE["up"] = 0.0;
-    dE["down"] = 0.0;
-    wt["up"] = 0.0;
-    wt["down"] = 0.0;
 }
 
 // 初期値あり
 SEO::SEO(double r, double rj, double cj, double c, double vd, int legscounts)
     : R(r), Rj(rj), Cj(cj), C(c), Vd(vd), Q(0.0), Vn(0.0), legs(legscounts),
-      V_sum(0.0), connection(0)
+      V_sum(0.0), Vext(0.0), connection(0), rng(defaultPhiloxStream())
 {
-    dE["up"] = 0.0;
-    dE["down"] = 0.0;
-    wt["up"] = 0.0;
-    wt["down"] = 0.0;
 }
 
 //-----------セッター------------//
@@ -44,6 +59,18 @@ void SEO::setVsum(double v)
     V_sum = v;
 }
 
+// 乱数列を設定(抽選回数は0に戻す)
+void SEO::setRandomStream(uint64_t seed, uint64_t stream)
+{
+    rng = PhiloxStream{seed, stream, 0};
+}
+
+// 外部から加える電圧を設定
+void SEO::setExternalVoltage(double v)
+{
+    Vext = v;
+}
+
 // 接続情報を設定
 void SEO::setConnections(const vector<shared_ptr<SEO>> &connectedSEOs)
 {
@@ -52,6 +79,7 @@ void SEO::setConnections(const vector<shared_ptr<SEO>> &connectedSEOs)
     {
         throw invalid_argument("The size of connections must match the number of legs.");
     }
+    connection.reserve(connectedSEOs.size());
     for (const auto &seo : connectedSEOs)
     {
         if (this == seo.get())
@@ -66,10 +94,11 @@ void SEO::setConnections(const vector<shared_ptr<SEO>> &connectedSEOs)
 void SEO::setSurroundingVoltages()
 {
     V_sum = 0;
-    for (auto seo : connection)
+    for (const auto &seo : connection)
     {
         V_sum += seo->Vn;
     }
+    V_sum += Vext;
 }
 
 // 振動子のパラメータ計算
@@ -81,8 +110,8 @@ void SEO::setPcalc()
 // 振動子のエネルギー計算
 void SEO::setdEcalc()
 {
-    dE["up"] = -e * (e - 2 * (Q + C * V_sum)) / (2 * (legs * C + Cj));
-    dE["down"] = -e * (e + 2 * (Q + C * V_sum)) / (2 * (legs * C + Cj));
+    dE[TunnelDirection::Up] = -e * (e - 2 * (Q + C * V_sum)) / (2 * (legs * C + Cj));
+    dE[TunnelDirection::Down] = -e * (e + 2 * (Q + C * V_sum)) / (2 * (legs * C + Cj));
 }
 
 // 電荷の更新
@@ -91,40 +120,46 @@ void SEO::setNodeCharge(const double dt)
     Q += (Vd - Vn) * dt / R;
 }
 
+// 電荷の更新(RC充電の解析解)
+void SEO::setNodeChargeExponential(const double dt)
+{
+    Q += exponentialChargeIncrement(Vd, Vn, R, legs * C + Cj, dt);
+}
+
+// dEが正になるまでの時間
+double SEO::getThresholdTime() const
+{
+    return thresholdCrossingTime(Q + C * V_sum, Vd, R, legs * C + Cj);
+}
+
 // トンネル待ち時間計算(upまたはdownが正の時にwtを計算してtrueを返す)
 bool SEO::calculateTunnelWt()
 {
     // 初期化
-    wt["up"] = 0;
-    wt["down"] = 0;
-    if (dE["up"] > 0)
+    wt = TunnelPair();
+    if (dE[TunnelDirection::Up] > 0)
     {
-        wt["up"] = (e * e * Rj / dE["up"]) * log(1 / Random());
+        wt[TunnelDirection::Up] = (e * e * Rj / dE[TunnelDirection::Up]) * Exponential();
         return true;
     }
-    if (dE["down"] > 0)
+    if (dE[TunnelDirection::Down] > 0)
     {
-        wt["down"] = (e * e * Rj / dE["down"]) * log(1 / Random());
+        wt[TunnelDirection::Down] = (e * e * Rj / dE[TunnelDirection::Down]) * Exponential();
         return true;
     }
     return false;
 }
 
 // 振動子のトンネル
-void SEO::setTunnel(const string direction)
+void SEO::setTunnel(TunnelDirection direction)
 {
-    if (direction == "up")
-    {
-        Q += -e;
-    }
-    else if (direction == "down")
-    {
-        Q += e;
-    }
-    else
-    {
-        throw invalid_argument("Invalid tunnel direction");
-    }
+    Q += (direction == TunnelDirection::Up) ? -e : e;
+}
+
+// 振動子のトンネル（互換用）
+void SEO::setTunnel(const string &direction)
+{
+    setTunnel(toTunnelDirection(direction));
 }
 //-----------ゲッター------------//
 
@@ -146,8 +181,14 @@ double SEO::getSurroundingVsum() const
     return V_sum;
 }
 
+// 外部から加えている電圧を取得
+double SEO::getExternalVoltage() const
+{
+    return Vext;
+}
+
 // dEの取得
-map<string, double> SEO::getdE() const
+const TunnelPair &SEO::getdE() const
 {
     return dE;
 }
@@ -159,19 +200,29 @@ double SEO::getQ() const
 }
 
 // wtの取得
-map<string, double> SEO::getWT() const
+const TunnelPair &SEO::getWT() const
 {
     return wt;
 }
 
+// 乱数列を取得
+const PhiloxStream &SEO::getRandomStream() const
+{
+    return rng;
+}
+
 //-------- 汎用処理 -------------//
-// 0から1の間の乱数を生成
+// 0から1の間(0は含まない)の乱数を生成
+// 素子ごとの乱数列から引くので、他の素子やスレッドと状態を共有しない
 double SEO::Random()
 {
-    static random_device rd;
-    static mt19937 mt(rd());
-    static uniform_real_distribution<double> dist(0.0, 1.0);
-    return dist(mt);
+    return rng.uniform();
+}
+
+// 平均1の指数分布の乱数 -log(u)(Grid2D<FlatSEO>のexponentialDrawと同じ値になる)
+double SEO::Exponential()
+{
+    return exponentialVariate(rng.seed, rng.stream, rng.counter++);
 }
 
 //-------- テスト用 -----------//
@@ -212,11 +263,17 @@ int SEO::getlegs() const
 }
 
 // テスト用dEセッター
-void SEO::setdE(const string &direction, double value)
+void SEO::setdE(TunnelDirection direction, double value)
 {
     dE[direction] = value;
 }
 
+// テスト用dEセッター（互換用）
+void SEO::setdE(const string &direction, double value)
+{
+    setdE(toTunnelDirection(direction), value);
+}
+
 // テスト用Vnセッター
 void SEO::setVn(double vn)
 {
@@ -0,0 +1,344 @@
+#include "seo_kernels.hpp"
+#include "seo_class.hpp"
+#include "philox.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+//------ スカラー版(基準になる実装) ---------//
+namespace
+{
+    void nodeVoltageScalar(const double *Qn, const double *Vsum, const double *C, const double *Cj, const int *legs,
+                           double *Vn, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            Vn[i] = Qn[i] / Cj[i] + (C[i] / (Cj[i] * (legs[i] * C[i] + Cj[i]))) * (Cj[i] * Vsum[i] - legs[i] * Qn[i]);
+        }
+    }
+
+    void energyChangeScalar(const double *Qn, const double *Vsum, const double *C, const double *Cj, const int *legs,
+                            double *dE, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            dE[2 * i] = -e * (e - 2 * (Qn[i] + C[i] * Vsum[i])) / (2 * (legs[i] * C[i] + Cj[i]));
+            dE[2 * i + 1] = -e * (e + 2 * (Qn[i] + C[i] * Vsum[i])) / (2 * (legs[i] * C[i] + Cj[i]));
+        }
+    }
+
+    WaitTimeMin waitTimeArgminScalar(const double *dE, const double *Rj, const double *expo, double *wt, int first,
+                                     int last)
+    {
+        WaitTimeMin best{std::numeric_limits<double>::infinity(), -1};
+        for (int i = first; i < last; ++i)
+        {
+            wt[2 * i] = 0.0;
+            wt[2 * i + 1] = 0.0;
+            // upとdownが同時に正になることはないので、正の方だけ計算する
+            int dir = 0;
+            if (!(dE[2 * i] > 0))
+            {
+                dir = 1;
+                if (!(dE[2 * i + 1] > 0))
+                    continue;
+            }
+            const double w = (e * e * Rj[i] / dE[2 * i + dir]) * expo[i];
+            wt[2 * i + dir] = w;
+            if (w < best.wt)
+            {
+                best.wt = w;
+                best.index = i;
+            }
+        }
+        return best;
+    }
+
+    void nodeVoltageClassScalar(const double *Qn, const double *Vsum, const std::uint16_t *cls,
+                                const SEOClassCoefficients &k, double *Vn, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            const int c = cls[i];
+            Vn[i] = (Qn[i] + k.C[c] * Vsum[i]) * k.invCtot[c];
+        }
+    }
+
+    void energyChangeClassScalar(const double *Qn, const double *Vsum, const std::uint16_t *cls,
+                                 const SEOClassCoefficients &k, double *dE, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            const int c = cls[i];
+            const double a = (Qn[i] + k.C[c] * Vsum[i]) * k.eOverCtot[c];
+            dE[2 * i] = a - k.halfE2OverCtot[c];
+            dE[2 * i + 1] = -a - k.halfE2OverCtot[c];
+        }
+    }
+
+    WaitTimeMin waitTimeArgminClassScalar(const double *dE, const std::uint16_t *cls, const SEOClassCoefficients &k,
+                                          const double *expo, double *wt, int first, int last)
+    {
+        WaitTimeMin best{std::numeric_limits<double>::infinity(), -1};
+        for (int i = first; i < last; ++i)
+        {
+            wt[2 * i] = 0.0;
+            wt[2 * i + 1] = 0.0;
+            int dir = 0;
+            if (!(dE[2 * i] > 0))
+            {
+                dir = 1;
+                if (!(dE[2 * i + 1] > 0))
+                    continue;
+            }
+            const double w = (k.e2Rj[cls[i]] / dE[2 * i + dir]) * expo[i];
+            wt[2 * i + dir] = w;
+            if (w < best.wt)
+            {
+                best.wt = w;
+                best.index = i;
+            }
+        }
+        return best;
+    }
+
+    // (0, 1]の一様乱数uに対する -log(u)(SIMD版と同じ計算順。u = 1 なら +0)
+    double negativeLog(double u)
+    {
+        using namespace seo_log;
+        std::uint64_t bits;
+        std::memcpy(&bits, &u, sizeof(bits));
+        std::int64_t k = static_cast<std::int64_t>(bits >> 52) - 1023;
+        std::uint64_t mantissa = bits & 0x000fffffffffffffULL;
+        // uは一様乱数なので分岐にすると半分は予測を外す。指数部とkを比較結果から作る(値は分岐と同じ)
+        const std::uint64_t high = (mantissa > sqrt2Mantissa) ? 1 : 0;
+        mantissa |= 0x3ff0000000000000ULL - (high << 52); // 大きければ[sqrt(2)/2, 1)、そうでなければ[1, sqrt(2)]
+        k += static_cast<std::int64_t>(high);
+        double m;
+        std::memcpy(&m, &mantissa, sizeof(m));
+        const double dk = static_cast<double>(k);
+        const double f = m - 1.0;
+        const double s = f / (2.0 + f);
+        const double z = s * s;
+        const double w = z * z;
+        const double t1 = w * (Lg2 + w * (Lg4 + w * Lg6));
+        const double t2 = z * (Lg1 + w * (Lg3 + w * (Lg5 + w * Lg7)));
+        const double r = t2 + t1;
+        const double hfsq = 0.5 * f * f;
+        const double logu = dk * ln2Hi - ((hfsq - (s * (hfsq + r) + dk * ln2Lo)) - f);
+        return 0.0 - logu;
+    }
+
+    void exponentialDrawScalar(const double *dE, std::uint64_t seed, std::uint64_t streamBase, std::uint64_t *counter,
+                               double *expo, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            if (dE[2 * i] > 0 || dE[2 * i + 1] > 0)
+                expo[i] = negativeLog(philoxUniform(seed, streamBase + static_cast<std::uint64_t>(i), counter[i]++));
+        }
+    }
+
+    void nodeVoltageFloatScalar(const float *Qn, const float *Vsum, const float *C, const float *Cj, const int *legs,
+                                float *Vn, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            Vn[i] = Qn[i] / Cj[i] + (C[i] / (Cj[i] * (legs[i] * C[i] + Cj[i]))) * (Cj[i] * Vsum[i] - legs[i] * Qn[i]);
+        }
+    }
+
+    void energyChangeFloatScalar(const float *Qn, const float *Vsum, const float *C, const float *Cj, const int *legs,
+                                 float *dE, int first, int last)
+    {
+        const float q = static_cast<float>(e);
+        for (int i = first; i < last; ++i)
+        {
+            dE[2 * i] = -q * (q - 2 * (Qn[i] + C[i] * Vsum[i])) / (2 * (legs[i] * C[i] + Cj[i]));
+            dE[2 * i + 1] = -q * (q + 2 * (Qn[i] + C[i] * Vsum[i])) / (2 * (legs[i] * C[i] + Cj[i]));
+        }
+    }
+
+    WaitTimeMin waitTimeArgminFloatScalar(const float *dE, const float *Rj, const float *expo, float *wt, int first,
+                                          int last)
+    {
+        const float q2 = static_cast<float>(e) * static_cast<float>(e);
+        WaitTimeMin best{std::numeric_limits<double>::infinity(), -1};
+        for (int i = first; i < last; ++i)
+        {
+            wt[2 * i] = 0.0f;
+            wt[2 * i + 1] = 0.0f;
+            int dir = 0;
+            if (!(dE[2 * i] > 0))
+            {
+                dir = 1;
+                if (!(dE[2 * i + 1] > 0))
+                    continue;
+            }
+            const float w = (q2 * Rj[i] / dE[2 * i + dir]) * expo[i];
+            wt[2 * i + dir] = w;
+            if (w < best.wt)
+            {
+                best.wt = w;
+                best.index = i;
+            }
+        }
+        return best;
+    }
+
+    void exponentialDrawFloatScalar(const float *dE, std::uint64_t seed, std::uint64_t streamBase,
+                                    std::uint64_t *counter, float *expo, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            if (dE[2 * i] > 0 || dE[2 * i + 1] > 0)
+                expo[i] = static_cast<float>(
+                    negativeLog(philoxUniform(seed, streamBase + static_cast<std::uint64_t>(i), counter[i]++)));
+        }
+    }
+
+    void laneNodeVoltageScalar(const int *neighbours, int maxLegs, const double *C, const double *Cj,
+                               const int *legs, const double *Qn, const double *Vn, const double *Vext, double *Vsum,
+                               double *VnNext, double *residual, int K, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            const int *nb = neighbours + static_cast<std::size_t>(i) * maxLegs;
+            const double cj = Cj[i], c = C[i], l = legs[i];
+            const double coupling = c / (cj * (l * c + cj));
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            for (int r = 0; r < K; ++r)
+            {
+                double sum = 0.0;
+                for (int k = 0; k < maxLegs; ++k)
+                {
+                    if (nb[k] >= 0)
+                        sum += Vn[static_cast<std::size_t>(nb[k]) * K + r];
+                }
+                const double vsum = sum + Vext[base + r];
+                const double q = Qn[base + r];
+                const double vn = q / cj + coupling * (cj * vsum - l * q);
+                Vsum[base + r] = vsum;
+                VnNext[base + r] = vn;
+                residual[r] = std::max(residual[r], std::fabs(vn - Vn[base + r]));
+            }
+        }
+    }
+
+    void laneEnergyChangeScalar(const double *C, const double *Cj, const int *legs, const double *Qn,
+                                const double *Vsum, double *dEUp, double *dEDown, int K, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            const double c = C[i], denom = 2 * (legs[i] * c + Cj[i]);
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            for (std::size_t k = base; k < base + K; ++k)
+            {
+                dEUp[k] = -e * (e - 2 * (Qn[k] + c * Vsum[k])) / denom;
+                dEDown[k] = -e * (e + 2 * (Qn[k] + c * Vsum[k])) / denom;
+            }
+        }
+    }
+
+    void laneChargeEulerScalar(const double *R, const double *Vd, const double *Vn, const double *h, double *Qn,
+                               int K, int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            for (int r = 0; r < K; ++r)
+                Qn[base + r] += (Vd[base + r] - Vn[base + r]) * h[r] / R[i];
+        }
+    }
+
+    const SEOKernelTable scalarTable = {SimdLevel::Scalar,         nodeVoltageScalar,         energyChangeScalar,
+                                        waitTimeArgminScalar,      nodeVoltageClassScalar,    energyChangeClassScalar,
+                                        waitTimeArgminClassScalar, exponentialDrawScalar,     nodeVoltageFloatScalar,
+                                        energyChangeFloatScalar,   waitTimeArgminFloatScalar, exponentialDrawFloatScalar,
+                                        laneNodeVoltageScalar,     laneEnergyChangeScalar,    laneChargeEulerScalar};
+}
+
+const SEOKernelTable *seoKernelsScalar()
+{
+    return &scalarTable;
+}
+
+// 乱数列(seed, stream)のcounter番目の一様乱数から作る -log(u)
+double exponentialVariate(std::uint64_t seed, std::uint64_t stream, std::uint64_t counter)
+{
+    return negativeLog(philoxUniform(seed, stream, counter));
+}
+
+//------ 命令セットの選択 ---------//
+// 実行中のCPUで使える最も広い命令セット
+SimdLevel detectSimdLevel()
+{
+    if (isSimdLevelSupported(SimdLevel::AVX512))
+        return SimdLevel::AVX512;
+    if (isSimdLevelSupported(SimdLevel::AVX2))
+        return SimdLevel::AVX2;
+    return SimdLevel::Scalar;
+}
+
+// 命令セットが使えるか
+bool isSimdLevelSupported(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar:
+        return true;
+    case SimdLevel::AVX2:
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        return seoKernelsAVX2() != nullptr && __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    case SimdLevel::AVX512:
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        return seoKernelsAVX512() != nullptr && __builtin_cpu_supports("avx512f");
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+// 指定した命令セットのカーネル
+const SEOKernelTable &seoKernels(SimdLevel level)
+{
+    if (!isSimdLevelSupported(level))
+    {
+        throw invalid_argument(string("SIMD level is not supported: ") + simdLevelName(level));
+    }
+    switch (level)
+    {
+    case SimdLevel::AVX2:
+        return *seoKernelsAVX2();
+    case SimdLevel::AVX512:
+        return *seoKernelsAVX512();
+    default:
+        return *seoKernelsScalar();
+    }
+}
+
+// 実行中のCPUに合わせて選んだカーネル
+const SEOKernelTable &seoKernels()
+{
+    static const SEOKernelTable &table = seoKernels(detectSimdLevel());
+    return table;
+}
+
+// 命令セットの名前
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,569 @@
+#include "seo_kernels.hpp"
+#include "seo_class.hpp"
+#include "philox.hpp"
+
+// -mavx2 -ffp-contract=off でコンパイルする(CMakeLists.txt参照)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include <limits>
+
+namespace
+{
+    // 4素子分のlegsをdoubleで読む
+    inline __m256d loadLegs(const int *legs)
+    {
+        return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(legs)));
+    }
+
+    // (up, down)の組を4素子分書き込む
+    inline void storePairs(double *out, __m256d up, __m256d down)
+    {
+        __m256d lo = _mm256_unpacklo_pd(up, down); // u0 d0 u2 d2
+        __m256d hi = _mm256_unpackhi_pd(up, down); // u1 d1 u3 d3
+        _mm256_storeu_pd(out, _mm256_permute2f128_pd(lo, hi, 0x20));
+        _mm256_storeu_pd(out + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+    }
+
+    void nodeVoltageAVX2(const double *Qn, const double *Vsum, const double *C, const double *Cj, const int *legs,
+                         double *Vn, int first, int last)
+    {
+        int i = first;
+        for (; i + 4 <= last; i += 4)
+        {
+            __m256d q = _mm256_loadu_pd(Qn + i);
+            __m256d vs = _mm256_loadu_pd(Vsum + i);
+            __m256d c = _mm256_loadu_pd(C + i);
+            __m256d cj = _mm256_loadu_pd(Cj + i);
+            __m256d l = loadLegs(legs + i);
+            __m256d denom = _mm256_add_pd(_mm256_mul_pd(l, c), cj);
+            __m256d coef = _mm256_div_pd(c, _mm256_mul_pd(cj, denom));
+            __m256d inner = _mm256_sub_pd(_mm256_mul_pd(cj, vs), _mm256_mul_pd(l, q));
+            _mm256_storeu_pd(Vn + i, _mm256_add_pd(_mm256_div_pd(q, cj), _mm256_mul_pd(coef, inner)));
+        }
+        seoKernelsScalar()->nodeVoltage(Qn, Vsum, C, Cj, legs, Vn, i, last);
+    }
+
+    void energyChangeAVX2(const double *Qn, const double *Vsum, const double *C, const double *Cj, const int *legs,
+                          double *dE, int first, int last)
+    {
+        const __m256d E = _mm256_set1_pd(e), negE = _mm256_set1_pd(-e), two = _mm256_set1_pd(2.0);
+        int i = first;
+        for (; i + 4 <= last; i += 4)
+        {
+            __m256d c = _mm256_loadu_pd(C + i);
+            __m256d charge = _mm256_add_pd(_mm256_loadu_pd(Qn + i), _mm256_mul_pd(c, _mm256_loadu_pd(Vsum + i)));
+            __m256d twice = _mm256_mul_pd(two, charge);
+            __m256d denom =
+                _mm256_mul_pd(two, _mm256_add_pd(_mm256_mul_pd(loadLegs(legs + i), c), _mm256_loadu_pd(Cj + i)));
+            __m256d up = _mm256_div_pd(_mm256_mul_pd(negE, _mm256_sub_pd(E, twice)), denom);
+            __m256d down = _mm256_div_pd(_mm256_mul_pd(negE, _mm256_add_pd(E, twice)), denom);
+            storePairs(dE + 2 * i, up, down);
+        }
+        seoKernelsScalar()->energyChange(Qn, Vsum, C, Cj, legs, dE, i, last);
+    }
+
+    // wtの計算と最小値の探索
+    // numerator(i)はi番目からの4素子分のe*e*Rj、tail(i)はi番目以降の残りの素子を調べた結果
+    template <typename Numerator, typename Tail>
+    WaitTimeMin waitTimeArgminImpl(const double *dE, Numerator numerator, const double *expo, double *wt, int first,
+                                   int last, Tail tail)
+    {
+        const double inf = std::numeric_limits<double>::infinity();
+        const __m256d zero = _mm256_setzero_pd(), infv = _mm256_set1_pd(inf);
+        __m256d best = infv;
+        __m256d bestIndex = _mm256_set1_pd(-1.0);
+        __m256d index = _mm256_setr_pd(first, first + 1.0, first + 2.0, first + 3.0);
+        const __m256d step = _mm256_set1_pd(4.0);
+        int i = first;
+        for (; i + 4 <= last; i += 4)
+        {
+            // (up, down)の組を向きごとに分ける
+            __m256d a = _mm256_loadu_pd(dE + 2 * i);
+            __m256d b = _mm256_loadu_pd(dE + 2 * i + 4);
+            __m256d t0 = _mm256_permute2f128_pd(a, b, 0x20); // u0 d0 u2 d2
+            __m256d t1 = _mm256_permute2f128_pd(a, b, 0x31); // u1 d1 u3 d3
+            __m256d up = _mm256_unpacklo_pd(t0, t1);
+            __m256d down = _mm256_unpackhi_pd(t0, t1);
+
+            __m256d maskUp = _mm256_cmp_pd(up, zero, _CMP_GT_OQ);
+            __m256d maskDown = _mm256_andnot_pd(maskUp, _mm256_cmp_pd(down, zero, _CMP_GT_OQ));
+            __m256d positive = _mm256_or_pd(maskUp, maskDown);
+            __m256d rate = _mm256_blendv_pd(down, up, maskUp);
+            __m256d w = _mm256_mul_pd(_mm256_div_pd(numerator(i), rate), _mm256_loadu_pd(expo + i));
+            storePairs(wt + 2 * i, _mm256_and_pd(w, maskUp), _mm256_and_pd(w, maskDown));
+
+            // 対象外の素子は+infにして、レーンごとに最小値と添字を持つ
+            __m256d masked = _mm256_blendv_pd(infv, w, positive);
+            __m256d less = _mm256_cmp_pd(masked, best, _CMP_LT_OQ);
+            best = _mm256_blendv_pd(best, masked, less);
+            bestIndex = _mm256_blendv_pd(bestIndex, index, less);
+            index = _mm256_add_pd(index, step);
+        }
+
+        // レーンをまとめる(同じ値なら添字の小さい方)
+        alignas(32) double values[4], indices[4];
+        _mm256_store_pd(values, best);
+        _mm256_store_pd(indices, bestIndex);
+        WaitTimeMin result{inf, -1};
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            if (indices[lane] < 0)
+                continue;
+            const int idx = static_cast<int>(indices[lane]);
+            if (values[lane] < result.wt || (values[lane] == result.wt && idx < result.index))
+            {
+                result.wt = values[lane];
+                result.index = idx;
+            }
+        }
+        // 残りの素子は後ろにあるので、小さいときだけ置き換える
+        WaitTimeMin rest = tail(i);
+        if (rest.wt < result.wt)
+            result = rest;
+        return result;
+    }
+
+    WaitTimeMin waitTimeArgminAVX2(const double *dE, const double *Rj, const double *expo, double *wt, int first,
+                                   int last)
+    {
+        const __m256d ee = _mm256_set1_pd(e * e);
+        return waitTimeArgminImpl(
+            dE, [&](int i) { return _mm256_mul_pd(ee, _mm256_loadu_pd(Rj + i)); }, expo, wt, first, last,
+            [&](int i) { return seoKernelsScalar()->waitTimeArgmin(dE, Rj, expo, wt, i, last); });
+    }
+
+    // 4素子分のクラス番号で係数の表を引く
+    inline __m256d gatherClass(const double *table, const std::uint16_t *cls)
+    {
+        __m128i idx = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(cls)));
+        return _mm256_i32gather_pd(table, idx, 8);
+    }
+
+    void nodeVoltageClassAVX2(const double *Qn, const double *Vsum, const std::uint16_t *cls,
+                              const SEOClassCoefficients &k, double *Vn, int first, int last)
+    {
+        int i = first;
+        for (; i + 4 <= last; i += 4)
+        {
+            __m256d charge = _mm256_add_pd(_mm256_loadu_pd(Qn + i),
+                                           _mm256_mul_pd(gatherClass(k.C, cls + i), _mm256_loadu_pd(Vsum + i)));
+            _mm256_storeu_pd(Vn + i, _mm256_mul_pd(charge, gatherClass(k.invCtot, cls + i)));
+        }
+        seoKernelsScalar()->nodeVoltageClass(Qn, Vsum, cls, k, Vn, i, last);
+    }
+
+    void energyChangeClassAVX2(const double *Qn, const double *Vsum, const std::uint16_t *cls,
+                               const SEOClassCoefficients &k, double *dE, int first, int last)
+    {
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        int i = first;
+        for (; i + 4 <= last; i += 4)
+        {
+            __m256d charge = _mm256_add_pd(_mm256_loadu_pd(Qn + i),
+                                           _mm256_mul_pd(gatherClass(k.C, cls + i), _mm256_loadu_pd(Vsum + i)));
+            __m256d a = _mm256_mul_pd(charge, gatherClass(k.eOverCtot, cls + i));
+            __m256d b = gatherClass(k.halfE2OverCtot, cls + i);
+            storePairs(dE + 2 * i, _mm256_sub_pd(a, b), _mm256_sub_pd(_mm256_xor_pd(a, sign), b));
+        }
+        seoKernelsScalar()->energyChangeClass(Qn, Vsum, cls, k, dE, i, last);
+    }
+
+    WaitTimeMin waitTimeArgminClassAVX2(const double *dE, const std::uint16_t *cls, const SEOClassCoefficients &k,
+                                        const double *expo, double *wt, int first, int last)
+    {
+        return waitTimeArgminImpl(
+            dE, [&](int i) { return gatherClass(k.e2Rj, cls + i); }, expo, wt, first, last,
+            [&](int i) { return seoKernelsScalar()->waitTimeArgminClass(dE, cls, k, expo, wt, i, last); });
+    }
+
+    // 4素子分のPhilox4x32-10(レーンごとにカウンタの4語c0..c3を下位32bitに持つ)
+    // philoxBitsと同じ64bitを返す。上位32bitに残るごみは乗算(下位32bitしか使わない)と最後のマスクで消える
+    inline __m256i philoxBits4(__m256i c0, __m256i c1, __m256i c2, __m256i c3, std::uint64_t seed)
+    {
+        const __m256i m0 = _mm256_set1_epi64x(Philox4x32::M0), m1 = _mm256_set1_epi64x(Philox4x32::M1);
+        const __m256i low = _mm256_set1_epi64x(0xffffffffLL);
+        std::uint32_t k0 = static_cast<std::uint32_t>(seed), k1 = static_cast<std::uint32_t>(seed >> 32);
+        for (int r = 0; r < Philox4x32::rounds; ++r)
+        {
+            if (r > 0)
+            {
+                k0 += Philox4x32::W0;
+                k1 += Philox4x32::W1;
+            }
+            const __m256i p0 = _mm256_mul_epu32(m0, c0);
+            const __m256i p1 = _mm256_mul_epu32(m1, c2);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), _mm256_set1_epi64x(k0));
+            c1 = p1;
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), _mm256_set1_epi64x(k1));
+            c3 = p0;
+        }
+        return _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(c0, low), 32), _mm256_and_si256(c1, low));
+    }
+
+    // 0 <= x < 2^32 の整数をdoubleにする(指数部を2^52に固定して引く。値は正確)
+    inline __m256d toDouble32(__m256i x)
+    {
+        const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+        return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(x, magic)), _mm256_set1_pd(0x1.0p52));
+    }
+
+    // philoxUniformと同じ (bits>>11 + 1) * 2^-53
+    inline __m256d uniform4(__m256i bits)
+    {
+        const __m256i v = _mm256_add_epi64(_mm256_srli_epi64(bits, 11), _mm256_set1_epi64x(1));
+        const __m256d hi = toDouble32(_mm256_srli_epi64(v, 32));
+        const __m256d lo = toDouble32(_mm256_and_si256(v, _mm256_set1_epi64x(0xffffffffLL)));
+        return _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(hi, _mm256_set1_pd(0x1.0p32)), lo), _mm256_set1_pd(0x1.0p-53));
+    }
+
+    // -log(u)(スカラー版のnegativeLogと同じ計算順)
+    inline __m256d negativeLog4(__m256d u)
+    {
+        using namespace seo_log;
+        const __m256i bits = _mm256_castpd_si256(u);
+        __m256i k = _mm256_sub_epi64(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(1023));
+        __m256i mantissa = _mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL));
+        const __m256i big = _mm256_cmpgt_epi64(mantissa, _mm256_set1_epi64x(sqrt2Mantissa));
+        mantissa = _mm256_or_si256(mantissa, _mm256_blendv_epi8(_mm256_set1_epi64x(0x3ff0000000000000LL),
+                                                                 _mm256_set1_epi64x(0x3fe0000000000000LL), big));
+        k = _mm256_sub_epi64(k, big);
+        // |k| < 2^51 なので指数部を固定して引けば正確にdoubleになる
+        const __m256d dk = _mm256_sub_pd(
+            _mm256_castsi256_pd(_mm256_add_epi64(k, _mm256_set1_epi64x(0x4338000000000000LL))),
+            _mm256_set1_pd(0x1.8p52));
+        const __m256d f = _mm256_sub_pd(_mm256_castsi256_pd(mantissa), _mm256_set1_pd(1.0));
+        const __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+        const __m256d z = _mm256_mul_pd(s, s);
+        const __m256d w = _mm256_mul_pd(z, z);
+        auto c = [](double v) { return _mm256_set1_pd(v); };
+        // t1 = w*(Lg2 + w*(Lg4 + w*Lg6)), t2 = z*(Lg1 + w*(Lg3 + w*(Lg5 + w*Lg7)))
+        __m256d p1 = _mm256_add_pd(c(Lg4), _mm256_mul_pd(w, c(Lg6)));
+        p1 = _mm256_add_pd(c(Lg2), _mm256_mul_pd(w, p1));
+        const __m256d t1 = _mm256_mul_pd(w, p1);
+        __m256d p2 = _mm256_add_pd(c(Lg5), _mm256_mul_pd(w, c(Lg7)));
+        p2 = _mm256_add_pd(c(Lg3), _mm256_mul_pd(w, p2));
+        p2 = _mm256_add_pd(c(Lg1), _mm256_mul_pd(w, p2));
+        const __m256d t2 = _mm256_mul_pd(z, p2);
+        const __m256d r = _mm256_add_pd(t2, t1);
+        const __m256d hfsq = _mm256_mul_pd(_mm256_mul_pd(c(0.5), f), f);
+        const __m256d inner = _mm256_add_pd(_mm256_mul_pd(s, _mm256_add_pd(hfsq, r)), _mm256_mul_pd(dk, c(ln2Lo)));
+        const __m256d logu =
+            _mm256_sub_pd(_mm256_mul_pd(dk, c(ln2Hi)), _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+        return _mm256_sub_pd(_mm256_setzero_pd(), logu);
+    }
+
+    // 4素子分の値をdoubleで読み書きする(floatの配列は広げて読み、丸めて書く。読む値は変わらない)
+    inline __m256d load4(const double *p) { return _mm256_loadu_pd(p); }
+    inline __m256d load4(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+    inline void store4(double *p, __m256d x) { _mm256_storeu_pd(p, x); }
+    inline void store4(float *p, __m256d x) { _mm_storeu_ps(p, _mm256_cvtpd_ps(x)); }
+
+    // 乱数は常にdoubleで作り、Value(doubleかfloat)の配列に書き込む。tail(i)はi番目以降の残りの素子を引く
+    template <typename Value, typename Tail>
+    void exponentialDrawImpl(const Value *dE, std::uint64_t seed, std::uint64_t streamBase, std::uint64_t *counter,
+                             Value *expo, int first, int last, Tail tail)
+    {
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256i low = _mm256_set1_epi64x(0xffffffffLL), lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+        int i = first;
+        for (; i + 4 <= last; i += 4)
+        {
+            __m256d a = load4(dE + 2 * i);
+            __m256d b = load4(dE + 2 * i + 4);
+            __m256d t0 = _mm256_permute2f128_pd(a, b, 0x20);
+            __m256d t1 = _mm256_permute2f128_pd(a, b, 0x31);
+            __m256d positive = _mm256_or_pd(_mm256_cmp_pd(_mm256_unpacklo_pd(t0, t1), zero, _CMP_GT_OQ),
+                                            _mm256_cmp_pd(_mm256_unpackhi_pd(t0, t1), zero, _CMP_GT_OQ));
+            if (_mm256_movemask_pd(positive) == 0)
+                continue;
+            // カウンタ = (抽選回数の下位, 上位, 乱数列の番号(streamBase + 素子の添字), 0)
+            __m256i count = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(counter + i));
+            __m256i stream = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(streamBase + i)), lanes);
+            __m256d x = negativeLog4(uniform4(philoxBits4(_mm256_and_si256(count, low), _mm256_srli_epi64(count, 32),
+                                                          stream, _mm256_setzero_si256(), seed)));
+            store4(expo + i, _mm256_blendv_pd(load4(expo + i), x, positive));
+            // 対象の素子だけ1進める(マスクは-1)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(counter + i),
+                                _mm256_sub_epi64(count, _mm256_castpd_si256(positive)));
+        }
+        tail(i);
+    }
+
+    void exponentialDrawAVX2(const double *dE, std::uint64_t seed, std::uint64_t streamBase, std::uint64_t *counter,
+                             double *expo, int first, int last)
+    {
+        exponentialDrawImpl(dE, seed, streamBase, counter, expo, first, last, [&](int i) {
+            seoKernelsScalar()->exponentialDraw(dE, seed, streamBase, counter, expo, i, last);
+        });
+    }
+
+    //------ 単精度(8素子ずつ) ---------//
+    // 8素子分のlegsをfloatで読む
+    inline __m256 loadLegs8(const int *legs)
+    {
+        return _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(legs)));
+    }
+
+    // (up, down)の組を8素子分書き込む
+    inline void storePairs(float *out, __m256 up, __m256 down)
+    {
+        __m256 lo = _mm256_unpacklo_ps(up, down); // u0 d0 u1 d1 | u4 d4 u5 d5
+        __m256 hi = _mm256_unpackhi_ps(up, down); // u2 d2 u3 d3 | u6 d6 u7 d7
+        _mm256_storeu_ps(out, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+
+    void nodeVoltageFloatAVX2(const float *Qn, const float *Vsum, const float *C, const float *Cj, const int *legs,
+                              float *Vn, int first, int last)
+    {
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            __m256 q = _mm256_loadu_ps(Qn + i);
+            __m256 vs = _mm256_loadu_ps(Vsum + i);
+            __m256 c = _mm256_loadu_ps(C + i);
+            __m256 cj = _mm256_loadu_ps(Cj + i);
+            __m256 l = loadLegs8(legs + i);
+            __m256 denom = _mm256_add_ps(_mm256_mul_ps(l, c), cj);
+            __m256 coef = _mm256_div_ps(c, _mm256_mul_ps(cj, denom));
+            __m256 inner = _mm256_sub_ps(_mm256_mul_ps(cj, vs), _mm256_mul_ps(l, q));
+            _mm256_storeu_ps(Vn + i, _mm256_add_ps(_mm256_div_ps(q, cj), _mm256_mul_ps(coef, inner)));
+        }
+        seoKernelsScalar()->nodeVoltageFloat(Qn, Vsum, C, Cj, legs, Vn, i, last);
+    }
+
+    void energyChangeFloatAVX2(const float *Qn, const float *Vsum, const float *C, const float *Cj, const int *legs,
+                               float *dE, int first, int last)
+    {
+        const float q = static_cast<float>(e);
+        const __m256 E = _mm256_set1_ps(q), negE = _mm256_set1_ps(-q), two = _mm256_set1_ps(2.0f);
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            __m256 c = _mm256_loadu_ps(C + i);
+            __m256 charge = _mm256_add_ps(_mm256_loadu_ps(Qn + i), _mm256_mul_ps(c, _mm256_loadu_ps(Vsum + i)));
+            __m256 twice = _mm256_mul_ps(two, charge);
+            __m256 denom =
+                _mm256_mul_ps(two, _mm256_add_ps(_mm256_mul_ps(loadLegs8(legs + i), c), _mm256_loadu_ps(Cj + i)));
+            __m256 up = _mm256_div_ps(_mm256_mul_ps(negE, _mm256_sub_ps(E, twice)), denom);
+            __m256 down = _mm256_div_ps(_mm256_mul_ps(negE, _mm256_add_ps(E, twice)), denom);
+            storePairs(dE + 2 * i, up, down);
+        }
+        seoKernelsScalar()->energyChangeFloat(Qn, Vsum, C, Cj, legs, dE, i, last);
+    }
+
+    WaitTimeMin waitTimeArgminFloatAVX2(const float *dE, const float *Rj, const float *expo, float *wt, int first,
+                                        int last)
+    {
+        const float inf = std::numeric_limits<float>::infinity();
+        const __m256 zero = _mm256_setzero_ps(), infv = _mm256_set1_ps(inf);
+        const __m256 ee = _mm256_set1_ps(static_cast<float>(e) * static_cast<float>(e));
+        __m256 best = infv;
+        __m256i bestIndex = _mm256_set1_epi32(-1);
+        __m256i index = _mm256_add_epi32(_mm256_set1_epi32(first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m256i step = _mm256_set1_epi32(8);
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            // (up, down)の組を向きごとに分ける
+            __m256 a = _mm256_loadu_ps(dE + 2 * i);
+            __m256 b = _mm256_loadu_ps(dE + 2 * i + 8);
+            __m256 t0 = _mm256_permute2f128_ps(a, b, 0x20); // u0 d0 u1 d1 | u4 d4 u5 d5
+            __m256 t1 = _mm256_permute2f128_ps(a, b, 0x31); // u2 d2 u3 d3 | u6 d6 u7 d7
+            __m256 up = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0));
+            __m256 down = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 3, 1));
+
+            __m256 maskUp = _mm256_cmp_ps(up, zero, _CMP_GT_OQ);
+            __m256 maskDown = _mm256_andnot_ps(maskUp, _mm256_cmp_ps(down, zero, _CMP_GT_OQ));
+            __m256 positive = _mm256_or_ps(maskUp, maskDown);
+            __m256 rate = _mm256_blendv_ps(down, up, maskUp);
+            __m256 w = _mm256_mul_ps(_mm256_div_ps(_mm256_mul_ps(ee, _mm256_loadu_ps(Rj + i)), rate),
+                                     _mm256_loadu_ps(expo + i));
+            storePairs(wt + 2 * i, _mm256_and_ps(w, maskUp), _mm256_and_ps(w, maskDown));
+
+            // 対象外の素子は+infにして、レーンごとに最小値と添字を持つ
+            __m256 masked = _mm256_blendv_ps(infv, w, positive);
+            __m256 less = _mm256_cmp_ps(masked, best, _CMP_LT_OQ);
+            best = _mm256_blendv_ps(best, masked, less);
+            bestIndex = _mm256_castps_si256(
+                _mm256_blendv_ps(_mm256_castsi256_ps(bestIndex), _mm256_castsi256_ps(index), less));
+            index = _mm256_add_epi32(index, step);
+        }
+
+        // レーンをまとめる(同じ値なら添字の小さい方)
+        alignas(32) float values[8];
+        alignas(32) int indices[8];
+        _mm256_store_ps(values, best);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(indices), bestIndex);
+        WaitTimeMin result{std::numeric_limits<double>::infinity(), -1};
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            if (indices[lane] < 0)
+                continue;
+            if (values[lane] < result.wt || (values[lane] == result.wt && indices[lane] < result.index))
+            {
+                result.wt = values[lane];
+                result.index = indices[lane];
+            }
+        }
+        // 残りの素子は後ろにあるので、小さいときだけ置き換える
+        WaitTimeMin rest = seoKernelsScalar()->waitTimeArgminFloat(dE, Rj, expo, wt, i, last);
+        if (rest.wt < result.wt)
+            result = rest;
+        return result;
+    }
+
+    void exponentialDrawFloatAVX2(const float *dE, std::uint64_t seed, std::uint64_t streamBase,
+                                  std::uint64_t *counter, float *expo, int first, int last)
+    {
+        exponentialDrawImpl(dE, seed, streamBase, counter, expo, first, last, [&](int i) {
+            seoKernelsScalar()->exponentialDrawFloat(dE, seed, streamBase, counter, expo, i, last);
+        });
+    }
+
+    //------ レプリカの並び(4レプリカずつ、端数はマスクして読み書きする) ---------//
+    // 残りのレプリカ数remainingのうち先頭4個までを有効にするマスク
+    inline __m256i laneMask4(int remaining)
+    {
+        return _mm256_cmpgt_epi64(_mm256_set1_epi64x(remaining), _mm256_setr_epi64x(0, 1, 2, 3));
+    }
+
+    // 4レプリカ分を読む(Fullでなければマスクの外は0)
+    template <bool Full>
+    inline __m256d loadLanes(const double *p, __m256i mask)
+    {
+        return Full ? _mm256_loadu_pd(p) : _mm256_maskload_pd(p, mask);
+    }
+
+    // 4レプリカ分を書き込む(Fullでなければマスクの中だけ)
+    template <bool Full>
+    inline void storeLanes(double *p, __m256i mask, __m256d x)
+    {
+        if (Full)
+            _mm256_storeu_pd(p, x);
+        else
+            _mm256_maskstore_pd(p, mask, x);
+    }
+
+    // 素子iのレプリカr..r+3のVn
+    template <bool Full>
+    inline void laneNodeVoltageBlock(const int *nb, int maxLegs, __m256d vcj, __m256d vcoupling, __m256d vlegs,
+                                     const double *Qn, const double *Vn, const double *Vext, double *Vsum,
+                                     double *VnNext, double *residual, std::size_t base, int K, int r, __m256i mask)
+    {
+        __m256d sum = _mm256_setzero_pd();
+        for (int k = 0; k < maxLegs; ++k)
+        {
+            if (nb[k] >= 0)
+                sum = _mm256_add_pd(sum, loadLanes<Full>(Vn + static_cast<std::size_t>(nb[k]) * K + r, mask));
+        }
+        const std::size_t at = base + r;
+        __m256d vsum = _mm256_add_pd(sum, loadLanes<Full>(Vext + at, mask));
+        __m256d q = loadLanes<Full>(Qn + at, mask);
+        __m256d inner = _mm256_sub_pd(_mm256_mul_pd(vcj, vsum), _mm256_mul_pd(vlegs, q));
+        __m256d vn = _mm256_add_pd(_mm256_div_pd(q, vcj), _mm256_mul_pd(vcoupling, inner));
+        storeLanes<Full>(Vsum + at, mask, vsum);
+        storeLanes<Full>(VnNext + at, mask, vn);
+        __m256d change = _mm256_andnot_pd(_mm256_set1_pd(-0.0), _mm256_sub_pd(vn, loadLanes<Full>(Vn + at, mask)));
+        storeLanes<Full>(residual + r, mask, _mm256_max_pd(change, loadLanes<Full>(residual + r, mask)));
+    }
+
+    void laneNodeVoltageAVX2(const int *neighbours, int maxLegs, const double *C, const double *Cj, const int *legs,
+                             const double *Qn, const double *Vn, const double *Vext, double *Vsum, double *VnNext,
+                             double *residual, int K, int first, int last)
+    {
+        const __m256i tail = laneMask4(K % 4);
+        for (int i = first; i < last; ++i)
+        {
+            const int *nb = neighbours + static_cast<std::size_t>(i) * maxLegs;
+            const double cj = Cj[i], c = C[i], l = legs[i];
+            const __m256d vcj = _mm256_set1_pd(cj), vlegs = _mm256_set1_pd(l);
+            const __m256d vcoupling = _mm256_set1_pd(c / (cj * (l * c + cj)));
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            int r = 0;
+            for (; r + 4 <= K; r += 4)
+                laneNodeVoltageBlock<true>(nb, maxLegs, vcj, vcoupling, vlegs, Qn, Vn, Vext, Vsum, VnNext, residual,
+                                           base, K, r, tail);
+            if (r < K)
+                laneNodeVoltageBlock<false>(nb, maxLegs, vcj, vcoupling, vlegs, Qn, Vn, Vext, Vsum, VnNext, residual,
+                                            base, K, r, tail);
+        }
+    }
+
+    // 素子iのレプリカr..r+3のdE
+    template <bool Full>
+    inline void laneEnergyChangeBlock(__m256d vc, __m256d vdenom, const double *Qn, const double *Vsum, double *dEUp,
+                                      double *dEDown, std::size_t at, __m256i mask)
+    {
+        const __m256d E = _mm256_set1_pd(e), negE = _mm256_set1_pd(-e), two = _mm256_set1_pd(2.0);
+        __m256d vsum = loadLanes<Full>(Vsum + at, mask);
+        __m256d charge = _mm256_add_pd(loadLanes<Full>(Qn + at, mask), _mm256_mul_pd(vc, vsum));
+        __m256d twice = _mm256_mul_pd(two, charge);
+        storeLanes<Full>(dEUp + at, mask, _mm256_div_pd(_mm256_mul_pd(negE, _mm256_sub_pd(E, twice)), vdenom));
+        storeLanes<Full>(dEDown + at, mask, _mm256_div_pd(_mm256_mul_pd(negE, _mm256_add_pd(E, twice)), vdenom));
+    }
+
+    void laneEnergyChangeAVX2(const double *C, const double *Cj, const int *legs, const double *Qn,
+                              const double *Vsum, double *dEUp, double *dEDown, int K, int first, int last)
+    {
+        const __m256i tail = laneMask4(K % 4);
+        for (int i = first; i < last; ++i)
+        {
+            const double c = C[i];
+            const __m256d vc = _mm256_set1_pd(c), vdenom = _mm256_set1_pd(2 * (legs[i] * c + Cj[i]));
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            int r = 0;
+            for (; r + 4 <= K; r += 4)
+                laneEnergyChangeBlock<true>(vc, vdenom, Qn, Vsum, dEUp, dEDown, base + r, tail);
+            if (r < K)
+                laneEnergyChangeBlock<false>(vc, vdenom, Qn, Vsum, dEUp, dEDown, base + r, tail);
+        }
+    }
+
+    // 素子iのレプリカr..r+3の充電
+    template <bool Full>
+    inline void laneChargeEulerBlock(__m256d vr, const double *Vd, const double *Vn, const double *h, double *Qn,
+                                     std::size_t at, int r, __m256i mask)
+    {
+        __m256d diff = _mm256_sub_pd(loadLanes<Full>(Vd + at, mask), loadLanes<Full>(Vn + at, mask));
+        __m256d dq = _mm256_div_pd(_mm256_mul_pd(diff, loadLanes<Full>(h + r, mask)), vr);
+        storeLanes<Full>(Qn + at, mask, _mm256_add_pd(loadLanes<Full>(Qn + at, mask), dq));
+    }
+
+    void laneChargeEulerAVX2(const double *R, const double *Vd, const double *Vn, const double *h, double *Qn, int K,
+                             int first, int last)
+    {
+        const __m256i tail = laneMask4(K % 4);
+        for (int i = first; i < last; ++i)
+        {
+            const __m256d vr = _mm256_set1_pd(R[i]);
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            int r = 0;
+            for (; r + 4 <= K; r += 4)
+                laneChargeEulerBlock<true>(vr, Vd, Vn, h, Qn, base + r, r, tail);
+            if (r < K)
+                laneChargeEulerBlock<false>(vr, Vd, Vn, h, Qn, base + r, r, tail);
+        }
+    }
+
+    const SEOKernelTable avx2Table = {SimdLevel::AVX2,         nodeVoltageAVX2,         energyChangeAVX2,
+                                      waitTimeArgminAVX2,      nodeVoltageClassAVX2,    energyChangeClassAVX2,
+                                      waitTimeArgminClassAVX2, exponentialDrawAVX2,     nodeVoltageFloatAVX2,
+                                      energyChangeFloatAVX2,   waitTimeArgminFloatAVX2, exponentialDrawFloatAVX2,
+                                      laneNodeVoltageAVX2,     laneEnergyChangeAVX2,    laneChargeEulerAVX2};
+}
+
+const SEOKernelTable *seoKernelsAVX2()
+{
+    return &avx2Table;
+}
+
+#else
+
+// AVX2でコンパイルされていない場合は使えない
+const SEOKernelTable *seoKernelsAVX2()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,528 @@
+#include "seo_kernels.hpp"
+#include "seo_class.hpp"
+#include "philox.hpp"
+
+// -mavx512f -ffp-contract=off でコンパイルする(CMakeLists.txt参照)
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#include <limits>
+
+namespace
+{
+    // 8素子分のlegsをdoubleで読む
+    inline __m512d loadLegs(const int *legs)
+    {
+        return _mm512_cvtepi32_pd(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(legs)));
+    }
+
+    // (up, down)の組を8素子分書き込む
+    inline void storePairs(double *out, __m512d up, __m512d down)
+    {
+        const __m512i lo = _mm512_setr_epi64(0, 8, 1, 9, 2, 10, 3, 11);
+        const __m512i hi = _mm512_setr_epi64(4, 12, 5, 13, 6, 14, 7, 15);
+        _mm512_storeu_pd(out, _mm512_permutex2var_pd(up, lo, down));
+        _mm512_storeu_pd(out + 8, _mm512_permutex2var_pd(up, hi, down));
+    }
+
+    void nodeVoltageAVX512(const double *Qn, const double *Vsum, const double *C, const double *Cj, const int *legs,
+                           double *Vn, int first, int last)
+    {
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            __m512d q = _mm512_loadu_pd(Qn + i);
+            __m512d vs = _mm512_loadu_pd(Vsum + i);
+            __m512d c = _mm512_loadu_pd(C + i);
+            __m512d cj = _mm512_loadu_pd(Cj + i);
+            __m512d l = loadLegs(legs + i);
+            __m512d denom = _mm512_add_pd(_mm512_mul_pd(l, c), cj);
+            __m512d coef = _mm512_div_pd(c, _mm512_mul_pd(cj, denom));
+            __m512d inner = _mm512_sub_pd(_mm512_mul_pd(cj, vs), _mm512_mul_pd(l, q));
+            _mm512_storeu_pd(Vn + i, _mm512_add_pd(_mm512_div_pd(q, cj), _mm512_mul_pd(coef, inner)));
+        }
+        seoKernelsScalar()->nodeVoltage(Qn, Vsum, C, Cj, legs, Vn, i, last);
+    }
+
+    void energyChangeAVX512(const double *Qn, const double *Vsum, const double *C, const double *Cj, const int *legs,
+                            double *dE, int first, int last)
+    {
+        const __m512d E = _mm512_set1_pd(e), negE = _mm512_set1_pd(-e), two = _mm512_set1_pd(2.0);
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            __m512d c = _mm512_loadu_pd(C + i);
+            __m512d charge = _mm512_add_pd(_mm512_loadu_pd(Qn + i), _mm512_mul_pd(c, _mm512_loadu_pd(Vsum + i)));
+            __m512d twice = _mm512_mul_pd(two, charge);
+            __m512d denom =
+                _mm512_mul_pd(two, _mm512_add_pd(_mm512_mul_pd(loadLegs(legs + i), c), _mm512_loadu_pd(Cj + i)));
+            __m512d up = _mm512_div_pd(_mm512_mul_pd(negE, _mm512_sub_pd(E, twice)), denom);
+            __m512d down = _mm512_div_pd(_mm512_mul_pd(negE, _mm512_add_pd(E, twice)), denom);
+            storePairs(dE + 2 * i, up, down);
+        }
+        seoKernelsScalar()->energyChange(Qn, Vsum, C, Cj, legs, dE, i, last);
+    }
+
+    // wtの計算と最小値の探索
+    // numerator(i)はi番目からの8素子分のe*e*Rj、tail(i)はi番目以降の残りの素子を調べた結果
+    template <typename Numerator, typename Tail>
+    WaitTimeMin waitTimeArgminImpl(const double *dE, Numerator numerator, const double *expo, double *wt, int first,
+                                   int last, Tail tail)
+    {
+        const double inf = std::numeric_limits<double>::infinity();
+        const __m512d zero = _mm512_setzero_pd();
+        const __m512i evens = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+        const __m512i odds = _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15);
+        __m512d best = _mm512_set1_pd(inf);
+        __m512i bestIndex = _mm512_set1_epi64(-1);
+        __m512i index = _mm512_add_epi64(_mm512_set1_epi64(first), _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m512i step = _mm512_set1_epi64(8);
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            // (up, down)の組を向きごとに分ける
+            __m512d a = _mm512_loadu_pd(dE + 2 * i);
+            __m512d b = _mm512_loadu_pd(dE + 2 * i + 8);
+            __m512d up = _mm512_permutex2var_pd(a, evens, b);
+            __m512d down = _mm512_permutex2var_pd(a, odds, b);
+
+            __mmask8 maskUp = _mm512_cmp_pd_mask(up, zero, _CMP_GT_OQ);
+            __mmask8 maskDown = _mm512_cmp_pd_mask(down, zero, _CMP_GT_OQ) & static_cast<__mmask8>(~maskUp);
+            __mmask8 positive = maskUp | maskDown;
+            __m512d rate = _mm512_mask_blend_pd(maskUp, down, up);
+            __m512d w = _mm512_mul_pd(_mm512_div_pd(numerator(i), rate), _mm512_loadu_pd(expo + i));
+            storePairs(wt + 2 * i, _mm512_maskz_mov_pd(maskUp, w), _mm512_maskz_mov_pd(maskDown, w));
+
+            // 対象の素子だけ比べて、レーンごとに最小値と添字を持つ
+            __mmask8 less = _mm512_mask_cmp_pd_mask(positive, w, best, _CMP_LT_OQ);
+            best = _mm512_mask_mov_pd(best, less, w);
+            bestIndex = _mm512_mask_mov_epi64(bestIndex, less, index);
+            index = _mm512_add_epi64(index, step);
+        }
+
+        // レーンをまとめる(同じ値なら添字の小さい方)
+        alignas(64) double values[8];
+        alignas(64) long long indices[8];
+        _mm512_store_pd(values, best);
+        _mm512_store_si512(indices, bestIndex);
+        WaitTimeMin result{inf, -1};
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            if (indices[lane] < 0)
+                continue;
+            const int idx = static_cast<int>(indices[lane]);
+            if (values[lane] < result.wt || (values[lane] == result.wt && idx < result.index))
+            {
+                result.wt = values[lane];
+                result.index = idx;
+            }
+        }
+        // 残りの素子は後ろにあるので、小さいときだけ置き換える
+        WaitTimeMin rest = tail(i);
+        if (rest.wt < result.wt)
+            result = rest;
+        return result;
+    }
+
+    WaitTimeMin waitTimeArgminAVX512(const double *dE, const double *Rj, const double *expo, double *wt, int first,
+                                     int last)
+    {
+        const __m512d ee = _mm512_set1_pd(e * e);
+        return waitTimeArgminImpl(
+            dE, [&](int i) { return _mm512_mul_pd(ee, _mm512_loadu_pd(Rj + i)); }, expo, wt, first, last,
+            [&](int i) { return seoKernelsScalar()->waitTimeArgmin(dE, Rj, expo, wt, i, last); });
+    }
+
+    // 8素子分のクラス番号で係数の表を引く
+    inline __m512d gatherClass(const double *table, const std::uint16_t *cls)
+    {
+        __m256i idx = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cls)));
+        return _mm512_i32gather_pd(idx, table, 8);
+    }
+
+    void nodeVoltageClassAVX512(const double *Qn, const double *Vsum, const std::uint16_t *cls,
+                                const SEOClassCoefficients &k, double *Vn, int first, int last)
+    {
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            __m512d charge = _mm512_add_pd(_mm512_loadu_pd(Qn + i),
+                                           _mm512_mul_pd(gatherClass(k.C, cls + i), _mm512_loadu_pd(Vsum + i)));
+            _mm512_storeu_pd(Vn + i, _mm512_mul_pd(charge, gatherClass(k.invCtot, cls + i)));
+        }
+        seoKernelsScalar()->nodeVoltageClass(Qn, Vsum, cls, k, Vn, i, last);
+    }
+
+    void energyChangeClassAVX512(const double *Qn, const double *Vsum, const std::uint16_t *cls,
+                                 const SEOClassCoefficients &k, double *dE, int first, int last)
+    {
+        const __m512i sign = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ULL));
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            __m512d charge = _mm512_add_pd(_mm512_loadu_pd(Qn + i),
+                                           _mm512_mul_pd(gatherClass(k.C, cls + i), _mm512_loadu_pd(Vsum + i)));
+            __m512d a = _mm512_mul_pd(charge, gatherClass(k.eOverCtot, cls + i));
+            __m512d b = gatherClass(k.halfE2OverCtot, cls + i);
+            // 符号ビットを反転して-aにする(AVX-512Fにはxor_pdが無いので整数で)
+            __m512d negA = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), sign));
+            storePairs(dE + 2 * i, _mm512_sub_pd(a, b), _mm512_sub_pd(negA, b));
+        }
+        seoKernelsScalar()->energyChangeClass(Qn, Vsum, cls, k, dE, i, last);
+    }
+
+    WaitTimeMin waitTimeArgminClassAVX512(const double *dE, const std::uint16_t *cls, const SEOClassCoefficients &k,
+                                          const double *expo, double *wt, int first, int last)
+    {
+        return waitTimeArgminImpl(
+            dE, [&](int i) { return gatherClass(k.e2Rj, cls + i); }, expo, wt, first, last,
+            [&](int i) { return seoKernelsScalar()->waitTimeArgminClass(dE, cls, k, expo, wt, i, last); });
+    }
+
+    // 8素子分のPhilox4x32-10(AVX2版と同じ。レーンごとにカウンタの4語c0..c3を下位32bitに持つ)
+    inline __m512i philoxBits8(__m512i c0, __m512i c1, __m512i c2, __m512i c3, std::uint64_t seed)
+    {
+        const __m512i m0 = _mm512_set1_epi64(Philox4x32::M0), m1 = _mm512_set1_epi64(Philox4x32::M1);
+        const __m512i low = _mm512_set1_epi64(0xffffffffLL);
+        std::uint32_t k0 = static_cast<std::uint32_t>(seed), k1 = static_cast<std::uint32_t>(seed >> 32);
+        for (int r = 0; r < Philox4x32::rounds; ++r)
+        {
+            if (r > 0)
+            {
+                k0 += Philox4x32::W0;
+                k1 += Philox4x32::W1;
+            }
+            const __m512i p0 = _mm512_mul_epu32(m0, c0);
+            const __m512i p1 = _mm512_mul_epu32(m1, c2);
+            c0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), c1), _mm512_set1_epi64(k0));
+            c1 = p1;
+            c2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), c3), _mm512_set1_epi64(k1));
+            c3 = p0;
+        }
+        return _mm512_or_si512(_mm512_slli_epi64(_mm512_and_si512(c0, low), 32), _mm512_and_si512(c1, low));
+    }
+
+    // 0 <= x < 2^32 の整数をdoubleにする
+    inline __m512d toDouble32(__m512i x)
+    {
+        const __m512i magic = _mm512_set1_epi64(0x4330000000000000LL);
+        return _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(x, magic)), _mm512_set1_pd(0x1.0p52));
+    }
+
+    // philoxUniformと同じ (bits>>11 + 1) * 2^-53
+    inline __m512d uniform8(__m512i bits)
+    {
+        const __m512i v = _mm512_add_epi64(_mm512_srli_epi64(bits, 11), _mm512_set1_epi64(1));
+        const __m512d hi = toDouble32(_mm512_srli_epi64(v, 32));
+        const __m512d lo = toDouble32(_mm512_and_si512(v, _mm512_set1_epi64(0xffffffffLL)));
+        return _mm512_mul_pd(_mm512_add_pd(_mm512_mul_pd(hi, _mm512_set1_pd(0x1.0p32)), lo), _mm512_set1_pd(0x1.0p-53));
+    }
+
+    // -log(u)(スカラー版のnegativeLogと同じ計算順)
+    inline __m512d negativeLog8(__m512d u)
+    {
+        using namespace seo_log;
+        const __m512i bits = _mm512_castpd_si512(u);
+        __m512i k = _mm512_sub_epi64(_mm512_srli_epi64(bits, 52), _mm512_set1_epi64(1023));
+        __m512i mantissa = _mm512_and_si512(bits, _mm512_set1_epi64(0x000fffffffffffffLL));
+        const __mmask8 big = _mm512_cmpgt_epu64_mask(mantissa, _mm512_set1_epi64(sqrt2Mantissa));
+        mantissa = _mm512_or_si512(mantissa, _mm512_mask_blend_epi64(big, _mm512_set1_epi64(0x3ff0000000000000LL),
+                                                                     _mm512_set1_epi64(0x3fe0000000000000LL)));
+        k = _mm512_mask_add_epi64(k, big, k, _mm512_set1_epi64(1));
+        const __m512d dk = _mm512_sub_pd(
+            _mm512_castsi512_pd(_mm512_add_epi64(k, _mm512_set1_epi64(0x4338000000000000LL))),
+            _mm512_set1_pd(0x1.8p52));
+        const __m512d f = _mm512_sub_pd(_mm512_castsi512_pd(mantissa), _mm512_set1_pd(1.0));
+        const __m512d s = _mm512_div_pd(f, _mm512_add_pd(_mm512_set1_pd(2.0), f));
+        const __m512d z = _mm512_mul_pd(s, s);
+        const __m512d w = _mm512_mul_pd(z, z);
+        auto c = [](double v) { return _mm512_set1_pd(v); };
+        __m512d p1 = _mm512_add_pd(c(Lg4), _mm512_mul_pd(w, c(Lg6)));
+        p1 = _mm512_add_pd(c(Lg2), _mm512_mul_pd(w, p1));
+        const __m512d t1 = _mm512_mul_pd(w, p1);
+        __m512d p2 = _mm512_add_pd(c(Lg5), _mm512_mul_pd(w, c(Lg7)));
+        p2 = _mm512_add_pd(c(Lg3), _mm512_mul_pd(w, p2));
+        p2 = _mm512_add_pd(c(Lg1), _mm512_mul_pd(w, p2));
+        const __m512d t2 = _mm512_mul_pd(z, p2);
+        const __m512d r = _mm512_add_pd(t2, t1);
+        const __m512d hfsq = _mm512_mul_pd(_mm512_mul_pd(c(0.5), f), f);
+        const __m512d inner = _mm512_add_pd(_mm512_mul_pd(s, _mm512_add_pd(hfsq, r)), _mm512_mul_pd(dk, c(ln2Lo)));
+        const __m512d logu =
+            _mm512_sub_pd(_mm512_mul_pd(dk, c(ln2Hi)), _mm512_sub_pd(_mm512_sub_pd(hfsq, inner), f));
+        return _mm512_sub_pd(_mm512_setzero_pd(), logu);
+    }
+
+    // 8素子分の値をdoubleで読み、マスクした素子だけ書き込む(floatの配列は広げて読み、丸めて書く)
+    inline __m512d load8(const double *p) { return _mm512_loadu_pd(p); }
+    inline __m512d load8(const float *p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+    inline void maskStore8(double *p, __mmask8 m, __m512d x) { _mm512_mask_storeu_pd(p, m, x); }
+    inline void maskStore8(float *p, __mmask8 m, __m512d x)
+    {
+        _mm256_storeu_ps(p, _mm512_cvtpd_ps(_mm512_mask_mov_pd(load8(p), m, x)));
+    }
+
+    // 乱数は常にdoubleで作り、Value(doubleかfloat)の配列に書き込む。tail(i)はi番目以降の残りの素子を引く
+    template <typename Value, typename Tail>
+    void exponentialDrawImpl(const Value *dE, std::uint64_t seed, std::uint64_t streamBase, std::uint64_t *counter,
+                             Value *expo, int first, int last, Tail tail)
+    {
+        const __m512d zero = _mm512_setzero_pd();
+        const __m512i evens = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+        const __m512i odds = _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15);
+        const __m512i low = _mm512_set1_epi64(0xffffffffLL), lanes = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+        int i = first;
+        for (; i + 8 <= last; i += 8)
+        {
+            __m512d a = load8(dE + 2 * i);
+            __m512d b = load8(dE + 2 * i + 8);
+            __mmask8 positive = _mm512_cmp_pd_mask(_mm512_permutex2var_pd(a, evens, b), zero, _CMP_GT_OQ) |
+                                _mm512_cmp_pd_mask(_mm512_permutex2var_pd(a, odds, b), zero, _CMP_GT_OQ);
+            if (positive == 0)
+                continue;
+            // カウンタ = (抽選回数の下位, 上位, 乱数列の番号(streamBase + 素子の添字), 0)
+            __m512i count = _mm512_loadu_si512(counter + i);
+            __m512i stream = _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>(streamBase + i)), lanes);
+            __m512d x = negativeLog8(uniform8(philoxBits8(_mm512_and_si512(count, low), _mm512_srli_epi64(count, 32),
+                                                          stream, _mm512_setzero_si512(), seed)));
+            maskStore8(expo + i, positive, x);
+            _mm512_storeu_si512(counter + i, _mm512_mask_add_epi64(count, positive, count, _mm512_set1_epi64(1)));
+        }
+        tail(i);
+    }
+
+    void exponentialDrawAVX512(const double *dE, std::uint64_t seed, std::uint64_t streamBase, std::uint64_t *counter,
+                               double *expo, int first, int last)
+    {
+        exponentialDrawImpl(dE, seed, streamBase, counter, expo, first, last, [&](int i) {
+            seoKernelsScalar()->exponentialDraw(dE, seed, streamBase, counter, expo, i, last);
+        });
+    }
+
+    //------ 単精度(16素子ずつ) ---------//
+    // 16素子分のlegsをfloatで読む
+    inline __m512 loadLegs16(const int *legs)
+    {
+        return _mm512_cvtepi32_ps(_mm512_loadu_si512(legs));
+    }
+
+    // (up, down)の組を16素子分書き込む
+    inline void storePairs(float *out, __m512 up, __m512 down)
+    {
+        const __m512i lo = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        const __m512i hi = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        _mm512_storeu_ps(out, _mm512_permutex2var_ps(up, lo, down));
+        _mm512_storeu_ps(out + 16, _mm512_permutex2var_ps(up, hi, down));
+    }
+
+    void nodeVoltageFloatAVX512(const float *Qn, const float *Vsum, const float *C, const float *Cj, const int *legs,
+                                float *Vn, int first, int last)
+    {
+        int i = first;
+        for (; i + 16 <= last; i += 16)
+        {
+            __m512 q = _mm512_loadu_ps(Qn + i);
+            __m512 vs = _mm512_loadu_ps(Vsum + i);
+            __m512 c = _mm512_loadu_ps(C + i);
+            __m512 cj = _mm512_loadu_ps(Cj + i);
+            __m512 l = loadLegs16(legs + i);
+            __m512 denom = _mm512_add_ps(_mm512_mul_ps(l, c), cj);
+            __m512 coef = _mm512_div_ps(c, _mm512_mul_ps(cj, denom));
+            __m512 inner = _mm512_sub_ps(_mm512_mul_ps(cj, vs), _mm512_mul_ps(l, q));
+            _mm512_storeu_ps(Vn + i, _mm512_add_ps(_mm512_div_ps(q, cj), _mm512_mul_ps(coef, inner)));
+        }
+        seoKernelsScalar()->nodeVoltageFloat(Qn, Vsum, C, Cj, legs, Vn, i, last);
+    }
+
+    void energyChangeFloatAVX512(const float *Qn, const float *Vsum, const float *C, const float *Cj, const int *legs,
+                                 float *dE, int first, int last)
+    {
+        const float q = static_cast<float>(e);
+        const __m512 E = _mm512_set1_ps(q), negE = _mm512_set1_ps(-q), two = _mm512_set1_ps(2.0f);
+        int i = first;
+        for (; i + 16 <= last; i += 16)
+        {
+            __m512 c = _mm512_loadu_ps(C + i);
+            __m512 charge = _mm512_add_ps(_mm512_loadu_ps(Qn + i), _mm512_mul_ps(c, _mm512_loadu_ps(Vsum + i)));
+            __m512 twice = _mm512_mul_ps(two, charge);
+            __m512 denom =
+                _mm512_mul_ps(two, _mm512_add_ps(_mm512_mul_ps(loadLegs16(legs + i), c), _mm512_loadu_ps(Cj + i)));
+            __m512 up = _mm512_div_ps(_mm512_mul_ps(negE, _mm512_sub_ps(E, twice)), denom);
+            __m512 down = _mm512_div_ps(_mm512_mul_ps(negE, _mm512_add_ps(E, twice)), denom);
+            storePairs(dE + 2 * i, up, down);
+        }
+        seoKernelsScalar()->energyChangeFloat(Qn, Vsum, C, Cj, legs, dE, i, last);
+    }
+
+    WaitTimeMin waitTimeArgminFloatAVX512(const float *dE, const float *Rj, const float *expo, float *wt, int first,
+                                          int last)
+    {
+        const __m512 zero = _mm512_setzero_ps();
+        const __m512 ee = _mm512_set1_ps(static_cast<float>(e) * static_cast<float>(e));
+        const __m512i evens = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+        const __m512i odds = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+        __m512 best = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+        __m512i bestIndex = _mm512_set1_epi32(-1);
+        __m512i index = _mm512_add_epi32(_mm512_set1_epi32(first),
+                                         _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+        const __m512i step = _mm512_set1_epi32(16);
+        int i = first;
+        for (; i + 16 <= last; i += 16)
+        {
+            // (up, down)の組を向きごとに分ける
+            __m512 a = _mm512_loadu_ps(dE + 2 * i);
+            __m512 b = _mm512_loadu_ps(dE + 2 * i + 16);
+            __m512 up = _mm512_permutex2var_ps(a, evens, b);
+            __m512 down = _mm512_permutex2var_ps(a, odds, b);
+
+            __mmask16 maskUp = _mm512_cmp_ps_mask(up, zero, _CMP_GT_OQ);
+            __mmask16 maskDown = _mm512_cmp_ps_mask(down, zero, _CMP_GT_OQ) & static_cast<__mmask16>(~maskUp);
+            __mmask16 positive = maskUp | maskDown;
+            __m512 rate = _mm512_mask_blend_ps(maskUp, down, up);
+            __m512 w = _mm512_mul_ps(_mm512_div_ps(_mm512_mul_ps(ee, _mm512_loadu_ps(Rj + i)), rate),
+                                     _mm512_loadu_ps(expo + i));
+            storePairs(wt + 2 * i, _mm512_maskz_mov_ps(maskUp, w), _mm512_maskz_mov_ps(maskDown, w));
+
+            // 対象の素子だけ比べて、レーンごとに最小値と添字を持つ
+            __mmask16 less = _mm512_mask_cmp_ps_mask(positive, w, best, _CMP_LT_OQ);
+            best = _mm512_mask_mov_ps(best, less, w);
+            bestIndex = _mm512_mask_mov_epi32(bestIndex, less, index);
+            index = _mm512_add_epi32(index, step);
+        }
+
+        // レーンをまとめる(同じ値なら添字の小さい方)
+        alignas(64) float values[16];
+        alignas(64) int indices[16];
+        _mm512_store_ps(values, best);
+        _mm512_store_si512(indices, bestIndex);
+        WaitTimeMin result{std::numeric_limits<double>::infinity(), -1};
+        for (int lane = 0; lane < 16; ++lane)
+        {
+            if (indices[lane] < 0)
+                continue;
+            if (values[lane] < result.wt || (values[lane] == result.wt && indices[lane] < result.index))
+            {
+                result.wt = values[lane];
+                result.index = indices[lane];
+            }
+        }
+        // 残りの素子は後ろにあるので、小さいときだけ置き換える
+        WaitTimeMin rest = seoKernelsScalar()->waitTimeArgminFloat(dE, Rj, expo, wt, i, last);
+        if (rest.wt < result.wt)
+            result = rest;
+        return result;
+    }
+
+    void exponentialDrawFloatAVX512(const float *dE, std::uint64_t seed, std::uint64_t streamBase,
+                                    std::uint64_t *counter, float *expo, int first, int last)
+    {
+        exponentialDrawImpl(dE, seed, streamBase, counter, expo, first, last, [&](int i) {
+            seoKernelsScalar()->exponentialDrawFloat(dE, seed, streamBase, counter, expo, i, last);
+        });
+    }
+
+    //------ レプリカの並び(8レプリカずつ、端数はマスクして読み書きする) ---------//
+    // 残りのレプリカ数remainingのうち先頭8個までを有効にするマスク
+    inline __mmask8 laneMask8(int remaining)
+    {
+        return remaining >= 8 ? static_cast<__mmask8>(0xff) : static_cast<__mmask8>((1u << remaining) - 1);
+    }
+
+    inline __m512d loadLanes(const double *p, __mmask8 m) { return _mm512_maskz_loadu_pd(m, p); }
+
+    void laneNodeVoltageAVX512(const int *neighbours, int maxLegs, const double *C, const double *Cj,
+                               const int *legs, const double *Qn, const double *Vn, const double *Vext, double *Vsum,
+                               double *VnNext, double *residual, int K, int first, int last)
+    {
+        // AVX-512Fだけで使える整数のandで符号を落とす
+        const __m512i magnitude = _mm512_set1_epi64(0x7fffffffffffffffLL);
+        for (int i = first; i < last; ++i)
+        {
+            const int *nb = neighbours + static_cast<std::size_t>(i) * maxLegs;
+            const double cj = Cj[i], c = C[i], l = legs[i];
+            const __m512d vcj = _mm512_set1_pd(cj), vlegs = _mm512_set1_pd(l);
+            const __m512d vcoupling = _mm512_set1_pd(c / (cj * (l * c + cj)));
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            for (int r = 0; r < K; r += 8)
+            {
+                const __mmask8 m = laneMask8(K - r);
+                __m512d sum = _mm512_setzero_pd();
+                for (int k = 0; k < maxLegs; ++k)
+                {
+                    if (nb[k] >= 0)
+                        sum = _mm512_add_pd(sum, loadLanes(Vn + static_cast<std::size_t>(nb[k]) * K + r, m));
+                }
+                const std::size_t at = base + r;
+                __m512d vsum = _mm512_add_pd(sum, loadLanes(Vext + at, m));
+                __m512d q = loadLanes(Qn + at, m);
+                __m512d inner = _mm512_sub_pd(_mm512_mul_pd(vcj, vsum), _mm512_mul_pd(vlegs, q));
+                __m512d vn = _mm512_add_pd(_mm512_div_pd(q, vcj), _mm512_mul_pd(vcoupling, inner));
+                _mm512_mask_storeu_pd(Vsum + at, m, vsum);
+                _mm512_mask_storeu_pd(VnNext + at, m, vn);
+                __m512d change = _mm512_castsi512_pd(
+                    _mm512_and_si512(_mm512_castpd_si512(_mm512_sub_pd(vn, loadLanes(Vn + at, m))), magnitude));
+                _mm512_mask_storeu_pd(residual + r, m, _mm512_max_pd(change, loadLanes(residual + r, m)));
+            }
+        }
+    }
+
+    void laneEnergyChangeAVX512(const double *C, const double *Cj, const int *legs, const double *Qn,
+                                const double *Vsum, double *dEUp, double *dEDown, int K, int first, int last)
+    {
+        const __m512d E = _mm512_set1_pd(e), negE = _mm512_set1_pd(-e), two = _mm512_set1_pd(2.0);
+        for (int i = first; i < last; ++i)
+        {
+            const double c = C[i];
+            const __m512d vc = _mm512_set1_pd(c), vdenom = _mm512_set1_pd(2 * (legs[i] * c + Cj[i]));
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            for (int r = 0; r < K; r += 8)
+            {
+                const __mmask8 m = laneMask8(K - r);
+                const std::size_t at = base + r;
+                __m512d charge = _mm512_add_pd(loadLanes(Qn + at, m), _mm512_mul_pd(vc, loadLanes(Vsum + at, m)));
+                __m512d twice = _mm512_mul_pd(two, charge);
+                __m512d up = _mm512_div_pd(_mm512_mul_pd(negE, _mm512_sub_pd(E, twice)), vdenom);
+                __m512d down = _mm512_div_pd(_mm512_mul_pd(negE, _mm512_add_pd(E, twice)), vdenom);
+                _mm512_mask_storeu_pd(dEUp + at, m, up);
+                _mm512_mask_storeu_pd(dEDown + at, m, down);
+            }
+        }
+    }
+
+    void laneChargeEulerAVX512(const double *R, const double *Vd, const double *Vn, const double *h, double *Qn, int K,
+                               int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            const __m512d vr = _mm512_set1_pd(R[i]);
+            const std::size_t base = static_cast<std::size_t>(i) * K;
+            for (int r = 0; r < K; r += 8)
+            {
+                const __mmask8 m = laneMask8(K - r);
+                const std::size_t at = base + r;
+                __m512d diff = _mm512_sub_pd(loadLanes(Vd + at, m), loadLanes(Vn + at, m));
+                __m512d dq = _mm512_div_pd(_mm512_mul_pd(diff, loadLanes(h + r, m)), vr);
+                _mm512_mask_storeu_pd(Qn + at, m, _mm512_add_pd(loadLanes(Qn + at, m), dq));
+            }
+        }
+    }
+
+    const SEOKernelTable avx512Table = {SimdLevel::AVX512,         nodeVoltageAVX512,         energyChangeAVX512,
+                                        waitTimeArgminAVX512,      nodeVoltageClassAVX512,    energyChangeClassAVX512,
+                                        waitTimeArgminClassAVX512, exponentialDrawAVX512,     nodeVoltageFloatAVX512,
+                                        energyChangeFloatAVX512,   waitTimeArgminFloatAVX512, exponentialDrawFloatAVX512,
+                                        laneNodeVoltageAVX512,     laneEnergyChangeAVX512,    laneChargeEulerAVX512};
+}
+
+const SEOKernelTable *seoKernelsAVX512()
+{
+    return &avx512Table;
+}
+
+#else
+
+// AVX-512でコンパイルされていない場合は使えない
+const SEOKernelTable *seoKernelsAVX512()
+{
+    return nullptr;
+}
+
+#endif
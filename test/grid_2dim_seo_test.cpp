@@ -62,3 +62,63 @@ TEST(Grid2DSEOTest, TunnelCalc) {
     EXPECT_GT(seo->getWT()["up"], 0.0);
     EXPECT_DOUBLE_EQ(seo->getWT()["down"], 0.0);
 }
+
+// relaxのテスト用に、横一列につないだgridを作る
+static Grid2D<SEO> makeChain(int n) {
+    Grid2D<SEO> grid(1, n);
+    for (int j = 0; j < n; ++j) {
+        auto seo = grid.getElement(0, j);
+        seo->setUp(0.5, 0.002, 10.0, 2.0, 0.004, 2);
+        seo->setQ(0.01 * (j + 1));
+        std::vector<std::shared_ptr<SEO>> connections;
+        if (j > 0) connections.push_back(grid.getElement(0, j - 1));
+        if (j < n - 1) connections.push_back(grid.getElement(0, j + 1));
+        seo->setConnections(connections);
+    }
+    return grid;
+}
+
+// デフォルト設定のrelaxは従来のJacobi法5回と同じ結果になる
+TEST(Grid2DSEOTest, RelaxDefaultMatchesJacobiLoop) {
+    auto a = makeChain(6);
+    auto b = makeChain(6);
+    RelaxationStats stats = a.relax(RelaxationConfig());
+    for (int i = 0; i < 5; ++i) {
+        b.updateGridSurVn();
+        b.updateGridVn();
+    }
+    EXPECT_EQ(stats.iterations, 5);
+    for (int j = 0; j < 6; ++j)
+        EXPECT_DOUBLE_EQ(a.getElement(0, j)->getVn(), b.getElement(0, j)->getVn());
+}
+
+// 赤黒SORは許容誤差で打ち切られ、収束した値に近づく
+TEST(Grid2DSEOTest, RelaxRedBlackSORConverges) {
+    auto a = makeChain(6);
+    auto ref = makeChain(6);
+    RelaxationConfig config;
+    config.method = RelaxationMethod::RedBlackSOR;
+    config.maxIterations = 100;
+    config.tolerance = 1e-12;
+    config.omega = 1.1;
+    RelaxationStats stats = a.relax(config);
+    EXPECT_LT(stats.iterations, 100);
+    EXPECT_LE(stats.residual, 1e-12);
+
+    for (int i = 0; i < 200; ++i) {
+        ref.updateGridSurVn();
+        ref.updateGridVn();
+    }
+    for (int j = 0; j < 6; ++j)
+        EXPECT_NEAR(a.getElement(0, j)->getVn(), ref.getElement(0, j)->getVn(), 1e-10);
+}
+
+// 直接法はGrid2D<FlatSEO>専用
+TEST(Grid2DSEOTest, RelaxDirectIsNotSupported) {
+    auto grid = makeChain(3);
+    RelaxationConfig config;
+    config.method = RelaxationMethod::Direct;
+    EXPECT_THROW(grid.relax(config), std::invalid_argument);
+    config.method = RelaxationMethod::Multigrid;
+    EXPECT_THROW(grid.relax(config), std::invalid_argument);
+}
@@ -0,0 +1,142 @@
+#include "gtest/gtest.h"
+#include "approx_domain_simulation_2d.hpp"
+#include "test_lattices.hpp"
+
+using test_lattices::makeOscillatingGrid;
+using test_lattices::charges;
+
+// 通常のエンジンと同じくらいの頻度でトンネルし、1つの窓で複数の領域がトンネルすること
+TEST(ApproxDomainSimulation2DTest, MatchesExactTunnelStatistics)
+{
+    const double endtime = 100.0;
+    Simulation2D<FlatSEO> exact(0.1, endtime);
+    exact.setSeed(1);
+    exact.appendGrid(makeOscillatingGrid(20, 20));
+    exact.run();
+
+    ApproxDomainSimulation2D<FlatSEO> split(0.1, endtime, 4);
+    split.setSeed(1);
+    split.appendGrid(makeOscillatingGrid(20, 20));
+    split.run();
+
+    ASSERT_GT(exact.getTunnelCount(), 1000);
+    EXPECT_NEAR(static_cast<double>(split.getTunnelCount()) / exact.getTunnelCount(), 1.0, 0.1);
+    EXPECT_GT(split.getMaxTunnelsPerWindow(), 1);
+    // 窓はdtごとなので、トンネルのたびに止まる通常のエンジンよりずっと少ない
+    EXPECT_LE(split.getWindowCount(), static_cast<long long>(endtime / 0.1) + 1);
+}
+
+// 領域数・同期の間隔を変えても、トンネル頻度が通常のエンジンから大きくずれないこと
+// のり代の行でのトンネルは領域が1つなら起きず、分けると起きる(近似になるのはこのイベント)
+TEST(ApproxDomainSimulation2DTest, StatisticsAcrossDomainsAndSyncIntervals)
+{
+    const double endtime = 100.0;
+    Simulation2D<FlatSEO> exact(0.1, endtime);
+    exact.setSeed(1);
+    exact.appendGrid(makeOscillatingGrid(20, 20));
+    exact.run();
+    ASSERT_GT(exact.getTunnelCount(), 1000);
+
+    for (int domains : {1, 2, 8})
+    {
+        for (double interval : {0.1, 0.3})
+        {
+            ApproxDomainSimulation2D<FlatSEO> split(0.1, endtime, domains);
+            split.setSyncInterval(interval);
+            split.setSeed(1);
+            split.appendGrid(makeOscillatingGrid(20, 20));
+            split.run();
+            SCOPED_TRACE(testing::Message() << "domains " << domains << ", syncInterval " << interval);
+            EXPECT_NEAR(static_cast<double>(split.getTunnelCount()) / exact.getTunnelCount(), 1.0, 0.08);
+            if (domains == 1)
+                EXPECT_EQ(split.getHaloTunnelCount(), 0);
+            else
+                EXPECT_GT(split.getHaloTunnelCount(), 0);
+            EXPECT_LT(split.getHaloTunnelCount(), split.getTunnelCount());
+        }
+    }
+}
+
+// 同じシード・同じ領域数なら、スレッド数によらず同じ経過になること
+TEST(ApproxDomainSimulation2DTest, ThreadIndependent)
+{
+    std::vector<std::vector<double>> finalQ;
+    std::vector<long long> tunnels;
+    for (int threads : {1, 3})
+    {
+        ApproxDomainSimulation2D<FlatSEO> sim(0.1, 30.0, 5);
+        sim.setThreadCount(threads);
+        sim.setSeed(11);
+        sim.appendGrid(makeOscillatingGrid(12, 12));
+        sim.appendGrid(makeOscillatingGrid(3, 3));
+        sim.run();
+        std::vector<double> q;
+        for (auto &grid : sim.getGrids())
+        {
+            const auto part = charges(grid);
+            q.insert(q.end(), part.begin(), part.end());
+        }
+        finalQ.push_back(q);
+        tunnels.push_back(sim.getTunnelCount());
+    }
+    EXPECT_GT(tunnels[0], 0);
+    EXPECT_EQ(tunnels[0], tunnels[1]);
+    EXPECT_EQ(finalQ[0], finalQ[1]);
+}
+
+// 1反復の緩和・トンネル無しなら、のり代を通した結合は分けない場合と同じ時間発展になること
+TEST(ApproxDomainSimulation2DTest, HaloReproducesGlobalCoupling)
+{
+    RelaxationConfig config;
+    config.maxIterations = 1;
+    auto makeQuietGrid = [] {
+        Grid2D<FlatSEO> grid(8, 5, false);
+        for (int i = 0; i < grid.numCells(); ++i)
+            grid.getElement(i / 5, i % 5)->setUp(0.5, 0.002, 10.0, 2.0, 0.001 * (i % 3));
+        // 領域の境目(3行目と4行目の間)に電荷を置く
+        grid.getElement(3, 2)->setQ(0.05);
+        return grid;
+    };
+    Simulation2D<FlatSEO> whole(0.1, 2.0);
+    whole.setRelaxation(config);
+    Grid2D<FlatSEO> &reference = whole.appendGrid(makeQuietGrid());
+    ApproxDomainSimulation2D<FlatSEO> split(0.1, 2.0, 2);
+    split.setRelaxation(config);
+    Grid2D<FlatSEO> &grid = split.appendGrid(makeQuietGrid());
+    for (int step = 0; step < 10; ++step)
+    {
+        whole.runStep();
+        split.runStep();
+    }
+    ASSERT_EQ(whole.getTunnelCount(), 0);
+    ASSERT_EQ(split.getTunnelCount(), 0);
+    EXPECT_DOUBLE_EQ(split.getTime(), whole.getTime());
+    EXPECT_NE(grid.getElement(4, 2)->getVn(), 0.0);
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 5; ++x)
+        {
+            EXPECT_NEAR(grid.getElement(y, x)->getVn(), reference.getElement(y, x)->getVn(), 1e-12);
+            EXPECT_NEAR(grid.getElement(y, x)->getQ(), reference.getElement(y, x)->getQ(), 1e-12);
+        }
+}
+
+// 領域数・同期の間隔の設定
+TEST(ApproxDomainSimulation2DTest, ConfigurationValidation)
+{
+    EXPECT_THROW(ApproxDomainSimulation2D<FlatSEO>(0.1, 1.0, 0), std::invalid_argument);
+    ApproxDomainSimulation2D<FlatSEO> sim(0.1, 1.0);
+    EXPECT_EQ(sim.getDomainCount(), 4);
+    EXPECT_DOUBLE_EQ(sim.getSyncInterval(), 0.1);
+    EXPECT_THROW(sim.setSyncInterval(0.0), std::invalid_argument);
+    sim.setSyncInterval(0.3);
+    EXPECT_DOUBLE_EQ(sim.getSyncInterval(), 0.3);
+    sim.setDomainCount(2);
+    sim.appendGrid(makeOscillatingGrid(4, 4));
+    sim.runStep();
+    EXPECT_THROW(sim.setDomainCount(3), std::logic_error);
+
+    ApproxDomainSimulation2D<FlatSEO> incremental(0.1, 1.0);
+    Grid2D<FlatSEO> &grid = incremental.appendGrid(makeOscillatingGrid(4, 4));
+    grid.setIncrementalUpdate(true);
+    EXPECT_THROW(incremental.runStep(), std::logic_error);
+}
@@ -0,0 +1,180 @@
+#include "gtest/gtest.h"
+#include "charge_integration.hpp"
+#include "test_lattices.hpp"
+#include "simulation_2d.hpp"
+
+// 孤立した素子の充電がRC回路の解析解と一致し、刻みを細かくしても結果が変わらないこと
+TEST(ChargeIntegrationTest, IsolatedCellMatchesClosedForm)
+{
+    const double ctot = 4 * 2.0 + 10.0, tau = 0.5 * ctot, vd = 0.004, T = 3.0;
+    SEO whole(0.5, 0.002, 10.0, 2.0, vd, 4), split(0.5, 0.002, 10.0, 2.0, vd, 4);
+    whole.setPcalc();
+    whole.setNodeChargeExponential(T);
+    for (int k = 0; k < 10; ++k)
+    {
+        split.setPcalc();
+        split.setNodeChargeExponential(T / 10);
+    }
+    const double exact = ctot * vd * -std::expm1(-T / tau);
+    EXPECT_NEAR(whole.getQ(), exact, 1e-15);
+    EXPECT_NEAR(split.getQ(), exact, 1e-15);
+    // 時定数より十分短い刻みではEuler法と一致する
+    EXPECT_NEAR(exponentialChargeIncrement(vd, 0.001, 0.5, ctot, 1e-6), (vd - 0.001) * 1e-6 / 0.5, 1e-15);
+}
+
+// 予測した時間だけ充電すると、ちょうどdEが0になること
+TEST(ChargeIntegrationTest, ThresholdTimePrediction)
+{
+    for (double vd : {0.006, -0.006})
+    {
+        SEO seo(0.5, 0.002, 10.0, 2.0, vd, 4);
+        seo.setPcalc();
+        const double wait = seo.getThresholdTime();
+        ASSERT_GT(wait, 0.0);
+        ASSERT_TRUE(std::isfinite(wait));
+        seo.setNodeChargeExponential(wait);
+        seo.setPcalc();
+        seo.setdEcalc();
+        const TunnelDirection dir = (vd > 0) ? TunnelDirection::Up : TunnelDirection::Down;
+        EXPECT_NEAR(seo.getdE()[dir], 0.0, 1e-12);
+        EXPECT_EQ(seo.getThresholdTime(), 0.0);
+    }
+    // しきい値に届かないバイアスでは永遠にdEが正にならない
+    EXPECT_TRUE(std::isinf(thresholdCrossingTime(0.0, 0.004, 0.5, 18.0)));
+}
+
+// Grid2D<SEO>・Grid2D<FlatSEO>・SEOGraphで、解析解の更新としきい値までの時間が一致すること
+TEST(ChargeIntegrationTest, GridsAgree)
+{
+    LatticeBuilder builder(6, 7);
+    builder.setParams(test_lattices::oscillating).setCheckerboardBias();
+    Grid2D<SEO> pointer = builder.buildPointerGrid();
+    Grid2D<FlatSEO> flat = builder.buildFlatGrid();
+    SEOGraph graph = builder.buildGraph();
+    test_lattices::setChargePattern(pointer, 0.01, 5, -0.02);
+    test_lattices::setChargePattern(flat, 0.01, 5, -0.02);
+    test_lattices::setChargePattern(graph, 0.01, 5, -0.02);
+    for (int step = 0; step < 3; ++step)
+    {
+        pointer.updateGridVn();
+        flat.updateGridVn();
+        graph.updateGridVn();
+        EXPECT_NEAR(flat.nextThresholdTime(), pointer.nextThresholdTime(), 1e-9);
+        EXPECT_NEAR(graph.nextThresholdTime(), pointer.nextThresholdTime(), 1e-9);
+        pointer.updateGridQnExponential(0.3);
+        flat.updateGridQnExponential(0.3);
+        graph.updateGridQnExponential(0.3);
+    }
+    for (int y = 0; y < 6; ++y)
+        for (int x = 0; x < 7; ++x)
+        {
+            EXPECT_NEAR(flat.getElement(y, x)->getQ(), pointer.getElement(y, x)->getQ(), 1e-12);
+            EXPECT_NEAR(graph.getElement(y, x)->getQ(), pointer.getElement(y, x)->getQ(), 1e-12);
+        }
+}
+
+// ExponentialJumpは最初のステップでしきい値を超える時刻まで一度に進むこと
+TEST(ChargeIntegrationTest, JumpLandsOnThreshold)
+{
+    Simulation2D<FlatSEO> sim(0.01, 100.0);
+    sim.setChargeIntegrator(ChargeIntegrator::ExponentialJump);
+    EXPECT_EQ(sim.getChargeIntegrator(), ChargeIntegrator::ExponentialJump);
+    Grid2D<FlatSEO> &grid = sim.appendGrid(Grid2D<FlatSEO>(1, 1, false));
+    grid.getElement(0, 0)->setUp(0.5, 0.002, 10.0, 2.0, 0.006);
+    sim.runStep();
+    const double ctot = 18.0, sInf = ctot * 0.006;
+    EXPECT_NEAR(sim.getTime(), 0.5 * ctot * std::log(sInf / (sInf - e / 2)), 1e-9);
+    EXPECT_NEAR(grid.getElement(0, 0)->getQ(), e / 2, 1e-12);
+}
+
+// ジャンプするとステップ数が大きく減り、終了時刻・出力時刻は飛び越さないこと
+TEST(ChargeIntegrationTest, JumpTakesFewerSteps)
+{
+    std::vector<int> steps;
+    for (ChargeIntegrator integrator : {ChargeIntegrator::Exponential, ChargeIntegrator::ExponentialJump})
+    {
+        LatticeBuilder builder(5, 5);
+        builder.setParams(test_lattices::oscillating).setCheckerboardBias();
+        Simulation2D<SEO> sim(0.01, 40.0);
+        sim.setSeed(3);
+        sim.setChargeIntegrator(integrator);
+        sim.setOutputInterval(10.0);
+        sim.addGrid({builder.buildPointerGrid()});
+        int count = 0;
+        while (sim.getTime() < 40.0)
+        {
+            sim.runStep();
+            ++count;
+        }
+        EXPECT_LT(sim.getTime(), 40.0 + 0.01);
+        // 出力は間隔ごとに1フレーム(t = 0, 10, 20, 30)
+        EXPECT_EQ(sim.getOutputs().at("output0").size(), 4u);
+        steps.push_back(count);
+    }
+    EXPECT_LT(steps[1] * 5, steps[0]);
+}
+
+// 結合した格子でも、ジャンプは周囲の電圧のずれを抑えて止まるので、
+// 最初のトンネルの時刻とトンネル回数が細かい刻みのExponentialと揃うこと
+TEST(ChargeIntegrationTest, JumpMatchesSmallStepOnCoupledLattice)
+{
+    struct Result
+    {
+        double firstTunnel = -1.0;
+        long long tunnels = 0;
+        int steps = 0;
+    };
+    auto run = [](ChargeIntegrator integrator, double dt, bool checkerboard) {
+        LatticeBuilder builder(8, 8);
+        builder.setParams(test_lattices::oscillating);
+        if (checkerboard)
+            builder.setCheckerboardBias();
+        Simulation2D<FlatSEO> sim(dt, 100.0);
+        sim.appendGrid(builder.buildFlatGrid()).setOutputEnabled(false);
+        sim.setSeed(1);
+        sim.setChargeIntegrator(integrator);
+        Result result;
+        while (sim.getTime() < 100.0)
+        {
+            sim.runStep();
+            ++result.steps;
+            if (result.firstTunnel < 0 && sim.getTunnelCount() > 0)
+                result.firstTunnel = sim.getTime();
+        }
+        result.tunnels = sim.getTunnelCount();
+        return result;
+    };
+    for (bool checkerboard : {false, true})
+    {
+        SCOPED_TRACE(checkerboard);
+        const Result reference = run(ChargeIntegrator::Exponential, 0.001, checkerboard);
+        const Result stepped = run(ChargeIntegrator::Exponential, 0.1, checkerboard);
+        const Result jump = run(ChargeIntegrator::ExponentialJump, 0.1, checkerboard);
+        ASSERT_GT(reference.tunnels, 100);
+        EXPECT_NEAR(jump.firstTunnel, reference.firstTunnel, 0.02 * reference.firstTunnel);
+        EXPECT_NEAR(static_cast<double>(jump.tunnels), static_cast<double>(reference.tunnels),
+                    0.05 * reference.tunnels);
+        EXPECT_LE(jump.steps, stepped.steps);
+    }
+}
+
+// ジャンプで許すV_sumのずれは正の値のみ
+TEST(ChargeIntegrationTest, JumpToleranceValidation)
+{
+    Simulation2D<FlatSEO> sim(0.1, 1.0);
+    EXPECT_DOUBLE_EQ(sim.getJumpTolerance(), 1e-3);
+    sim.setJumpTolerance(1e-4);
+    EXPECT_DOUBLE_EQ(sim.getJumpTolerance(), 1e-4);
+    EXPECT_THROW(sim.setJumpTolerance(0.0), std::invalid_argument);
+}
+
+// 出力間隔は正の値のみ
+TEST(ChargeIntegrationTest, OutputIntervalValidation)
+{
+    Simulation2D<SEO> sim(0.1, 1.0);
+    EXPECT_DOUBLE_EQ(sim.getOutputInterval(), 0.1);
+    EXPECT_THROW(sim.setOutputInterval(0.0), std::invalid_argument);
+    EXPECT_THROW(sim.setOutputInterval(-1.0), std::invalid_argument);
+    sim.setOutputInterval(0.5);
+    EXPECT_DOUBLE_EQ(sim.getOutputInterval(), 0.5);
+}
@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include "ensemble_simulation_2d.hpp"
+#include "test_lattices.hpp"
+#include "simulation_2d.hpp"
+
+using test_lattices::makeOscillatingGrid;
+
+// 各レプリカが、同じシード・バイアスで1つずつ実行した場合とビット単位で同じ経過になること
+TEST(EnsembleSimulation2DTest, ReplicasMatchIndependentRuns)
+{
+    for (ChargeIntegrator integrator : {ChargeIntegrator::Euler, ChargeIntegrator::Exponential})
+    {
+        const int K = 5, rows = 6, cols = 7;
+        const double endtime = 40.0;
+        EnsembleSimulation2D ensemble(0.1, endtime, K);
+        ensemble.setGrid(makeOscillatingGrid(rows, cols, true));
+        ensemble.setSeed(11);
+        ensemble.setChargeIntegrator(integrator);
+        ensemble.addVoltageTrigger(20.0, 2, 3, 0.05);
+        // レプリカ3だけバイアスを弱める
+        for (int y = 0; y < rows; ++y)
+            for (int x = 0; x < cols; ++x)
+            {
+                auto elem = ensemble.getElement(3, y, x);
+                elem->setVias(0.9 * elem->getVd());
+            }
+        ensemble.run();
+
+        for (int r = 0; r < K; ++r)
+        {
+            SCOPED_TRACE(r);
+            Simulation2D<FlatSEO> single(0.1, endtime);
+            Grid2D<FlatSEO> &grid = single.appendGrid(makeOscillatingGrid(rows, cols, true));
+            if (r == 3)
+                for (int i = 0; i < grid.numCells(); ++i)
+                {
+                    auto elem = grid.getElement(i / cols, i % cols);
+                    elem->setVias(0.9 * elem->getVd());
+                }
+            single.setSeed(ensemble.getReplicaSeed(r));
+            single.setChargeIntegrator(integrator);
+            single.addVoltageTrigger(20.0, &grid, 2, 3, 0.05);
+            single.run();
+
+            ASSERT_GT(single.getTunnelCount(), 20);
+            EXPECT_EQ(ensemble.getTunnelCount(r), single.getTunnelCount());
+            EXPECT_EQ(ensemble.getTime(r), single.getTime());
+            for (int y = 0; y < rows; ++y)
+                for (int x = 0; x < cols; ++x)
+                {
+                    EXPECT_EQ(ensemble.getElement(r, y, x)->getQ(), grid.getElement(y, x)->getQ());
+                    EXPECT_EQ(ensemble.getElement(r, y, x)->getVn(), grid.getElement(y, x)->getVn());
+                }
+            EXPECT_EQ(ensemble.getOutputs(r), single.getOutputs().at("output0"));
+        }
+    }
+}
+
+// シードが違えばレプリカごとに違う経過になり、同じシードなら同じ経過になること
+TEST(EnsembleSimulation2DTest, SeedsSelectIndependentStreams)
+{
+    EnsembleSimulation2D ensemble(0.1, 40.0, 3);
+    ensemble.setGrid(makeOscillatingGrid(5, 5, true));
+    ensemble.setReplicaSeed(0, 7);
+    ensemble.setReplicaSeed(1, 7);
+    ensemble.setReplicaSeed(2, 8);
+    ensemble.run();
+    EXPECT_EQ(ensemble.getOutputs(0), ensemble.getOutputs(1));
+    EXPECT_NE(ensemble.getOutputs(0), ensemble.getOutputs(2));
+}
+
+// レプリカ用カーネルの命令セットによらず、ビット単位で同じ経過になること
+// (レプリカ数はAVX-512の8個ずつの本体と端数の両方を通る数にする)
+TEST(EnsembleSimulation2DTest, MatchesAcrossSimdLevels)
+{
+    const int K = 11;
+    auto runAt = [K](SimdLevel level) {
+        EnsembleSimulation2D ensemble(0.1, 30.0, K);
+        ensemble.setGrid(makeOscillatingGrid(6, 6, true));
+        ensemble.setSeed(5);
+        ensemble.setSimdLevel(level);
+        EXPECT_EQ(ensemble.getSimdLevel(), level);
+        ensemble.run();
+        std::vector<std::vector<std::vector<std::vector<double>>>> outputs;
+        for (int r = 0; r < K; ++r)
+            outputs.push_back(ensemble.getOutputs(r));
+        return outputs;
+    };
+    const auto reference = runAt(SimdLevel::Scalar);
+    for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        if (!isSimdLevelSupported(level))
+            continue;
+        SCOPED_TRACE(simdLevelName(level));
+        EXPECT_EQ(runAt(level), reference);
+    }
+}
+
+// 扱えない設定は例外になること
+TEST(EnsembleSimulation2DTest, RejectsUnsupportedConfiguration)
+{
+    EXPECT_THROW(EnsembleSimulation2D(0.1, 1.0, 0), std::invalid_argument);
+    EnsembleSimulation2D ensemble(0.1, 1.0, 2);
+    EXPECT_THROW(ensemble.runStep(), std::logic_error);
+    RelaxationConfig sor;
+    sor.method = RelaxationMethod::RedBlackSOR;
+    EXPECT_THROW(ensemble.setRelaxation(sor), std::invalid_argument);
+    EXPECT_THROW(ensemble.setChargeIntegrator(ChargeIntegrator::ExponentialJump), std::invalid_argument);
+}
@@ -0,0 +1,163 @@
+#include "gtest/gtest.h"
+#include <cstdlib>
+#include "flat_seo_grid.hpp"
+#include "event_simulation_2d.hpp"
+#include "test_lattices.hpp"
+
+using test_lattices::makeOscillatingGrid;
+
+namespace
+{
+    // 中央の4x4だけが自励振動し、周りはしきい値より下で定常状態まで充電した格子
+    // (インクリメンタル更新・アクティブセットを使う)
+    Grid2D<FlatSEO> makePatchGrid(int n)
+    {
+        LatticeBuilder builder(n, n);
+        builder.setParams(test_lattices::oscillating).setOutputEnabled(false);
+        builder.setBiasPattern([n](int y, int x, double vd) {
+            const bool patch = std::abs(x - n / 2) < 2 && std::abs(y - n / 2) < 2;
+            return (((x + y) % 2 == 0) ? 1 : -1) * (patch ? vd : vd / 3);
+        });
+        Grid2D<FlatSEO> grid = builder.buildFlatGrid();
+        RelaxationConfig config;
+        config.maxIterations = 10000;
+        config.tolerance = 1e-13;
+        for (int k = 0; k < 60; ++k)
+        {
+            grid.relax(config);
+            grid.updateGridQnExponential(20.0);
+        }
+        grid.relax(config);
+        grid.setIncrementalUpdate(true, 1e-10);
+        grid.setActiveSet(true);
+        return grid;
+    }
+}
+
+// ヒープの登録・更新・削除
+TEST(IndexedMinHeapTest, UpdateAndRemove)
+{
+    IndexedMinHeap heap(5);
+    EXPECT_TRUE(heap.empty());
+    heap.update(3, 2.0);
+    heap.update(1, 5.0);
+    heap.update(4, 1.0);
+    EXPECT_EQ(heap.top(), 4);
+    EXPECT_DOUBLE_EQ(heap.topKey(), 1.0);
+
+    heap.update(1, 0.5); // キーを小さくする
+    EXPECT_EQ(heap.top(), 1);
+    heap.update(1, 9.0); // キーを大きくする
+    EXPECT_EQ(heap.top(), 4);
+
+    heap.remove(4);
+    EXPECT_FALSE(heap.contains(4));
+    EXPECT_EQ(heap.top(), 3);
+    EXPECT_EQ(heap.size(), 2);
+    heap.remove(4); // 未登録の削除は何もしない
+    EXPECT_EQ(heap.size(), 2);
+}
+
+// 同じキーでは添字の小さい方が先
+TEST(IndexedMinHeapTest, TieBreaksByIndex)
+{
+    IndexedMinHeap heap(4);
+    heap.update(2, 1.0);
+    heap.update(0, 1.0);
+    heap.update(3, 1.0);
+    EXPECT_EQ(heap.top(), 0);
+}
+
+// 終了時刻まで進み、トンネルが起きること
+TEST(EventSimulation2DTest, RunsAndTunnels)
+{
+    EventSimulation2D<FlatSEO> sim(0.1, 50.0);
+    sim.seedRandom(1);
+    auto grid = makeOscillatingGrid(6, 6, true);
+    grid.setOutputLabel("seo");
+    sim.addGrid({grid});
+    sim.run();
+
+    EXPECT_GE(sim.getTime(), 50.0);
+    EXPECT_GT(sim.getTunnelCount(), 0);
+    ASSERT_TRUE(sim.getOutputs().count("seo"));
+    EXPECT_GE(sim.getOutputs().at("seo").size(), 400u);
+}
+
+// ヒープに入っているのはレートが正のチャネルだけ
+TEST(EventSimulation2DTest, OnlyPositiveRatesAreScheduled)
+{
+    EventSimulation2D<FlatSEO> sim(0.1, 1.0);
+    sim.seedRandom(2);
+    sim.addGrid({makeOscillatingGrid(4, 4)});
+    for (int i = 0; i < 200; ++i)
+        sim.runStep();
+
+    auto &grid = sim.getGrids()[0];
+    // runStep内と同じ状態でdEを数える（最後の充電の分だけ進めて比較する）
+    int positive = 0;
+    for (int i = 0; i < grid.numCells(); ++i)
+    {
+        if (grid.tunnelRate(i, TunnelDirection::Up) > 0)
+            ++positive;
+        if (grid.tunnelRate(i, TunnelDirection::Down) > 0)
+            ++positive;
+    }
+    EXPECT_EQ(sim.numScheduled(0), positive);
+}
+
+// インクリメンタル更新では、1イベントあたりの組み直し・充電の手間が格子の大きさによらないこと
+TEST(EventSimulation2DTest, PerEventWorkIndependentOfSize)
+{
+    std::vector<double> reschedules, active;
+    for (int n : {16, 64})
+    {
+        EventSimulation2D<FlatSEO> sim(0.1, 60.0);
+        sim.setSeed(3);
+        Grid2D<FlatSEO> &grid = sim.appendGrid(makePatchGrid(n));
+        long long activeSteps = 0;
+        while (sim.getTime() < 60.0)
+        {
+            sim.runStep();
+            activeSteps += grid.numActiveCells();
+        }
+        ASSERT_GT(sim.getTunnelCount(), 10);
+        reschedules.push_back(static_cast<double>(sim.getRescheduleCount()) / sim.getTunnelCount());
+        active.push_back(static_cast<double>(activeSteps) / sim.getTunnelCount());
+    }
+    // 素子数は16倍だが、1イベントあたりの手間はほぼ同じ(全チャネルを1回組み直すより少ない)
+    EXPECT_LT(reschedules[1], 2 * reschedules[0]);
+    EXPECT_LT(reschedules[1], 2 * 64 * 64);
+    EXPECT_LT(active[1], 2 * active[0]);
+}
+
+// インクリメンタル更新・アクティブセットでも、通常のエンジンと同じ頻度でトンネルすること
+TEST(EventSimulation2DTest, IncrementalMatchesTunnelStatistics)
+{
+    Simulation2D<FlatSEO> exact(0.1, 300.0);
+    exact.setSeed(1);
+    exact.appendGrid(makeOscillatingGrid(12, 12));
+    exact.run();
+
+    EventSimulation2D<FlatSEO> event(0.1, 300.0);
+    event.setSeed(1);
+    Grid2D<FlatSEO> &grid = event.appendGrid(makeOscillatingGrid(12, 12));
+    grid.setIncrementalUpdate(true, 1e-10);
+    grid.setActiveSet(true);
+    event.run();
+
+    ASSERT_GT(exact.getTunnelCount(), 1000);
+    EXPECT_NEAR(static_cast<double>(event.getTunnelCount()) / exact.getTunnelCount(), 1.0, 0.02);
+}
+
+// Grid2D<SEO>でも動くこと
+TEST(EventSimulation2DTest, WorksWithPointerGrid)
+{
+    EventSimulation2D<SEO> sim(0.1, 1.0);
+    Grid2D<SEO> grid(1, 1, false);
+    grid.getElement(0, 0)->setUp(0.5, 0.002, 10.0, 2.0, 0.006, 4);
+    grid.getElement(0, 0)->setQ(1.0);
+    sim.addGrid({grid});
+    sim.runStep();
+    EXPECT_EQ(sim.getTunnelCount(), 1);
+}
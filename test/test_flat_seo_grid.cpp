@@ -0,0 +1,848 @@
+#include "gtest/gtest.h"
+#include "flat_seo_grid.hpp"
+#include "lattice_builder.hpp"
+#include "test_lattices.hpp"
+#include "simulation_2d.hpp"
+
+namespace
+{
+    constexpr double kVd = 0.0044, kR = 0.5, kRj = 0.002, kCj = 10.0, kC = 2.0;
+
+    // 市松模様にバイアスした格子のbuilder(main.cppと同じ配線: 上・右・下・左、端は開放)
+    LatticeBuilder makeBuilder(int rows, int cols)
+    {
+        LatticeBuilder builder(rows, cols);
+        builder.setParams({kR, kRj, kCj, kC, kVd}).setCheckerboardBias();
+        return builder;
+    }
+
+    // Grid2D<SEO>を作る
+    Grid2D<SEO> makePointerGrid(int rows, int cols) { return makeBuilder(rows, cols).buildPointerGrid(); }
+
+    // 同じパラメータのGrid2D<FlatSEO>を作る
+    Grid2D<FlatSEO> makeFlatGrid(int rows, int cols) { return makeBuilder(rows, cols).buildFlatGrid(); }
+}
+
+// ビュー経由のパラメータ設定と取得
+TEST(FlatSEOGridTest, ElementViewAccess)
+{
+    Grid2D<FlatSEO> grid(3, 2);
+    EXPECT_EQ(grid.numRows(), 3);
+    EXPECT_EQ(grid.numCols(), 2);
+    EXPECT_EQ(grid.numCells(), 6);
+
+    auto elem = grid.getElement(2, 1);
+    elem->setUp(1.0, 0.001, 18.0, 2.0, 0.007, 3);
+    elem->setQ(0.5);
+    EXPECT_EQ(elem->getIndex(), 5);
+    EXPECT_DOUBLE_EQ(grid.getElement(2, 1)->getQ(), 0.5);
+    EXPECT_DOUBLE_EQ(grid.getElement(2, 1)->getCj(), 18.0);
+    EXPECT_EQ(grid.getElement(2, 1)->getlegs(), 3);
+    EXPECT_THROW(grid.getElement(3, 0), std::out_of_range);
+}
+
+// ポインタ版のGrid2D<SEO>と同じ電圧・dEになること
+TEST(FlatSEOGridTest, MatchesPointerGrid)
+{
+    const int rows = 6, cols = 5;
+    auto pointerGrid = makePointerGrid(rows, cols);
+    auto flatGrid = makeFlatGrid(rows, cols);
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            double q = 0.01 * ((y * cols + x) % 7) - 0.03;
+            pointerGrid.getElement(y, x)->setQ(q);
+            flatGrid.getElement(y, x)->setQ(q);
+        }
+    }
+
+    for (int i = 0; i < 5; ++i)
+    {
+        pointerGrid.updateGridSurVn();
+        pointerGrid.updateGridVn();
+        flatGrid.updateGridSurVn();
+        flatGrid.updateGridVn();
+    }
+    pointerGrid.updateGriddE();
+    flatGrid.updateGriddE();
+    pointerGrid.updateGridQn(0.1);
+    flatGrid.updateGridQn(0.1);
+
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            auto p = pointerGrid.getElement(y, x);
+            auto f = flatGrid.getElement(y, x);
+            EXPECT_DOUBLE_EQ(p->getSurroundingVsum(), f->getSurroundingVsum());
+            EXPECT_DOUBLE_EQ(p->getVn(), f->getVn());
+            EXPECT_DOUBLE_EQ(p->getdE()["up"], f->getdE()["up"]);
+            EXPECT_DOUBLE_EQ(p->getdE()["down"], f->getdE()["down"]);
+            EXPECT_DOUBLE_EQ(p->getQ(), f->getQ());
+        }
+    }
+}
+
+// gridminwtが最小の待ち時間を持つ素子を選ぶこと
+TEST(FlatSEOGridTest, MinWtSelectsArgmin)
+{
+    auto grid = makeFlatGrid(4, 4);
+    grid.seedRandom(7);
+    grid.getElement(1, 1)->setdE("up", 0.2);
+    grid.getElement(2, 3)->setdE("down", 0.3);
+    grid.getElement(3, 0)->setdE("up", 0.1);
+
+    ASSERT_TRUE(grid.gridminwt(1e9));
+    auto place = grid.getTunnelPlace();
+    double wt = std::max(place->getWT()["up"], place->getWT()["down"]);
+    EXPECT_DOUBLE_EQ(wt, grid.getMinWT());
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            auto elem = grid.getElement(y, x);
+            double other = std::max(elem->getWT()["up"], elem->getWT()["down"]);
+            if (other > 0)
+            {
+                EXPECT_LE(grid.getMinWT(), other);
+            }
+        }
+    }
+}
+
+// 乱数列の番号をずらした切り出しは、元のgridの同じ素子と同じ待ち時間を引くこと
+TEST(FlatSEOGridTest, RandomStreamBaseMatchesWholeGrid)
+{
+    auto whole = makeFlatGrid(6, 4);
+    auto part = makeFlatGrid(3, 4);
+    whole.seedRandom(9);
+    part.seedRandom(9);
+    part.setRandomStreamBase(2 * 4);
+    for (int y = 0; y < 3; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            const double de = 0.05 * (y * 4 + x + 1);
+            whole.getElement(y + 2, x)->setdE(TunnelDirection::Up, de);
+            part.getElement(y, x)->setdE(TunnelDirection::Up, de);
+        }
+    }
+    for (int draw = 0; draw < 3; ++draw)
+    {
+        ASSERT_TRUE(whole.gridminwt(1e9));
+        ASSERT_TRUE(part.gridminwt(1e9));
+        EXPECT_EQ(part.getTunnelIndex() + 2 * 4, whole.getTunnelIndex());
+        for (int y = 0; y < 3; ++y)
+            for (int x = 0; x < 4; ++x)
+                EXPECT_EQ(part.getElement(y, x)->getWT()[TunnelDirection::Up],
+                          whole.getElement(y + 2, x)->getWT()[TunnelDirection::Up]);
+    }
+}
+
+// Simulation2D<FlatSEO>で登録したgrid自体にトンネルが反映されること
+TEST(FlatSEOGridTest, SimulationAppliesTunnelToStoredGrid)
+{
+    Simulation2D<FlatSEO> sim(1e6, 1e7); // dtを大きくして必ずトンネルさせる
+    sim.addGrid({makeFlatGrid(3, 3)});
+    auto &grid = sim.getGrids()[0];
+    grid.getElement(1, 1)->setQ(1.0); // dE(up)が正になる電荷
+    grid.updateGridSurVn();
+    grid.updateGridVn();
+    grid.updateGriddE();
+
+    auto compared = sim.comparewt();
+    ASSERT_TRUE(compared.first);
+    sim.handleTunnels(compared.second);
+    EXPECT_NEAR(grid.getElement(1, 1)->getQ(), 1.0 - e, 1e-12);
+}
+
+namespace
+{
+    // 収束するまでJacobi法で緩和する
+    void relaxFully(Grid2D<FlatSEO> &grid)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            grid.updateGridSurVn();
+            grid.updateGridVn();
+        }
+        grid.updateGridSurVn();
+    }
+}
+
+// インクリメンタル更新が、収束させた全体計算と許容誤差内で一致すること
+TEST(FlatSEOGridTest, IncrementalMatchesFullSweep)
+{
+    const int rows = 12, cols = 10;
+    auto full = makeFlatGrid(rows, cols);
+    auto inc = makeFlatGrid(rows, cols);
+    inc.setIncrementalUpdate(true, 1e-12);
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            double q = 0.06 * ((y * cols + x) % 5) - 0.12;
+            full.getElement(y, x)->setQ(q);
+            inc.getElement(y, x)->setQ(q);
+        }
+    }
+    full.seedRandom(3);
+    inc.seedRandom(3);
+
+    int tunnels = 0;
+    for (int step = 0; step < 20; ++step)
+    {
+        relaxFully(full);
+        inc.updateGridSurVn();
+        inc.updateGridVn();
+        full.updateGriddE();
+        inc.updateGriddE();
+        for (int i = 0; i < rows * cols; ++i)
+        {
+            auto f = full.getElement(i / cols, i % cols);
+            auto n = inc.getElement(i / cols, i % cols);
+            ASSERT_NEAR(f->getVn(), n->getVn(), 1e-9);
+            ASSERT_NEAR(f->getdE()[TunnelDirection::Up], n->getdE()[TunnelDirection::Up], 1e-9);
+        }
+
+        bool tf = full.gridminwt(10.0);
+        bool ti = inc.gridminwt(10.0);
+        ASSERT_EQ(tf, ti);
+        if (tf)
+        {
+            ASSERT_EQ(full.getTunnelIndex(), inc.getTunnelIndex());
+            ++tunnels;
+            full.applyTunnel(full.getTunnelIndex(), full.getTunnelDirection());
+            inc.applyTunnel(inc.getTunnelIndex(), inc.getTunnelDirection());
+        }
+        full.updateGridQn(0.1);
+        inc.updateGridQn(0.1);
+    }
+    EXPECT_GT(tunnels, 0);
+}
+
+// インクリメンタル更新で外部電圧(トリガ)を入れて戻すと元の電圧に戻ること
+TEST(FlatSEOGridTest, IncrementalExternalVoltage)
+{
+    auto grid = makeFlatGrid(5, 5);
+    grid.setIncrementalUpdate(true, 1e-13);
+    grid.getElement(2, 2)->setQ(0.05);
+    grid.updateGridSurVn();
+    double before = grid.getElement(2, 3)->getVn();
+
+    grid.getElement(2, 2)->setExternalVoltage(0.06);
+    grid.updateGridSurVn();
+    EXPECT_NE(grid.getElement(2, 3)->getVn(), before);
+
+    grid.getElement(2, 2)->setExternalVoltage(0.0);
+    grid.updateGridSurVn();
+    EXPECT_NEAR(grid.getElement(2, 3)->getVn(), before, 1e-12);
+}
+
+// インクリメンタル更新のrelaxは、記録された素子の周りで実際に伝えた波の数を返し、使えない設定は例外になること
+TEST(FlatSEOGridTest, IncrementalRelaxReportsDirtyWork)
+{
+    auto grid = makeFlatGrid(9, 9);
+    grid.setIncrementalUpdate(true, 1e-12);
+    RelaxationConfig converge;
+    converge.maxIterations = 10000;
+    RelaxationStats settle = grid.relax(converge);
+    EXPECT_GE(settle.iterations, 1);
+    EXPECT_EQ(grid.relax(converge).iterations, 0);
+
+    grid.getElement(4, 4)->setQ(0.05);
+    RelaxationStats kick = grid.relax(converge);
+    EXPECT_GT(kick.iterations, 1);
+    EXPECT_LE(kick.residual, 1e-12);
+
+    RelaxationConfig sor;
+    sor.method = RelaxationMethod::RedBlackSOR;
+    EXPECT_THROW(grid.relax(sor), std::invalid_argument);
+    RelaxationConfig tiled;
+    tiled.tileRows = 4;
+    EXPECT_THROW(grid.relax(tiled), std::invalid_argument);
+}
+
+// インクリメンタル更新のrelaxは、maxIterationsを波の数の上限、toleranceを打ち切りの閾値に使い、残りは次回に回すこと
+TEST(FlatSEOGridTest, IncrementalRelaxHonoursWaveCapAndTolerance)
+{
+    auto grid = makeFlatGrid(9, 9);
+    grid.setIncrementalUpdate(true, 1e-12);
+    RelaxationConfig converge;
+    converge.maxIterations = 10000;
+    grid.relax(converge);
+    auto ref = grid;
+
+    grid.getElement(4, 4)->setQ(0.05);
+    ref.getElement(4, 4)->setQ(0.05);
+    RelaxationConfig capped;
+    capped.maxIterations = 2;
+    EXPECT_EQ(grid.relax(capped).iterations, 2);
+    RelaxationConfig loose = converge;
+    loose.tolerance = 1e-6;
+    const RelaxationStats stopped = grid.relax(loose);
+    EXPECT_LE(stopped.residual, 1e-6);
+    EXPECT_GT(grid.relax(converge).iterations, 0);
+    ref.relax(converge);
+    for (int i = 0; i < grid.numCells(); ++i)
+        EXPECT_NEAR(grid.getElement(i / 9, i % 9)->getVn(), ref.getElement(i / 9, i % 9)->getVn(), 1e-11);
+    EXPECT_EQ(grid.relax(converge).iterations, 0);
+}
+
+// 数千回トンネルさせても、インクリメンタル更新のV_sum・Vnが全体計算とずれないこと
+TEST(FlatSEOGridTest, IncrementalNeighbourSumsStayInSyncOverLongRuns)
+{
+    const int rows = 16, cols = 16, n = rows * cols;
+    auto grid = test_lattices::makeOscillatingGrid(rows, cols);
+    grid.setIncrementalUpdate(true, 1e-10);
+    EXPECT_THROW(grid.setResyncInterval(-1), std::invalid_argument);
+    grid.setResyncInterval(64);
+    EXPECT_EQ(grid.getResyncInterval(), 64);
+    grid.seedRandom(11);
+
+    int tunnels = 0;
+    for (int step = 0; tunnels < 3000; ++step)
+    {
+        ASSERT_LT(step, 200000);
+        grid.updateGridVn();
+        grid.updateGriddE();
+        if (grid.gridminwt(0.1))
+        {
+            grid.applyTunnel(grid.getTunnelIndex(), grid.getTunnelDirection());
+            ++tunnels;
+        }
+        grid.updateGridQn(0.1);
+    }
+    grid.updateGridVn();
+
+    // V_sumは今のVnの隣接和と一致し、Vnは全体計算で収束させた値と許容誤差の範囲で一致する
+    auto full = grid;
+    full.setIncrementalUpdate(false);
+    RelaxationConfig converge;
+    converge.maxIterations = 10000;
+    converge.tolerance = 1e-14;
+    for (int i = 0; i < n; ++i)
+    {
+        const int y = i / cols, x = i % cols;
+        double sum = 0.0;
+        if (y > 0) sum += grid.getElement(y - 1, x)->getVn();
+        if (x < cols - 1) sum += grid.getElement(y, x + 1)->getVn();
+        if (y < rows - 1) sum += grid.getElement(y + 1, x)->getVn();
+        if (x > 0) sum += grid.getElement(y, x - 1)->getVn();
+        ASSERT_NEAR(grid.getElement(y, x)->getSurroundingVsum(), sum, 1e-12);
+    }
+    full.relax(converge);
+    for (int i = 0; i < n; ++i)
+    {
+        auto a = grid.getElement(i / cols, i % cols);
+        auto b = full.getElement(i / cols, i % cols);
+        ASSERT_NEAR(a->getVn(), b->getVn(), 1e-8);
+        ASSERT_NEAR(a->getSurroundingVsum(), b->getSurroundingVsum(), 1e-8);
+    }
+}
+
+// アクティブセットを使っても、インクリメンタル更新と同じトンネルの経過になり、静かな素子は眠ること
+TEST(FlatSEOGridTest, ActiveSetMatchesIncremental)
+{
+    const int rows = 32, cols = 32, n = rows * cols;
+    // 定常状態まで充電した格子(しきい値の少し下)
+    auto base = makeFlatGrid(rows, cols);
+    for (int k = 0; k < 60; ++k)
+    {
+        relaxFully(base);
+        base.updateGridQnExponential(20.0);
+    }
+    relaxFully(base);
+    auto inc = base;
+    auto active = base;
+    inc.setIncrementalUpdate(true, 1e-10);
+    active.setIncrementalUpdate(true, 1e-10);
+    EXPECT_THROW(base.setActiveSet(true), std::logic_error);
+    active.setActiveSet(true);
+    EXPECT_TRUE(active.isActiveSet());
+    inc.seedRandom(5);
+    active.seedRandom(5);
+    // 中央の素子を蹴って波を起こす
+    const double kick = base.getElement(16, 16)->getQ() + 0.02;
+    inc.getElement(16, 16)->setQ(kick);
+    active.getElement(16, 16)->setQ(kick);
+
+    int tunnels = 0, minActive = n;
+    for (int step = 0; step < 150; ++step)
+    {
+        inc.updateGridVn();
+        active.updateGridVn();
+        inc.updateGriddE();
+        active.updateGriddE();
+        const bool ti = inc.gridminwt(0.05);
+        ASSERT_EQ(ti, active.gridminwt(0.05));
+        if (ti)
+        {
+            ASSERT_EQ(inc.getTunnelIndex(), active.getTunnelIndex());
+            ++tunnels;
+            inc.applyTunnel(inc.getTunnelIndex(), inc.getTunnelDirection());
+            active.applyTunnel(active.getTunnelIndex(), active.getTunnelDirection());
+        }
+        inc.updateGridQn(0.05);
+        active.updateGridQn(0.05);
+        minActive = std::min(minActive, active.numActiveCells());
+    }
+    EXPECT_GT(tunnels, 0);
+    // 波が届いていない素子は眠ったまま
+    EXPECT_LT(minActive, n / 4);
+    EXPECT_LT(active.numActiveCells(), n * 3 / 4);
+    for (int i = 0; i < n; ++i)
+    {
+        ASSERT_NEAR(inc.getElement(i / cols, i % cols)->getQ(), active.getElement(i / cols, i % cols)->getQ(), 1e-12);
+        ASSERT_NEAR(inc.getElement(i / cols, i % cols)->getVn(), active.getElement(i / cols, i % cols)->getVn(), 1e-12);
+    }
+    // 無効にすると全素子を起こし、眠っていた間の充電も足される
+    const double q = active.getElement(0, 0)->getQ();
+    active.setActiveSet(false);
+    EXPECT_EQ(active.numActiveCells(), n);
+    EXPECT_EQ(active.getElement(0, 0)->getQ(), q);
+}
+
+// 赤黒SORがポインタ版と同じ結果になること
+TEST(FlatSEOGridTest, RedBlackSORMatchesPointerGrid)
+{
+    auto pointerGrid = makePointerGrid(5, 7);
+    auto flatGrid = makeFlatGrid(5, 7);
+    pointerGrid.getElement(2, 3)->setQ(0.1);
+    flatGrid.getElement(2, 3)->setQ(0.1);
+
+    RelaxationConfig config;
+    config.method = RelaxationMethod::RedBlackSOR;
+    config.maxIterations = 50;
+    config.tolerance = 1e-10;
+    config.omega = 1.2;
+    auto ps = pointerGrid.relax(config);
+    auto fs = flatGrid.relax(config);
+    EXPECT_EQ(ps.iterations, fs.iterations);
+    for (int y = 0; y < 5; ++y)
+        for (int x = 0; x < 7; ++x)
+            EXPECT_DOUBLE_EQ(pointerGrid.getElement(y, x)->getVn(), flatGrid.getElement(y, x)->getVn());
+}
+
+// 直接法の解が、収束させたJacobi法と一致すること
+TEST(FlatSEOGridTest, DirectSolveMatchesConvergedJacobi)
+{
+    for (auto size : {std::make_pair(6, 9), std::make_pair(9, 6), std::make_pair(1, 5)})
+    {
+        auto direct = makeFlatGrid(size.first, size.second);
+        auto ref = makeFlatGrid(size.first, size.second);
+        for (int i = 0; i < direct.numCells(); ++i)
+        {
+            double q = 0.03 * (i % 4) - 0.05;
+            direct.getElement(i / size.second, i % size.second)->setQ(q);
+            ref.getElement(i / size.second, i % size.second)->setQ(q);
+        }
+        direct.getElement(0, 0)->setExternalVoltage(0.06);
+        ref.getElement(0, 0)->setExternalVoltage(0.06);
+
+        RelaxationConfig config;
+        config.method = RelaxationMethod::Direct;
+        direct.relax(config);
+        relaxFully(ref);
+        for (int i = 0; i < direct.numCells(); ++i)
+        {
+            auto d = direct.getElement(i / size.second, i % size.second);
+            auto r = ref.getElement(i / size.second, i % size.second);
+            EXPECT_NEAR(d->getVn(), r->getVn(), 1e-12);
+            EXPECT_NEAR(d->getSurroundingVsum(), r->getSurroundingVsum(), 1e-12);
+        }
+    }
+}
+
+// パラメータを変えると分解をやり直すこと
+TEST(FlatSEOGridTest, DirectSolveRefactorsAfterSetUp)
+{
+    auto direct = makeFlatGrid(4, 4);
+    RelaxationConfig config;
+    config.method = RelaxationMethod::Direct;
+    direct.getElement(1, 1)->setQ(0.1);
+    direct.relax(config);
+
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 4; ++x)
+            direct.getElement(y, x)->setUp(kR, kRj, 5.0, 3.0, kVd, 4);
+    direct.relax(config);
+
+    auto ref = makeFlatGrid(4, 4);
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 4; ++x)
+            ref.getElement(y, x)->setUp(kR, kRj, 5.0, 3.0, kVd, 4);
+    ref.getElement(1, 1)->setQ(0.1);
+    relaxFully(ref);
+    EXPECT_NEAR(direct.getElement(2, 1)->getVn(), ref.getElement(2, 1)->getVn(), 1e-12);
+
+    Grid2D<FlatSEO> empty(2, 2); // C, Cjが0のままでは分解できない
+    EXPECT_THROW(empty.relax(config), std::invalid_argument);
+}
+
+// マルチグリッド法の解が直接法と一致すること
+TEST(FlatSEOGridTest, MultigridMatchesDirectSolve)
+{
+    for (auto size : {std::make_pair(37, 23), std::make_pair(9, 6), std::make_pair(1, 90)})
+    {
+        auto multigrid = makeFlatGrid(size.first, size.second);
+        auto direct = makeFlatGrid(size.first, size.second);
+        for (int i = 0; i < direct.numCells(); ++i)
+        {
+            double q = 0.03 * (i % 4) - 0.05;
+            multigrid.getElement(i / size.second, i % size.second)->setQ(q);
+            direct.getElement(i / size.second, i % size.second)->setQ(q);
+        }
+        multigrid.getElement(0, 0)->setExternalVoltage(0.06);
+        direct.getElement(0, 0)->setExternalVoltage(0.06);
+
+        RelaxationConfig config;
+        config.method = RelaxationMethod::Direct;
+        direct.relax(config);
+        config.method = RelaxationMethod::Multigrid;
+        config.maxIterations = 50;
+        config.tolerance = 1e-14;
+        RelaxationStats stats = multigrid.relax(config);
+        EXPECT_LT(stats.iterations, 50);
+        for (int i = 0; i < direct.numCells(); ++i)
+        {
+            auto m = multigrid.getElement(i / size.second, i % size.second);
+            auto d = direct.getElement(i / size.second, i % size.second);
+            EXPECT_NEAR(m->getVn(), d->getVn(), 1e-12);
+            EXPECT_NEAR(m->getSurroundingVsum(), d->getSurroundingVsum(), 1e-12);
+        }
+    }
+}
+
+// 格子を大きくしても反復回数がほとんど増えないこと
+TEST(FlatSEOGridTest, MultigridIterationsIndependentOfSize)
+{
+    RelaxationConfig config;
+    config.method = RelaxationMethod::Multigrid;
+    config.maxIterations = 100;
+    config.tolerance = 1e-12;
+    std::vector<int> iterations;
+    for (int size : {16, 64, 256})
+    {
+        Grid2D<FlatSEO> grid(size, size, false);
+        for (int i = 0; i < grid.numCells(); ++i)
+        {
+            auto elem = grid.getElement(i / size, i % size);
+            elem->setUp(kR, kRj, 0.1, kC, kVd, 4); // Cj << C でJacobi法では収束が遅い場合
+            elem->setQ(0.01 * ((i * 7919) % 13) - 0.06);
+        }
+        iterations.push_back(grid.relax(config).iterations);
+    }
+    EXPECT_LE(iterations[2], iterations[0] + 4);
+    EXPECT_LE(iterations[1], iterations[0] + 4);
+}
+
+// グリーン関数でトンネルさせた後のVnが、解き直した結果と一致すること(中央・端・角)
+TEST(FlatSEOGridTest, GreenUpdateMatchesDirectSolve)
+{
+    const int rows = 40, cols = 33;
+    auto green = makeFlatGrid(rows, cols);
+    auto ref = makeFlatGrid(rows, cols);
+    for (int i = 0; i < green.numCells(); ++i)
+    {
+        double q = 0.01 * ((i * 7919) % 13) - 0.06;
+        green.getElement(i / cols, i % cols)->setQ(q);
+        ref.getElement(i / cols, i % cols)->setQ(q);
+    }
+    RelaxationConfig direct;
+    direct.method = RelaxationMethod::Direct;
+    green.relax(direct);
+    EXPECT_THROW(green.setGreenUpdate(true, 1e-12), std::logic_error);
+    green.setIncrementalUpdate(true, 1e-13);
+    green.setGreenUpdate(true, 1e-12);
+    EXPECT_TRUE(green.isGreenUpdate());
+
+    const int cells[] = {20 * cols + 16, 0, cols - 1, 5 * cols, (rows - 1) * cols + 3, rows * cols - 1};
+    for (int index : cells)
+    {
+        green.applyTunnel(index, TunnelDirection::Up);
+        ref.applyTunnel(index, TunnelDirection::Up);
+    }
+    ref.relax(direct);
+    for (int i = 0; i < green.numCells(); ++i)
+    {
+        auto g = green.getElement(i / cols, i % cols);
+        auto r = ref.getElement(i / cols, i % cols);
+        ASSERT_NEAR(g->getVn(), r->getVn(), 1e-12);
+        ASSERT_NEAR(g->getSurroundingVsum(), r->getSurroundingVsum(), 1e-12);
+    }
+}
+
+// 打ち切り半径は格子の大きさによらず、一様でない格子では使えないこと
+TEST(FlatSEOGridTest, GreenKernelIsLocal)
+{
+    auto small = makeFlatGrid(8, 8);
+    Grid2D<FlatSEO> large(300, 300, false);
+    for (int y = 0; y < 300; ++y)
+        for (int x = 0; x < 300; ++x)
+            large.getElement(y, x)->setUp(kR, kRj, kCj, kC, kVd, 4);
+    small.setIncrementalUpdate(true);
+    large.setIncrementalUpdate(true);
+    small.setGreenUpdate(true);
+    large.setGreenUpdate(true);
+    EXPECT_EQ(small.getGreenRadius(), large.getGreenRadius());
+    EXPECT_LT(large.getGreenRadius(), 20);
+
+    small.getElement(3, 3)->setUp(kR, kRj, kCj, 3.0, kVd, 4);
+    EXPECT_THROW(small.applyTunnel(0, TunnelDirection::Down), std::invalid_argument);
+    EXPECT_THROW(small.setGreenUpdate(true), std::invalid_argument);
+    small.setIncrementalUpdate(false);
+    EXPECT_FALSE(small.isGreenUpdate());
+}
+
+// グリーン関数で更新したトンネル1回の後に計算し直す素子数が、格子の大きさによらないこと
+TEST(FlatSEOGridTest, GreenUpdateWorkPerEventIsLocal)
+{
+    std::vector<std::size_t> relaxed, updated;
+    for (int size : {64, 128})
+    {
+        Grid2D<FlatSEO> grid(size, size, false);
+        for (int i = 0; i < grid.numCells(); ++i)
+            grid.getElement(i / size, i % size)->setUp(kR, kRj, kCj, kC, kVd, 4);
+        grid.setIncrementalUpdate(true, 1e-12);
+        grid.updateGridVn();
+        grid.updateGriddE();
+        grid.setGreenUpdate(true, 1e-10);
+        ASSERT_LT(2 * grid.getGreenRadius() + 2, size);
+
+        const int center = (size / 2) * size + size / 2;
+        grid.applyTunnel(center, TunnelDirection::Up);
+        RelaxationConfig converge;
+        converge.maxIterations = 10000;
+        const RelaxationStats stats = grid.relax(converge);
+        grid.updateGriddE();
+        relaxed.push_back(static_cast<std::size_t>(stats.iterations));
+        updated.push_back(grid.getdEUpdatedCells().size());
+        EXPECT_LT(grid.getdEUpdatedCells().size(), static_cast<std::size_t>(grid.numCells() / 4));
+    }
+    EXPECT_EQ(relaxed[0], relaxed[1]);
+    EXPECT_EQ(updated[0], updated[1]);
+}
+
+// 8近傍・六角格子でも、隣接素子をつないだGrid2D<SEO>と同じ結果になること
+template <typename Topology>
+static void expectTopologyMatchesPointerGrid(int rows, int cols)
+{
+    // LatticeBuilder::buildPointerGridは4近傍だけなので、近傍のオフセットから素子ごとに配線する
+    Grid2D<SEO> pointerGrid(rows, cols);
+    Grid2D<BasicFlatSEO<Topology>> flatGrid(rows, cols);
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            double q = 0.01 * ((y * cols + x) % 7) - 0.03;
+            auto seo = pointerGrid.getElement(y, x);
+            seo->setUp(kR, kRj, kCj, kC, kVd, Topology::legs);
+            seo->setQ(q);
+            std::vector<std::shared_ptr<SEO>> connections;
+            for (const NeighbourOffset &o : Topology::offsets)
+            {
+                if (y + o.dr >= 0 && y + o.dr < rows && x + o.dc >= 0 && x + o.dc < cols)
+                    connections.push_back(pointerGrid.getElement(y + o.dr, x + o.dc));
+            }
+            seo->setConnections(connections);
+            flatGrid.getElement(y, x)->setUp(kR, kRj, kCj, kC, kVd);
+            flatGrid.getElement(y, x)->setQ(q);
+            EXPECT_EQ(flatGrid.getElement(y, x)->getlegs(), Topology::legs);
+        }
+    }
+    RelaxationConfig config;
+    config.maxIterations = 8;
+    pointerGrid.relax(config);
+    flatGrid.relax(config);
+    config.method = RelaxationMethod::RedBlackSOR;
+    pointerGrid.relax(config);
+    flatGrid.relax(config);
+    pointerGrid.updateGriddE();
+    flatGrid.updateGriddE();
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            auto p = pointerGrid.getElement(y, x);
+            auto f = flatGrid.getElement(y, x);
+            EXPECT_DOUBLE_EQ(p->getSurroundingVsum(), f->getSurroundingVsum());
+            EXPECT_DOUBLE_EQ(p->getVn(), f->getVn());
+            EXPECT_DOUBLE_EQ(p->getdE()[TunnelDirection::Up], f->getdE()[TunnelDirection::Up]);
+        }
+    }
+}
+
+TEST(FlatSEOGridTest, TopologiesMatchPointerGrid)
+{
+    expectTopologyMatchesPointerGrid<VonNeumann4>(5, 7);
+    expectTopologyMatchesPointerGrid<Moore8>(6, 5);
+    expectTopologyMatchesPointerGrid<Hex6>(5, 6);
+    expectTopologyMatchesPointerGrid<Moore8>(1, 4);
+}
+
+// 隣接素子の和が、トポロジの位置の値だけを足したものになること
+TEST(FlatSEOGridTest, HexNeighbourSum)
+{
+    Grid2D<BasicFlatSEO<Hex6>> grid(4, 4);
+    for (int i = 0; i < 16; ++i)
+        grid.getElement(i / 4, i % 4)->setVn(1 << i);
+    grid.updateGridSurVn();
+    // (1,1)の隣接: (0,1), (0,2), (1,2), (2,1), (2,0), (1,0)
+    EXPECT_EQ(grid.getElement(1, 1)->getSurroundingVsum(), (1 << 1) + (1 << 2) + (1 << 6) + (1 << 9) + (1 << 8) + (1 << 4));
+    // 角(0,0)の隣接: (0,1), (1,0)
+    EXPECT_EQ(grid.getElement(0, 0)->getSurroundingVsum(), (1 << 1) + (1 << 4));
+
+    // 4近傍の容量行列を前提にした解法は使えない(グリーン関数は切り替え自体がコンパイルできない)
+    RelaxationConfig config;
+    config.method = RelaxationMethod::Direct;
+    using HexGrid = Grid2D<BasicFlatSEO<Hex6>>;
+    EXPECT_FALSE(HexGrid::supportsRelaxation(config));
+    EXPECT_TRUE(Grid2D<FlatSEO>::supportsRelaxation(config));
+    EXPECT_THROW(grid.relax(config), std::invalid_argument);
+    static_assert(test_lattices::HasIncrementalUpdate<HexGrid>::value, "double grids are incremental");
+    static_assert(!test_lattices::HasGreenUpdate<HexGrid>::value, "Green update needs VonNeumann4");
+    static_assert(test_lattices::HasGreenUpdate<Grid2D<FlatSEO>>::value, "FlatSEO has the Green update");
+    grid.setIncrementalUpdate(true);
+    EXPECT_FALSE(grid.isGreenUpdate());
+
+    // 使えない緩和方法は、Simulation2Dに設定した時点で例外になる
+    Simulation2D<BasicFlatSEO<Hex6>> sim(0.1, 1.0);
+    EXPECT_THROW(sim.setRelaxation(config), std::invalid_argument);
+    config.method = RelaxationMethod::RedBlackSOR;
+    EXPECT_NO_THROW(sim.setRelaxation(config));
+}
+
+namespace
+{
+    // Jacobi法をタイルあり・なしで同じ回数だけ反復し、Vn・V_sum・残差がビット単位で一致することを確かめる
+    template <typename Topology>
+    void expectTiledJacobiMatches(int rows, int cols, bool classes, int threads)
+    {
+        Grid2D<BasicFlatSEO<Topology>> plain(rows, cols);
+        for (int y = 0; y < rows; ++y)
+            for (int x = 0; x < cols; ++x)
+            {
+                auto elem = plain.getElement(y, x);
+                elem->setUp(kR, kRj, kCj, kC, ((x + y) % 2 == 0) ? kVd : -kVd);
+                elem->setQ(0.03 * ((y * cols + x) % 7) - 0.09);
+            }
+        plain.getElement(rows / 2, cols / 3)->setExternalVoltage(0.05);
+        plain.setParameterClasses(classes);
+        for (int iterations : {1, 5, 9})
+        {
+            for (int tileRows : {1, 4, 16, 64})
+            {
+                auto tiled = plain;
+                auto untiled = plain;
+                if (threads > 1)
+                    tiled.setThreadPool(std::make_shared<ThreadPool>(threads));
+                RelaxationConfig config;
+                config.maxIterations = iterations;
+                const RelaxationStats u = untiled.relax(config);
+                config.tileRows = tileRows;
+                const RelaxationStats t = tiled.relax(config);
+                ASSERT_EQ(u.iterations, t.iterations);
+                ASSERT_EQ(u.residual, t.residual);
+                for (int y = 0; y < rows; ++y)
+                    for (int x = 0; x < cols; ++x)
+                    {
+                        ASSERT_EQ(untiled.getElement(y, x)->getVn(), tiled.getElement(y, x)->getVn());
+                        ASSERT_EQ(untiled.getElement(y, x)->getSurroundingVsum(), tiled.getElement(y, x)->getSurroundingVsum());
+                    }
+            }
+        }
+    }
+}
+
+// Jacobi法の時間方向ブロッキングが、タイルを使わない反復とビット単位で一致すること
+TEST(FlatSEOGridTest, TiledJacobiMatchesUntiled)
+{
+    expectTiledJacobiMatches<VonNeumann4>(37, 23, false, 1);
+    expectTiledJacobiMatches<VonNeumann4>(37, 23, true, 3);
+    expectTiledJacobiMatches<Moore8>(20, 9, false, 2);
+    expectTiledJacobiMatches<Hex6>(3, 11, false, 1);
+
+    // 反復回数は固定なので、許容誤差とは一緒に使えない
+    RelaxationConfig config;
+    config.tileRows = 8;
+    config.tolerance = 1e-9;
+    EXPECT_THROW(validateRelaxationConfig(config), std::invalid_argument);
+    config.tileRows = -1;
+    config.tolerance = 0.0;
+    EXPECT_THROW(validateRelaxationConfig(config), std::invalid_argument);
+}
+
+// パラメータクラスモード：市松模様のバイアスは2クラスになり、素子ごとの値と同じ結果になること
+TEST(FlatSEOGridTest, ParameterClassesMatchPerCell)
+{
+    const int rows = 6, cols = 7;
+    Grid2D<FlatSEO> perCell = makeFlatGrid(rows, cols);
+    Grid2D<FlatSEO> classed = makeFlatGrid(rows, cols);
+    classed.setParameterClasses(true);
+    EXPECT_TRUE(classed.isParameterClasses());
+    EXPECT_EQ(classed.numParameterClasses(), 2);
+    EXPECT_EQ(perCell.numParameterClasses(), 0);
+    EXPECT_NE(classed.getElement(0, 0)->getParameterClass(), classed.getElement(0, 1)->getParameterClass());
+    for (auto *grid : {&perCell, &classed})
+    {
+        for (int i = 0; i < rows * cols; ++i)
+            grid->getElement(i / cols, i % cols)->setQ(0.01 * (i % 5) - 0.02);
+    }
+
+    RelaxationConfig config;
+    config.maxIterations = 100;
+    config.tolerance = 1e-15;
+    for (auto method : {RelaxationMethod::Jacobi, RelaxationMethod::RedBlackSOR, RelaxationMethod::Direct})
+    {
+        config.method = method;
+        perCell.relax(config);
+        classed.relax(config);
+        perCell.updateGriddE();
+        classed.updateGriddE();
+        for (int y = 0; y < rows; ++y)
+        {
+            for (int x = 0; x < cols; ++x)
+            {
+                auto p = perCell.getElement(y, x);
+                auto c = classed.getElement(y, x);
+                EXPECT_EQ(c->getVd(), p->getVd());
+                EXPECT_EQ(c->getCj(), p->getCj());
+                EXPECT_EQ(c->getlegs(), p->getlegs());
+                EXPECT_NEAR(c->getVn(), p->getVn(), 1e-14);
+                EXPECT_NEAR(c->getdE()[TunnelDirection::Up], p->getdE()[TunnelDirection::Up], 1e-14);
+                EXPECT_NEAR(c->getdE()[TunnelDirection::Down], p->getdE()[TunnelDirection::Down], 1e-14);
+            }
+        }
+    }
+    perCell.updateGridQn(0.1);
+    classed.updateGridQn(0.1);
+    EXPECT_NEAR(classed.getElement(2, 3)->getQ(), perCell.getElement(2, 3)->getQ(), 1e-15);
+
+    // 設定し直すとクラスが増え、バイアスだけ変えても同じ回路パラメータのまま
+    classed.getElement(1, 1)->setUp(kR, kRj, 12.0, kC, kVd, 4);
+    EXPECT_EQ(classed.numParameterClasses(), 3);
+    classed.getElement(1, 2)->setVias(0.001);
+    EXPECT_EQ(classed.getElement(1, 2)->getVd(), 0.001);
+    EXPECT_EQ(classed.getElement(1, 2)->getCj(), kCj);
+
+    // 素子ごとの配列に戻しても値は同じ
+    classed.setParameterClasses(false);
+    EXPECT_FALSE(classed.isParameterClasses());
+    EXPECT_EQ(classed.getElement(1, 1)->getCj(), 12.0);
+    EXPECT_EQ(classed.getElement(1, 2)->getVd(), 0.001);
+    EXPECT_EQ(classed.getElement(0, 1)->getVd(), -kVd);
+}
+
+// クラスが65536個を超えると例外になり、元の状態のまま
+TEST(FlatSEOGridTest, TooManyParameterClasses)
+{
+    Grid2D<FlatSEO> grid(257, 256, false);
+    for (int i = 0; i < grid.numCells(); ++i)
+        grid.getElement(i / 256, i % 256)->setUp(kR, kRj, kCj, kC, 1e-6 * i, 4);
+    EXPECT_THROW(grid.setParameterClasses(true), std::invalid_argument);
+    EXPECT_FALSE(grid.isParameterClasses());
+    EXPECT_EQ(grid.numParameterClasses(), 0);
+    EXPECT_EQ(grid.getElement(256, 255)->getVd(), 1e-6 * (grid.numCells() - 1));
+}
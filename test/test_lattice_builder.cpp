@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include "lattice_builder.hpp"
+
+namespace
+{
+    const LatticeParams kParams{0.5, 0.002, 10.0, 2.0, 0.0044};
+
+    // main.cppで使っていた、素子ごとに接続する配線(buildPointerGridと同じになるかを確かめる参照。他のテストはbuilderを使う)
+    Grid2D<SEO> makeManualGrid(int rows, int cols)
+    {
+        Grid2D<SEO> grid(rows, cols);
+        for (int y = 0; y < rows; ++y)
+        {
+            for (int x = 0; x < cols; ++x)
+            {
+                auto seo = grid.getElement(y, x);
+                seo->setUp(kParams.R, kParams.Rj, kParams.Cj, kParams.C, ((x + y) % 2 == 0) ? kParams.Vd : -kParams.Vd, 4);
+                std::vector<std::shared_ptr<SEO>> connections;
+                if (y > 0) connections.push_back(grid.getElement(y - 1, x));
+                if (x < cols - 1) connections.push_back(grid.getElement(y, x + 1));
+                if (y < rows - 1) connections.push_back(grid.getElement(y + 1, x));
+                if (x > 0) connections.push_back(grid.getElement(y, x - 1));
+                seo->setConnections(connections);
+            }
+        }
+        return grid;
+    }
+
+    // 少し電荷を置いて緩和し、dEまで求める
+    template <typename Grid>
+    void settle(Grid &grid)
+    {
+        for (int y = 0; y < grid.numRows(); ++y)
+            for (int x = 0; x < grid.numCols(); ++x)
+                grid.getElement(y, x)->setQ(0.01 * ((y * grid.numCols() + x) % 5) - 0.02);
+        RelaxationConfig config;
+        config.maxIterations = 300;
+        config.tolerance = 1e-14;
+        grid.relax(config);
+        grid.updateGriddE();
+    }
+}
+
+// 組み立てた格子が、素子ごとに配線した格子と同じになること
+TEST(LatticeBuilderTest, MatchesManualWiring)
+{
+    const int rows = 6, cols = 7;
+    Grid2D<SEO> manual = makeManualGrid(rows, cols);
+    LatticeBuilder builder(rows, cols);
+    builder.setParams(kParams).setCheckerboardBias();
+    Grid2D<SEO> pointer = builder.buildPointerGrid();
+    EXPECT_GE(builder.getBuildSeconds(), 0.0);
+    Grid2D<FlatSEO> flat = builder.buildFlatGrid();
+    SEOGraph graph = builder.buildGraph();
+    Grid2D<FlatSEO> classed = builder.setParameterClasses(true).buildFlatGrid();
+    EXPECT_EQ(classed.numParameterClasses(), 2);
+    settle(manual);
+    settle(pointer);
+    settle(flat);
+    settle(graph);
+    settle(classed);
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            auto m = manual.getElement(y, x);
+            EXPECT_EQ(pointer.getElement(y, x)->getConnection().size(), m->getConnection().size());
+            EXPECT_EQ(pointer.getElement(y, x)->getVd(), m->getVd());
+            EXPECT_EQ(flat.getElement(y, x)->getVd(), m->getVd());
+            EXPECT_EQ(graph.getElement(y, x)->getVd(), m->getVd());
+            EXPECT_EQ(pointer.getElement(y, x)->getVn(), m->getVn());
+            EXPECT_NEAR(flat.getElement(y, x)->getVn(), m->getVn(), 1e-12);
+            EXPECT_NEAR(graph.getElement(y, x)->getVn(), m->getVn(), 1e-12);
+            EXPECT_NEAR(classed.getElement(y, x)->getVn(), m->getVn(), 1e-12);
+            EXPECT_NEAR(graph.getElement(y, x)->getdE()[TunnelDirection::Up], m->getdE()[TunnelDirection::Up], 1e-12);
+        }
+    }
+}
+
+// 周期境界では全素子の隣接が4つになり、反対側の端とつながること
+TEST(LatticeBuilderTest, PeriodicBoundary)
+{
+    LatticeBuilder builder(4, 5);
+    builder.setParams(kParams).setBoundary(BoundaryMode::Periodic);
+    SEOGraph graph = builder.buildGraph();
+    EXPECT_EQ(graph.numEdges(), 2 * 4 * 5);
+    for (int i = 0; i < graph.numCells(); ++i)
+    {
+        EXPECT_EQ(graph.degree(i), 4);
+        EXPECT_EQ(graph.getNode(i)->getGroundCapacitance(), 0.0);
+        EXPECT_EQ(graph.getNode(i)->getVd(), kParams.Vd);
+    }
+    // (0,0)は(0,4)と(3,0)にもつながる
+    std::vector<int> n0;
+    for (int k = 0; k < graph.degree(0); ++k)
+        n0.push_back(graph.neighbour(0, k));
+    std::sort(n0.begin(), n0.end());
+    EXPECT_EQ(n0, (std::vector<int>{1, 4, 5, 15}));
+
+    Grid2D<SEO> pointer = builder.buildPointerGrid();
+    EXPECT_EQ(pointer.getElement(0, 0)->getConnection().size(), 4u);
+    EXPECT_EQ(pointer.getElement(0, 0)->getConnection()[0], pointer.getElement(3, 0));
+
+    EXPECT_THROW(builder.buildFlatGrid(), std::invalid_argument);
+    EXPECT_THROW(LatticeBuilder(2, 5).setBoundary(BoundaryMode::Periodic), std::invalid_argument);
+}
+
+// 任意のバイアスパターン
+TEST(LatticeBuilderTest, CustomBiasPattern)
+{
+    LatticeBuilder builder(3, 3);
+    builder.setParams(kParams).setBiasPattern([](int, int col, double vd) { return (col == 0) ? vd : 0.0; });
+    auto grid = builder.buildFlatGrid<Moore8>();
+    EXPECT_EQ(grid.getElement(2, 0)->getVd(), kParams.Vd);
+    EXPECT_EQ(grid.getElement(2, 1)->getVd(), 0.0);
+    EXPECT_EQ(grid.getElement(1, 1)->getlegs(), 8);
+    EXPECT_THROW(builder.setBiasPattern(nullptr), std::invalid_argument);
+    EXPECT_THROW(LatticeBuilder(0, 3), std::invalid_argument);
+}
@@ -0,0 +1,86 @@
+#ifndef TEST_LATTICES_HPP
+#define TEST_LATTICES_HPP
+
+#include <vector>
+#include <type_traits>
+#include <utility>
+#include "lattice_builder.hpp"
+
+// テストで共通に使う格子(LatticeBuilderで作る)
+namespace test_lattices
+{
+    // 自励振動するパラメータ(Ctot*Vd = 0.108 > e/2)
+    const LatticeParams oscillating{0.5, 0.002, 10.0, 2.0, 0.006};
+
+    // 格子の型がモードの切り替えを持つか(使えない組み合わせは呼ぶとコンパイルエラーになる)
+    template <typename Grid, typename = void>
+    struct HasIncrementalUpdate : std::false_type
+    {
+    };
+    template <typename Grid>
+    struct HasIncrementalUpdate<Grid, std::void_t<decltype(std::declval<Grid &>().setIncrementalUpdate(true))>>
+        : std::true_type
+    {
+    };
+    template <typename Grid, typename = void>
+    struct HasParameterClasses : std::false_type
+    {
+    };
+    template <typename Grid>
+    struct HasParameterClasses<Grid, std::void_t<decltype(std::declval<Grid &>().setParameterClasses(true))>>
+        : std::true_type
+    {
+    };
+    template <typename Grid, typename = void>
+    struct HasGreenUpdate : std::false_type
+    {
+    };
+    template <typename Grid>
+    struct HasGreenUpdate<Grid, std::void_t<decltype(std::declval<Grid &>().setGreenUpdate(true))>> : std::true_type
+    {
+    };
+
+    // 自励振動するパラメータで市松模様にバイアスした格子のbuilder
+    inline LatticeBuilder oscillatingBuilder(int rows, int cols, bool output = false)
+    {
+        LatticeBuilder builder(rows, cols);
+        builder.setParams(oscillating).setCheckerboardBias().setOutputEnabled(output);
+        return builder;
+    }
+
+    // 素子ごとに異なる電荷 step * (i % period) + offset を置く(iは行優先の通し番号)
+    template <typename Grid>
+    void setChargePattern(Grid &grid, double step, int period, double offset)
+    {
+        for (int i = 0; i < grid.numRows() * grid.numCols(); ++i)
+            grid.getElement(i / grid.numCols(), i % grid.numCols())->setQ(step * (i % period) + offset);
+    }
+
+    // 自励振動する格子に、素子ごとに異なる電荷(0.01 * (i % 7) - 0.03)を置いたもの
+    inline Grid2D<FlatSEO> makeOscillatingGrid(int rows, int cols, bool output = false)
+    {
+        Grid2D<FlatSEO> grid = oscillatingBuilder(rows, cols, output).buildFlatGrid();
+        setChargePattern(grid, 0.01, 7, -0.03);
+        return grid;
+    }
+
+    // makeOscillatingGridと同じ格子のGrid2D<SEO>
+    inline Grid2D<SEO> makeOscillatingPointerGrid(int rows, int cols, bool output = false)
+    {
+        Grid2D<SEO> grid = oscillatingBuilder(rows, cols, output).buildPointerGrid();
+        setChargePattern(grid, 0.01, 7, -0.03);
+        return grid;
+    }
+
+    // gridの全素子の電荷
+    template <typename Grid>
+    std::vector<double> charges(const Grid &grid)
+    {
+        std::vector<double> q;
+        for (int i = 0; i < grid.numRows() * grid.numCols(); ++i)
+            q.push_back(grid.getElement(i / grid.numCols(), i % grid.numCols())->getQ());
+        return q;
+    }
+}
+
+#endif // TEST_LATTICES_HPP
@@ -0,0 +1,94 @@
+#include <mpi.h>
+#include "gtest/gtest.h"
+#include "mpi_simulation_2d.hpp"
+#include "test_lattices.hpp"
+
+// mpirun -np 4 で実行する(ランク0が1プロセスの結果を計算して比べる)
+
+using test_lattices::makeOscillatingGrid;
+using test_lattices::charges;
+
+namespace
+{
+    // 全ランクで成否をそろえる(どこかのランクで失敗したら全ランクで失敗にする)
+    bool allRanks(bool ok)
+    {
+        int local = ok ? 1 : 0, global = 0;
+        MPI_Allreduce(&local, &global, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        return global == 1;
+    }
+}
+
+// 分けて実行しても、1プロセスと同じトンネルの経過・出力になること
+TEST(MPISimulation2DTest, MatchesSingleProcessBitwise)
+{
+    const double endtime = 30.0;
+    MPISimulation2D<FlatSEO> sim(0.1, endtime);
+    sim.setSeed(5);
+    sim.distributeGrid(makeOscillatingGrid(13, 9, true));
+    Grid2D<FlatSEO> small = makeOscillatingGrid(5, 6, true);
+    small.setOutputLabel("small");
+    Grid2D<FlatSEO> &part = sim.distributeGrid(small);
+    sim.addVoltageTrigger(10.0, &part, 2, 3, 0.05);
+    sim.run();
+    const std::vector<double> q0 = sim.gatherCharges(0), q1 = sim.gatherCharges(1);
+    const std::vector<double> v0 = sim.gatherVoltages(0);
+    ASSERT_GT(sim.getSize(), 1);
+    ASSERT_TRUE(allRanks(sim.getOwnedRows(0) > 0));
+
+    if (sim.getRank() == 0)
+    {
+        Simulation2D<FlatSEO> single(0.1, endtime);
+        single.setSeed(5);
+        single.appendGrid(makeOscillatingGrid(13, 9, true));
+        Grid2D<FlatSEO> &reference = single.appendGrid(std::move(small));
+        single.addVoltageTrigger(10.0, &reference, 2, 3, 0.05);
+        single.run();
+
+        ASSERT_GT(single.getTunnelCount(), 50);
+        EXPECT_EQ(sim.getTunnelCount(), single.getTunnelCount());
+        EXPECT_EQ(sim.getTime(), single.getTime());
+        EXPECT_EQ(q0, charges(single.getGrids()[0]));
+        EXPECT_EQ(q1, charges(single.getGrids()[1]));
+        for (int i = 0; i < single.getGrids()[0].numCells(); ++i)
+            EXPECT_EQ(v0[i], single.getGrids()[0].getElement(i / 9, i % 9)->getVn()) << i;
+        EXPECT_EQ(sim.getOutputs(), single.getOutputs());
+    }
+    else
+    {
+        EXPECT_TRUE(q0.empty());
+        EXPECT_TRUE(sim.getOutputs().empty());
+    }
+}
+
+// 扱えない設定は全ランクで例外になること
+TEST(MPISimulation2DTest, RejectsUnsupportedConfiguration)
+{
+    MPISimulation2D<FlatSEO> sim(0.1, 1.0);
+    EXPECT_THROW(sim.distributeGrid(Grid2D<FlatSEO>(sim.getSize() - 1, 3)), std::invalid_argument);
+    sim.distributeGrid(makeOscillatingGrid(8, 4, true));
+    RelaxationConfig sor;
+    sor.method = RelaxationMethod::RedBlackSOR;
+    sim.setRelaxation(sor);
+    EXPECT_THROW(sim.runStep(), std::logic_error);
+    sim.setRelaxation(RelaxationConfig());
+    sim.setChargeIntegrator(ChargeIntegrator::ExponentialJump);
+    EXPECT_THROW(sim.runStep(), std::logic_error);
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // 結果の表示はランク0だけにする
+    if (rank != 0)
+    {
+        auto &listeners = ::testing::UnitTest::GetInstance()->listeners();
+        delete listeners.Release(listeners.default_result_printer());
+    }
+    const int result = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return result;
+}
@@ -0,0 +1,191 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include "flat_seo_grid.hpp"
+#include "lattice_builder.hpp"
+#include "test_lattices.hpp"
+#include "simulation_2d.hpp"
+#include "thread_pool.hpp"
+
+using test_lattices::makeOscillatingGrid;
+
+namespace
+{
+    // 一様にバイアスしたGrid2D<SEO>
+    Grid2D<SEO> makePointerGrid(int rows, int cols)
+    {
+        LatticeBuilder builder(rows, cols);
+        builder.setParams({0.5, 0.002, 10.0, 2.0, 0.0044}).setOutputEnabled(false);
+        Grid2D<SEO> grid = builder.buildPointerGrid();
+        test_lattices::setChargePattern(grid, 0.01, 5, -0.02);
+        return grid;
+    }
+
+    // Simulation2D::runStepと同じ順に1ステップ進める
+    bool step(Grid2D<FlatSEO> &grid, const RelaxationConfig &config, double dt)
+    {
+        grid.relax(config);
+        grid.updateGriddE();
+        bool tunnel = grid.gridminwt(dt);
+        if (tunnel)
+            grid.applyTunnel(grid.getTunnelIndex(), grid.getTunnelDirection());
+        grid.updateGridQn(tunnel ? grid.getMinWT() : dt);
+        return tunnel;
+    }
+}
+
+// 全ての添字がちょうど1回ずつ、連続した区間で処理されること
+TEST(ThreadPoolTest, CoversRangeOnce)
+{
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    std::vector<std::atomic<int>> hits(1001);
+    std::vector<int> chunkBegin(4, -1), chunkEnd(4, -1);
+    for (int repeat = 0; repeat < 20; ++repeat)
+    {
+        pool.parallelFor(0, 1001, [&](int chunk, int first, int last) {
+            chunkBegin[chunk] = first;
+            chunkEnd[chunk] = last;
+            for (int i = first; i < last; ++i)
+                ++hits[i];
+        });
+    }
+    for (auto &h : hits)
+        EXPECT_EQ(h.load(), 20);
+    EXPECT_EQ(chunkBegin[0], 0);
+    EXPECT_EQ(chunkEnd[3], 1001);
+    for (int c = 1; c < 4; ++c)
+        EXPECT_EQ(chunkBegin[c], chunkEnd[c - 1]);
+
+    EXPECT_THROW(ThreadPool(0), std::invalid_argument);
+}
+
+// 区間で投げられた例外は呼び出し元に伝わること
+TEST(ThreadPoolTest, PropagatesExceptions)
+{
+    ThreadPool pool(3);
+    EXPECT_THROW(pool.parallelFor(0, 30, [](int chunk, int, int) {
+                     if (chunk == 2)
+                         throw std::runtime_error("chunk failed");
+                 }),
+                 std::runtime_error);
+    // 例外の後も使えること
+    std::atomic<int> count(0);
+    pool.parallelFor(0, 30, [&](int, int first, int last) { count += last - first; });
+    EXPECT_EQ(count.load(), 30);
+}
+
+// 同じシードなら、並列実行でも逐次と全く同じ経過になること
+TEST(ParallelGridTest, FlatGridMatchesSerial)
+{
+    for (RelaxationMethod method : {RelaxationMethod::Jacobi, RelaxationMethod::RedBlackSOR})
+    {
+        auto serial = makeOscillatingGrid(13, 11);
+        auto parallel = makeOscillatingGrid(13, 11);
+        parallel.setThreadPool(std::make_shared<ThreadPool>(4));
+        serial.seedRandom(7);
+        parallel.seedRandom(7);
+
+        RelaxationConfig config;
+        config.method = method;
+        int tunnels = 0;
+        for (int s = 0; s < 300; ++s)
+        {
+            bool ts = step(serial, config, 0.1);
+            bool tp = step(parallel, config, 0.1);
+            ASSERT_EQ(ts, tp);
+            if (ts)
+            {
+                ASSERT_EQ(serial.getTunnelIndex(), parallel.getTunnelIndex());
+                ASSERT_EQ(serial.getMinWT(), parallel.getMinWT());
+                ++tunnels;
+            }
+        }
+        EXPECT_GT(tunnels, 0);
+        for (int i = 0; i < serial.numCells(); ++i)
+        {
+            ASSERT_EQ(serial.getElement(i / 11, i % 11)->getVn(), parallel.getElement(i / 11, i % 11)->getVn());
+            ASSERT_EQ(serial.getElement(i / 11, i % 11)->getQ(), parallel.getElement(i / 11, i % 11)->getQ());
+        }
+    }
+}
+
+// Grid2D<SEO>でも、素子ごとの処理は並列でも同じ結果になること
+TEST(ParallelGridTest, PointerGridMatchesSerial)
+{
+    auto serial = makePointerGrid(9, 10);
+    auto parallel = makePointerGrid(9, 10);
+    parallel.setThreadPool(std::make_shared<ThreadPool>(3));
+    RelaxationConfig config;
+    config.maxIterations = 20;
+    EXPECT_EQ(serial.relax(config).residual, parallel.relax(config).residual);
+    serial.updateGriddE();
+    parallel.updateGriddE();
+    serial.updateGridQn(0.1);
+    parallel.updateGridQn(0.1);
+    for (int y = 0; y < 9; ++y)
+    {
+        for (int x = 0; x < 10; ++x)
+        {
+            EXPECT_EQ(serial.getElement(y, x)->getVn(), parallel.getElement(y, x)->getVn());
+            EXPECT_EQ(serial.getElement(y, x)->getdE()[TunnelDirection::Up],
+                      parallel.getElement(y, x)->getdE()[TunnelDirection::Up]);
+            EXPECT_EQ(serial.getElement(y, x)->getQ(), parallel.getElement(y, x)->getQ());
+        }
+    }
+}
+
+// Grid2D<SEO>の赤黒SORは、同じ色の素子が隣接する配線(奇数サイズの周期境界)でも逐次と同じ結果になること
+TEST(ParallelGridTest, PointerGridSORMatchesSerialOnOddPeriodicLattice)
+{
+    LatticeBuilder builder(9, 9);
+    builder.setParams({0.5, 0.002, 10.0, 2.0, 0.0044}).setBoundary(BoundaryMode::Periodic);
+    auto serial = builder.buildPointerGrid();
+    auto parallel = builder.buildPointerGrid();
+    for (int i = 0; i < 81; ++i)
+    {
+        serial.getElement(i / 9, i % 9)->setQ(0.01 * (i % 5) - 0.02);
+        parallel.getElement(i / 9, i % 9)->setQ(0.01 * (i % 5) - 0.02);
+    }
+    parallel.setThreadPool(std::make_shared<ThreadPool>(8));
+    RelaxationConfig sor;
+    sor.method = RelaxationMethod::RedBlackSOR;
+    sor.omega = 1.5;
+    sor.maxIterations = 3;
+    EXPECT_EQ(serial.relax(sor).residual, parallel.relax(sor).residual);
+    for (int i = 0; i < 81; ++i)
+    {
+        EXPECT_EQ(serial.getElement(i / 9, i % 9)->getVn(), parallel.getElement(i / 9, i % 9)->getVn());
+        EXPECT_EQ(serial.getElement(i / 9, i % 9)->getSurroundingVsum(),
+                  parallel.getElement(i / 9, i % 9)->getSurroundingVsum());
+    }
+}
+
+// Simulation2Dのスレッド数の設定が、後から追加したgridにも使われること
+TEST(ParallelGridTest, SimulationThreadCount)
+{
+    Simulation2D<FlatSEO> serial(0.1, 20.0), parallel(0.1, 20.0);
+    EXPECT_EQ(parallel.getThreadCount(), 1);
+    parallel.setThreadCount(4);
+    EXPECT_EQ(parallel.getThreadCount(), 4);
+    EXPECT_THROW(parallel.setThreadCount(0), std::invalid_argument);
+
+    auto a = makeOscillatingGrid(8, 8);
+    auto b = makeOscillatingGrid(8, 8);
+    a.seedRandom(3);
+    b.seedRandom(3);
+    serial.appendGrid(std::move(a));
+    Grid2D<FlatSEO> &added = parallel.appendGrid(std::move(b));
+    ASSERT_NE(added.getThreadPool(), nullptr);
+    EXPECT_EQ(added.getThreadPool()->size(), 4);
+
+    serial.run();
+    parallel.run();
+    EXPECT_EQ(serial.getTime(), parallel.getTime());
+    auto &gs = serial.getGrids()[0];
+    auto &gp = parallel.getGrids()[0];
+    for (int i = 0; i < gs.numCells(); ++i)
+        EXPECT_EQ(gs.getElement(i / 8, i % 8)->getQ(), gp.getElement(i / 8, i % 8)->getQ());
+
+    parallel.setThreadCount(1);
+    EXPECT_EQ(parallel.getGrids()[0].getThreadPool(), nullptr);
+}
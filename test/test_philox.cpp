@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+#include "philox.hpp"
+#include "flat_seo_grid.hpp"
+#include "simulation_2d.hpp"
+#include "event_simulation_2d.hpp"
+#include "test_lattices.hpp"
+
+using test_lattices::makeOscillatingGrid;
+using test_lattices::makeOscillatingPointerGrid;
+
+namespace
+{
+    // 全gridの素子の電荷
+    template <typename Element>
+    std::vector<double> charges(Simulation2D<Element> &sim)
+    {
+        std::vector<double> q;
+        for (auto &grid : sim.getGrids())
+            for (int i = 0; i < grid.numCells(); ++i)
+                q.push_back(grid.getElement(i / grid.numCols(), i % grid.numCols())->getQ());
+        return q;
+    }
+}
+
+// Random123の既知の出力と一致すること
+TEST(PhiloxTest, KnownAnswerVectors)
+{
+    EXPECT_EQ(Philox4x32::generate({0, 0, 0, 0}, {0, 0}),
+              (Philox4x32::Counter{0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}));
+    EXPECT_EQ(Philox4x32::generate({0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu}, {0xffffffffu, 0xffffffffu}),
+              (Philox4x32::Counter{0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}));
+    EXPECT_EQ(Philox4x32::generate({0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u}, {0xa4093822u, 0x299f31d0u}),
+              (Philox4x32::Counter{0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}));
+}
+
+// 一様乱数は(0, 1]に入り、ストリームごとに異なり、何度計算しても同じ値になること
+TEST(PhiloxTest, UniformStreams)
+{
+    double sum = 0.0;
+    const int n = 20000;
+    for (int k = 0; k < n; ++k)
+    {
+        const double u = philoxUniform(12, 3, k);
+        ASSERT_GT(u, 0.0);
+        ASSERT_LE(u, 1.0);
+        sum += u;
+    }
+    EXPECT_NEAR(sum / n, 0.5, 0.01);
+    EXPECT_EQ(philoxUniform(12, 3, 7), philoxUniform(12, 3, 7));
+    EXPECT_NE(philoxUniform(12, 3, 7), philoxUniform(12, 4, 7));
+    EXPECT_NE(philoxUniform(12, 3, 7), philoxUniform(13, 3, 7));
+    EXPECT_NE(deriveSeed(12, 0), deriveSeed(12, 1));
+
+    PhiloxStream stream{12, 3, 0};
+    EXPECT_EQ(stream.uniform(), philoxUniform(12, 3, 0));
+    EXPECT_EQ(stream.uniform(), philoxUniform(12, 3, 1));
+    EXPECT_EQ(stream.counter, 2u);
+    // シードを指定しない素子はストリーム番号が重ならない
+    EXPECT_NE(defaultPhiloxStream().stream, defaultPhiloxStream().stream);
+}
+
+// SEOの乱数列はシードとストリーム番号だけで決まり、gridのseedRandomは素子の添字を番号にすること
+TEST(PhiloxTest, SEORandomStreams)
+{
+    SEO a, b;
+    a.setRandomStream(5, 9);
+    b.setRandomStream(5, 9);
+    EXPECT_EQ(a.Random(), b.Random());
+    EXPECT_EQ(a.Random(), philoxUniform(5, 9, 1));
+    a.setRandomStream(5, 9);
+    EXPECT_EQ(a.getRandomStream().counter, 0u);
+
+    Grid2D<SEO> grid(3, 4, false);
+    grid.seedRandom(21);
+    EXPECT_EQ(grid.getElement(2, 1)->getRandomStream().seed, 21u);
+    EXPECT_EQ(grid.getElement(2, 1)->getRandomStream().stream, 9u);
+}
+
+// 同じシードなら、スレッド数によらずGrid2D<SEO>とGrid2D<FlatSEO>のトンネルの経過が同じになること
+// (後から追加したgridにもシードが使われる)
+TEST(PhiloxTest, SimulationSeedIsThreadIndependent)
+{
+    std::vector<std::vector<double>> pointerQ, flatQ;
+    for (int threads : {1, 3})
+    {
+        Simulation2D<SEO> pointer(0.1, 20.0);
+        pointer.setThreadCount(threads);
+        pointer.setSeed(42);
+        pointer.addGrid({makeOscillatingPointerGrid(7, 9)});
+        pointer.run();
+        pointerQ.push_back(charges(pointer));
+
+        Simulation2D<FlatSEO> flat(0.1, 20.0);
+        flat.appendGrid(makeOscillatingGrid(7, 9));
+        flat.setThreadCount(threads);
+        flat.setSeed(42);
+        flat.appendGrid(makeOscillatingGrid(5, 5));
+        EXPECT_EQ(flat.getSeed(), 42u);
+        flat.run();
+        flatQ.push_back(charges(flat));
+    }
+    EXPECT_EQ(pointerQ[0], pointerQ[1]);
+    EXPECT_EQ(flatQ[0], flatQ[1]);
+
+    // シードが違えば経過も変わる
+    Simulation2D<FlatSEO> other(0.1, 20.0);
+    other.appendGrid(makeOscillatingGrid(7, 9));
+    other.appendGrid(makeOscillatingGrid(5, 5));
+    other.setSeed(43);
+    other.run();
+    EXPECT_NE(charges(other), flatQ[0]);
+    EXPECT_THROW(Simulation2D<FlatSEO>(0.1, 1.0).getSeed(), std::logic_error);
+}
+
+// イベント駆動のエンジンでも、同じシードなら同じ経過になること
+TEST(PhiloxTest, EventSimulationSeed)
+{
+    std::vector<std::vector<double>> finalQ;
+    std::vector<long long> tunnels;
+    for (int threads : {1, 2})
+    {
+        EventSimulation2D<FlatSEO> sim(0.1, 20.0);
+        sim.setThreadCount(threads);
+        sim.addGrid({makeOscillatingGrid(6, 6)});
+        sim.setSeed(8);
+        sim.run();
+        finalQ.push_back(charges(sim));
+        tunnels.push_back(sim.getTunnelCount());
+    }
+    EXPECT_GT(tunnels[0], 0);
+    EXPECT_EQ(tunnels[0], tunnels[1]);
+    EXPECT_EQ(finalQ[0], finalQ[1]);
+}
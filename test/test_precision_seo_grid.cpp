@@ -0,0 +1,171 @@
+#include "gtest/gtest.h"
+#include "flat_seo_grid.hpp"
+#include "precision_comparison.hpp"
+#include "test_lattices.hpp"
+#include "simulation_2d.hpp"
+
+using test_lattices::charges;
+
+// 倍精度はGrid2D<FlatSEO>そのもので、buildPrecisionGrid<double>もbuildFlatGridと同じ経過になること
+TEST(PrecisionSEOGridTest, DoubleMatchesFlatGridBitwise)
+{
+    static_assert(std::is_same<DoubleSEO, FlatSEO>::value, "double precision is the flat grid");
+    RelaxationConfig sor;
+    sor.method = RelaxationMethod::RedBlackSOR;
+    sor.omega = 1.3;
+    sor.tolerance = 1e-10;
+    sor.maxIterations = 20;
+    for (const auto &[config, integrator] : {std::make_pair(RelaxationConfig(), ChargeIntegrator::Euler),
+                                             std::make_pair(sor, ChargeIntegrator::ExponentialJump)})
+    {
+        LatticeBuilder builder(7, 6);
+        builder.setParams(test_lattices::oscillating).setCheckerboardBias();
+        Simulation2D<FlatSEO> flat(0.1, 20.0);
+        Simulation2D<DoubleSEO> precise(0.1, 20.0);
+        Grid2D<FlatSEO> &a = flat.appendGrid(builder.buildFlatGrid());
+        Grid2D<DoubleSEO> &b = precise.appendGrid(builder.buildPrecisionGrid<double>());
+        test_lattices::setChargePattern(a, 0.01, 5, -0.02);
+        test_lattices::setChargePattern(b, 0.01, 5, -0.02);
+        flat.addVoltageTrigger(5.0, &a, 2, 3, 0.05);
+        precise.addVoltageTrigger(5.0, &b, 2, 3, 0.05);
+        flat.setRelaxation(config);
+        precise.setRelaxation(config);
+        flat.setChargeIntegrator(integrator);
+        precise.setChargeIntegrator(integrator);
+        flat.setSeed(3);
+        precise.setSeed(3);
+        flat.run();
+        precise.run();
+
+        ASSERT_GT(flat.getTunnelCount(), 20);
+        EXPECT_EQ(precise.getTunnelCount(), flat.getTunnelCount());
+        EXPECT_EQ(precise.getTime(), flat.getTime());
+        EXPECT_EQ(charges(precise.getGrids()[0]), charges(flat.getGrids()[0]));
+        EXPECT_EQ(precise.getOutputs(), flat.getOutputs());
+    }
+}
+
+// 単精度の格子も、どの命令セットのカーネルで回しても同じ経過になること
+TEST(PrecisionSEOGridTest, SinglePrecisionMatchesAcrossSimdLevels)
+{
+    std::vector<std::vector<double>> finalQ;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        if (!isSimdLevelSupported(level))
+            continue;
+        SCOPED_TRACE(simdLevelName(level));
+        Grid2D<SingleSEO> grid = test_lattices::oscillatingBuilder(9, 21).buildPrecisionGrid<float>();
+        test_lattices::setChargePattern(grid, 0.01, 5, -0.02);
+        grid.setSimdLevel(level);
+        grid.seedRandom(5);
+        int tunnels = 0;
+        for (int s = 0; s < 300; ++s)
+        {
+            grid.relax(RelaxationConfig());
+            grid.updateGriddE();
+            const bool tunnel = grid.gridminwt(0.1);
+            if (tunnel)
+            {
+                grid.applyTunnel(grid.getTunnelIndex(), grid.getTunnelDirection());
+                ++tunnels;
+            }
+            grid.updateGridQn(tunnel ? grid.getMinWT() : 0.1);
+        }
+        EXPECT_GT(tunnels, 0);
+        finalQ.push_back(charges(grid));
+    }
+    for (const auto &q : finalQ)
+        EXPECT_EQ(q, finalQ.front());
+}
+
+// 単精度の格子は状態をfloatで持ち、Simulation2Dからそのまま使えること
+TEST(PrecisionSEOGridTest, SinglePrecisionRunsInSimulation)
+{
+    LatticeBuilder builder(6, 6);
+    builder.setParams(test_lattices::oscillating).setCheckerboardBias();
+    Grid2D<SingleSEO> grid = builder.buildPrecisionGrid<float>();
+    static_assert(std::is_same<Grid2D<SingleSEO>::value_type, float>::value, "state must be float");
+    grid.getElement(1, 1)->setQ(0.1);
+    EXPECT_EQ(grid.getElement(1, 1)->getQ(), static_cast<double>(0.1f));
+    EXPECT_EQ(grid.getElement(2, 3)->getVd(), static_cast<double>(-0.006f));
+
+    Simulation2D<SingleSEO, float> sim(0.1, 10.0);
+    sim.setSeed(1);
+    sim.addGrid({grid});
+    sim.run();
+    EXPECT_GT(sim.getTunnelCount(), 0);
+    const auto &frames = sim.getOutputs().at("output0");
+    ASSERT_EQ(frames.size(), 100u);
+    EXPECT_EQ(frames[0].size(), 4u);
+
+    // 直接法などは倍精度のGrid2D<FlatSEO>だけ
+    RelaxationConfig direct;
+    direct.method = RelaxationMethod::Direct;
+    EXPECT_FALSE(Grid2D<SingleSEO>::supportsRelaxation(direct));
+    EXPECT_THROW(grid.relax(direct), std::invalid_argument);
+    EXPECT_THROW(sim.setRelaxation(direct), std::invalid_argument);
+    RelaxationConfig tiled;
+    tiled.tileRows = 2;
+    EXPECT_FALSE(Grid2D<SingleSEO>::supportsRelaxation(tiled));
+    EXPECT_TRUE(Grid2D<DoubleSEO>::supportsRelaxation(tiled));
+    EXPECT_THROW(grid.relax(tiled), std::invalid_argument);
+    // インクリメンタル更新・パラメータクラス・グリーン関数の切り替えは単精度の格子には無い
+    static_assert(!test_lattices::HasIncrementalUpdate<Grid2D<SingleSEO>>::value, "no incremental update in float");
+    static_assert(!test_lattices::HasParameterClasses<Grid2D<SingleSEO>>::value, "no parameter classes in float");
+    static_assert(!test_lattices::HasGreenUpdate<Grid2D<SingleSEO>>::value, "no Green update in float");
+    static_assert(test_lattices::HasIncrementalUpdate<Grid2D<DoubleSEO>>::value, "double grids are incremental");
+    EXPECT_FALSE(grid.isIncrementalUpdate());
+    EXPECT_FALSE(grid.isParameterClasses());
+    EXPECT_FALSE(grid.isGreenUpdate());
+    EXPECT_THROW(builder.setParameterClasses(true).buildPrecisionGrid<float>(), std::invalid_argument);
+}
+
+// outputsのフレームをfloatにしても、doubleのフレームを丸めた値と一致すること
+TEST(PrecisionSEOGridTest, FloatOutputFramesMatchRoundedDouble)
+{
+    LatticeBuilder builder(5, 6);
+    builder.setParams(test_lattices::oscillating).setCheckerboardBias();
+    Simulation2D<FlatSEO> wide(0.1, 5.0);
+    Simulation2D<FlatSEO, float> narrow(0.1, 5.0);
+    wide.appendGrid(builder.buildFlatGrid()).setOutputLabel("seo");
+    narrow.appendGrid(builder.buildFlatGrid()).setOutputLabel("seo");
+    wide.setSeed(8);
+    narrow.setSeed(8);
+    wide.run();
+    narrow.run();
+
+    const auto &a = wide.getOutputs().at("seo");
+    const auto &b = narrow.getOutputs().at("seo");
+    ASSERT_EQ(a.size(), b.size());
+    for (std::size_t t = 0; t < a.size(); ++t)
+        for (std::size_t y = 0; y < a[t].size(); ++y)
+            for (std::size_t x = 0; x < a[t][y].size(); ++x)
+                EXPECT_EQ(b[t][y][x], static_cast<float>(a[t][y][x]));
+}
+
+// 並べて実行すると、短い間は同じ経過のままでVnのずれが単精度の丸め誤差程度に収まること
+TEST(PrecisionSEOGridTest, ComparisonReportsSmallDrift)
+{
+    LatticeBuilder builder(8, 8);
+    builder.setParams(test_lattices::oscillating).setCheckerboardBias();
+    PrecisionComparison cmp(0.1, 5.0);
+    cmp.setSeed(4);
+    const int g = cmp.addLattice(builder);
+    cmp.addVoltageTrigger(1.0, g, 3, 3, 0.05);
+    test_lattices::setChargePattern(cmp.getReference().getGrids()[g], 0.01, 5, -0.02);
+    test_lattices::setChargePattern(cmp.getSingle().getGrids()[g], 0.01, 5, -0.02);
+    const PrecisionDrift drift = cmp.run();
+
+    ASSERT_FALSE(drift.diverged);
+    // 終了時刻まで比べた(トンネルの無いステップはdtずつ進む)
+    EXPECT_GE(cmp.getReference().getTime(), 5.0);
+    EXPECT_GT(drift.steps, drift.matchedTunnels);
+    EXPECT_GT(drift.matchedTunnels, 0);
+    EXPECT_EQ(drift.matchedTunnels, cmp.getReference().getTunnelCount());
+    EXPECT_GT(drift.maxVnDrift, 0.0);
+    EXPECT_LT(drift.maxVnDrift, 1e-5);
+    EXPECT_LE(drift.rmsVnDrift, drift.maxVnDrift);
+    EXPECT_LT(drift.maxWaitTimeDrift, 1e-4);
+    EXPECT_TRUE(drift.isAcceptable(1e-5, 1e-3));
+    EXPECT_FALSE(drift.isAcceptable(0.0, 1e-3));
+}
@@ -235,4 +235,27 @@ TEST_F(SEOTest, SetTunnel)
     // 無効なトンネル方向（例: 空文字列）では例外処理が発生することを確認
     EXPECT_THROW(oscillator->setTunnel(""), invalid_argument);
     
-}
\ No newline at end of file
+}
+
+// テストケース: TunnelDirectionでのdE/wtの参照と文字列互換
+TEST_F(SEOTest, TunnelDirectionSlots)
+{
+    auto oscillator = (*seoGrid).at(0).at(0).at(0);
+
+    oscillator->setdE(TunnelDirection::Up, -1);
+    oscillator->setdE(TunnelDirection::Down, 1);
+    EXPECT_EQ(oscillator->getdE()[TunnelDirection::Down], oscillator->getdE()["down"]);
+
+    oscillator->calculateTunnelWt();
+    const TunnelPair &wt = oscillator->getWT();
+    EXPECT_EQ(wt[TunnelDirection::Up], 0);
+    EXPECT_GT(wt[TunnelDirection::Down], 0);
+
+    oscillator->setQ(0.0);
+    oscillator->setTunnel(TunnelDirection::Down);
+    EXPECT_DOUBLE_EQ(oscillator->getQ(), e);
+
+    EXPECT_EQ(toTunnelDirection("up"), TunnelDirection::Up);
+    EXPECT_STREQ(tunnelDirectionName(TunnelDirection::Down), "down");
+    EXPECT_THROW(toTunnelDirection("left"), invalid_argument);
+}
@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include "seo_graph.hpp"
+#include "lattice_builder.hpp"
+#include "simulation_2d.hpp"
+
+namespace
+{
+    // 4近傍の格子の辺
+    std::vector<GraphEdge> latticeEdges(int rows, int cols, double c)
+    {
+        std::vector<GraphEdge> edges;
+        for (int y = 0; y < rows; ++y)
+            for (int x = 0; x < cols; ++x)
+            {
+                if (x + 1 < cols) edges.push_back({y * cols + x, y * cols + x + 1, c});
+                if (y + 1 < rows) edges.push_back({y * cols + x, (y + 1) * cols + x, c});
+            }
+        return edges;
+    }
+
+    // 輪に近道を足したスモールワールド風のネットワーク(自励振動するパラメータ)
+    SEOGraph makeOscillatingGraph(int n)
+    {
+        std::vector<GraphEdge> edges;
+        for (int i = 0; i < n; ++i)
+        {
+            edges.push_back({i, (i + 1) % n, 2.0});
+            if (i % 5 == 0) edges.push_back({i, (i + n / 3) % n, 1.0});
+        }
+        SEOGraph graph(n, edges, false);
+        for (int i = 0; i < n; ++i)
+        {
+            auto node = graph.getNode(i);
+            node->setUp(0.5, 0.002, 10.0, (i % 2 == 0) ? 0.006 : -0.006);
+            node->setGroundCapacitance(2.0);
+            node->setQ(0.001 * (i % 7));
+        }
+        return graph;
+    }
+}
+
+// CSRの並びと容量
+TEST(SEOGraphTest, BuildsCompressedRows)
+{
+    SEOGraph graph(4, {{0, 1, 1.0}, {2, 0, 2.0}, {1, 3, 3.0}, {0, 1, 0.5}});
+    EXPECT_EQ(graph.numCells(), 4);
+    EXPECT_EQ(graph.numEdges(), 4);
+    EXPECT_EQ(graph.degree(0), 3);
+    EXPECT_EQ(graph.degree(3), 1);
+    EXPECT_EQ(graph.neighbour(0, 0), 1);
+    EXPECT_EQ(graph.neighbour(0, 1), 2);
+    EXPECT_DOUBLE_EQ(graph.edgeCapacitance(0, 1), 2.0);
+    EXPECT_EQ(graph.neighbour(3, 0), 1);
+    EXPECT_THROW(graph.neighbour(3, 1), std::out_of_range);
+
+    graph.getNode(0)->setUp(1.0, 0.001, 10.0, 0.0);
+    graph.getNode(0)->setGroundCapacitance(0.25);
+    // 平行な辺は容量を足したものになる
+    EXPECT_DOUBLE_EQ(graph.getNode(0)->getTotalCapacitance(), 10.0 + 0.25 + 3.5);
+
+    EXPECT_EQ(graph.numRows(), 1);
+    graph.setLayout(2, 2);
+    EXPECT_EQ(graph.getElement(1, 0)->getIndex(), 2);
+    EXPECT_THROW(graph.setLayout(3, 2), std::invalid_argument);
+}
+
+// 不正な辺は例外
+TEST(SEOGraphTest, RejectsInvalidEdges)
+{
+    EXPECT_THROW(SEOGraph(3, {{0, 3, 1.0}}), std::out_of_range);
+    EXPECT_THROW(SEOGraph(3, {{1, 1, 1.0}}), std::invalid_argument);
+    EXPECT_THROW(SEOGraph(3, {{0, 1, 0.0}}), std::invalid_argument);
+    EXPECT_THROW(SEOGraph(0, {}), std::invalid_argument);
+}
+
+// 格子をグラフで組み、余った足を接地容量にすればGrid2D<SEO>と同じになること
+TEST(SEOGraphTest, LatticeMatchesPointerGrid)
+{
+    const int rows = 5, cols = 6;
+    const double c = 2.0;
+    LatticeBuilder builder(rows, cols);
+    builder.setParams({0.5, 0.002, 10.0, c, 0.0044});
+    Grid2D<SEO> pointerGrid = builder.buildPointerGrid();
+    SEOGraph graph(rows * cols, latticeEdges(rows, cols, c));
+    graph.setLayout(rows, cols);
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+        {
+            double q = 0.01 * ((y * cols + x) % 7) - 0.03;
+            pointerGrid.getElement(y, x)->setQ(q);
+
+            auto node = graph.getElement(y, x);
+            node->setUp(0.5, 0.002, 10.0, 0.0044);
+            node->setGroundCapacitance((4 - node->getDegree()) * c);
+            node->setQ(q);
+        }
+    }
+    for (auto method : {RelaxationMethod::Jacobi, RelaxationMethod::RedBlackSOR})
+    {
+        SCOPED_TRACE(static_cast<int>(method));
+        RelaxationConfig config;
+        config.method = method;
+        config.maxIterations = 200;
+        config.tolerance = 1e-14;
+        pointerGrid.relax(config);
+        graph.relax(config);
+        pointerGrid.updateGriddE();
+        graph.updateGriddE();
+        for (int y = 0; y < rows; ++y)
+        {
+            for (int x = 0; x < cols; ++x)
+            {
+                auto p = pointerGrid.getElement(y, x);
+                auto g = graph.getElement(y, x);
+                EXPECT_NEAR(p->getVn(), g->getVn(), 1e-12);
+                EXPECT_NEAR(p->getdE()[TunnelDirection::Up], g->getdE()[TunnelDirection::Up], 1e-12);
+                EXPECT_NEAR(p->getdE()[TunnelDirection::Down], g->getdE()[TunnelDirection::Down], 1e-12);
+            }
+        }
+    }
+    RelaxationConfig direct;
+    direct.method = RelaxationMethod::Direct;
+    EXPECT_THROW(graph.relax(direct), std::invalid_argument);
+}
+
+// Simulation2Dで回せて、スレッド数によらず同じ経過になること
+TEST(SEOGraphTest, RunsInSimulationDeterministically)
+{
+    std::vector<std::vector<double>> finalQ;
+    for (int threads : {1, 3})
+    {
+        Simulation2D<GraphSEO> sim(0.1, 30.0);
+        sim.setThreadCount(threads);
+        SEOGraph &graph = sim.appendGrid(makeOscillatingGraph(53));
+        graph.seedRandom(7);
+        sim.run();
+        std::vector<double> q;
+        for (int i = 0; i < graph.numCells(); ++i)
+            q.push_back(graph.getNode(i)->getQ());
+        finalQ.push_back(q);
+    }
+    EXPECT_EQ(finalQ[0], finalQ[1]);
+
+    // トンネルが起きていること
+    SEOGraph graph = makeOscillatingGraph(53);
+    graph.seedRandom(7);
+    int tunnels = 0;
+    for (int s = 0; s < 300; ++s)
+    {
+        graph.relax(RelaxationConfig());
+        graph.updateGriddE();
+        bool tunnel = graph.gridminwt(0.1);
+        if (tunnel)
+        {
+            graph.applyTunnel(graph.getTunnelIndex(), graph.getTunnelDirection());
+            ++tunnels;
+        }
+        graph.updateGridQn(tunnel ? graph.getMinWT() : 0.1);
+    }
+    EXPECT_GT(tunnels, 0);
+}
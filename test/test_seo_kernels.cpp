@@ -0,0 +1,457 @@
+#include "gtest/gtest.h"
+#include <random>
+#include <cmath>
+#include "philox.hpp"
+#include "seo_kernels.hpp"
+#include "flat_seo_grid.hpp"
+
+namespace
+{
+    // このCPUで使える命令セット
+    std::vector<SimdLevel> supportedLevels()
+    {
+        std::vector<SimdLevel> levels;
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512})
+            if (isSimdLevelSupported(level))
+                levels.push_back(level);
+        return levels;
+    }
+
+    // カーネルの入力(ランダムなSEOの状態)
+    struct KernelInput
+    {
+        std::vector<double> Qn, Vsum, C, Cj, Rj, expo;
+        std::vector<int> legs;
+
+        explicit KernelInput(int n, unsigned int seed)
+        {
+            std::mt19937 mt(seed);
+            std::uniform_real_distribution<double> q(-0.15, 0.15), v(-0.05, 0.05), u(0.0, 1.0);
+            for (int i = 0; i < n; ++i)
+            {
+                Qn.push_back(q(mt));
+                Vsum.push_back(v(mt));
+                C.push_back(1.0 + u(mt));
+                Cj.push_back(5.0 + 10.0 * u(mt));
+                Rj.push_back(0.001 + 0.002 * u(mt));
+                expo.push_back(-std::log(1.0 - u(mt)));
+                legs.push_back(2 + i % 3);
+            }
+        }
+    };
+}
+
+// 全ての命令セットで、範囲内だけがスカラー版とビット単位で同じ結果になること
+TEST(SEOKernelsTest, MatchScalarBitwise)
+{
+    const int n = 45, first = 3, last = 42;
+    KernelInput in(n, 11);
+    const SEOKernelTable &scalar = seoKernels(SimdLevel::Scalar);
+
+    std::vector<double> vnRef(n, -1.0), dERef(2 * n, -1.0), wtRef(2 * n, -1.0);
+    scalar.nodeVoltage(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), vnRef.data(), first, last);
+    scalar.energyChange(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), dERef.data(), first, last);
+    WaitTimeMin minRef = scalar.waitTimeArgmin(dERef.data(), in.Rj.data(), in.expo.data(), wtRef.data(), first, last);
+    ASSERT_GE(minRef.index, first);
+
+    for (SimdLevel level : supportedLevels())
+    {
+        SCOPED_TRACE(simdLevelName(level));
+        const SEOKernelTable &k = seoKernels(level);
+        EXPECT_EQ(k.level, level);
+        std::vector<double> vn(n, -1.0), dE(2 * n, -1.0), wt(2 * n, -1.0);
+        k.nodeVoltage(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), vn.data(), first, last);
+        k.energyChange(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), dE.data(), first, last);
+        WaitTimeMin found = k.waitTimeArgmin(dE.data(), in.Rj.data(), in.expo.data(), wt.data(), first, last);
+        for (int i = 0; i < n; ++i)
+            EXPECT_EQ(vn[i], vnRef[i]) << i;
+        for (int i = 0; i < 2 * n; ++i)
+        {
+            EXPECT_EQ(dE[i], dERef[i]) << i;
+            EXPECT_EQ(wt[i], wtRef[i]) << i;
+        }
+        EXPECT_EQ(found.index, minRef.index);
+        EXPECT_EQ(found.wt, minRef.wt);
+    }
+}
+
+// 単精度のカーネルも全ての命令セットでスカラー版とビット単位で同じになり、倍精度の結果と丸め誤差の範囲で一致すること
+TEST(SEOKernelsTest, FloatKernelsMatchScalarBitwise)
+{
+    const int n = 77, first = 3, last = 74; // 16素子ずつの本体と端数の両方を通る
+    KernelInput in(n, 23);
+    auto toFloat = [](const std::vector<double> &v) { return std::vector<float>(v.begin(), v.end()); };
+    const std::vector<float> Qn = toFloat(in.Qn), Vsum = toFloat(in.Vsum), C = toFloat(in.C), Cj = toFloat(in.Cj),
+                             Rj = toFloat(in.Rj), expo = toFloat(in.expo);
+    const SEOKernelTable &scalar = seoKernels(SimdLevel::Scalar);
+
+    std::vector<float> vnRef(n, -1.0f), dERef(2 * n, -1.0f), wtRef(2 * n, -1.0f);
+    scalar.nodeVoltageFloat(Qn.data(), Vsum.data(), C.data(), Cj.data(), in.legs.data(), vnRef.data(), first, last);
+    scalar.energyChangeFloat(Qn.data(), Vsum.data(), C.data(), Cj.data(), in.legs.data(), dERef.data(), first, last);
+    WaitTimeMin minRef = scalar.waitTimeArgminFloat(dERef.data(), Rj.data(), expo.data(), wtRef.data(), first, last);
+    ASSERT_GE(minRef.index, first);
+
+    std::vector<double> vnDouble(n), dEDouble(2 * n);
+    scalar.nodeVoltage(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), vnDouble.data(), first, last);
+    scalar.energyChange(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), dEDouble.data(), first, last);
+    for (int i = first; i < last; ++i)
+    {
+        EXPECT_NEAR(vnRef[i], vnDouble[i], 1e-6) << i;
+        EXPECT_NEAR(dERef[2 * i], dEDouble[2 * i], 1e-6) << i;
+    }
+
+    const std::uint64_t seed = 99, streamBase = 7;
+    std::vector<float> drawRef(n, -1.0f);
+    std::vector<std::uint64_t> counterRef(n, 5);
+    scalar.exponentialDrawFloat(dERef.data(), seed, streamBase, counterRef.data(), drawRef.data(), first, last);
+    for (int i = first; i < last; ++i)
+    {
+        const bool drawn = dERef[2 * i] > 0 || dERef[2 * i + 1] > 0;
+        EXPECT_EQ(drawRef[i], drawn ? static_cast<float>(exponentialVariate(seed, streamBase + i, 5)) : -1.0f) << i;
+    }
+
+    for (SimdLevel level : supportedLevels())
+    {
+        SCOPED_TRACE(simdLevelName(level));
+        const SEOKernelTable &k = seoKernels(level);
+        std::vector<float> vn(n, -1.0f), dE(2 * n, -1.0f), wt(2 * n, -1.0f), draw(n, -1.0f);
+        std::vector<std::uint64_t> counter(n, 5);
+        k.nodeVoltageFloat(Qn.data(), Vsum.data(), C.data(), Cj.data(), in.legs.data(), vn.data(), first, last);
+        k.energyChangeFloat(Qn.data(), Vsum.data(), C.data(), Cj.data(), in.legs.data(), dE.data(), first, last);
+        WaitTimeMin found = k.waitTimeArgminFloat(dE.data(), Rj.data(), expo.data(), wt.data(), first, last);
+        k.exponentialDrawFloat(dE.data(), seed, streamBase, counter.data(), draw.data(), first, last);
+        EXPECT_EQ(vn, vnRef);
+        EXPECT_EQ(dE, dERef);
+        EXPECT_EQ(wt, wtRef);
+        EXPECT_EQ(draw, drawRef);
+        EXPECT_EQ(counter, counterRef);
+        EXPECT_EQ(found.index, minRef.index);
+        EXPECT_EQ(found.wt, minRef.wt);
+    }
+}
+
+// レプリカ用カーネルも全ての命令セットで範囲内だけがスカラー版とビット単位で同じになり、
+// 素子ごとの式(SEOクラスと同じ)と一致すること
+TEST(SEOKernelsTest, LaneKernelsMatchScalarBitwise)
+{
+    const int n = 7, first = 1, last = 6, legsPerCell = 3;
+    KernelInput in(n, 31);
+    for (int K : {1, 4, 13}) // 13は8レプリカずつの本体と端数の両方を通る
+    {
+        SCOPED_TRACE(K);
+        const std::size_t lanes = static_cast<std::size_t>(n) * K;
+        // 素子iの隣接素子はi-1, i+1, i+3(範囲外は-1)
+        std::vector<int> neighbours;
+        for (int i = 0; i < n; ++i)
+            for (int d : {-1, 1, 3})
+                neighbours.push_back((i + d >= 0 && i + d < n) ? i + d : -1);
+        std::vector<double> R(n, 0.5), Qn(lanes), Vn(lanes), Vext(lanes), Vd(lanes), h(K);
+        for (std::size_t k = 0; k < lanes; ++k)
+        {
+            Qn[k] = in.Qn[k % n] + 0.001 * static_cast<double>(k / n);
+            Vn[k] = in.Vsum[(k + 3) % n];
+            Vext[k] = 0.0001 * static_cast<double>(k % 5);
+            Vd[k] = (k % 2 == 0) ? 0.004 : -0.004;
+        }
+        for (int r = 0; r < K; ++r)
+            h[r] = (r % 5 == 0) ? 0.0 : 0.1 * in.expo[r % n];
+
+        struct LaneOutput
+        {
+            std::vector<double> Vsum, VnNext, residual, dEUp, dEDown, Qn;
+        };
+        auto run = [&](const SEOKernelTable &k) {
+            LaneOutput out{std::vector<double>(lanes, -1.0), std::vector<double>(lanes, -1.0),
+                           std::vector<double>(K, 1e-5),     std::vector<double>(lanes, -1.0),
+                           std::vector<double>(lanes, -1.0), Qn};
+            k.laneNodeVoltage(neighbours.data(), legsPerCell, in.C.data(), in.Cj.data(), in.legs.data(), Qn.data(),
+                              Vn.data(), Vext.data(), out.Vsum.data(), out.VnNext.data(), out.residual.data(), K,
+                              first, last);
+            k.laneEnergyChange(in.C.data(), in.Cj.data(), in.legs.data(), Qn.data(), out.Vsum.data(),
+                               out.dEUp.data(), out.dEDown.data(), K, first, last);
+            k.laneChargeEuler(R.data(), Vd.data(), out.VnNext.data(), h.data(), out.Qn.data(), K, first, last);
+            return out;
+        };
+
+        const LaneOutput ref = run(seoKernels(SimdLevel::Scalar));
+        std::vector<double> residual(K, 1e-5);
+        for (int i = 0; i < n; ++i)
+        {
+            for (int r = 0; r < K; ++r)
+            {
+                const std::size_t k = static_cast<std::size_t>(i) * K + r;
+                if (i < first || i >= last)
+                {
+                    EXPECT_EQ(ref.VnNext[k], -1.0);
+                    EXPECT_EQ(ref.Qn[k], Qn[k]);
+                    continue;
+                }
+                double sum = 0.0;
+                for (int leg = 0; leg < legsPerCell; ++leg)
+                {
+                    const int nb = neighbours[i * legsPerCell + leg];
+                    if (nb >= 0)
+                        sum += Vn[static_cast<std::size_t>(nb) * K + r];
+                }
+                SEO seo;
+                seo.setUp(R[i], in.Rj[i], in.Cj[i], in.C[i], Vd[k], in.legs[i]);
+                seo.setQ(Qn[k]);
+                seo.setVsum(sum + Vext[k]);
+                seo.setPcalc();
+                seo.setdEcalc();
+                EXPECT_EQ(ref.Vsum[k], sum + Vext[k]) << k;
+                EXPECT_DOUBLE_EQ(ref.VnNext[k], seo.getVn()) << k;
+                EXPECT_DOUBLE_EQ(ref.dEUp[k], seo.getdE()[TunnelDirection::Up]) << k;
+                EXPECT_DOUBLE_EQ(ref.dEDown[k], seo.getdE()[TunnelDirection::Down]) << k;
+                EXPECT_EQ(ref.Qn[k], Qn[k] + (Vd[k] - ref.VnNext[k]) * h[r] / R[i]) << k;
+                residual[r] = std::max(residual[r], std::fabs(ref.VnNext[k] - Vn[k]));
+            }
+        }
+        EXPECT_EQ(ref.residual, residual);
+
+        for (SimdLevel level : supportedLevels())
+        {
+            SCOPED_TRACE(simdLevelName(level));
+            const LaneOutput out = run(seoKernels(level));
+            EXPECT_EQ(out.Vsum, ref.Vsum);
+            EXPECT_EQ(out.VnNext, ref.VnNext);
+            EXPECT_EQ(out.residual, ref.residual);
+            EXPECT_EQ(out.dEUp, ref.dEUp);
+            EXPECT_EQ(out.dEDown, ref.dEDown);
+            EXPECT_EQ(out.Qn, ref.Qn);
+        }
+    }
+}
+
+// スカラー版がSEOクラスの式と一致すること
+TEST(SEOKernelsTest, ScalarMatchesSEO)
+{
+    KernelInput in(6, 5);
+    std::vector<double> vn(6), dE(12);
+    const SEOKernelTable &scalar = seoKernels(SimdLevel::Scalar);
+    scalar.nodeVoltage(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), vn.data(), 0, 6);
+    scalar.energyChange(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), dE.data(), 0, 6);
+    for (int i = 0; i < 6; ++i)
+    {
+        SEO seo;
+        seo.setUp(1.0, in.Rj[i], in.Cj[i], in.C[i], 0.0, in.legs[i]);
+        seo.setQ(in.Qn[i]);
+        seo.setVsum(in.Vsum[i]);
+        seo.setPcalc();
+        seo.setdEcalc();
+        EXPECT_DOUBLE_EQ(vn[i], seo.getVn());
+        EXPECT_DOUBLE_EQ(dE[2 * i], seo.getdE()[TunnelDirection::Up]);
+        EXPECT_DOUBLE_EQ(dE[2 * i + 1], seo.getdE()[TunnelDirection::Down]);
+    }
+}
+
+// 同じwtなら添字の小さい方を返し、対象が無ければ-1を返すこと
+TEST(SEOKernelsTest, ArgminTieBreaksByIndex)
+{
+    const int n = 21;
+    std::vector<double> dE(2 * n, -1.0), Rj(n, 0.001), expo(n, 1.0), wt(2 * n);
+    for (SimdLevel level : supportedLevels())
+    {
+        SCOPED_TRACE(simdLevelName(level));
+        const SEOKernelTable &k = seoKernels(level);
+        WaitTimeMin none = k.waitTimeArgmin(dE.data(), Rj.data(), expo.data(), wt.data(), 0, n);
+        EXPECT_EQ(none.index, -1);
+
+        std::vector<double> tied = dE;
+        tied[2 * 13] = 0.01;     // up
+        tied[2 * 6 + 1] = 0.01;  // down
+        tied[2 * 18 + 1] = 0.01; // down
+        WaitTimeMin found = k.waitTimeArgmin(tied.data(), Rj.data(), expo.data(), wt.data(), 0, n);
+        EXPECT_EQ(found.index, 6);
+        EXPECT_EQ(wt[2 * 6], 0.0);
+        EXPECT_GT(wt[2 * 6 + 1], 0.0);
+        EXPECT_GT(wt[2 * 13], 0.0);
+    }
+}
+
+// クラス版のカーネルも全ての命令セットでビット単位で一致し、素子ごとの式と丸め誤差の範囲で一致すること
+TEST(SEOKernelsTest, ClassKernelsMatchScalarBitwise)
+{
+    const int n = 45, first = 3, last = 42;
+    KernelInput in(n, 17);
+    // 3クラス(C, Cj, legs, Rjが違う)
+    const double C[3] = {2.0, 1.5, 2.5}, Cj[3] = {10.0, 8.0, 12.0}, Rj[3] = {0.002, 0.001, 0.003};
+    const int legs[3] = {4, 3, 2};
+    std::vector<double> kc, kinv, keo, khalf, ke2rj;
+    for (int c = 0; c < 3; ++c)
+    {
+        const double ctot = legs[c] * C[c] + Cj[c];
+        kc.push_back(C[c]);
+        kinv.push_back(1.0 / ctot);
+        keo.push_back(e / ctot);
+        khalf.push_back(e * e / (2 * ctot));
+        ke2rj.push_back(e * e * Rj[c]);
+    }
+    const SEOClassCoefficients k{kc.data(), kinv.data(), keo.data(), khalf.data(), ke2rj.data()};
+    std::vector<std::uint16_t> cls(n);
+    for (int i = 0; i < n; ++i)
+    {
+        cls[i] = static_cast<std::uint16_t>((i * 7) % 3);
+        in.C[i] = C[cls[i]];
+        in.Cj[i] = Cj[cls[i]];
+        in.Rj[i] = Rj[cls[i]];
+        in.legs[i] = legs[cls[i]];
+    }
+
+    const SEOKernelTable &scalar = seoKernels(SimdLevel::Scalar);
+    std::vector<double> vnRef(n, -1.0), dERef(2 * n, -1.0), wtRef(2 * n, -1.0);
+    scalar.nodeVoltageClass(in.Qn.data(), in.Vsum.data(), cls.data(), k, vnRef.data(), first, last);
+    scalar.energyChangeClass(in.Qn.data(), in.Vsum.data(), cls.data(), k, dERef.data(), first, last);
+    WaitTimeMin minRef = scalar.waitTimeArgminClass(dERef.data(), cls.data(), k, in.expo.data(), wtRef.data(), first, last);
+    ASSERT_GE(minRef.index, first);
+
+    // 素子ごとの式との比較(wtは同じdEなら同じ値)
+    std::vector<double> vnCell(n), dECell(2 * n), wtCell(2 * n);
+    scalar.nodeVoltage(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), vnCell.data(), first, last);
+    scalar.energyChange(in.Qn.data(), in.Vsum.data(), in.C.data(), in.Cj.data(), in.legs.data(), dECell.data(), first, last);
+    scalar.waitTimeArgmin(dERef.data(), in.Rj.data(), in.expo.data(), wtCell.data(), first, last);
+    for (int i = first; i < last; ++i)
+    {
+        EXPECT_NEAR(vnRef[i], vnCell[i], 1e-15) << i;
+        EXPECT_NEAR(dERef[2 * i], dECell[2 * i], 1e-15) << i;
+        EXPECT_NEAR(dERef[2 * i + 1], dECell[2 * i + 1], 1e-15) << i;
+        EXPECT_EQ(wtRef[2 * i], wtCell[2 * i]) << i;
+        EXPECT_EQ(wtRef[2 * i + 1], wtCell[2 * i + 1]) << i;
+    }
+
+    for (SimdLevel level : supportedLevels())
+    {
+        SCOPED_TRACE(simdLevelName(level));
+        const SEOKernelTable &t = seoKernels(level);
+        std::vector<double> vn(n, -1.0), dE(2 * n, -1.0), wt(2 * n, -1.0);
+        t.nodeVoltageClass(in.Qn.data(), in.Vsum.data(), cls.data(), k, vn.data(), first, last);
+        t.energyChangeClass(in.Qn.data(), in.Vsum.data(), cls.data(), k, dE.data(), first, last);
+        WaitTimeMin found = t.waitTimeArgminClass(dE.data(), cls.data(), k, in.expo.data(), wt.data(), first, last);
+        for (int i = 0; i < n; ++i)
+            EXPECT_EQ(vn[i], vnRef[i]) << i;
+        for (int i = 0; i < 2 * n; ++i)
+        {
+            EXPECT_EQ(dE[i], dERef[i]) << i;
+            EXPECT_EQ(wt[i], wtRef[i]) << i;
+        }
+        EXPECT_EQ(found.index, minRef.index);
+        EXPECT_EQ(found.wt, minRef.wt);
+    }
+}
+
+// 指数分布の乱数のまとめ引きが、全ての命令セットでビット単位で一致し、dEが正の素子だけ進むこと
+TEST(SEOKernelsTest, ExponentialDrawMatchesScalarBitwise)
+{
+    const int n = 53, first = 2, last = 51;
+    std::mt19937 mt(3);
+    std::uniform_real_distribution<double> de(-1.0, 1.0);
+    std::vector<double> dE(2 * n);
+    std::vector<std::uint64_t> counter0(n);
+    for (int i = 0; i < n; ++i)
+    {
+        // upとdownが同時に正にならないようにする(8素子おきに両方負の塊も作る)
+        const double d = (i / 8 % 2 == 1) ? -std::fabs(de(mt)) : de(mt);
+        dE[2 * i] = d;
+        dE[2 * i + 1] = (i % 3 == 0) ? -std::fabs(d) : -d;
+        counter0[i] = (static_cast<std::uint64_t>(mt()) << 20) + i; // 32bitを超える抽選回数も含める
+    }
+    const std::uint64_t seed = 0x0123456789abcdefULL, streamBase = 1000;
+    std::vector<double> expoRef(n, -1.0);
+    std::vector<std::uint64_t> counterRef = counter0;
+    seoKernels(SimdLevel::Scalar)
+        .exponentialDraw(dE.data(), seed, streamBase, counterRef.data(), expoRef.data(), first, last);
+    for (int i = 0; i < n; ++i)
+    {
+        const bool drawn = i >= first && i < last && (dE[2 * i] > 0 || dE[2 * i + 1] > 0);
+        EXPECT_EQ(counterRef[i], counter0[i] + (drawn ? 1 : 0)) << i;
+        if (!drawn)
+        {
+            EXPECT_EQ(expoRef[i], -1.0) << i;
+            continue;
+        }
+        EXPECT_EQ(expoRef[i], exponentialVariate(seed, streamBase + i, counter0[i])) << i;
+        // std::logとの差は丸め誤差程度
+        const double ref = std::log(1 / philoxUniform(seed, streamBase + i, counter0[i]));
+        EXPECT_NEAR(expoRef[i], ref, 1e-15 * std::max(1.0, ref)) << i;
+    }
+
+    for (SimdLevel level : supportedLevels())
+    {
+        SCOPED_TRACE(simdLevelName(level));
+        std::vector<double> expo(n, -1.0);
+        std::vector<std::uint64_t> counter = counter0;
+        seoKernels(level).exponentialDraw(dE.data(), seed, streamBase, counter.data(), expo.data(), first, last);
+        EXPECT_EQ(counter, counterRef);
+        for (int i = 0; i < n; ++i)
+            EXPECT_EQ(expo[i], expoRef[i]) << i;
+    }
+}
+
+// -log(u)が(0, 1]の全域でstd::logと丸め誤差の範囲で一致し、SEOの乱数とも同じ値になること
+TEST(SEOKernelsTest, ExponentialVariateAccuracy)
+{
+    double worst = 0.0;
+    for (std::uint64_t k = 0; k < 200000; ++k)
+    {
+        const double u = philoxUniform(9, 1, k);
+        const double x = exponentialVariate(9, 1, k);
+        const double ref = -std::log(u);
+        ASSERT_FALSE(std::signbit(x));
+        if (ref > 0)
+            worst = std::max(worst, std::fabs(x - ref) / ref);
+    }
+    EXPECT_LT(worst, 4.5e-16);
+
+    SEO seo;
+    seo.setRandomStream(9, 1);
+    EXPECT_EQ(seo.Exponential(), exponentialVariate(9, 1, 0));
+    EXPECT_EQ(seo.getRandomStream().counter, 1u);
+}
+
+// gridをどの命令セットで回しても同じ経過になること
+TEST(SEOKernelsTest, FlatGridMatchesAcrossLevels)
+{
+    std::vector<std::vector<double>> finalQ;
+    for (bool classes : {false, true})
+    for (SimdLevel level : supportedLevels())
+    {
+        SCOPED_TRACE(classes);
+        Grid2D<FlatSEO> grid(9, 13, false);
+        for (int i = 0; i < grid.numCells(); ++i)
+        {
+            auto elem = grid.getElement(i / 13, i % 13);
+            elem->setUp(0.5, 0.002, 10.0, 2.0, (i % 2 == 0) ? 0.006 : -0.006, 4);
+            elem->setQ(0.001 * (i % 7));
+        }
+        grid.setParameterClasses(classes);
+        grid.setSimdLevel(level);
+        EXPECT_EQ(grid.getSimdLevel(), level);
+        grid.seedRandom(5);
+        RelaxationConfig config;
+        int tunnels = 0;
+        for (int s = 0; s < 300; ++s)
+        {
+            grid.relax(config);
+            grid.updateGriddE();
+            bool tunnel = grid.gridminwt(0.1);
+            if (tunnel)
+            {
+                grid.applyTunnel(grid.getTunnelIndex(), grid.getTunnelDirection());
+                ++tunnels;
+            }
+            grid.updateGridQn(tunnel ? grid.getMinWT() : 0.1);
+        }
+        EXPECT_GT(tunnels, 0);
+        std::vector<double> q;
+        for (int i = 0; i < grid.numCells(); ++i)
+            q.push_back(grid.getElement(i / 13, i % 13)->getQ());
+        finalQ.push_back(q);
+    }
+    // 命令セットによらず同じ(パラメータクラスモードはモードの中で同じ)
+    const std::size_t levels = supportedLevels().size();
+    for (std::size_t l = 1; l < levels; ++l)
+    {
+        EXPECT_EQ(finalQ[l], finalQ[0]);
+        EXPECT_EQ(finalQ[levels + l], finalQ[levels]);
+    }
+}
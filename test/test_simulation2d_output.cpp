@@ -2,6 +2,7 @@
 #include "simulation_2d.hpp"
 #include "seo_class.hpp"
 #include "grid_2dim.hpp"
+#include "flat_seo_grid.hpp"
 
 using Sim = Simulation2D<SEO>;
 
@@ -44,7 +45,7 @@ TEST(Simulation2DTest, CompareWtReturnsFalseIfNoTunnel) {
     sim.addGrid({grid});
     auto result = sim.comparewt();
     EXPECT_FALSE(result.first);
-    EXPECT_EQ(result.second, nullptr);
+    EXPECT_EQ(result.second.gridIndex, -1);
 }
 
 TEST(Simulation2DTest, HandleTunnelsModifiesCharge) {
@@ -52,12 +53,31 @@ TEST(Simulation2DTest, HandleTunnelsModifiesCharge) {
     Grid2D<SEO> grid(1, 1);
     auto elem = grid.getElement(0, 0);
     elem->setdE("up", 0.2);
-    elem->calculateTunnelWt();
-    grid.gridminwt(1.0); // tunnelplaceを更新
-    sim.handleTunnels(grid);
+    sim.addGrid({grid});
+
+    TunnelEvent event;
+    event.gridIndex = 0;
+    event.cellIndex = 0;
+    event.direction = TunnelDirection::Up;
+    sim.handleTunnels(event);
     EXPECT_NEAR(elem->getQ(), -0.1602, 1e-4); // e = 0.1602
 }
 
+TEST(Simulation2DTest, CompareWtReportsTunnelEvent) {
+    Sim sim(1e9, 1e10); // dtを大きくして必ずトンネルさせる
+    Grid2D<SEO> grid(1, 2);
+    grid.getElement(0, 1)->setUp(1, 1, 1, 1, 0, 0);
+    grid.getElement(0, 1)->setdE("down", 0.2);
+    sim.appendGrid(std::move(grid));
+
+    auto result = sim.comparewt();
+    ASSERT_TRUE(result.first);
+    EXPECT_EQ(result.second.gridIndex, 0);
+    EXPECT_EQ(result.second.cellIndex, 1);
+    EXPECT_EQ(result.second.direction, TunnelDirection::Down);
+    EXPECT_DOUBLE_EQ(result.second.wt, sim.getGrids()[0].getMinWT());
+}
+
 TEST(Simulation2DTest, RunStepIncrementsTime) {
     Sim sim(0.01, 1.0);
     Grid2D<SEO> grid(3, 3);
@@ -78,3 +98,80 @@ TEST(Simulation2DTest, RunTerminatesAtEndtime) {
     ASSERT_TRUE(outputs.find("test") != outputs.end()); // ラベルがあること
     EXPECT_GE(outputs.at("test").size(), 2); // 出力時刻2回以上
 }
+
+TEST(Simulation2DTest, RelaxationPolicyReportsIterations) {
+    Sim sim(0.01, 1.0);
+    Grid2D<SEO> grid(3, 3);
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            grid.getElement(i, j)->setUp(0.5, 0.002, 10.0, 2.0, 0.004, 4);
+    sim.addGrid({grid});
+
+    sim.runStep();
+    ASSERT_EQ(sim.getRelaxationStats().size(), 1u);
+    EXPECT_EQ(sim.getRelaxationStats()[0].iterations, 5); // デフォルトはJacobi法5回
+
+    RelaxationConfig config;
+    config.method = RelaxationMethod::RedBlackSOR;
+    config.maxIterations = 20;
+    config.tolerance = 1e-9;
+    sim.setRelaxation(config);
+    sim.runStep();
+    EXPECT_LE(sim.getRelaxationStats()[0].iterations, 20);
+    EXPECT_EQ(sim.getTotalRelaxationIterations(), 5 + sim.getRelaxationStats()[0].iterations);
+
+    config.omega = 2.5;
+    EXPECT_THROW(sim.setRelaxation(config), std::invalid_argument);
+}
+
+TEST(Simulation2DTest, VoltageTriggersResolveAgainstRegisteredGrids) {
+    Simulation2D<FlatSEO> sim(0.1, 1.0);
+    Grid2D<FlatSEO> grid(2, 3, false);
+    sim.addGrid({grid});
+    // Grid2D<FlatSEO>はコピーで素子の配列も複製するので、コピー元のgridへのトリガは受け付けない
+    EXPECT_THROW(sim.addVoltageTrigger(0.0, &grid, 1, 1, 0.05), std::invalid_argument);
+    EXPECT_THROW(sim.addVoltageTrigger(0.0, -1, 1, 1, 0.05), std::invalid_argument);
+
+    // 番号で指定したトリガは、後からgridを追加して配列が移動しても登録されたgridに加わる
+    sim.addVoltageTrigger(0.0, 0, 1, 1, 0.05);
+    sim.addVoltageTrigger(0.0, &sim.getGrids()[0], 2, 0, 0.03);
+    sim.addVoltageTrigger(0.0, 1, 0, 0, 0.02);
+    sim.appendGrid(Grid2D<FlatSEO>(2, 2, false));
+    sim.applyVoltageTriggers();
+    EXPECT_DOUBLE_EQ(sim.getGrids()[0].getElement(1, 1)->getExternalVoltage(), 0.05);
+    EXPECT_DOUBLE_EQ(sim.getGrids()[0].getElement(0, 2)->getExternalVoltage(), 0.03);
+    EXPECT_DOUBLE_EQ(sim.getGrids()[1].getElement(0, 0)->getExternalVoltage(), 0.02);
+
+    sim.addVoltageTrigger(0.0, 5, 0, 0, 0.02);
+    EXPECT_THROW(sim.applyVoltageTriggers(), std::invalid_argument);
+}
+
+// appendGridの戻り値は、後から何個gridを追加しても登録されたgridを指したままであること
+TEST(Simulation2DTest, AppendGridReferencesStayValid) {
+    Simulation2D<FlatSEO> sim(0.1, 1.0);
+    Grid2D<FlatSEO> &first = sim.appendGrid(Grid2D<FlatSEO>(2, 2, false));
+    for (int g = 0; g < 40; ++g)
+        sim.appendGrid(Grid2D<FlatSEO>(3, 3, false));
+    first.getElement(1, 0)->setQ(0.02);
+    EXPECT_EQ(&first, &sim.getGrids()[0]);
+    EXPECT_DOUBLE_EQ(sim.getGrids()[0].getElement(1, 0)->getQ(), 0.02);
+    sim.addVoltageTrigger(0.0, &first, 1, 1, 0.04);
+    sim.applyVoltageTriggers();
+    EXPECT_DOUBLE_EQ(first.getElement(1, 1)->getExternalVoltage(), 0.04);
+}
+
+// 従来の使い方: Grid2D<SEO>をaddGrid({grid})で登録し、コピー元の&gridにトリガを付ける
+// (コピーは素子を共有するので、登録されたgridの同じ素子に加わる)
+TEST(Simulation2DTest, PointerGridTriggerOnCopySource) {
+    Simulation2D<SEO> sim(0.1, 1.0);
+    Grid2D<SEO> grid(2, 3, false);
+    sim.addGrid({grid});
+    sim.addVoltageTrigger(0.0, &grid, 2, 1, 0.05);
+    sim.applyVoltageTriggers();
+    EXPECT_DOUBLE_EQ(grid.getElement(1, 2)->getExternalVoltage(), 0.05);
+    EXPECT_DOUBLE_EQ(sim.getGrids()[0].getElement(1, 2)->getExternalVoltage(), 0.05);
+
+    // 素子を共有しないgridは登録されていないので例外
+    Grid2D<SEO> other(2, 3, false);
+    EXPECT_THROW(sim.addVoltageTrigger(0.0, &other, 0, 0, 0.05), std::invalid_argument);
+}
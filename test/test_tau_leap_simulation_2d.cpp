@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include "tau_leap_simulation_2d.hpp"
+#include "test_lattices.hpp"
+
+using test_lattices::makeOscillatingGrid;
+
+namespace
+{
+    // 終了までのステップ数
+    template <typename Sim>
+    int runCountingSteps(Sim &sim, double endtime)
+    {
+        int steps = 0;
+        while (sim.getTime() < endtime)
+        {
+            sim.runStep();
+            ++steps;
+        }
+        return steps;
+    }
+}
+
+// 厳密なエンジンと同じくらいの頻度でトンネルし、ステップ数は少ないこと
+TEST(TauLeapSimulation2DTest, MatchesExactTunnelStatistics)
+{
+    const double endtime = 100.0;
+    Simulation2D<FlatSEO> exact(0.1, endtime);
+    exact.setSeed(1);
+    exact.appendGrid(makeOscillatingGrid(20, 20));
+    const int exactSteps = runCountingSteps(exact, endtime);
+
+    TauLeapSimulation2D<FlatSEO> leap(0.1, endtime);
+    leap.setSeed(1);
+    leap.appendGrid(makeOscillatingGrid(20, 20));
+    const int leapSteps = runCountingSteps(leap, endtime);
+
+    ASSERT_GT(exact.getTunnelCount(), 1000);
+    // 乱数によるばらつき(シードを変えると数%)より大きくずれないこと
+    EXPECT_NEAR(static_cast<double>(leap.getTunnelCount()) / exact.getTunnelCount(), 1.0, 0.1);
+    EXPECT_GT(leap.getMaxTunnelsPerLeap(), 1);
+    EXPECT_GT(leap.getMeanTunnelsPerLeap(), 0.0);
+    EXPECT_GT(leap.getMeanLeapTime(), 0.0);
+    EXPECT_LE(leap.getMeanLeapTime(), 0.1);
+    EXPECT_LT(leapSteps * 3, exactSteps * 2);
+}
+
+// 同じシードなら、スレッド数によらず同じ経過になること
+TEST(TauLeapSimulation2DTest, ThreadIndependent)
+{
+    std::vector<std::vector<double>> finalQ;
+    std::vector<long long> tunnels;
+    for (int threads : {1, 3})
+    {
+        TauLeapSimulation2D<FlatSEO> sim(0.1, 30.0);
+        sim.setThreadCount(threads);
+        sim.setSeed(11);
+        sim.appendGrid(makeOscillatingGrid(9, 9));
+        sim.appendGrid(makeOscillatingGrid(5, 5));
+        sim.run();
+        std::vector<double> q;
+        for (auto &grid : sim.getGrids())
+            for (int i = 0; i < grid.numCells(); ++i)
+                q.push_back(grid.getElement(i / grid.numCols(), i % grid.numCols())->getQ());
+        finalQ.push_back(q);
+        tunnels.push_back(sim.getTunnelCount());
+    }
+    EXPECT_GT(tunnels[0], 0);
+    EXPECT_EQ(tunnels[0], tunnels[1]);
+    EXPECT_EQ(finalQ[0], finalQ[1]);
+}
+
+// トンネルしうる素子が無ければdtずつ進み、リープとして数えないこと
+TEST(TauLeapSimulation2DTest, QuietGridAdvancesByDt)
+{
+    TauLeapSimulation2D<FlatSEO> sim(0.1, 1.0);
+    Grid2D<FlatSEO> &grid = sim.appendGrid(Grid2D<FlatSEO>(3, 3, false));
+    for (int i = 0; i < 9; ++i)
+        grid.getElement(i / 3, i % 3)->setUp(0.5, 0.002, 10.0, 2.0, 0.001);
+    sim.runStep();
+    EXPECT_DOUBLE_EQ(sim.getTime(), 0.1);
+    EXPECT_EQ(sim.getLeapCount(), 0);
+    EXPECT_EQ(sim.getTunnelCount(), 0);
+    EXPECT_EQ(sim.getMeanTunnelsPerLeap(), 0.0);
+}
+
+// 誤差の目安は(0, 1)のみ
+TEST(TauLeapSimulation2DTest, ToleranceValidation)
+{
+    EXPECT_THROW(TauLeapSimulation2D<FlatSEO>(0.1, 1.0, 0.0), std::invalid_argument);
+    TauLeapSimulation2D<FlatSEO> sim(0.1, 1.0);
+    EXPECT_DOUBLE_EQ(sim.getTolerance(), 0.2);
+    EXPECT_THROW(sim.setTolerance(1.0), std::invalid_argument);
+    sim.setTolerance(0.3);
+    EXPECT_DOUBLE_EQ(sim.getTolerance(), 0.3);
+}